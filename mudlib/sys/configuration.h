@@ -18,12 +18,17 @@
 #define IC_PROMPT                        9
 #define IC_MAX_COMMANDS                 10
 #define IC_MODIFY_COMMAND               11
+#define IC_MCCP_LEVEL                   12
+#define IC_MCCP_WINDOW_BITS             13
+#define IC_MCCP_MEM_LEVEL               14
 
 /* Possible options for configure_object().
  */
 #define OC_COMMANDS_ENABLED    0
 #define OC_HEART_BEAT          1
 #define OC_EUID                2
+#define OC_IDS                 3
+#define OC_HEART_BEAT_INTERVAL 4
 
 /* Possible options for configure_driver().
  */
@@ -37,5 +42,13 @@
 #define DC_EXTRA_WIZINFO_SIZE            7
 #define DC_DEFAULT_RUNTIME_LIMITS        8
 #define DC_SWAP_COMPACT_MODE             9
+#define DC_PROFILE_SAMPLING_RATE        10
+#define DC_FUNCTION_PROFILING           11
+#define DC_DATA_CLEAN_SLICE_TIME        12
+#define DC_REGEX_CACHE_SIZE             13
+#define DC_SWAP_TIME                    14
+#define DC_SWAP_VAR_TIME                15
+#define DC_IP_NAME_TTL                  16
+#define DC_IP_NAME_FAILED_TTL           17
 
 #endif /* LPC_CONFIGURATION_H_ */
@@ -31,6 +31,11 @@
 #define DI_TRACE_LAST_UNCAUGHT_ERROR                         -45
 #define DI_TRACE_LAST_UNCAUGHT_ERROR_AS_STRING               -46
 
+/* Profiling */
+#define DI_PROFILE_SAMPLES                                   -50
+#define DI_NUM_PROFILE_SAMPLES                               -51
+#define DI_FUNCTION_PROFILE                                  -52
+
 /* LPC Runtime statistics */
 #define DI_NUM_FUNCTION_NAME_CALLS                          -100
 #define DI_NUM_FUNCTION_NAME_CALL_HITS                      -101
@@ -41,6 +46,9 @@
 #define DI_NUM_HEARTBEAT_TOTAL_CYCLES                       -104
 #define DI_NUM_HEARTBEAT_ACTIVE_CYCLES                      -105
 #define DI_NUM_HEARTBEATS_LAST_PROCESSED                    -106
+#define DI_HEARTBEAT_WHEEL_OBJECTS                          -107
+#define DI_HEARTBEAT_WHEEL_LAST_PROCESSED                   -108
+#define DI_HEARTBEAT_WHEEL_LAST_TIME                        -109
 
 #define DI_NUM_STRING_TABLE_STRINGS_ADDED                   -110
 #define DI_NUM_STRING_TABLE_STRINGS_REMOVED                 -111
@@ -51,11 +59,29 @@
 #define DI_NUM_STRING_TABLE_HITS_BY_VALUE                   -116
 #define DI_NUM_STRING_TABLE_HITS_BY_INDEX                   -117
 #define DI_NUM_STRING_TABLE_COLLISIONS                      -118
+#define DI_STRING_TABLE_CHAIN_LENGTHS                       -119
 
 #define DI_NUM_REGEX_LOOKUPS                                -120
 #define DI_NUM_REGEX_LOOKUP_HITS                            -121
 #define DI_NUM_REGEX_LOOKUP_MISSES                          -122
 #define DI_NUM_REGEX_LOOKUP_COLLISIONS                      -123
+#define DI_NUM_REGEX_LOOKUP_EVICTIONS                       -124
+#define DI_NUM_REGEX_JIT_COMPILES                           -125
+
+#define DI_NUM_CALLOUT_LOOKUPS                              -130
+#define DI_NUM_CALLOUT_LOOKUP_STEPS                         -131
+#define DI_NUM_CALLOUTS_REMOVED_BY_DESTRUCT                 -132
+
+#define DI_NUM_OBJECTS_IN_RESET_QUEUE                       -140
+#define DI_NUM_OBJECTS_IN_CLEAN_UP_QUEUE                    -141
+#define DI_NUM_OBJECTS_IN_DATA_CLEANUP_QUEUE                -142
+#define DI_NUM_OBJECTS_IN_SWAP_QUEUE                        -143
+
+#define DI_GC_PAUSE_HISTOGRAM                               -150
+#define DI_DATA_CLEAN_PAUSE_HISTOGRAM                       -151
+
+#define DI_NUM_CYCLE_ROOTS                                  -152
+#define DI_NUM_CYCLE_GARBAGE_FREED                          -153
 
 /* Network statistics */
 #define DI_NUM_MESSAGES_OUT                                 -200
@@ -64,12 +90,23 @@
 #define DI_SIZE_PACKETS_OUT                                 -203
 #define DI_SIZE_PACKETS_IN                                  -204
 
+#define DI_NUM_IP_NAME_LOOKUP_HITS                          -210
+#define DI_NUM_IP_NAME_LOOKUP_MISSES                        -211
+#define DI_NUM_IP_NAME_REQUESTS                             -212
+#define DI_NUM_IP_NAME_REQUESTS_FAILED                      -213
+#define DI_NUM_IP_NAMES                                     -214
+#define DI_NUM_IP_NAME_TABLE_SLOTS                          -215
+
 /* Load */
 #define DI_LOAD_AVERAGE_COMMANDS                            -300
 #define DI_LOAD_AVERAGE_LINES                               -301
 #define DI_LOAD_AVERAGE_PROCESSED_OBJECTS                   -302
 #define DI_LOAD_AVERAGE_PROCESSED_OBJECTS_RELATIVE          -303
 #define DI_LOAD_AVERAGE_PROCESSED_HEARTBEATS_RELATIVE       -304
+#define DI_LOAD_AVERAGE_RESET_LATENESS                      -305
+#define DI_LOAD_AVERAGE_CLEAN_UP_LATENESS                   -306
+#define DI_LOAD_AVERAGE_DATA_CLEANUP_LATENESS               -307
+#define DI_LOAD_AVERAGE_SWAP_LATENESS                       -308
 
 /* Memory use statistics */
 #define DI_NUM_ACTIONS                                      -400
@@ -137,6 +174,12 @@
 #define DI_SIZE_SWAP_BLOCKS_FREE                            -508
 #define DI_SIZE_SWAP_BLOCKS_REUSED                          -509
 #define DI_SWAP_RECYCLE_PHASE                               -510
+#define DI_NUM_SWAP_WRITES_QUEUED                           -511
+#define DI_SIZE_SWAP_WRITES_QUEUED                          -512
+#define DI_NUM_SWAP_READS_QUEUED                            -513
+#define DI_NUM_SWAP_PREFETCHES                              -514
+#define DI_SWAP_WRITE_LATENCY                               -515
+#define DI_SWAP_READ_LATENCY                                -516
 
 /* Memory allocator statistics */
 #define DI_MEMORY_ALLOCATOR_NAME                            -600
@@ -235,4 +278,15 @@
 #define TRACE_TYPE_LAMBDA  3
 #define TRACE_TYPE_LFUN    4
 
+/* Indices into the entries of the DI_FUNCTION_PROFILE result */
+#define FUNCTION_PROFILE_PROGRAM     0  /* Name of the program */
+#define FUNCTION_PROFILE_FUNCTION    1  /* Name of the function */
+#define FUNCTION_PROFILE_CALLS       2  /* Number of calls */
+#define FUNCTION_PROFILE_COST        3  /* Eval cost including callees */
+#define FUNCTION_PROFILE_EXCL_COST   4  /* Eval cost excluding callees */
+#define FUNCTION_PROFILE_TIME        5  /* Time in microseconds incl. callees */
+#define FUNCTION_PROFILE_EXCL_TIME   6  /* Time in microseconds excl. callees */
+
+#define FUNCTION_PROFILE_MAX         7  /* Size of each entry */
+
 #endif /* LPC_DRIVER_INFO_H_ */
@@ -71,6 +71,7 @@
 #include "sent.h"
 #include "simulate.h"
 #include "svalue.h"
+#include "swap.h"
 #include "wiz_list.h"
 #include "xalloc.h"
 
@@ -83,6 +84,19 @@
 #error MAX_COMMAND_LENGTH has to be > 0!
 #endif
 
+#define ACTION_INDEX_THRESHOLD 32
+  /* Objects with this many actions get an action index for the
+   * command search.
+   */
+
+#define ACTION_INDEX_MIN_SIZE 16
+  /* Minimum size of the hash table of an action index.
+   */
+
+#define ACTION_TABLE_CACHE_SIZE 256
+  /* Size of the hash table of cached action tables, a power of 2.
+   */
+
 /*-------------------------------------------------------------------------*/
 
 
@@ -107,6 +121,32 @@ struct command_context_s
     object_t * errobj;       /* object which set the error message */
 };
 
+/* --- struct action_table_s: the declared actions of a program ---
+ *
+ * The table holds the actions a program declares with its lfun
+ * action_table(), in the order given there. It is cached in
+ * action_tables[] until the program is freed.
+ */
+
+typedef struct declared_action_s declared_action_t;
+typedef struct action_table_s action_table_t;
+
+struct declared_action_s
+{
+    string_t *verb;            /* The verb, tabled */
+    string_t *fun;             /* The function to call, tabled */
+    unsigned char type;        /* The sentence type */
+    unsigned short short_verb; /* SENT_SHORT_VERB: minimum length */
+};
+
+struct action_table_s
+{
+    action_table_t *next;           /* Next table in the hash chain */
+    int32 id;                       /* Id number of the program */
+    int num_actions;                /* Number of declared actions */
+    declared_action_t actions[];    /* The declared actions */
+};
+
 /*-------------------------------------------------------------------------*/
 
 /* All the following variables constitute the runtime context for a command,
@@ -159,6 +199,14 @@ p_int alloc_action_sent = 0;
   /* Statistic: how many action sentences have been allocated.
    */
 
+static p_uint action_seq = 0;
+  /* The sequence number of the last added action.
+   */
+
+static action_table_t *action_tables[ACTION_TABLE_CACHE_SIZE];
+  /* The cache of the action tables, hashed by program id.
+   */
+
 /*-------------------------------------------------------------------------*/
 void
 free_action_temporaries (void)
@@ -233,6 +281,464 @@ void free_action_sent (action_t *p)
 
 #define free_action_sent(p) _free_action_sent(p)
 
+/*-------------------------------------------------------------------------*/
+void
+free_action_index (object_t *ob)
+
+/* Free the action index of <ob>, if any.
+ */
+
+{
+    if (ob->action_index)
+    {
+        xfree(ob->action_index);
+        ob->action_index = NULL;
+    }
+} /* free_action_index() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE action_t **
+index_chain (action_index_t *index, action_t *p)
+
+/* Return the chain of <index> the action <p> belongs into.
+ */
+
+{
+    if (p->sent.type != SENT_PLAIN)
+        return &index->wild;
+    return &index->table[mstr_get_hash(p->verb) & (index->size - 1)];
+} /* index_chain() */
+
+/*-------------------------------------------------------------------------*/
+static void
+build_action_index (object_t *ob, p_int num)
+
+/* (Re)Build the action index of <ob>, which holds <num> actions.
+ * If the memory for the index can't be allocated, <ob> just goes
+ * without.
+ */
+
+{
+    action_index_t *index;
+    sentence_t *s;
+    action_t *p, **chain;
+    p_int size, i;
+
+    for (size = ACTION_INDEX_MIN_SIZE; size < num; size *= 2) NOOP;
+
+    free_action_index(ob);
+    index = xalloc(sizeof(*index) + (size - 1) * sizeof(index->table[0]));
+    if (!index)
+        return;
+
+    index->num_actions = 0;
+    index->size = size;
+    index->wild = NULL;
+    for (i = 0; i < size; i++)
+        index->table[i] = NULL;
+
+    /* Put every action at the front of its chain... */
+    for (s = ob->sent; s; s = s->next)
+    {
+        if (SENT_IS_INTERNAL(s->type))
+            continue;
+
+        p = (action_t *)s;
+        chain = index_chain(index, p);
+        p->index_next = *chain;
+        *chain = p;
+        index->num_actions++;
+    }
+
+    /* ...and then turn all chains around to get the list order. */
+    for (i = -1; i < size; i++)
+    {
+        action_t *prev = NULL;
+
+        chain = i < 0 ? &index->wild : &index->table[i];
+        for (p = *chain; p; )
+        {
+            action_t *next = p->index_next;
+
+            p->index_next = prev;
+            if (prev)
+                prev->index_prev = p;
+            prev = p;
+            p = next;
+        }
+        if (prev)
+            prev->index_prev = NULL;
+        *chain = prev;
+    }
+
+    ob->action_index = index;
+} /* build_action_index() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE void
+index_action (object_t *ob, action_t *p)
+
+/* Add the new action <p>, which was put in front of all other actions
+ * of <ob>, to the action index of <ob>, if there is one.
+ */
+
+{
+    action_index_t *index = ob->action_index;
+    action_t **chain;
+
+    if (!index)
+        return;
+
+    if (index->num_actions >= 2 * index->size)
+    {
+        build_action_index(ob, index->num_actions + 1);
+        return;
+    }
+
+    chain = index_chain(index, p);
+    p->index_prev = NULL;
+    p->index_next = *chain;
+    if (*chain)
+        (*chain)->index_prev = p;
+    *chain = p;
+    index->num_actions++;
+} /* index_action() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE void
+unindex_action (object_t *ob, action_t *p)
+
+/* Remove the action <p> of <ob> from the action index of <ob>, if there
+ * is one. The index is freed with its last action.
+ */
+
+{
+    action_index_t *index = ob->action_index;
+
+    if (!index || SENT_IS_INTERNAL(p->sent.type))
+        return;
+
+    if (p->index_prev)
+        p->index_prev->index_next = p->index_next;
+    else
+        *index_chain(index, p) = p->index_next;
+    if (p->index_next)
+        p->index_next->index_prev = p->index_prev;
+
+    if (--index->num_actions == 0)
+        free_action_index(ob);
+} /* unindex_action() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE void
+move_indexed_action (object_t *ob, action_t *p)
+
+/* The action <p> of <ob> has been copied into new storage: update
+ * the chain in the action index.
+ */
+
+{
+    action_index_t *index = ob->action_index;
+
+    if (!index || SENT_IS_INTERNAL(p->sent.type))
+        return;
+
+    if (p->index_prev)
+        p->index_prev->index_next = p;
+    else
+        *index_chain(index, p) = p;
+    if (p->index_next)
+        p->index_next->index_prev = p;
+} /* move_indexed_action() */
+
+/*-------------------------------------------------------------------------*/
+/* The declared actions.
+ *
+ * Instead of adding its actions in init(), a program may declare them
+ * in the lfun action_table(). The table is queried once per program and
+ * kept in a cache hashed by the program id; the command search consults
+ * it for the objects in the vicinity of the command giver after all
+ * actions added with add_action().
+ */
+
+static INLINE action_table_t *
+lookup_action_table (int32 id)
+
+/* Return the cached action table of the program with <id>, or NULL
+ * if there is none.
+ */
+
+{
+    action_table_t *table;
+
+    for ( table = action_tables[id & (ACTION_TABLE_CACHE_SIZE - 1)]
+        ; table && table->id != id
+        ; table = table->next) NOOP;
+    return table;
+} /* lookup_action_table() */
+
+/*-------------------------------------------------------------------------*/
+static void
+free_action_table (action_table_t *table)
+
+/* Free the action table <table>, which is not in the cache anymore.
+ */
+
+{
+    int i;
+
+    for (i = 0; i < table->num_actions; i++)
+    {
+        free_mstring(table->actions[i].verb);
+        free_mstring(table->actions[i].fun);
+    }
+    xfree(table);
+} /* free_action_table() */
+
+/*-------------------------------------------------------------------------*/
+void
+forget_action_table (program_t *prog)
+
+/* The program <prog> is freed: remove its action table from the cache.
+ */
+
+{
+    action_table_t **tablep, *table;
+
+    for ( tablep = &action_tables[prog->id_number & (ACTION_TABLE_CACHE_SIZE - 1)]
+        ; NULL != (table = *tablep)
+        ; tablep = &table->next)
+    {
+        if (table->id == prog->id_number)
+        {
+            *tablep = table->next;
+            free_action_table(table);
+            return;
+        }
+    }
+} /* forget_action_table() */
+
+/*-------------------------------------------------------------------------*/
+void
+clear_action_tables (void)
+
+/* Empty the cache of action tables, e.g. because the program ids
+ * changed.
+ */
+
+{
+    int i;
+
+    for (i = 0; i < ACTION_TABLE_CACHE_SIZE; i++)
+    {
+        action_table_t *table;
+
+        while (NULL != (table = action_tables[i]))
+        {
+            action_tables[i] = table->next;
+            free_action_table(table);
+        }
+    }
+} /* clear_action_tables() */
+
+#ifdef GC_SUPPORT
+
+/*-------------------------------------------------------------------------*/
+void
+count_action_table_refs (void)
+
+/* GC support: Mark all memory referenced from the action table cache.
+ */
+
+{
+    int i, j;
+
+    for (i = 0; i < ACTION_TABLE_CACHE_SIZE; i++)
+    {
+        action_table_t *table;
+
+        for (table = action_tables[i]; table; table = table->next)
+        {
+            note_malloced_block_ref(table);
+            for (j = 0; j < table->num_actions; j++)
+            {
+                count_ref_from_string(table->actions[j].verb);
+                count_ref_from_string(table->actions[j].fun);
+            }
+        }
+    }
+} /* count_action_table_refs() */
+
+#endif /* GC_SUPPORT */
+
+/*-------------------------------------------------------------------------*/
+static int
+declared_action_type (svalue_t *entry, unsigned short *short_verb)
+
+/* Check the entry <entry> of an action table and return the sentence
+ * type for it, setting *<short_verb> for SENT_SHORT_VERB.
+ * Result is -1 if the entry is not valid.
+ */
+
+{
+    svalue_t *item;
+    p_int flag;
+
+    if (entry->type != T_POINTER
+     || VEC_SIZE(entry->u.vec) < 2 || VEC_SIZE(entry->u.vec) > 3)
+        return -1;
+
+    item = entry->u.vec->item;
+    if (item[0].type != T_STRING || item[1].type != T_STRING)
+        return -1;
+
+    flag = 0;
+    if (VEC_SIZE(entry->u.vec) > 2)
+    {
+        if (item[2].type != T_NUMBER)
+            return -1;
+        flag = item[2].u.number;
+    }
+
+    *short_verb = 0;
+    if (flag == 0)
+        return SENT_PLAIN;
+    if (flag == AA_SHORT)
+        return SENT_SHORT_VERB;
+    if (flag == AA_NOSPACE)
+        return SENT_OLD_NO_SPACE;
+    if (flag == AA_IMM_ARGS)
+        return SENT_NO_SPACE;
+    if (flag < AA_VERB && (size_t)(-flag) < mstrsize(item[1].u.str))
+    {
+        *short_verb = 0 - (unsigned short)flag;
+        return SENT_SHORT_VERB;
+    }
+    return -1;
+} /* declared_action_type() */
+
+/*-------------------------------------------------------------------------*/
+static action_table_t *
+make_action_table (object_t *ob)
+
+/* Query the action table of the program of <ob> by calling the
+ * lfun action_table() in <ob>, and put it into the cache.
+ * Result is the new table.
+ *
+ * The lfun has to return an array of ({ function, verb [, flag] })
+ * arrays, with the same meaning as the arguments of add_action().
+ */
+
+{
+    action_table_t *table;
+    svalue_t *ret;
+    vector_t *vec;
+    unsigned short short_verb;
+    int32 id;
+    int i, num;
+
+    id = ob->prog->id_number;
+    ret = sapply_int(STR_ACTION_TABLE, ob, 0, MY_TRUE, MY_FALSE);
+
+    vec = NULL;
+    num = 0;
+    if (ret && ret->type == T_POINTER)
+    {
+        vec = ret->u.vec;
+        num = (int)VEC_SIZE(vec);
+    }
+    else if (ret && (ret->type != T_NUMBER || ret->u.number != 0))
+        errorf("Bad result from %s->action_table(): not an array.\n"
+              , get_txt(ob->name));
+
+    /* The lfun might have destructed the object or replaced its program */
+    if ((ob->flags & O_DESTRUCTED) || O_PROG_SWAPPED(ob)
+     || ob->prog->id_number != id)
+        errorf("%s changed during action_table().\n", get_txt(ob->name));
+
+    for (i = 0; i < num; i++)
+    {
+        if (declared_action_type(&vec->item[i], &short_verb) < 0)
+            errorf("Bad entry %d in %s->action_table().\n"
+                  , i, get_txt(ob->name));
+    }
+
+    table = xalloc(sizeof(*table) + num * sizeof(table->actions[0]));
+    if (!table)
+        errorf("Out of memory (%zu bytes) for the action table of %s.\n"
+              , sizeof(*table) + num * sizeof(table->actions[0])
+              , get_txt(ob->name));
+
+    table->id = id;
+    table->num_actions = num;
+    for (i = 0; i < num; i++)
+    {
+        declared_action_t *act = &table->actions[i];
+        svalue_t *item = vec->item[i].u.vec->item;
+
+        act->type = (unsigned char)declared_action_type(&vec->item[i], &act->short_verb);
+        act->fun = make_tabled_from(item[0].u.str);
+        act->verb = make_tabled_from(item[1].u.str);
+    }
+
+    table->next = action_tables[id & (ACTION_TABLE_CACHE_SIZE - 1)];
+    action_tables[id & (ACTION_TABLE_CACHE_SIZE - 1)] = table;
+
+    return table;
+} /* make_action_table() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE action_table_t *
+get_action_table (object_t *ob)
+
+/* Return the action table of the program of <ob>, or NULL if it
+ * declares no actions.
+ */
+
+{
+    action_table_t *table;
+
+    if (O_PROG_SWAPPED(ob) && load_ob_from_swap(ob) < 0)
+        return NULL;
+
+    table = lookup_action_table(ob->prog->id_number);
+    if (!table)
+        table = make_action_table(ob);
+    if (!table->num_actions)
+    {
+        ob->flags |= O_NO_ACTIONS;
+        return NULL;
+    }
+    return table;
+} /* get_action_table() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE Bool
+may_declare_actions (object_t *ob)
+
+/* Return TRUE if <ob> may have declared actions, i.e. if its action
+ * table is not known to be empty. The O_NO_ACTIONS flag remembers an
+ * empty table while the program is swapped out, so that such objects
+ * are not swapped in just to find that out again.
+ */
+
+{
+    action_table_t *table;
+
+    if (ob->flags & (O_DESTRUCTED|O_NO_ACTIONS))
+        return MY_FALSE;
+    if (O_PROG_SWAPPED(ob))
+        return MY_TRUE;
+
+    table = lookup_action_table(ob->prog->id_number);
+    if (table && !table->num_actions)
+    {
+        ob->flags |= O_NO_ACTIONS;
+        return MY_FALSE;
+    }
+    return MY_TRUE;
+} /* may_declare_actions() */
+
 /*-------------------------------------------------------------------------*/
 static INLINE void
 save_command_context (struct command_context_s * context)
@@ -348,6 +854,7 @@ remove_action_sent (object_t *ob, object_t *player)
 #else
             *s = tmp->sent.next;
 #endif /* CHECK_OBJECT_REF */
+            unindex_action(player, tmp);
             free_action_sent(tmp);
         }
         else
@@ -393,6 +900,7 @@ remove_shadow_action_sent (object_t *ob, object_t *player)
 #else
             *s = tmp->sent.next;
 #endif /* CHECK_OBJECT_REF */
+            unindex_action(player, tmp);
             free_action_sent(tmp);
         }
         else
@@ -439,6 +947,7 @@ remove_environment_sent (object_t *player)
 #endif
                 tmp = s;
                 s = (action_t *)s->sent.next;
+                unindex_action(player, tmp);
                 free_action_sent(tmp);
                 if (!s) {
 #ifdef CHECK_OBJECT_REF
@@ -743,6 +1252,337 @@ notify_no_command (char *command, object_t *save_command_giver)
 
 } /* notify_no_command() */
 
+/*-------------------------------------------------------------------------*/
+static INLINE Bool
+action_matches (action_t *sa, char *buff)
+
+/* Test if the action sentence <sa> matches the command in <buff>
+ * with the verb last_verb. Internal sentences never match.
+ */
+
+{
+    unsigned char type;      /* sa->sent.type */
+
+    if ((type = sa->sent.type) == SENT_PLAIN)
+    {
+        if (sa->verb != last_verb)
+            return MY_FALSE;
+    }
+    else if (type == SENT_SHORT_VERB)
+    {
+        /* The verb may be shortened to a few leading characters,
+         * but not shorter than .short_verb.
+         */
+        size_t len;
+        if (sa->short_verb)
+        {
+            len = mstrsize(last_verb);
+            if (len < sa->short_verb
+             || len > mstrsize(sa->verb)
+             || (   sa->verb != last_verb
+                 && strncmp(get_txt(sa->verb), get_txt(last_verb), len) != 0))
+                return MY_FALSE;
+        }
+        else
+        {
+            len = mstrsize(sa->verb);
+            if (strncmp(buff, get_txt(sa->verb), len) != 0)
+                return MY_FALSE;
+        }
+    }
+    else if (type == SENT_OLD_NO_SPACE || type == SENT_NO_SPACE)
+    {
+        /* The arguments may follow the verb without space,
+         * that means we just have to check if buff[] begins
+         * with sa->verb.
+         */
+        size_t len;
+        len = mstrsize(sa->verb);
+        if (strncmp(buff, get_txt(sa->verb), len) != 0)
+            return MY_FALSE;
+    }
+    else
+    {
+        /* SENT_MARKER ... due to recursion. Or another SENT_IS_INTERNAL */
+        return MY_FALSE;
+    }
+
+    return MY_TRUE;
+} /* action_matches() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE svalue_t *
+call_action_function (action_t *sa, string_t *fun, int num_arg, Bool toplevel)
+
+/* Call the function of action <sa> with the <num_arg> arguments on the
+ * stack. If <fun> is given, it is the name of the function to call
+ * in sa->ob, else the callback of <sa> is used.
+ * <toplevel> is TRUE if the command was given by the player directly.
+ *
+ * Result is the result of the call, or NULL if the function couldn't
+ * be called.
+ */
+
+{
+    if (!fun)
+        return execute_callback(&(sa->cb), num_arg, MY_TRUE, toplevel);
+
+    if (toplevel)
+        tracedepth = 0;
+    return sapply(fun, sa->ob, num_arg);
+} /* call_action_function() */
+
+/*-------------------------------------------------------------------------*/
+static svalue_t *
+call_action (action_t *sa, string_t *fun, char *buff, ptrdiff_t length
+            , Bool toplevel)
+
+/* Call the action <sa> matching the command in <buff>, with <length>
+ * being the length of the verb in the command. The function to call
+ * is given by <fun> or the callback of <sa>, see call_action_function().
+ *
+ * Result is the result of the call, or NULL if the function couldn't
+ * be called.
+ */
+
+{
+    svalue_t *ret;
+
+    if (sa->sent.type == SENT_OLD_NO_SPACE)
+    {
+        if (strlen(buff) > mstrsize(sa->verb))
+        {
+            push_c_string(inter_sp, &buff[mstrsize(sa->verb)]);
+            ret = call_action_function(sa, fun, 1, toplevel);
+        }
+        else
+        {
+            ret = call_action_function(sa, fun, 0, toplevel);
+        }
+    }
+    else if (sa->sent.type == SENT_NO_SPACE)
+    {
+        if (strlen(buff) > mstrsize(sa->verb))
+        {
+            /* We need to cut off the verb right where the
+             * arguments start. On the other hand, we can't modify
+             * the last_verb permanently, as this sentence might
+             * fail and other sentences want the full one.
+             */
+            char ch;
+            size_t len = mstrsize(sa->verb);
+
+            push_string(inter_sp, last_verb);
+            ch = buff[len];
+            buff[len] = '\0';
+            last_verb = new_tabled(buff);
+            buff[len] = ch;
+            push_c_string(inter_sp, &buff[len]);
+            ret = call_action_function(sa, fun, 1, toplevel);
+            free_mstring(last_verb);
+            last_verb = inter_sp->u.str; inter_sp--;
+        }
+        else
+        {
+            ret = call_action_function(sa, fun, 0, toplevel);
+        }
+    }
+    else if (buff[length] == ' ')
+    {
+        push_c_string(inter_sp, &buff[length+1]);
+        ret = call_action_function(sa, fun, 1, toplevel);
+    }
+    else
+    {
+        ret = call_action_function(sa, fun, 0, toplevel);
+    }
+
+    return ret;
+} /* call_action() */
+
+/*-------------------------------------------------------------------------*/
+static sentence_t *
+find_first_action (object_t *ob, char *buff)
+
+/* Return the first sentence of <ob> which matches the command in <buff>
+ * with the verb last_verb, or NULL if there is none. Without an action
+ * index this is just the start of the sentence list.
+ *
+ * Objects with at least ACTION_INDEX_THRESHOLD actions get an index
+ * here, so that only the actions with the same verb and the ones with
+ * partial verbs need to be tested.
+ */
+
+{
+    action_index_t *index = ob->action_index;
+    action_t *plain, *sa;
+
+    if (!index)
+    {
+        sentence_t *s;
+        p_int num = 0;
+
+        for (s = ob->sent; s && num < ACTION_INDEX_THRESHOLD; s = s->next)
+            if (!SENT_IS_INTERNAL(s->type))
+                num++;
+        if (num < ACTION_INDEX_THRESHOLD)
+            return ob->sent;
+
+        for (; s; s = s->next)
+            if (!SENT_IS_INTERNAL(s->type))
+                num++;
+        build_action_index(ob, num);
+        if (NULL == (index = ob->action_index))
+            return ob->sent;
+    }
+
+    /* The first action with exactly this verb... */
+    for ( plain = index->table[mstr_get_hash(last_verb) & (index->size - 1)]
+        ; plain && plain->verb != last_verb
+        ; plain = plain->index_next) NOOP;
+
+    /* ...unless a partial verb added later matches as well. */
+    for ( sa = index->wild
+        ; sa && (!plain || sa->seq > plain->seq)
+        ; sa = sa->index_next)
+    {
+        if (action_matches(sa, buff))
+            return (sentence_t *)sa;
+    }
+
+    return (sentence_t *)plain;
+} /* find_first_action() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+parse_declared_actions (char *buff, ptrdiff_t length, Bool toplevel)
+
+/* Search the actions declared by the objects in the vicinity of
+ * marked_command_giver for the command in <buff> with the verb last_verb,
+ * <length> being the length of the verb. The vicinity is searched in the
+ * order environment, objects in the environment, and inventory; the
+ * actions of one object in the order of its action table.
+ * <toplevel> is TRUE if the command was given by the player directly.
+ *
+ * Return TRUE if an action took the command (or the command_giver was
+ * destructed), and FALSE if not.
+ */
+
+{
+    object_t *save_current_object = current_object;
+    object_t *save_command_giver  = command_giver;
+    object_t *env, *item;
+    vector_t *vicinity;
+    svalue_t *svp;
+    p_int num, i;
+
+    /* Collect the candidates first, as the actions may move them. */
+    env = marked_command_giver->super;
+    num = 0;
+    if (env)
+    {
+        if (may_declare_actions(env))
+            num++;
+        for (item = env->contains; item; item = item->next_inv)
+            if (item != marked_command_giver && may_declare_actions(item))
+                num++;
+    }
+    for (item = marked_command_giver->contains; item; item = item->next_inv)
+        if (may_declare_actions(item))
+            num++;
+
+    if (!num)
+        return MY_FALSE;
+
+    vicinity = allocate_uninit_array(num);
+    svp = vicinity->item;
+    if (env)
+    {
+        if (may_declare_actions(env))
+        {
+            put_ref_object(svp, env, "parse_declared_actions");
+            svp++;
+        }
+        for (item = env->contains; item; item = item->next_inv)
+            if (item != marked_command_giver && may_declare_actions(item))
+            {
+                put_ref_object(svp, item, "parse_declared_actions");
+                svp++;
+            }
+    }
+    for (item = marked_command_giver->contains; item; item = item->next_inv)
+        if (may_declare_actions(item))
+        {
+            put_ref_object(svp, item, "parse_declared_actions");
+            svp++;
+        }
+
+    /* Keep the array on the stack, so that it is freed on errors. */
+    push_array(inter_sp, vicinity);
+
+    for (i = 0; i < num; i++)
+    {
+        object_t *ob = vicinity->item[i].u.ob;
+        action_table_t *table;
+        int j;
+
+        /* The table is looked up again after every call, as the call
+         * might have freed it.
+         */
+        for (j = 0; ; j++)
+        {
+            declared_action_t *declared;
+            action_t action;
+            svalue_t *ret;
+
+            if ((ob->flags & O_DESTRUCTED)
+             || NULL == (table = get_action_table(ob))
+             || j >= table->num_actions)
+                break;
+
+            declared = &table->actions[j];
+            action.sent.type = declared->type;
+            action.verb = declared->verb;
+            action.short_verb = declared->short_verb;
+            action.ob = ob;
+            action.shadow_ob = NULL;
+            if (!action_matches(&action, buff))
+                continue;
+
+            if (last_action_verb)
+                free_mstring(last_action_verb);
+            last_action_verb = ref_mstring(declared->verb);
+
+            if (current_object == NULL)
+                current_object = ob;
+
+            ret = call_action(&action, declared->fun, buff, length, toplevel);
+
+            /* Restore the old current_object and command_giver */
+            current_object = save_current_object;
+            command_giver  = save_command_giver;
+
+            if (command_giver->flags & O_DESTRUCTED)
+            {
+                /* the caller (execute_command()) will do the clean up */
+                free_svalue(inter_sp--);
+                return MY_TRUE;
+            }
+
+            if (ret && (ret->type != T_NUMBER || ret->u.number != 0))
+            {
+                if (O_IS_INTERACTIVE(command_giver))
+                    ob->user->score++;
+                free_svalue(inter_sp--);
+                return MY_TRUE;
+            }
+        }
+    }
+
+    free_svalue(inter_sp--);
+    return MY_FALSE;
+} /* parse_declared_actions() */
+
 /*-------------------------------------------------------------------------*/
 static Bool
 parse_command (char *buff, Bool from_efun)
@@ -827,62 +1667,22 @@ parse_command (char *buff, Bool from_efun)
     marker_sent = new_action_sent();
     marker_sent->sent.type = SENT_MARKER;
 
-    /* Scan the list of sentences for the saved command giver */
-    for (s = marked_command_giver->sent; s; s = s->next)
+    /* Scan the list of sentences for the saved command giver,
+     * starting with the first one that matches.
+     */
+    for (s = find_first_action(marked_command_giver, buff); s; s = s->next)
     {
         svalue_t *ret;
         object_t *command_object;
         action_t *sa;            /* (action_t *)s */
-        unsigned char type;      /* s->type */
         sentence_t *next;        /* used only as flag */
         sentence_t *insert;      /* insertion point */
 
         sa = (action_t *)s;
 
         /* Test the current sentence */
-        if ((type = s->type) == SENT_PLAIN)
-        {
-            if (sa->verb != last_verb)
-                continue;
-        }
-        else if (type == SENT_SHORT_VERB)
-        {
-            /* The verb may be shortened to a few leading characters,
-             * but not shorter than .short_verb.
-             */
-            size_t len;
-            if (sa->short_verb)
-            {
-                len = mstrsize(last_verb);
-                if (len < sa->short_verb
-                 || len > mstrsize(sa->verb)
-                 || (   sa->verb != last_verb
-                     && strncmp(get_txt(sa->verb), get_txt(last_verb), len) != 0))
-                    continue;
-            }
-            else
-            {
-                len = mstrsize(sa->verb);
-                if (strncmp(buff, get_txt(sa->verb), len) != 0)
-                    continue;
-            }
-        }
-        else if (type == SENT_OLD_NO_SPACE || type == SENT_NO_SPACE)
-        {
-            /* The arguments may follow the verb without space,
-             * that means we just have to check if buff[] begins
-             * with sa->verb.
-             */
-            size_t len;
-            len = mstrsize(sa->verb);
-            if (strncmp(buff, get_txt(sa->verb), len) != 0)
-                continue;
-        }
-        else
-        {
-            /* SENT_MARKER ... due to recursion. Or another SENT_IS_INTERNAL */
+        if (!action_matches(sa, buff))
             continue;
-        }
 
         /*
          * Now we have found a special sentence!
@@ -958,56 +1758,9 @@ parse_command (char *buff, Bool from_efun)
         marker_sent->shadow_ob = NULL;
         init_empty_callback(&(marker_sent->cb));
 
-        /* Push the argument and call the command function.
+        /* Call the command function.
          */
-        if (s->type == SENT_OLD_NO_SPACE)
-        {
-            if (strlen(buff) > mstrsize(sa->verb))
-            {
-                push_c_string(inter_sp, &buff[mstrsize(sa->verb)]);
-                ret = execute_callback(&(sa->cb), 1, MY_TRUE, save_current_object == NULL);
-            }
-            else
-            {
-                ret = execute_callback(&(sa->cb), 0, MY_TRUE, save_current_object == NULL);
-            }
-        }
-        else if (s->type == SENT_NO_SPACE)
-        {
-            if (strlen(buff) > mstrsize(sa->verb))
-            {
-                /* We need to cut off the verb right where the
-                 * arguments start. On the other hand, we can't modify
-                 * the last_verb permanently, as this sentence might
-                 * fail and other sentences want the full one.
-                 */
-                char ch;
-                size_t len = mstrsize(sa->verb);
-
-                push_string(inter_sp, last_verb);
-                ch = buff[len];
-                buff[len] = '\0';
-                last_verb = new_tabled(buff);
-                buff[len] = ch;
-                push_c_string(inter_sp, &buff[len]);
-                ret = execute_callback(&(sa->cb), 1, MY_TRUE, save_current_object == NULL);
-                free_mstring(last_verb);
-                last_verb = inter_sp->u.str; inter_sp--;
-            }
-            else
-            {
-                ret = execute_callback(&(sa->cb), 0, MY_TRUE, save_current_object == NULL);
-            }
-        }
-        else if (buff[length] == ' ')
-        {
-            push_c_string(inter_sp, &buff[length+1]);
-            ret = execute_callback(&(sa->cb), 1, MY_TRUE, save_current_object == NULL);
-        }
-        else
-        {
-            ret = execute_callback(&(sa->cb), 0, MY_TRUE, save_current_object == NULL);
-        }
+        ret = call_action(sa, NULL, buff, length, save_current_object == NULL);
 
         /* Restore the old current_object and command_giver */
         current_object = save_current_object;
@@ -1031,6 +1784,7 @@ parse_command (char *buff, Bool from_efun)
              * SENT_MARKER.
              */
             *marker_sent = *((action_t *)s);
+            move_indexed_action(marked_command_giver, marker_sent);
             s->next = (sentence_t *)marker_sent;
             marker_sent = (action_t *)s;
         }
@@ -1077,9 +1831,13 @@ parse_command (char *buff, Bool from_efun)
     init_empty_callback(&(marker_sent->cb));
     command_marker = marker_sent;
 
-    /* If the command was not found, notify the failure */
+    /* If the command was not found, try the declared actions and
+     * otherwise notify the failure.
+     */
     if (s == 0)
     {
+        if (parse_declared_actions(buff, length, save_current_object == NULL))
+            return MY_TRUE;
         if (!from_efun)
             notify_no_command(buff, marked_command_giver);
         return MY_FALSE;
@@ -1288,6 +2046,7 @@ e_add_action (svalue_t *func, svalue_t *cmd, p_int flag)
     p->verb = make_tabled(cmd->u.str); cmd->type = T_NUMBER;
     p->sent.type = SENT_PLAIN;
     p->short_verb = 0;
+    p->seq = ++action_seq;
 
     if (flag)
     {
@@ -1346,6 +2105,7 @@ e_add_action (svalue_t *func, svalue_t *cmd, p_int flag)
         command_giver->sent = (sentence_t *)p;
 #endif /* CHECK_OBJECT_REF */
     }
+    index_action(command_giver, p);
 
     return MY_FALSE;
 } /* e_add_action() */
@@ -1824,7 +2584,7 @@ f_remove_action (svalue_t *sp)
  */
 
 {
-    object_t    *ob, *shadow_ob;
+    object_t    *ob, *shadow_ob, *player;
     string_t    *verb;
     sentence_t **sentp;
     action_t    *s;
@@ -1832,7 +2592,7 @@ f_remove_action (svalue_t *sp)
 
     /* Get and test the arguments */
 
-    ob = sp->u.ob;
+    ob = player = sp->u.ob;
 
     verb = NULL;
     if (sp[-1].type == T_STRING)
@@ -1889,6 +2649,7 @@ f_remove_action (svalue_t *sp)
 #else
             *sentp = s->sent.next;
 #endif /* CHECK_OBJECT_REF */
+            unindex_action(player, s);
             free_action_sent(s);
             rc++;
             if (verb != NULL)
@@ -47,6 +47,34 @@ struct action_s
       /* SENT_SHORT_VERB: the number of characters which have to
        *   match at minimum.
        */
+
+    p_uint seq;
+      /* Sequence number of the add_action() which created this sentence.
+       * Along a sentence list the numbers are decreasing.
+       */
+
+    action_t *index_prev, *index_next;
+      /* The chain of the action index this sentence is kept in, if the
+       * object holding it has an index.
+       */
+};
+
+/* --- struct action_index_s: the verb index of a sentence list ---
+ *
+ * Objects with many actions keep an index of them, so that a command
+ * search need not compare every sentence with the given verb.
+ *
+ * SENT_PLAIN actions are hashed by their verb into .table[], all
+ * other actions (whose verbs may match only partially) are kept in
+ * the .wild chain. Every chain is in the order of the sentence list.
+ */
+
+struct action_index_s
+{
+    p_int num_actions;   /* Number of indexed actions */
+    p_int size;          /* Size of .table[], a power of 2 */
+    action_t *wild;      /* The actions which are not SENT_PLAIN */
+    action_t *table[1];  /* The hashed SENT_PLAIN actions */
 };
 
 /* --- Variables --- */
@@ -58,6 +86,9 @@ extern p_int alloc_action_sent;
 
 extern void free_action_temporaries(void);
 extern void free_action_sent(action_t *p);
+extern void free_action_index(object_t *ob);
+extern void forget_action_table(program_t *prog);
+extern void clear_action_tables(void);
 extern void remove_action_sent(object_t *ob, object_t *player);
 extern void remove_shadow_action_sent(object_t *ob, object_t *player);
 extern void remove_environment_sent(object_t *player);
@@ -80,4 +111,8 @@ extern svalue_t *f_set_this_player(svalue_t *sp);
 extern svalue_t *f_remove_action(svalue_t *sp);
 extern svalue_t *f_match_command(svalue_t * sp);
 
+#ifdef GC_SUPPORT
+extern void count_action_table_refs(void);
+#endif /* GC_SUPPORT */
+
 #endif /* ACTIONS_H__ */
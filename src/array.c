@@ -311,6 +311,7 @@ _free_vector (vector_t *p)
         free_svalue(svp++);
     } while (--i);
 
+    forget_cycle_root(p);
     xfree(p);
 } /* _free_vector() */
 
@@ -328,6 +329,7 @@ free_empty_vector (vector_t *p)
     i = VEC_SIZE(p);
     p->user->size_array -= i;
     num_arrays--;
+    forget_cycle_root(p);
     xfree((char *)p);
 }
 
@@ -457,7 +459,7 @@ explode_string (string_t *str, string_t *del)
  */
 
 {
-    char *p, *beg;
+    char *p, *beg, *end;
     long num;
     long len, left;
     vector_t *ret;
@@ -553,59 +555,36 @@ explode_string (string_t *str, string_t *del)
      *
      * The number of array items is then one more than the number of
      * delimiters, hence the 'num=1'.
-     * TODO: Implement a strncmp() which returns the number of matching
-     *   characters in case of a mismatch.
      * TODO: Remember the found positions so that we don't have to
-     *   do the comparisons again.
+     *   search them again.
      */
-    for (p = get_txt(str), left = mstrsize(str), num=1 ; left > 0; )
-    {
-        if (left >= len && memcmp(p, get_txt(del), (size_t)len) == 0) {
-            p += len;
-            left -= len;
-            num++;
-        }
-        else
-        {
-            p += 1;
-            left -= 1;
-        }
-    }
+    end = get_txt(str) + mstrsize(str);
+    for ( num = 1, p = get_txt(str)
+        ; NULL != (p = xmemmem(p, end - p, get_txt(del), (size_t)len))
+        ; p += len, num++) NOOP;
 
     ret = allocate_array(num);
 
     /* Extract the <num> strings into the result array <ret>.
-     *   <buff> serves as temporary buffer for the copying.
      */
-    for (p = get_txt(str), beg = get_txt(str), num = 0, left = mstrsize(str)
-        ; left > 0; )
+    for ( beg = get_txt(str), num = 0
+        ; NULL != (p = xmemmem(beg, end - beg, get_txt(del), (size_t)len))
+        ; beg = p + len, num++)
     {
-        if (left >= len && memcmp(p, get_txt(del), (size_t)len) == 0)
-        {
-            ptrdiff_t bufflen;
+        ptrdiff_t bufflen;
 
-            bufflen = p - beg;
-            buff = new_n_mstring(beg, (size_t)bufflen);
-            if (!buff) {
-                free_array(ret);
-                outofmem(bufflen, "buffer for explode()");
-            }
-
-            put_string(ret->item+num, buff);
-
-            num++;
-            beg = p + len;
-            p = beg;
-            left -= len;
-
-        } else {
-            p += 1;
-            left -= 1;
+        bufflen = p - beg;
+        buff = new_n_mstring(beg, (size_t)bufflen);
+        if (!buff) {
+            free_array(ret);
+            outofmem(bufflen, "buffer for explode()");
         }
+
+        put_string(ret->item+num, buff);
     }
 
     /* Copy the last occurence (may be empty). */
-    len = get_txt(str) + mstrsize(str) - beg;
+    len = end - beg;
     buff = new_n_mstring(beg, (size_t)len);
     if (!buff) {
         free_array(ret);
@@ -5,6 +5,7 @@
 #include <stddef.h>
 
 #include "typedefs.h"
+#include "gcollect.h"
 #include "svalue.h"
 
 
@@ -127,11 +128,14 @@ static INLINE vector_t* ref_array(vector_t *a) {
 
 /* void free_array(vector_t *a)
  *   Subtract one ref from array <a>, and free the array fully if
- *   the refcount reaches zero.
+ *   the refcount reaches zero. Otherwise the array is noted as a
+ *   possible root of a reference cycle.
  */
 static INLINE void free_array(vector_t *a) {
     if (--(a->ref) <= 0) 
         _free_vector(a); 
+    else if (VEC_SIZE(a))
+        note_cycle_root(a, T_POINTER);
 }
 
 /* p_int deref_array(vector_t *a)
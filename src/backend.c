@@ -16,10 +16,11 @@
  * heartbeats are evaluated, but no longer until the time runs out. Any
  * heartbeat remaining will be evaluated in the next cycle. After the
  * heartbeat, the call_outs are evaluated. Callouts have no time limit,
- * but are bound by the eval_cost limit. Next, the object list is scanned
- * for objects in need of a reset, cleanup or swap. The driver will
- * (due objects given) perform at least one of each operation, but only
- * as many as it can before the time runs out. Last, player commands are
+ * but are bound by the eval_cost limit. Next, the objects in need of a
+ * reset, cleanup or swap are taken from queues sorted by their due times.
+ * The driver will (due objects given) perform at least one of each
+ * operation, but only as many as it can before the time runs out.
+ * Last, player commands are
  * retrieved with get_message(). The semantic is so that all players are
  * considered once before get_message() checks for a timeout. If a timeout
  * is detected, get_message() select()s, but returns immediately with the
@@ -76,6 +77,7 @@
 #include "i-eval_cost.h"
 
 #include "../mudlib/sys/driver_hook.h"
+#include "../mudlib/sys/driver_info.h"
 #include "../mudlib/sys/debug_message.h"
 #include "../mudlib/sys/signals.h"
 
@@ -130,6 +132,47 @@ statistic_t stat_in_list = { 0, 0, 0.0 };
   /* Decaying average number of objects processed and objects in the list.
    */
 
+/* --- struct obj_queue_s: one due-time queue of process_objects()
+ *
+ * Every queue is a binary min-heap of the objects, ordered by the
+ * time their next action of that kind is due. The objects record
+ * their position in the heap in object_t.queue_pos[], so that they
+ * can be moved or removed in O(log n).
+ *
+ * The due times of the clean_up and swap queues are derived from
+ * object_t.time_of_ref, which is updated without notice whenever
+ * the object is used. Since it only grows there, the queued due time is
+ * never too late; process_objects() rechecks every object it takes
+ * from the queue and just requeues it when it isn't due after all.
+ * The one place that sets time_of_ref back (after a reset) requeues
+ * the object itself.
+ */
+
+struct obj_queue_entry_s
+{
+    mp_int    due;  /* Time when the object becomes due */
+    object_t *ob;   /* The object */
+};
+
+struct obj_queue_s
+{
+    struct obj_queue_entry_s *heap;  /* The heap array */
+    p_int        size;          /* Number of used entries */
+    p_int        alloced;       /* Number of allocated entries */
+    uint         num_processed; /* Objects handled in the last cycle */
+    mp_int       max_lateness;  /* Max lateness in the last cycle */
+    statistic_t  lateness;      /* Average lateness of handled objects */
+};
+
+static struct obj_queue_s obj_queues[OQ_NUM_QUEUES];
+  /* The queues, indexed by OQ_xxx.
+   */
+
+static const char * obj_queue_names[OQ_NUM_QUEUES]
+  = { "Reset", "Clean up", "Data cleanup", "Swap" };
+  /* The names of the queues for status().
+   */
+
 Bool extra_jobs_to_do = MY_FALSE;
   /* True: the backend has other things to do in this cycle than just
    *   parsing commands or calling the heart_beat.
@@ -503,6 +546,11 @@ void install_signal_handlers()
         debug_message("%s Unable to install signal handler for SIGPROF - profiling "
             "not available\n", time_stamp());
     }
+    // Signal handler for the sampling profiler.
+    sa.sa_handler = handle_sample_signal;
+    if (sigaction(SIGVTALRM, &sa, NULL) == -1)
+        debug_message("%s Unable to install signal handler for SIGVTALRM - "
+            "sampling profiler not available\n", time_stamp());
     // for SIGTERM and SIGINT the default handler should be restored upon signal
     // delivery, so that a repeated signal is handled immediately with the 
     // default action and not only in the next backend cycle.
@@ -529,7 +577,7 @@ backend (void)
          */
     Bool prevent_object_cleanup;
         /* Implement a low/high water mark handling for the call to
-         * cleanup_all_objects(), as it turns out that a single
+         * start_cleanup_all_objects(), as it turns out that a single
          * cleanup doesn't always remove enough destructed objects.
          */
     
@@ -629,10 +677,12 @@ backend (void)
         {
             if (num_listed_objs <= num_destructed)
             {
-                cleanup_all_objects();
+                start_cleanup_all_objects();
                 prevent_object_cleanup = MY_TRUE;
             }
         }
+        continue_cleanup_all_objects();
+        collect_cycles();
 
         if (extra_jobs_to_do) {
 
@@ -1005,6 +1055,311 @@ void check_alarm (void)
     alarm_called = MY_FALSE;
 } /* check_alarm() */
 
+/*-------------------------------------------------------------------------*/
+static void
+oq_sift (int qnum, p_int pos)
+
+/* Move the entry at position <pos> of queue <qnum> up or down until
+ * the heap order is restored.
+ */
+
+{
+    struct obj_queue_s *q = &obj_queues[qnum];
+    struct obj_queue_entry_s entry = q->heap[pos];
+
+    while (pos > 0)
+    {
+        p_int parent = (pos - 1) / 2;
+
+        if (q->heap[parent].due <= entry.due)
+            break;
+        q->heap[pos] = q->heap[parent];
+        q->heap[pos].ob->queue_pos[qnum] = (uint32)pos + 1;
+        pos = parent;
+    }
+
+    for (;;)
+    {
+        p_int child = 2 * pos + 1;
+
+        if (child >= q->size)
+            break;
+        if (child + 1 < q->size && q->heap[child+1].due < q->heap[child].due)
+            child++;
+        if (entry.due <= q->heap[child].due)
+            break;
+        q->heap[pos] = q->heap[child];
+        q->heap[pos].ob->queue_pos[qnum] = (uint32)pos + 1;
+        pos = child;
+    }
+
+    q->heap[pos] = entry;
+    entry.ob->queue_pos[qnum] = (uint32)pos + 1;
+} /* oq_sift() */
+
+/*-------------------------------------------------------------------------*/
+static void
+oq_set (int qnum, object_t *ob, mp_int due)
+
+/* Enter <ob> with the time <due> into queue <qnum>, or move it there
+ * if it is already queued.
+ */
+
+{
+    struct obj_queue_s *q = &obj_queues[qnum];
+    p_int pos;
+
+    if (ob->queue_pos[qnum])
+    {
+        pos = (p_int)ob->queue_pos[qnum] - 1;
+        if (q->heap[pos].due == due)
+            return;
+    }
+    else
+    {
+        if (q->size >= q->alloced)
+        {
+            p_int new_alloced = q->alloced ? 2 * q->alloced : 1024;
+            struct obj_queue_entry_s *new_heap;
+
+            new_heap = prexalloc(q->heap, (size_t)new_alloced * sizeof(*new_heap));
+            if (!new_heap)
+            {
+                outofmem((size_t)new_alloced * sizeof(*new_heap)
+                        , "object queue");
+                return;
+            }
+            q->heap = new_heap;
+            q->alloced = new_alloced;
+        }
+        pos = q->size++;
+        q->heap[pos].ob = ob;
+    }
+
+    q->heap[pos].due = due;
+    oq_sift(qnum, pos);
+} /* oq_set() */
+
+/*-------------------------------------------------------------------------*/
+static void
+oq_remove (int qnum, object_t *ob)
+
+/* Remove <ob> from queue <qnum>, if it is queued there.
+ */
+
+{
+    struct obj_queue_s *q = &obj_queues[qnum];
+    p_int pos;
+
+    if (!ob->queue_pos[qnum])
+        return;
+
+    pos = (p_int)ob->queue_pos[qnum] - 1;
+    ob->queue_pos[qnum] = 0;
+    q->size--;
+    if (pos < q->size)
+    {
+        q->heap[pos] = q->heap[q->size];
+        oq_sift(qnum, pos);
+    }
+} /* oq_remove() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+swap_interval (void)
+
+/* Return the shorter of the two (enabled) swap times.
+ */
+
+{
+    if (time_to_swap <= 0)
+        return time_to_swap_variables;
+    if (time_to_swap_variables <= 0 || time_to_swap < time_to_swap_variables)
+        return time_to_swap;
+    return time_to_swap_variables;
+} /* swap_interval() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+object_due_time (int qnum, object_t *ob, mp_int *due)
+
+/* Compute the time when the action of queue <qnum> becomes due for <ob>
+ * and store it in *<due>; <ob> is due when this time is reached.
+ * Return FALSE if <ob> doesn't need that action at all.
+ */
+
+{
+    switch (qnum)
+    {
+    case OQ_RESET:
+        if (time_to_reset <= 0 || !ob->time_reset)
+            return MY_FALSE;
+        *due = ob->time_reset + 1;
+        return MY_TRUE;
+
+    case OQ_CLEAN_UP:
+        if (time_to_cleanup <= 0 || !(ob->flags & O_WILL_CLEAN_UP))
+            return MY_FALSE;
+        *due = ob->time_of_ref + time_to_cleanup + 1;
+        return MY_TRUE;
+
+    case OQ_DATA_CLEANUP:
+        *due = ob->time_cleanup + 1;
+        return MY_TRUE;
+
+    case OQ_SWAP:
+        if (time_to_swap <= 0 && time_to_swap_variables <= 0)
+            return MY_FALSE;
+
+        /* The next swap time not yet passed, if any. */
+        *due = ob->time_of_ref + swap_interval();
+        if (*due <= current_time)
+        {
+            if (time_to_swap > 0 && ob->time_of_ref + time_to_swap > current_time)
+                *due = ob->time_of_ref + time_to_swap;
+            if (time_to_swap_variables > 0
+             && ob->time_of_ref + time_to_swap_variables > current_time)
+                *due = ob->time_of_ref + time_to_swap_variables;
+        }
+        return MY_TRUE;
+    }
+
+    return MY_FALSE;
+} /* object_due_time() */
+
+/*-------------------------------------------------------------------------*/
+void
+schedule_object (object_t *ob)
+
+/* Enter <ob> into the queues of process_objects() according to its
+ * current reset, cleanup and reference times, resp. update its positions
+ * there. This has to be called when an object is entered into the
+ * object list, and whenever its .time_reset changes.
+ */
+
+{
+    int qnum;
+    mp_int due;
+
+    if (ob->flags & O_DESTRUCTED)
+        return;
+
+    for (qnum = 0; qnum < OQ_NUM_QUEUES; qnum++)
+    {
+        if (object_due_time(qnum, ob, &due))
+            oq_set(qnum, ob, due);
+        else
+            oq_remove(qnum, ob);
+    }
+} /* schedule_object() */
+
+/*-------------------------------------------------------------------------*/
+void
+reschedule_swapping (void)
+
+/* The swap times have been changed: recompute the position of every
+ * object in the swap queue.
+ */
+
+{
+    object_t *ob;
+    mp_int due;
+
+    for (ob = obj_list; ob != NULL; ob = ob->next_all)
+    {
+        if (object_due_time(OQ_SWAP, ob, &due))
+            oq_set(OQ_SWAP, ob, due);
+        else
+            oq_remove(OQ_SWAP, ob);
+    }
+} /* reschedule_swapping() */
+
+/*-------------------------------------------------------------------------*/
+void
+unschedule_object (object_t *ob)
+
+/* Remove <ob> from all queues of process_objects(). This has to be
+ * called when the object is removed from the object list.
+ */
+
+{
+    int qnum;
+
+    for (qnum = 0; qnum < OQ_NUM_QUEUES; qnum++)
+        oq_remove(qnum, ob);
+} /* unschedule_object() */
+
+/*-------------------------------------------------------------------------*/
+static void
+requeue_object (int qnum, object_t *ob, mp_int earliest)
+
+/* Enter <ob> into queue <qnum> again after it has been handled (or was
+ * found not to be due yet), but not before time <earliest>. <earliest>
+ * must be in the future, so that every object is handled at most once
+ * per process_objects() call.
+ */
+
+{
+    mp_int due;
+
+    if (ob->flags & O_DESTRUCTED)
+        return;
+
+    if (!object_due_time(qnum, ob, &due))
+        oq_remove(qnum, ob);
+    else
+        oq_set(qnum, ob, due < earliest ? earliest : due);
+} /* requeue_object() */
+
+/*-------------------------------------------------------------------------*/
+static object_t *
+next_due_object (int qnum, mp_int *due)
+
+/* Return the first object of queue <qnum> which is due according to its
+ * queued time, after making sure that it is still due, and store its
+ * actual due time in *<due>. Objects which are not due after all are
+ * requeued on the way.
+ * Return NULL if there is no due object left.
+ */
+
+{
+    struct obj_queue_s *q = &obj_queues[qnum];
+
+    while (q->size && q->heap[0].due <= current_time)
+    {
+        object_t *ob = q->heap[0].ob;
+
+        if (!object_due_time(qnum, ob, due) || *due > current_time)
+        {
+            requeue_object(qnum, ob, current_time + 1);
+            continue;
+        }
+
+        return ob;
+    }
+
+    return NULL;
+} /* next_due_object() */
+
+/*-------------------------------------------------------------------------*/
+static void
+count_due_object (int qnum, mp_int due)
+
+/* An object of queue <qnum> with the due time <due> is being handled,
+ * update the statistics.
+ */
+
+{
+    struct obj_queue_s *q = &obj_queues[qnum];
+    mp_int lateness = current_time - due;
+
+    if (lateness > q->max_lateness)
+        q->max_lateness = lateness;
+    update_statistic_avg(&q->lateness, (long)lateness);
+    q->num_processed++;
+    num_last_processed++;
+} /* count_due_object() */
+
 /*-------------------------------------------------------------------------*/
 static void
 process_objects (void)
@@ -1018,9 +1373,11 @@ process_objects (void)
  * before the current timeslot runs out (as registered by comm_time_to-
  * _call_heart_beat), but will do at least one cleanup/swap and reset.
  *
- * Objects are moved to the end of the list before they are processed,
- * so that a the next object to handle is always the first object
- * in the list. Even arbitrary object destruction doesn't change this.
+ * The objects are taken from separate queues for resets, clean_ups,
+ * data cleanups and swaps, which are sorted by the time the action is
+ * due, so that only the due objects have to be looked at. An object
+ * is requeued with its next due time before the action is performed,
+ * so even errors or the destruction of the object won't stall a queue.
  *
  * The functions in detail:
  *
@@ -1029,7 +1386,7 @@ process_objects (void)
  *
  *  - An object's clean_up() lfun will be called if the object has not
  *    been used for quite some time, and if it was not reset in this
- *    very round.
+ *    very cycle.
  *
  *  - If the object hasn't been data-cleaned for a sufficient time, it
  *    will be.
@@ -1039,7 +1396,8 @@ process_objects (void)
  *    Since swapping of variables is costly, care is taken that variables
  *    are not swapped out right before the next reset which in that case
  *    would cause a swap in/swap out-yoyo. Instead, such variable swapping
- *    is delayed until after the reset occured.
+ *    is delayed until after the reset occured. Objects which can't be
+ *    swapped are checked again after the shorter of the two swap times.
  *
  *    To disable swapping, set the swapping times (either in config.h or per
  *    commandline option) to a value <= 0.
@@ -1047,9 +1405,6 @@ process_objects (void)
  * The function maintains its own error recovery info so that errors
  * in reset() or clean_up() won't mess up the handling.
  *
- * TODO: The objlist should be split into resets and cleanup/swaps, which
- * TODO:: are then sorted by due times. This would make this function
- * TODO:: much more efficient.
  * TODO: It might be a good idea to distinguish between the time_of_ref
  * TODO:: (when the object was last used/called) and the time_of_swap,
  * TODO:: when it was last swapped in or out. Then, maybe not.
@@ -1067,6 +1422,10 @@ static Bool did_swap;
 
     object_t *obj;               /* Current object worked on */
     long      limit_data_clean;  /* Max number of objects to dataclean */
+    mp_int    due;               /* Due time of the current object */
+    mp_int    time_since_ref;    /* Time since last reference */
+    mp_int    min_time_to_swap;  /* Variable swap exclusion time before reset */
+    int       qnum;
 
     struct error_recovery_info error_recovery_info;
       /* Local error recovery info */
@@ -1077,6 +1436,11 @@ static Bool did_swap;
     num_last_data_cleaned = 0;
     did_reset = MY_FALSE;
     did_swap = MY_FALSE;
+    for (qnum = 0; qnum < OQ_NUM_QUEUES; qnum++)
+    {
+        obj_queues[qnum].num_processed = 0;
+        obj_queues[qnum].max_lateness = 0;
+    }
 
     error_recovery_info.rt.last = rt_context;
     error_recovery_info.rt.type = ERROR_RECOVERY_BACKEND;
@@ -1108,289 +1472,273 @@ static Bool did_swap;
     if (limit_data_clean < num_newly_destructed)
         limit_data_clean = num_newly_destructed;
 
-    /* The processing loop, runs until either time or objects
-     * run short.
-     *
-     * To be safe against errors and destruction of objects,
-     * the object processed is moved immediately to the end
-     * of the object list, so that obj_list always points to
-     * the next object to process.
-     *
-     * The loop ends (apart from timeouts) when num_last_processed
-     * exceeds num_listed_objs.
+    /* Variables won't be swapped if a reset is due shortly.
+     * "shortly" means half the var swap interval, but at max 5 minutes.
      */
-    while (NULL != (obj = obj_list)
-        && (!did_reset || !did_swap || !comm_time_to_call_heart_beat)
-        && num_last_processed < num_listed_objs
-          )
+    min_time_to_swap = 5 * 60;
+    if (time_to_swap_variables / 2 < min_time_to_swap)
+        min_time_to_swap = time_to_swap_variables/2;
+
+    /* ------ Reset ------ */
+
+    /* Objects which have not been touched since the last reset just get
+     * a new due time set.
+     * It is tempting to skip the reset handling for objects which
+     * are swapped out, but then swapper would have to call reset_object()
+     * for due objects on swap-in (just setting a new due-time is not
+     * sufficient).
+     * TODO: Do exactly that?
+     */
+
+    while (NULL != (obj = next_due_object(OQ_RESET, &due)))
     {
-        mp_int time_since_ref; /* Time since last reference */
-        mp_int min_time_to_swap; /* Variable swap exclusion time before reset */
-        Bool bResetCalled;  /* TRUE: reset() called */
+        if (!(obj->flags & O_RESET_STATE)
+         && did_reset && comm_time_to_call_heart_beat)
+            break;
 
         clear_state();
+        count_due_object(OQ_RESET, due);
 
-        num_last_processed++;
-
-        /* Move obj to the end of the list */
-        if (obj != obj_list_end)
+        if (obj->flags & O_RESET_STATE)
         {
-            obj_list = obj->next_all;
-            obj_list->prev_all = NULL;
-            obj->next_all = NULL;
-            obj->prev_all = obj_list_end;
-            obj_list_end->next_all = obj;
-            obj_list_end = obj;
+#ifdef DEBUG
+            if (d_flag)
+                fprintf(stderr, "%s RESET (virtual) %s\n", time_stamp(), get_txt(obj->name));
+#endif
+            obj->time_reset = current_time+time_to_reset/2
+                              +(mp_int)random_number((uint32)time_to_reset/2);
+            requeue_object(OQ_RESET, obj, current_time + 1);
+            continue;
         }
 
-        /* Set Variables */
+#ifdef DEBUG
+        if (d_flag)
+            fprintf(stderr, "%s RESET %s\n", time_stamp(), get_txt(obj->name));
+#endif
+        mark_start_evaluation();
+        if (obj->flags & O_SWAPPED
+         && load_ob_from_swap(obj) < 0)
+        {
+            requeue_object(OQ_RESET, obj, current_time + 1);
+            continue;
+        }
         time_since_ref = current_time - obj->time_of_ref;
-        bResetCalled = MY_FALSE;
-
-        /* Variables won't be swapped if a reset is due shortly.
-         * "shortly" means half the var swap interval, but at max 5 minutes.
-         */
-        min_time_to_swap = 5 * 60;
-        if (time_to_swap_variables / 2 < min_time_to_swap)
-            min_time_to_swap = time_to_swap_variables/2;
-
-        /* ------ Reset ------ */
-
-        /* Check if a reset() is due. Objects which have not been touched
-         * since the last reset just get a new due time set.
-         * It is tempting to skip the reset handling for objects which
-         * are swapped out, but then swapper would have to call reset_object()
-         * for due objects on swap-in (just setting a new due-time is not
-         * sufficient).
-         * TODO: Do exactly that?
-         */
+        did_reset = MY_TRUE;
+        RESET_LIMITS;
+        CLEAR_EVAL_COST;
+        command_giver = 0;
+        previous_ob = NULL;
+        trace_level = 0;
+        reset_object(obj, H_RESET);
+          /* This requeues the object as well. */
+        mark_end_evaluation();
+        if (obj->flags & O_DESTRUCTED)
+            continue;
 
-        if (time_to_reset > 0
-         && obj->time_reset
-         && obj->time_reset < current_time)
+        if (time_to_swap > 0 || time_to_swap_variables > 0)
         {
-            if (obj->flags & O_RESET_STATE)
-            {
-#ifdef DEBUG
-                if (d_flag)
-                    fprintf(stderr, "%s RESET (virtual) %s\n", time_stamp(), get_txt(obj->name));
-#endif
-                obj->time_reset = current_time+time_to_reset/2
-                                  +(mp_int)random_number((uint32)time_to_reset/2);
-            }
-            else if (!did_reset || !comm_time_to_call_heart_beat)
-            {
-#ifdef DEBUG
-                if (d_flag)
-                    fprintf(stderr, "%s RESET %s\n", time_stamp(), get_txt(obj->name));
-#endif
-                mark_start_evaluation();
-                if (obj->flags & O_SWAPPED
-                 && load_ob_from_swap(obj) < 0)
-                   continue;
-                bResetCalled = MY_TRUE;
-                did_reset = MY_TRUE;
-                RESET_LIMITS;
-                CLEAR_EVAL_COST;
-                command_giver = 0;
-                previous_ob = NULL;
-                trace_level = 0;
-                reset_object(obj, H_RESET);
-                mark_end_evaluation();
-                if (obj->flags & O_DESTRUCTED)
-                    continue;
-
-                if (time_to_swap > 0 || time_to_swap_variables > 0)
-                {
-                    /* Restore old time_of_ref. This might result in a quick
-                     * swap-in/swap-out yoyo if this object was swapped out
-                     * in the first place. To make this less costly, variables
-                     * are not swapped out short before a reset (see below).
-                     */
-                    obj->time_of_ref = current_time - time_since_ref;
-                }
-            } /* if (call reset or not) */
-        } /* if (needs reset?) */
+            /* Restore old time_of_ref. This might result in a quick
+             * swap-in/swap-out yoyo if this object was swapped out
+             * in the first place. To make this less costly, variables
+             * are not swapped out short before a reset (see below).
+             */
+            obj->time_of_ref = current_time - time_since_ref;
 
+            /* The swap queue has the object at the due time of the
+             * reset's reference, move it back to the restored one.
+             */
+            if (obj->queue_pos[OQ_SWAP])
+                requeue_object(OQ_SWAP, obj, current_time + 1);
+        }
 
-        /* ------ Clean Up ------ */
+        /* Don't clean up an object which was actively reset just now. */
+        if (obj->queue_pos[OQ_CLEAN_UP])
+            requeue_object(OQ_CLEAN_UP, obj, current_time + 1);
+    } /* while (due resets) */
 
-        /* If enough time has passed, give the object a chance to self-
-         * destruct. The O_RESET_STATE is saved over the call to clean_up().
-         *
-         * Only call clean_up in objects that have defined such a function.
-         * Only if the clean_up returns a non-zero value, it will be called
-         * again.
-         *
-         * The cleanup is not called if the object was actively reset
-         * just before.
-         */
-        if (time_to_cleanup > 0
-          && obj->flags & O_WILL_CLEAN_UP
-          && time_since_ref > time_to_cleanup
-          && !bResetCalled
-          && (!did_swap || !comm_time_to_call_heart_beat))
-        {
-            int save_reset_state = obj->flags & O_RESET_STATE;
-            svalue_t *svp;
+
+    /* ------ Clean Up ------ */
+
+    /* If enough time has passed, give the object a chance to self-
+     * destruct. The O_RESET_STATE is saved over the call to clean_up().
+     *
+     * Only call clean_up in objects that have defined such a function.
+     * Only if the clean_up returns a non-zero value, it will be called
+     * again.
+     */
+    while ((!did_swap || !comm_time_to_call_heart_beat)
+        && NULL != (obj = next_due_object(OQ_CLEAN_UP, &due)))
+    {
+        int save_reset_state = obj->flags & O_RESET_STATE;
+        svalue_t *svp;
+
+        clear_state();
+        count_due_object(OQ_CLEAN_UP, due);
 
 #ifdef DEBUG
-            if (d_flag)
-                fprintf(stderr, "%s CLEANUP %s\n", time_stamp(), get_txt(obj->name));
+        if (d_flag)
+            fprintf(stderr, "%s CLEANUP %s\n", time_stamp(), get_txt(obj->name));
 #endif
 
-            did_swap = MY_TRUE;
+        did_swap = MY_TRUE;
+        requeue_object(OQ_CLEAN_UP, obj, current_time + time_to_cleanup + 1);
 
-            /* Remove all pending destructed objects, to get a true refcount.
-             * But make sure that we don't clobber anything else while
-             * doing so.
-             */
-            cleanup_stuff();
-            remove_destructed_objects(MY_FALSE);
-
-            /* Supply a flag to the object that says if this program
-             * is inherited by other objects. Cloned objects might as well
-             * believe they are not inherited. Swapped objects will not
-             * have a ref count > 1 (and will have an invalid ob->prog
-             * pointer). If the object is a blueprint, the extra reference
-             * from the program will not be counted.
-             */
-            if (obj->flags & (O_CLONE|O_REPLACED))
-                push_number(inter_sp, 0);
-            else if (O_PROG_SWAPPED(obj))
-                push_number(inter_sp, 1);
-            else if (obj->prog->blueprint == obj)
-                push_number(inter_sp, obj->prog->ref - 1);
-            else
-                push_number(inter_sp, obj->prog->ref);
+        /* Remove all pending destructed objects, to get a true refcount.
+         * But make sure that we don't clobber anything else while
+         * doing so.
+         */
+        cleanup_stuff();
+        remove_destructed_objects(MY_FALSE);
+
+        /* Supply a flag to the object that says if this program
+         * is inherited by other objects. Cloned objects might as well
+         * believe they are not inherited. Swapped objects will not
+         * have a ref count > 1 (and will have an invalid ob->prog
+         * pointer). If the object is a blueprint, the extra reference
+         * from the program will not be counted.
+         */
+        if (obj->flags & (O_CLONE|O_REPLACED))
+            push_number(inter_sp, 0);
+        else if (O_PROG_SWAPPED(obj))
+            push_number(inter_sp, 1);
+        else if (obj->prog->blueprint == obj)
+            push_number(inter_sp, obj->prog->ref - 1);
+        else
+            push_number(inter_sp, obj->prog->ref);
 
-            RESET_LIMITS;
-            CLEAR_EVAL_COST;
-            command_giver = NULL;
-            previous_ob = NULL;
-            trace_level = 0;
-            if (driver_hook[H_CLEAN_UP].type == T_CLOSURE)
-            {
-                lambda_t *l;
+        RESET_LIMITS;
+        CLEAR_EVAL_COST;
+        command_giver = NULL;
+        previous_ob = NULL;
+        trace_level = 0;
+        if (driver_hook[H_CLEAN_UP].type == T_CLOSURE)
+        {
+            lambda_t *l;
 
-                mark_start_evaluation();
-                l = driver_hook[H_CLEAN_UP].u.lambda;
-                if (driver_hook[H_CLEAN_UP].x.closure_type == CLOSURE_LAMBDA)
-                {
-                    free_object(l->ob, "clean_up");
-                    l->ob = ref_object(obj, "clean_up");
-                }
-                push_ref_object(inter_sp, obj, "clean up");
-                call_lambda(&driver_hook[H_CLEAN_UP], 2);
-                svp = inter_sp;
-                pop_stack();
-                mark_end_evaluation();
-            }
-            else if (driver_hook[H_CLEAN_UP].type == T_STRING)
-            {
-                mark_start_evaluation();
-                svp = apply(driver_hook[H_CLEAN_UP].u.str, obj, 1);
-                mark_end_evaluation();
-            }
-            else
-            {
-                pop_stack();
-                goto no_clean_up;
-            }
-            if (obj->flags & O_DESTRUCTED)
+            mark_start_evaluation();
+            l = driver_hook[H_CLEAN_UP].u.lambda;
+            if (driver_hook[H_CLEAN_UP].x.closure_type == CLOSURE_LAMBDA)
             {
-                continue;
+                free_object(l->ob, "clean_up");
+                l->ob = ref_object(obj, "clean_up");
             }
+            push_ref_object(inter_sp, obj, "clean up");
+            call_lambda(&driver_hook[H_CLEAN_UP], 2);
+            svp = inter_sp;
+            pop_stack();
+            mark_end_evaluation();
+        }
+        else if (driver_hook[H_CLEAN_UP].type == T_STRING)
+        {
+            mark_start_evaluation();
+            svp = apply(driver_hook[H_CLEAN_UP].u.str, obj, 1);
+            mark_end_evaluation();
+        }
+        else
+        {
+            pop_stack();
+            goto no_clean_up;
+        }
+        if (obj->flags & O_DESTRUCTED)
+        {
+            continue;
+        }
 
-            if (!svp
-             || (svp->type == T_NUMBER && svp->u.number == 0)
-               )
-                obj->flags &= ~O_WILL_CLEAN_UP;
-            obj->flags |= save_reset_state;
+        if (!svp
+         || (svp->type == T_NUMBER && svp->u.number == 0)
+           )
+            obj->flags &= ~O_WILL_CLEAN_UP;
+        obj->flags |= save_reset_state;
 
 no_clean_up:
-            obj->time_of_ref = current_time;
-                  /* in case the hook didn't update it */
-        }
+        obj->time_of_ref = current_time;
+              /* in case the hook didn't update it */
+        requeue_object(OQ_CLEAN_UP, obj, current_time + 1);
+    } /* while (due clean_ups) */
 
 
-        /* ------ Data Cleanup ------ */
+    /* ------ Data Cleanup ------ */
+
+    /* Objects are processed at intervals determined by their
+     * time to clean up.
+     */
+    while ((num_last_data_cleaned == 0 || !comm_time_to_call_heart_beat)
+        && num_last_data_cleaned < limit_data_clean
+        && NULL != (obj = next_due_object(OQ_DATA_CLEANUP, &due)))
+    {
+        count_due_object(OQ_DATA_CLEANUP, due);
 
-        /* Objects are processed at intervals determined by their
-         * time to clean up.
-         */
-        if ( (num_last_data_cleaned == 0 || !comm_time_to_call_heart_beat)
-            && ((unsigned long)obj->time_cleanup < (unsigned long)current_time)
-            && (num_last_data_cleaned < limit_data_clean)
-           )
-        {
 #ifdef DEBUG
-            if (d_flag)
-                fprintf(stderr, "%s DATA CLEANUP %s\n"
-                              , time_stamp(), get_txt(obj->name));
+        if (d_flag)
+            fprintf(stderr, "%s DATA CLEANUP %s\n"
+                          , time_stamp(), get_txt(obj->name));
 #endif
 
-            cleanup_object(obj);
-            num_last_data_cleaned++;
-        }
+        cleanup_object(obj);
+        num_last_data_cleaned++;
+        requeue_object(OQ_DATA_CLEANUP, obj, current_time + 1);
+    } /* while (due data cleanups) */
 
 
-        /* ------ Swapping ------ */
-
-        /* At last, there is a possibility that the object can be swapped
-         * out.
-         *
-         * Variables are swapped after time_to_swap_variables has elapsed
-         * since the last ref, and if the object is either still reset or
-         * the next reset is at least min(5 minutes, time_to_swap_variables/2)
-         * in the future. When a reset is due, this second condition delays the
-         * costly variable swapping until after the reset.
-         *
-         * Programs are swapped after time_to_swap has elapsed, and if
-         * they have only one reference, ie are not cloned or inherited.
-         * Since program swapping is relatively cheap, no care is
-         * taken of resets.
-         */
+    /* ------ Swapping ------ */
+
+    /* At last, there is a possibility that the object can be swapped
+     * out.
+     *
+     * Variables are swapped after time_to_swap_variables has elapsed
+     * since the last ref, and if the object is either still reset or
+     * the next reset is at least min(5 minutes, time_to_swap_variables/2)
+     * in the future. When a reset is due, this second condition delays the
+     * costly variable swapping until after the reset.
+     *
+     * Programs are swapped after time_to_swap has elapsed, and if
+     * they have only one reference, ie are not cloned or inherited.
+     * Since program swapping is relatively cheap, no care is
+     * taken of resets.
+     */
+    while ((!did_swap || !comm_time_to_call_heart_beat)
+        && NULL != (obj = next_due_object(OQ_SWAP, &due)))
+    {
+        count_due_object(OQ_SWAP, due);
+        time_since_ref = current_time - obj->time_of_ref;
+        requeue_object(OQ_SWAP, obj, current_time + swap_interval());
 
-        if ( (time_to_swap > 0 || time_to_swap_variables > 0)
-         && !(obj->flags & O_HEART_BEAT)
-         && (!did_swap || !comm_time_to_call_heart_beat))
+        if (obj->flags & O_HEART_BEAT)
+            continue;
+
+        /* Swap the variables, if possible */
+        if (!O_VAR_SWAPPED(obj)
+         && time_since_ref >= time_to_swap_variables
+         && time_to_swap_variables > 0
+         && obj->variables
+         && ( obj->flags & O_RESET_STATE
+           || !obj->time_reset
+           || (obj->time_reset - current_time > min_time_to_swap)))
         {
-            /* Swap the variables, if possible */
-            if (!O_VAR_SWAPPED(obj)
-             && time_since_ref >= time_to_swap_variables
-             && time_to_swap_variables > 0
-             && obj->variables
-             && ( obj->flags & O_RESET_STATE
-               || !obj->time_reset
-               || (obj->time_reset - current_time > min_time_to_swap)))
-            {
 #ifdef DEBUG
-                if (d_flag)
-                   fprintf(stderr, "%s swap vars of %s\n", time_stamp(), get_txt(obj->name));
+            if (d_flag)
+               fprintf(stderr, "%s swap vars of %s\n", time_stamp(), get_txt(obj->name));
 #endif
-                swap_variables(obj);
-                if (O_VAR_SWAPPED(obj))
-                    did_swap = MY_TRUE;
-            }
+            swap_variables(obj);
+            if (O_VAR_SWAPPED(obj))
+                did_swap = MY_TRUE;
+        }
 
-            /* Swap the program, if possible */
-            if (!O_PROG_SWAPPED(obj)
-             && obj->prog->ref == 1
-             && time_since_ref >= time_to_swap
-             && time_to_swap > 0)
-            {
+        /* Swap the program, if possible */
+        if (!O_PROG_SWAPPED(obj)
+         && obj->prog->ref == 1
+         && time_since_ref >= time_to_swap
+         && time_to_swap > 0)
+        {
 #ifdef DEBUG
-                if (d_flag)
-                    fprintf(stderr, "%s swap %s\n", time_stamp(), get_txt(obj->name));
+            if (d_flag)
+                fprintf(stderr, "%s swap %s\n", time_stamp(), get_txt(obj->name));
 #endif
-                swap_program(obj);
-                if (O_PROG_SWAPPED(obj))
-                    did_swap = MY_TRUE;
-            }
-        } /* if (obj can be swapped) */
-
-    } /* End of loop */
+            swap_program(obj);
+            if (O_PROG_SWAPPED(obj))
+                did_swap = MY_TRUE;
+        }
+    } /* while (due swaps) */
 
     /* Update the processing averages
      */
@@ -1402,6 +1750,77 @@ no_clean_up:
     rt_context = error_recovery_info.rt.last;
 } /* process_objects() */
 
+/*-------------------------------------------------------------------------*/
+void
+object_queue_status (strbuf_t *sbuf)
+
+/* Add the status of the process_objects() queues to <sbuf>.
+ */
+
+{
+    int qnum;
+
+    for (qnum = 0; qnum < OQ_NUM_QUEUES; qnum++)
+    {
+        struct obj_queue_s *q = &obj_queues[qnum];
+
+        strbuf_addf(sbuf, "%-12s queue: %8"PRIdPINT" objects, "
+                          "%5u handled in last cycle "
+                          "(max. %"PRIdMPINT" s late - avg. %5.1lf s)\n"
+                   , obj_queue_names[qnum], q->size, q->num_processed
+                   , q->max_lateness, q->lateness.weighted_avg);
+    }
+} /* object_queue_status() */
+
+/*-------------------------------------------------------------------------*/
+void
+backend_driver_info (svalue_t *svp, int value)
+
+/* Returns the object queue information for driver_info(<what>).
+ * <svp> points to the svalue for the result.
+ */
+
+{
+    switch (value)
+    {
+        case DI_NUM_OBJECTS_IN_RESET_QUEUE:
+            put_number(svp, obj_queues[OQ_RESET].size);
+            break;
+
+        case DI_NUM_OBJECTS_IN_CLEAN_UP_QUEUE:
+            put_number(svp, obj_queues[OQ_CLEAN_UP].size);
+            break;
+
+        case DI_NUM_OBJECTS_IN_DATA_CLEANUP_QUEUE:
+            put_number(svp, obj_queues[OQ_DATA_CLEANUP].size);
+            break;
+
+        case DI_NUM_OBJECTS_IN_SWAP_QUEUE:
+            put_number(svp, obj_queues[OQ_SWAP].size);
+            break;
+
+        case DI_LOAD_AVERAGE_RESET_LATENESS:
+            put_float(svp, obj_queues[OQ_RESET].lateness.weighted_avg);
+            break;
+
+        case DI_LOAD_AVERAGE_CLEAN_UP_LATENESS:
+            put_float(svp, obj_queues[OQ_CLEAN_UP].lateness.weighted_avg);
+            break;
+
+        case DI_LOAD_AVERAGE_DATA_CLEANUP_LATENESS:
+            put_float(svp, obj_queues[OQ_DATA_CLEANUP].lateness.weighted_avg);
+            break;
+
+        case DI_LOAD_AVERAGE_SWAP_LATENESS:
+            put_float(svp, obj_queues[OQ_SWAP].lateness.weighted_avg);
+            break;
+
+        default:
+            fatal("Unknown option for backend_driver_info(): %d\n", value);
+            break;
+    }
+} /* backend_driver_info() */
+
 /*-------------------------------------------------------------------------*/
 void
 preload_objects (int eflag)
@@ -56,6 +56,11 @@ extern void update_statistic (statistic_t * pStat, long number);
 extern void update_statistic_avg (statistic_t * pStat, long number);
 extern double relate_statistics (statistic_t sStat, statistic_t sRef);
 extern void update_compile_av (int lines);
+extern void schedule_object (object_t *ob);
+extern void unschedule_object (object_t *ob);
+extern void reschedule_swapping (void);
+extern void object_queue_status (strbuf_t *sbuf);
+extern void backend_driver_info (svalue_t *svp, int value) __attribute__((nonnull(1)));
 extern svalue_t *v_garbage_collection(svalue_t *sp, int num_arg);
 
 /* --- Macros --- */
@@ -10,10 +10,12 @@
  * callouts), the callouts of one user can use only MAX_EVAL_COST at
  * one time altogether.
  *
- * Pending call outs are held in a list, sorted in ascending order of
- * remaining delaytime. The actual delay values stored are deltas: the
- * delay this callout is to be scheduled after its predecessor in
- * the list.
+ * Pending call outs are held in a hierarchical timing wheel, keyed by
+ * their absolute due time. Scheduling and removing a callout is O(1),
+ * callouts with the same due time are executed in the order they were
+ * created. Additionally every callout is kept in a list of the object
+ * it is bound to (object_t.call_outs), so that find_call_out() and
+ * remove_call_out() have to search only the callouts of that one object.
  *
  * TODO: It would be nice if the callout would store from where the
  * TODO:: callout originated and fake a control-stack entry for a proper
@@ -50,30 +52,97 @@
 
 /*-------------------------------------------------------------------------*/
 
+/* The timing wheel: CO_WHEEL_LEVELS levels of CO_WHEEL_SIZE slots each.
+ * Level 0 has a resolution of one second, every further level covers
+ * CO_WHEEL_SIZE times the span of the previous one. With 6 levels of
+ * 64 slots, 2^36 seconds can be represented, which is more than enough
+ * for any delay expressed as int.
+ */
+
+#define CO_WHEEL_BITS    6
+#define CO_WHEEL_SIZE    (1 << CO_WHEEL_BITS)
+#define CO_WHEEL_MASK    (CO_WHEEL_SIZE - 1)
+#define CO_WHEEL_LEVELS  6
+
+#define CO_WHEEL_SPAN(level) ((mp_int)1 << (CO_WHEEL_BITS * (level)))
+  /* The time span covered by one slot in wheel <level>.
+   */
+
+/*-------------------------------------------------------------------------*/
+
+  /* One slot in the timing wheel: a doubly linked list of callouts,
+   * sorted in ascending order of .seq.
+   */
+
+struct call_slot_s {
+    call_t *first;
+    call_t *last;
+};
+
   /* The description of one callout.
    *
    * The function to call be either given by object:name or as closure.
    */
 
-struct call {
-    struct call *next;   /* link to next structure */
-    /* TODO: p_int or mp_int */ int delta;           /* Delay in relation to the previous structure */
+struct call_s {
+    call_t *next;        /* Next callout in the same wheel slot */
+    call_t *prev;        /* Previous callout in the same wheel slot */
+    struct call_slot_s *slot;  /* The wheel slot the callout is in */
+    call_t *ob_next;     /* Next callout of the same object */
+    call_t *ob_prev;     /* Previous callout of the same object */
+    object_t *ob;
+      /* The object the callout is bound to, and in whose .call_outs list
+       * it is kept. This is the object callback_object() returns,
+       * but also when it is destructed. The reference is held by .fun.
+       */
+    mp_int when;         /* Absolute time when the callout is due */
+    p_uint seq;          /* Creation number, to keep callouts in FIFO order */
     callback_t fun;
     object_t *command_giver;  /* the saved command_giver */
 };
 
+static struct call_slot_s call_wheel[CO_WHEEL_LEVELS][CO_WHEEL_SIZE];
+  /* The timing wheel holding all pending call_outs.
+   * A callout due at time <when> is kept in the lowest level whose span
+   * covers the distance to wheel_time, in slot
+   * (<when> >> (CO_WHEEL_BITS * level)) & CO_WHEEL_MASK. Whenever the
+   * wheel_time enters a new slot of a higher level, the callouts in that
+   * slot are redistributed into the lower levels ('cascaded').
+   */
 
-static struct call *call_list = NULL;
-  /* The list of pending call_outs, sorted in ascending order of delay.
+#define CO_WHEEL_END (&call_wheel[0][0] + CO_WHEEL_LEVELS * CO_WHEEL_SIZE)
+  /* End of the wheel when traversing all slots linearly.
+   */
+
+static mp_int wheel_time = 0;
+  /* The current time of the wheel: all callouts due before this time
+   * have been executed. This time never advances beyond current_time.
+   */
+
+static p_uint call_seq = 0;
+  /* Sequence number for the next callout.
    */
 
 static long num_callouts = 0;
   /* Number of active callouts.
    */
 
+static statcounter_t num_lookups = 0;
+  /* Statistics: Number of find_call_out() and remove_call_out() lookups.
+   */
+
+static statcounter_t num_lookup_steps = 0;
+  /* Statistics: Number of callouts inspected during those lookups.
+   */
+
+static statcounter_t num_removed_by_destruct = 0;
+  /* Statistics: Number of callouts removed because their object
+   * was destructed.
+   */
+
 /*-------------------------------------------------------------------------*/
 static INLINE void
-free_call (struct call *cop)
+free_call (call_t *cop)
 
 /* Deallocate all resources bound to <cop> and put <cop> into the free list.
  * This can be used for used and unused callouts alike.
@@ -90,37 +159,203 @@ free_call (struct call *cop)
 
 /*-------------------------------------------------------------------------*/
 static void
-insert_call (struct call *cop, int delay)
-  
-/* Inser the call_out structure <cop> with the <delay> into the callout
- * list.
+wheel_insert (call_t *cop)
+
+/* Insert the callout <cop> into the timing wheel according to its .when.
+ * Callouts already overdue are filed under the current wheel_time.
  */
 
 {
-    struct call   **copp;   /* Auxiliary pointers for list insertion */
-    struct call    *cop2;
+    struct call_slot_s *slot;
+    call_t *prev;
+    mp_int when, diff;
+    int level;
+
+    when = cop->when;
+    if (when < wheel_time)
+        when = wheel_time;
+    diff = when - wheel_time;
+
+    for (level = 0
+        ; level < CO_WHEEL_LEVELS-1 && diff >= CO_WHEEL_SPAN(level+1)
+        ; level++)
+        NOOP;
+
+    slot = &call_wheel[level][(when >> (CO_WHEEL_BITS * level)) & CO_WHEEL_MASK];
+
+    /* Keep the slot sorted by creation, so that callouts with the
+     * same due time are executed in FIFO order. New callouts simply go to
+     * the end, only cascaded callouts may have to move in front of
+     * younger ones.
+     */
+    for (prev = slot->last; prev && prev->seq > cop->seq; prev = prev->prev)
+        NOOP;
 
-    num_callouts++;
-    for (copp = &call_list; NULL != (cop2 = *copp); copp = &cop2->next)
+    cop->slot = slot;
+    cop->prev = prev;
+    if (prev)
+    {
+        cop->next = prev->next;
+        prev->next = cop;
+    }
+    else
     {
-        int delta;
-        /* Insert the call_out *after* calls with the same delay (FIFO). */
-        if ((delta = cop2->delta) > delay)
+        cop->next = slot->first;
+        slot->first = cop;
+    }
+    if (cop->next)
+        cop->next->prev = cop;
+    else
+        slot->last = cop;
+} /* wheel_insert() */
+
+/*-------------------------------------------------------------------------*/
+static void
+wheel_remove (call_t *cop)
+
+/* Remove the callout <cop> from the timing wheel.
+ */
+
+{
+    if (cop->prev)
+        cop->prev->next = cop->next;
+    else
+        cop->slot->first = cop->next;
+
+    if (cop->next)
+        cop->next->prev = cop->prev;
+    else
+        cop->slot->last = cop->prev;
+
+    cop->next = cop->prev = NULL;
+} /* wheel_remove() */
+
+/*-------------------------------------------------------------------------*/
+static void
+unlink_call (call_t *cop)
+
+/* Remove the callout <cop> from the timing wheel and from the list
+ * of its object. The callout itself is not freed.
+ */
+
+{
+    wheel_remove(cop);
+
+    if (cop->ob_prev)
+        cop->ob_prev->ob_next = cop->ob_next;
+    else
+        cop->ob->call_outs = cop->ob_next;
+    if (cop->ob_next)
+        cop->ob_next->ob_prev = cop->ob_prev;
+
+    num_callouts--;
+} /* unlink_call() */
+
+/*-------------------------------------------------------------------------*/
+static void
+cascade_wheel (void)
+
+/* The wheel_time just advanced: if it entered a new slot in any of
+ * the higher levels, redistribute the callouts of those slots into
+ * the lower levels.
+ */
+
+{
+    int level;
+
+    if (wheel_time & CO_WHEEL_MASK)
+        return;
+
+    for (level = 1; level < CO_WHEEL_LEVELS; level++)
+    {
+        struct call_slot_s *slot;
+        call_t *cop, *next;
+        int ix;
+
+        ix = (wheel_time >> (CO_WHEEL_BITS * level)) & CO_WHEEL_MASK;
+        slot = &call_wheel[level][ix];
+
+        cop = slot->first;
+        slot->first = slot->last = NULL;
+        for ( ; cop != NULL; cop = next)
         {
-            cop2->delta -= delay;
-            cop->delta = delay;
-            cop->next = *copp;
-            *copp = cop;
-            return;
+            next = cop->next;
+            wheel_insert(cop);
         }
-        delay -= (delta >= 0 ? delta : 0);
-          /* Especially when called from within a call_out, delta may be
-           * negative.
-           */
+
+        if (ix)
+            break;
     }
-    *copp = cop;
-    cop->delta = delay;
-    cop->next = NULL;
+} /* cascade_wheel() */
+
+/*-------------------------------------------------------------------------*/
+static call_t *
+next_due_call (void)
+
+/* Remove the next callout due for execution from the timing wheel,
+ * and return it. If there is none, return NULL.
+ * The callout is also removed from its object's list.
+ */
+
+{
+    while (num_callouts && wheel_time <= current_time)
+    {
+        call_t *cop;
+
+        cop = call_wheel[0][wheel_time & CO_WHEEL_MASK].first;
+        if (cop)
+        {
+            unlink_call(cop);
+            return cop;
+        }
+
+        if (wheel_time == current_time)
+            break;
+
+        wheel_time++;
+        cascade_wheel();
+    }
+
+    return NULL;
+} /* next_due_call() */
+
+/*-------------------------------------------------------------------------*/
+static void
+insert_call (call_t *cop, int delay)
+  
+/* Inser the call_out structure <cop> with the <delay> into the callout
+ * wheel and the list of its object.
+ */
+
+{
+    object_t *ob;
+
+    /* With no callouts pending, the wheel can be moved to the current
+     * time without any further work.
+     */
+    if (!num_callouts)
+        wheel_time = current_time;
+
+    num_callouts++;
+
+    cop->when = current_time + delay;
+    cop->seq = call_seq++;
+    wheel_insert(cop);
+
+    /* File the callout under its object. */
+    if (cop->fun.is_lambda)
+        ob = !CLOSURE_MALLOCED(cop->fun.function.lambda.x.closure_type)
+             ? cop->fun.function.lambda.u.ob
+             : cop->fun.function.lambda.u.lambda->ob;
+    else
+        ob = cop->fun.function.named.ob;
+
+    cop->ob = ob;
+    cop->ob_prev = NULL;
+    cop->ob_next = ob->call_outs;
+    if (cop->ob_next)
+        cop->ob_next->ob_prev = cop;
+    ob->call_outs = cop;
 } /* insert_call() */
 
 /*-------------------------------------------------------------------------*/
@@ -141,7 +376,7 @@ v_call_out (svalue_t *sp, int num_arg)
 {
     svalue_t       *arg;    /* Pointer to efun arguments */
     int             delay;
-    struct call    *cop;    /* New callout structure */
+    call_t         *cop;    /* New callout structure */
     int             error_index;
 
     arg = sp - num_arg + 1;
@@ -170,7 +405,7 @@ v_call_out (svalue_t *sp, int num_arg)
      * usage. Any overhead savings by a pool are more than made up
      * by the unused structures sitting around.
      */
-    cop = pxalloc(sizeof (struct call));
+    cop = pxalloc(sizeof (call_t));
 
     /* Get the function designation from the stack */
 
@@ -220,31 +455,17 @@ v_call_out (svalue_t *sp, int num_arg)
 void
 next_call_out_cycle (void)
 
-/* Starts the next call_out cycle by decrementing the first delta.
+/* Starts the next call_out cycle.
  * This function is called in the backend cycle before heart_beats are handled.
+ *
+ * As the callouts store their absolute due time, there is not much to
+ * do here: if no calls are pending, the wheel is just moved to the
+ * current time.
  */
 
 {
-    static int last_time;
-      /* Last time this function was called */
-
-    /* No calls pending: just update the last_time and return */
-
-    if (call_list == NULL)
-    {
-        last_time = current_time;
-        return;
-    }
-
-    /* If not set yet, initialize last_time on the first call */
-    if (last_time == 0)
-        last_time = current_time;
-
-    /* Update the first .delta in the list.
-     */
-    call_list->delta -= current_time - last_time;
-
-    last_time = current_time;
+    if (!num_callouts)
+        wheel_time = current_time;
 } /* next_call_out_cycle() */
 
 
@@ -259,7 +480,7 @@ call_out (void)
  */
 
 {
-    static struct call *current_call_out;
+    static call_t *current_call_out;
       /* Current callout, static so that longjmp() won't clobber it. */
 
     static object_t *called_object;
@@ -269,7 +490,7 @@ call_out (void)
 
     /* No calls pending: fine. */
 
-    if (call_list == NULL)
+    if (!num_callouts)
         return;
 
     current_interactive = NULL;
@@ -284,7 +505,7 @@ call_out (void)
     {
         /* An error occured: recover and delete the guilty callout */
 
-        struct call *cop;
+        call_t *cop;
         object_t *ob;
         wiz_list_t *user;
 
@@ -308,30 +529,15 @@ call_out (void)
 
     tracedepth = 0;
 
-    /* Loop over the call list until it is empty or until all
-     * due callouts are processed.
+    /* Loop over the call wheel until all due callouts are processed.
      */
-    while (call_list && call_list->delta <= 0)
+    while (NULL != (current_call_out = next_due_call()))
     {
         object_t    *ob;
-        struct call *cop;
+        call_t      *cop;
         wiz_list_t  *user;
 
-        /* Move the first callout out of the chain.
-         */
-        cop = call_list;
-        call_list = cop->next;
-        current_call_out = cop;
-        num_callouts--;
-
-        /* A special case:
-         * If a lot of time has passed, so that current call out was missed,
-         * then it will have a negative delta. This negative delta implies
-         * that the next call out in the list has to be adjusted.
-         */
-        if (cop->delta < 0 && call_list)
-            call_list->delta += cop->delta;
-
+        cop = current_call_out;
 
         /* Get the object for the function call and make sure it's valid */
 
@@ -450,6 +656,18 @@ call_out (void)
     rt_context = error_recovery_info.rt.last;
 } /* call_out() */
 
+/*-------------------------------------------------------------------------*/
+static INLINE Bool
+call_before (call_t *cop, call_t *cop2)
+
+/* Return TRUE if callout <cop> is due before callout <cop2>.
+ */
+
+{
+    return cop->when < cop2->when
+        || (cop->when == cop2->when && cop->seq < cop2->seq);
+} /* call_before() */
+
 /*-------------------------------------------------------------------------*/
 static void
 find_call_out (object_t *ob, svalue_t *fun, Bool do_free_call)
@@ -459,89 +677,106 @@ find_call_out (object_t *ob, svalue_t *fun, Bool do_free_call)
  *
  * In either case, *<fun> is modified into a NUMBER holding the time left
  * for the found/removed callout. If no callout was found, -1 is returned.
+ *
+ * Named callouts and callouts to lfun or lambda closures are looked up
+ * in the list of their object only. Efun, operator and simul-efun closures
+ * compare equal regardless of their bound object, so for these all
+ * pending callouts are searched.
  */
 
 {
-    struct call **copp, *cop;
-    int delay = 0;
-    string_t *fun_name;
+    call_t *cop, *found;
+    mp_int delay;
+
+    found = NULL;
+    num_lookups++;
 
     /* Find callout by closure */
 
     if (fun->type != T_STRING)
     {
-        if (fun->type == T_CLOSURE)
+        if (fun->type != T_CLOSURE)
+        {
+            fatal("find_call_out() got %s, expected string/closure.\n"
+                 , typename(fun->type));
+            /* NOTREACHED */
+        }
+
+        if (CLOSURE_MALLOCED(fun->x.closure_type) && fun->u.lambda->ob)
         {
-            for (copp = &call_list; NULL != (cop = *copp); copp = &cop->next)
+            for (cop = fun->u.lambda->ob->call_outs; cop; cop = cop->ob_next)
             {
-                delay += cop->delta;
+                num_lookup_steps++;
                 if (cop->fun.is_lambda
+                 && (!found || call_before(cop, found))
                  && closure_eq(&(cop->fun.function.lambda), fun)
                    )
-                {
-                    goto found;
-                }
+                    found = cop;
             }
+        }
+        else
+        {
+            struct call_slot_s *slot;
 
-            /* Not found */
-            free_svalue(fun);
-            put_number(fun, -1);
-            return;
-found:
-            free_svalue(fun);
-            if (do_free_call)
+            for (slot = &call_wheel[0][0]; slot < CO_WHEEL_END; slot++)
             {
-                if (cop->next)
-                    cop->next->delta += cop->delta;
-                *copp = cop->next;
-                free_call(cop);
-                num_callouts--;
+                for (cop = slot->first; cop; cop = cop->next)
+                {
+                    num_lookup_steps++;
+                    if (cop->fun.is_lambda
+                     && (!found || call_before(cop, found))
+                     && closure_eq(&(cop->fun.function.lambda), fun)
+                       )
+                        found = cop;
+                }
             }
-            /* It is possible to have delay < 0 if we are
-             * called from inside call_out() .
-             */
-            if (delay < 0)
-                delay = 0;
-            put_number(fun, delay);
-            return;
         }
-        fatal("find_call_out() got %s, expected string/closure.\n"
-             , typename(fun->type));
-        /* NOTREACHED */
     }
+    else
+    {
+        /* Find callout by object/name */
 
+        string_t *fun_name;
 
-    /* Find callout by object/name */
-
-    fun_name = find_tabled(fun->u.str);
+        fun_name = find_tabled(fun->u.str);
 
-    if (fun_name != NULL)
-    for (copp = &call_list; NULL != (cop = *copp); copp = &cop->next)
-    {
-        delay += cop->delta;
-        if (cop->fun.function.named.ob == ob
-         && cop->fun.function.named.name == fun_name
-         && !cop->fun.is_lambda)
+        if (fun_name != NULL)
         {
-            if (do_free_call)
+            for (cop = ob->call_outs; cop; cop = cop->ob_next)
             {
-                if (cop->next)
-                    cop->next->delta += cop->delta;
-                *copp = cop->next;
-                free_call(cop);
-                num_callouts--;
+                num_lookup_steps++;
+                if (!cop->fun.is_lambda
+                 && cop->fun.function.named.ob == ob
+                 && cop->fun.function.named.name == fun_name
+                 && (!found || call_before(cop, found))
+                   )
+                    found = cop;
             }
-            if (delay < 0)
-                delay = 0;
-            free_svalue(fun);
-            put_number(fun, delay);
-            return;
         }
-    } /* if()for() */
+    }
 
-    /* Not found */
     free_svalue(fun);
-    put_number(fun, -1);
+
+    if (!found)
+    {
+        put_number(fun, -1);
+        return;
+    }
+
+    /* It is possible to have delay < 0 if we are
+     * called from inside call_out() .
+     */
+    delay = found->when - current_time;
+    if (delay < 0)
+        delay = 0;
+
+    if (do_free_call)
+    {
+        unlink_call(found);
+        free_call(found);
+    }
+
+    put_number(fun, delay);
 } /* find_call_out() */
 
 /*-------------------------------------------------------------------------*/
@@ -559,15 +794,22 @@ call_out_status (strbuf_t *sbuf, Bool verbose)
         strbuf_add(sbuf, "\nCall out information:\n");
         strbuf_add(sbuf,"---------------------\n");
         strbuf_addf(sbuf, "Number of call outs: %8ld, %8ld bytes\n",
-                    num_callouts, num_callouts * sizeof (struct call));
+                    num_callouts, num_callouts * sizeof (call_t));
+        strbuf_addf(sbuf, "Lookups: %"PRIuSTATCOUNTER", %"PRIuSTATCOUNTER
+                          " steps (%.1f per lookup)\n"
+                   , num_lookups, num_lookup_steps
+                   , num_lookups ? (double)num_lookup_steps / num_lookups
+                                 : 0.0);
+        strbuf_addf(sbuf, "Removed by destruct: %"PRIuSTATCOUNTER"\n"
+                   , num_removed_by_destruct);
     }
     else
     {
         strbuf_addf(sbuf, "call out:\t\t\t%8ld %9ld\n"
-                   , num_callouts, num_callouts * sizeof (struct call));
+                   , num_callouts, num_callouts * sizeof (call_t));
     }
 
-    return num_callouts * sizeof (struct call);
+    return num_callouts * sizeof (call_t);
 } /* call_out_status() */
 
 /*-------------------------------------------------------------------------*/
@@ -586,7 +828,19 @@ callout_driver_info (svalue_t *svp, int value)
             break;
 
         case DI_SIZE_CALLOUTS:
-            put_number(svp, num_callouts * sizeof(struct call));
+            put_number(svp, num_callouts * sizeof(call_t));
+            break;
+
+        case DI_NUM_CALLOUT_LOOKUPS:
+            put_number(svp, num_lookups);
+            break;
+
+        case DI_NUM_CALLOUT_LOOKUP_STEPS:
+            put_number(svp, num_lookup_steps);
+            break;
+
+        case DI_NUM_CALLOUTS_REMOVED_BY_DESTRUCT:
+            put_number(svp, num_removed_by_destruct);
             break;
 
         default:
@@ -606,45 +860,61 @@ count_extra_ref_from_call_outs (void)
  */
 
 {
-    struct call *cop;
+    struct call_slot_s *slot;
+    call_t *cop;
 
-    for (cop = call_list; cop; cop = cop->next)
+    for (slot = &call_wheel[0][0]; slot < CO_WHEEL_END; slot++)
     {
-        count_callback_extra_refs(&(cop->fun));
-        if (cop->command_giver)
-            count_extra_ref_in_object(cop->command_giver);
+        for (cop = slot->first; cop; cop = cop->next)
+        {
+            count_callback_extra_refs(&(cop->fun));
+            if (cop->command_giver)
+                count_extra_ref_in_object(cop->command_giver);
+        }
     }
 }
 
 #endif
 
+/*-------------------------------------------------------------------------*/
+void
+remove_object_call_outs (object_t *ob)
+
+/* Remove all callouts bound to the destructed object <ob>.
+ * This is called when the object is finally removed, and has to touch
+ * only the callouts of this object.
+ */
+
+{
+    call_t *cop;
+
+    while (NULL != (cop = ob->call_outs))
+    {
+        unlink_call(cop);
+        free_call(cop);
+        num_removed_by_destruct++;
+    }
+} /* remove_object_call_outs() */
+
 /*-------------------------------------------------------------------------*/
 void
 remove_stale_call_outs (void)
 
 /* GC and statistics support: Remove all callouts referencing destructed
  * objects.
+ *
+ * Callouts are filed under their object, so only the lists of destructed
+ * objects have to be checked. The object lists themselves hold a reference
+ * to the objects, so freeing the callouts can't free the objects.
  */
 
 {
-    struct call **copp, *cop;
-
-    for (copp = &call_list; NULL != (cop = *copp); )
-    {
-        object_t *ob;
+    object_t *ob;
 
-        ob = callback_object(&(cop->fun));
-        if (!ob)
-        {
-            num_callouts--;
-            if (cop->next)
-                cop->next->delta += cop->delta;
-            *copp = cop->next;
-            free_call(cop);
-            continue;
-        }
-        copp = &cop->next;
-    }
+    for (ob = newly_destructed_objs; ob != NULL; ob = ob->next_all)
+        remove_object_call_outs(ob);
+    for (ob = destructed_objs; ob != NULL; ob = ob->next_all)
+        remove_object_call_outs(ob);
 } /* remove_stale_call_outs() */
 
 
@@ -658,16 +928,20 @@ clear_ref_from_call_outs (void)
  */
 
 {
-    struct call *cop;
+    struct call_slot_s *slot;
+    call_t *cop;
 
-    for (cop = call_list; cop; cop = cop->next)
+    for (slot = &call_wheel[0][0]; slot < CO_WHEEL_END; slot++)
     {
-        object_t *ob;
+        for (cop = slot->first; cop; cop = cop->next)
+        {
+            object_t *ob;
 
-        clear_ref_in_callback(&(cop->fun));
+            clear_ref_in_callback(&(cop->fun));
 
-        if (NULL != (ob = cop->command_giver))
-            clear_object_ref(ob);
+            if (NULL != (ob = cop->command_giver))
+                clear_object_ref(ob);
+        }
     }
 } /* clear_ref_from_call_outs() */
 
@@ -679,20 +953,24 @@ count_ref_from_call_outs (void)
  */
 
 {
-    struct call *cop;
+    struct call_slot_s *slot;
+    call_t *cop;
     object_t *ob;
 
-    for (cop = call_list; cop; cop = cop->next)
+    for (slot = &call_wheel[0][0]; slot < CO_WHEEL_END; slot++)
     {
-        count_ref_in_callback(&(cop->fun));
-
-        if ( NULL != (ob = cop->command_giver) )
+        for (cop = slot->first; cop; cop = cop->next)
         {
-            if (ob->flags & O_DESTRUCTED) {
-                reference_destructed_object(ob);
-                cop->command_giver = NULL;
-            } else {
-                ob->ref++;
+            count_ref_in_callback(&(cop->fun));
+
+            if ( NULL != (ob = cop->command_giver) )
+            {
+                if (ob->flags & O_DESTRUCTED) {
+                    reference_destructed_object(ob);
+                    cop->command_giver = NULL;
+                } else {
+                    ob->ref++;
+                }
             }
         }
     }
@@ -700,48 +978,81 @@ count_ref_from_call_outs (void)
 
 #endif /* GC_SUPPORT */
 
+/*-------------------------------------------------------------------------*/
+static int
+call_cmp (const void *left, const void *right)
+
+/* qsort() comparison function: sort callouts by due time and creation.
+ */
+
+{
+    call_t *cop = *(call_t * const *)left;
+    call_t *cop2 = *(call_t * const *)right;
+
+    if (call_before(cop, cop2))
+        return -1;
+    if (call_before(cop2, cop))
+        return 1;
+    return 0;
+} /* call_cmp() */
+
 /*-------------------------------------------------------------------------*/
 static vector_t *
 get_all_call_outs (void)
 
 /* Construct an array of all pending call_outs (whose object is not
- * destructed). Every item in the array is itself an array of 4 or
- * more entries:
+ * destructed), in the order of their execution. Every item in the array
+ * is itself an array of 4 or more entries:
  *  0:   The object (only if the function is a string).
  *  1:   The function (string or closure).
  *  2:   The delay.
  *  3..: The argument(s).
+ *
+ * inter_sp has to point to the top-of-stack before calling.
  */
 {
-    int i, next_time;
-    struct call *cop;
+    int i, num;
+    struct call_slot_s *slot;
+    call_t *cop;
+    call_t **calls;
     vector_t *v;
 
-    /* Count the number of pending callouts and allocate
-     * the result array.
+    /* Collect the pending callouts and sort them by their due time:
+     * in the higher levels of the wheel they are not ordered.
      */
-    for (i = 0, cop = call_list; cop; cop = cop->next)
+    calls = xalloc_with_error_handler((num_callouts+1) * sizeof(*calls));
+    if (!calls)
     {
-        if (!callback_object(&(cop->fun)))
-            continue;
-        i++;
+        errorf("Out of memory (%zu bytes) in call_out_info()\n"
+              , (num_callouts+1) * sizeof(*calls));
+        /* NOTREACHED */
+        return NULL;
     }
-    v = allocate_array(i); /* assume that all elements are inited to 0 */
+
+    num = 0;
+    for (slot = &call_wheel[0][0]; slot < CO_WHEEL_END; slot++)
+    {
+        for (cop = slot->first; cop; cop = cop->next)
+        {
+            if (callback_object(&(cop->fun)))
+                calls[num++] = cop;
+        }
+    }
+
+    qsort(calls, num, sizeof(*calls), call_cmp);
+
+    v = allocate_array(num); /* assume that all elements are inited to 0 */
 
     /* Create the result array contents.
      */
 
-    next_time = 0;
-    for (i=0, cop = call_list; cop; cop = cop->next)
+    for (i = 0; i < num; i++)
     {
         vector_t *vv;
         object_t *ob;
 
-        next_time += cop->delta;
-
+        cop = calls[i];
         ob = callback_object(&(cop->fun));
-        if (!ob)
-            continue;
 
         /* Get the subarray */
 
@@ -763,7 +1074,7 @@ get_all_call_outs (void)
             put_ref_string(vv->item + 1, cop->fun.function.named.name);
         }
 
-        vv->item[2].u.number = next_time;
+        vv->item[2].u.number = cop->when - current_time;
 
         if (cop->fun.num_arg > 0)
         {
@@ -782,9 +1093,11 @@ get_all_call_outs (void)
         }
 
         put_array(v->item + i, vv);
-        i++;
     }
 
+    /* Free the intermediate buffer by freeing the error handler. */
+    free_svalue(inter_sp--);
+
     return v;
 } /* get_all_call_outs() */
 
@@ -808,7 +1121,11 @@ f_call_out_info (svalue_t *sp)
 {
     if (privilege_violation(STR_CALL_OUT_INFO, &const0, sp))
     {
-        push_array(sp, get_all_call_outs());
+        vector_t *v;
+
+        inter_sp = sp;
+        v = get_all_call_outs();
+        push_array(sp, v);
     }
     else
     {
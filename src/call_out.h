@@ -11,6 +11,7 @@ extern void  call_out(void);
 extern void  next_call_out_cycle(void);
 extern size_t  call_out_status(strbuf_t *sbuf, Bool verbose);
 extern void  callout_driver_info(svalue_t *svp, int value) __attribute__((nonnull(1)));
+extern void  remove_object_call_outs(object_t *ob);
 extern void  remove_stale_call_outs(void);
 
 extern svalue_t *v_call_out(svalue_t *sp, int num_arg);
@@ -79,6 +79,7 @@
 #include <stdarg.h>
 #include <stddef.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
 #include <poll.h>
 
 #define TELOPTS
@@ -135,6 +136,7 @@
 #ifdef USE_TLS
 #include "pkg-tls.h"
 #endif
+#include "poller.h"
 #include "sent.h"
 #include "simulate.h"
 #include "stdstrings.h"
@@ -148,6 +150,7 @@
 #include "../mudlib/sys/comm.h"
 #include "../mudlib/sys/configuration.h"
 #include "../mudlib/sys/driver_hook.h"
+#include "../mudlib/sys/driver_info.h"
 #include "../mudlib/sys/input_to.h"
 #include "../mudlib/sys/interactive_info.h"
 
@@ -175,9 +178,23 @@
 #    endif
 #    define socket_read   read
 #    define socket_write  write
+#    define socket_writev writev
 #    define socket_close  close
 #endif /* SOCKET_LIB */
 
+#ifdef socket_writev
+#    define WRITE_PENDING_IOV 16
+#else
+#    define WRITE_PENDING_IOV 1
+#endif
+  /* Max number of write buffers sent with one system call.
+   */
+
+#define WRITE_BUFFER_CHUNK_SIZE 4096
+  /* Minimum allocation size for the data of a write buffer. Smaller
+   * messages are collected in one buffer.
+   */
+
 #if defined(_AIX)
 typedef unsigned long length_t;
 #elif defined(__INTEL_COMPILER) || defined (__GNUC__)
@@ -245,6 +262,16 @@ p_int write_buffer_max_size = WRITE_BUFFER_MAX_SIZE;
    *  -1: Infinite queue.
    */
 
+p_int ip_name_ttl = 86400;
+  /* Time in seconds after which a resolved hostname is looked up again,
+   * set with configure_driver(DC_IP_NAME_TTL).
+   */
+
+p_int ip_name_failed_ttl = 600;
+  /* Time in seconds after which a failed hostname lookup is retried,
+   * set with configure_driver(DC_IP_NAME_FAILED_TTL).
+   */
+
 static char udp_buf[65536];
   /* Buffer for incoming UDP datagrams in get_message(). 
    * If it is too small, the rest of the to be received datagram will be
@@ -329,7 +356,7 @@ static erq_callback_t pending_erq[MAX_PENDING_ERQ+1];
 static erq_callback_t *free_erq;
   /* The first free entry in the freelist in pending_erq[] */
 
-/* The size of the IPTABLE depends on the number of users,
+/* The size of the IP name cache depends on the number of users,
  * and is at least 200.
  */
 #if MAX_PLAYERS > 700
@@ -342,22 +369,54 @@ static erq_callback_t *free_erq;
 #    endif
 #endif
 
+#define IP_NAME_PENDING_TTL     60
+  /* Time in seconds to wait for an answer from the ERQ before
+   * a lookup is sent again.
+   */
+
+enum ipentry_state { ipUnresolved = 0, ipPending, ipResolved, ipFailed };
+
 static struct ipentry {
-    struct in_addr  addr;  /* The address (only .s_addr is significant) */
-    string_t       *name;  /* tabled string with the hostname for <addr> */
+    struct in_addr  addr;  /* The address */
+    string_t       *name;
+      /* NULL for an unused entry, otherwise the tabled string with
+       * the hostname for <addr>, or the numeric address while the
+       * hostname is not known.
+       */
+    enum ipentry_state state;
+    mp_int          expires;
+      /* The current_time after which the hostname should be looked up
+       * again.
+       */
+    struct ipentry *next_hash;  /* Next entry in the hash chain */
+    struct ipentry *lru_prev;   /* Previous entry in the LRU list */
+    struct ipentry *lru_next;   /* Next entry in the LRU list */
 } iptable[IPSIZE];
   /* Cache of known names for given IP addresses.
-   * It is used as a ringbuffer, indexed by ipcur.
-   * TODO: Instead of a simple circular buffer, the lookup should be
-   * TODO:: hashed over the IP address. Worst case would still be O(IPSIZE),
-   * TODO:: but best case would be O(1).
-   * TODO: Allow unlimited numbers of entries, but give them a max lifetime
-   * TODO:: of a day. After that, even existing entries need to be
-   * TODO:: re-resolved. Maybe an additional size limit. (suggested by Coogan)
+   * The entries are hashed over the address into iphash[], and kept
+   * in a list ordered by their last use. If all entries are in use,
+   * the least recently used one is replaced.
+   */
+
+static struct ipentry *iphash[IPSIZE];
+  /* The hash chains of the iptable[] entries.
+   */
+
+static struct ipentry *ip_lru_first = NULL;
+static struct ipentry *ip_lru_last = NULL;
+  /* The iptable[] entries in use, most recently used first.
+   */
+
+static int num_ip_entries = 0;
+  /* Number of iptable[] entries in use.
    */
 
-static int ipcur = 0;
-  /* Index of the next entry to use in the iptable[].
+static statcounter_t ip_cache_hits = 0;
+static statcounter_t ip_cache_misses = 0;
+static statcounter_t ip_cache_requests = 0;
+static statcounter_t ip_cache_failures = 0;
+  /* Statistics: number of found and not found addresses, of lookups
+   * sent to the ERQ, and of failed lookups.
    */
 
 #endif /* ERQ_DEMON */
@@ -393,11 +452,6 @@ char * domain_name = NULL;
   /* This computer's domain name, as needed by lex.c::get_domainname().
    */
 
-static int min_nfds = 0;
-  /* The number of fds used by the driver's sockets (udp, erq, login).
-   * It is the number of the highest fd plus one.
-   */
-
 /* --- Telnet handling --- */
 
 Bool sending_telnet_command = MY_FALSE;
@@ -510,12 +564,14 @@ static void shutdown_erq_demon(void);
 static void stop_erq_demon(Bool);
 static string_t * lookup_ip_entry (struct in_addr addr, Bool useErq);
 static void add_ip_entry(struct in_addr addr, const char *name);
+static void fail_ip_entry(struct in_addr addr);
 #ifdef USE_IPV6
 static void update_ip_entry(const char *oldname, const char *newname);
 #endif
 
 #endif /* ERQ_DEMON */
 
+static ssize_t comm_send_iov(struct iovec *iov, int iovcnt, interactive_t *ip);
 static INLINE ssize_t comm_send_buf(char *msg, size_t size, interactive_t *ip);
 
 #ifdef USE_IPV6
@@ -1175,8 +1231,7 @@ initialize_host_ip_number (const char *hname, const char * haddr)
         }
         set_socket_nonblocking(udp_s);
         set_close_on_exec(udp_s);
-        if (socket_number(udp_s) >= min_nfds)
-            min_nfds = socket_number(udp_s)+1;
+        poller_set(socket_number(udp_s), POLLER_READ);
     }
 
 } /* initialize_host_ip_number() */
@@ -1212,6 +1267,7 @@ prepare_ipc(void)
 #ifdef ERQ_DEMON
     /* Initialize the IP name lookup table */
     memset(iptable, 0, sizeof(iptable));
+    memset(iphash, 0, sizeof(iphash));
 #endif
 
     for (i = 0; i < MAX_OUTCONN; i++)
@@ -1281,8 +1337,7 @@ prepare_ipc(void)
         set_close_on_exec(sos[i]);
         set_socket_nosigpipe(sos[i]);
 
-        if (socket_number(sos[i]) >= min_nfds)
-            min_nfds = socket_number(sos[i])+1;
+        poller_set(socket_number(sos[i]), POLLER_READ);
     } /* for(i = 0..numports) */
 
     // install some signal handlers
@@ -1327,10 +1382,11 @@ ipc_remove (void)
 } /* ipc_remove() */
 
 /*-------------------------------------------------------------------------*/
-static INLINE ssize_t
-comm_send_buf (char *msg, size_t size, interactive_t *ip)
+static ssize_t
+comm_send_iov (struct iovec *iov, int iovcnt, interactive_t *ip)
 
-/* Low level send routine, just tries to send the data without buffering. 
+/* Low level send routine, just tries to send the data of the <iovcnt>
+   buffers <iov> without buffering. Over TLS only one buffer can be sent.
    A return value -1 indicates a total failure (i.e. the connection should
    be dropped), otherwise the amount of data sent (even if it's 0).
 */
@@ -1341,12 +1397,18 @@ comm_send_buf (char *msg, size_t size, interactive_t *ip)
     for (retries = 6;;)
     {
 #ifdef USE_TLS
-        if ((n = (ip->tls_status == TLS_INACTIVE ? 
-                  (int)socket_write(ip->socket, msg, size):
-                  (int)tls_write(ip, msg, size))) != -1)
-#else
-        if ((n = (int)socket_write(ip->socket, msg, size)) != -1)
+        if (ip->tls_status != TLS_INACTIVE)
+            n = (int)tls_write(ip, iov[0].iov_base, iov[0].iov_len);
+        else
+#endif
+#ifdef socket_writev
+        if (iovcnt > 1)
+            n = socket_writev(ip->socket, iov, iovcnt);
+        else
 #endif
+            n = (int)socket_write(ip->socket, iov[0].iov_base, iov[0].iov_len);
+
+        if (n != -1)
         {
             break;
         }
@@ -1410,8 +1472,114 @@ comm_send_buf (char *msg, size_t size, interactive_t *ip)
 #endif
 
     return n;
+} /* comm_send_iov() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE ssize_t
+comm_send_buf (char *msg, size_t size, interactive_t *ip)
+
+/* Low level send routine, just tries to send the data without buffering. 
+   A return value -1 indicates a total failure (i.e. the connection should
+   be dropped), otherwise the amount of data sent (even if it's 0).
+*/
+{
+    struct iovec iov;
+
+    iov.iov_base = msg;
+    iov.iov_len = size;
+    return comm_send_iov(&iov, 1, ip);
 } /* comm_send_buf() */
 
+/*-------------------------------------------------------------------------*/
+static INLINE void
+update_poller (interactive_t *ip)
+
+/* Register the events get_message() waits for on the socket of <ip>:
+ * input always, output only while there is buffered data.
+ */
+
+{
+    poller_set(socket_number(ip->socket)
+              , POLLER_READ | (ip->write_first ? POLLER_WRITE : 0));
+} /* update_poller() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+comm_socket_send (char *buf, size_t length, interactive_t *ip, write_buffer_flag_t flags)
+
+/* Send the (already compressed) data <buf> with <length> bytes to <ip>.
+ * If no data can be send right now append them to the buffer.
+ * Returns false if the connection was dropped.
+ */
+
+{
+    struct write_buffer_s *b;
+
+    /* now sending the buffer... */
+    if (ip->write_first == NULL)
+    {
+        /* Try writing to the socket first. */
+        ssize_t n = comm_send_buf(buf, length, ip);
+
+        if (n == -1)
+            return MY_FALSE;
+        else if (n == length)
+        {
+            /* We're done. */
+            return MY_TRUE;
+        }
+        else if (n > 0)
+        {
+            buf += n;
+            length -= n;
+        }
+    }
+
+    /* We have to enqueue the message. If there is room left in the
+     * last buffer, append it there.
+     */
+
+    if (ip->write_first
+     && ip->write_last->size - ip->write_last->length >= length)
+    {
+        b = ip->write_last;
+        memcpy(b->buffer + b->length, buf, length);
+        b->length += length;
+        b->flags |= flags;
+    }
+    else
+    {
+        size_t bufsize;
+
+        bufsize = length < WRITE_BUFFER_CHUNK_SIZE ? WRITE_BUFFER_CHUNK_SIZE
+                                                   : length;
+        b = xalloc(sizeof(struct write_buffer_s) + bufsize - 1);
+        if (!b)
+            outofmem(sizeof(struct write_buffer_s) + bufsize - 1, "comm_socket_write()");
+
+        b->length = length;
+        b->size = bufsize;
+        b->pos = 0;
+        b->flags = flags;
+        b->next = NULL;
+        memcpy(b->buffer, buf, length);
+
+         /* Chain in the new buffer */
+        if (ip->write_first)
+            ip->write_last = ip->write_last->next = b;
+        else
+        {
+            ip->write_last = ip->write_first = b;
+            update_poller(ip);
+        }
+    }
+
+    ip->write_size += length;
+    ip->msg_discarded = DM_NONE;
+
+    return MY_TRUE;
+} /* comm_socket_send() */
+
 /*-------------------------------------------------------------------------*/
 Bool
 comm_socket_write (char *msg, size_t size, interactive_t *ip, write_buffer_flag_t flags)
@@ -1424,10 +1592,6 @@ comm_socket_write (char *msg, size_t size, interactive_t *ip, write_buffer_flag_
  */
 
 {
-    struct write_buffer_s *b;
-    char *buf;
-    size_t length;
-
     if (size == 0)
         return MY_TRUE;
 
@@ -1468,109 +1632,98 @@ comm_socket_write (char *msg, size_t size, interactive_t *ip, write_buffer_flag_
 #ifdef USE_MCCP
     if (ip->out_compress)
     {
-        int status;
-
+        /* Compress into the shared buffer, sending it
+         * whenever it is full.
+         */
         ip->out_compress->next_in = (unsigned char *) msg;
         ip->out_compress->avail_in = size;
 
-        ip->out_compress->next_out = ip->out_compress_buf;
-        ip->out_compress->avail_out = COMPRESS_BUF_SIZE;
-
-        status = deflate(ip->out_compress, Z_SYNC_FLUSH);
-
-        if (status != Z_OK)
-        {
-            fprintf(stderr, "%s comm: MCCP compression error: %d\n"
-                          , time_stamp(), status);
-            return MY_FALSE;
-        }
-
-        /* ok.. perhaps i should take care that all data in message_buf
-         * is compressed, but i guess there is no chance that 1024 byte
-         * compressed won't fit into the 8192 byte buffer
-         */
-
-        length = ip->out_compress->next_out - ip->out_compress_buf;
-        buf = (char *) ip->out_compress_buf;
-    }
-    else
-#endif /* USE_MCCP */
-    {
-        buf = msg;
-        length = size;
-    }
-
-    /* now sending the buffer... */
-    if (ip->write_first == NULL)
-    {
-        /* Try writing to the socket first. */
-        ssize_t n = comm_send_buf(buf, length, ip);
-
-        if (n == -1)
-            return MY_FALSE;
-        else if (n == length)
-        {
-            /* We're done. */
-            return MY_TRUE;
-        }
-        else if (n > 0)
+        do
         {
-            buf += n;
-            length -= n;
-        }
-    }
+            int status;
 
-    /* We have to enqueue the message. */
+            ip->out_compress->next_out = mccp_compress_buf;
+            ip->out_compress->avail_out = COMPRESS_BUF_SIZE;
 
-    b = xalloc(sizeof(struct write_buffer_s) + length - 1);
-    if (!b)
-        outofmem(sizeof(struct write_buffer_s) + length - 1, "comm_socket_write()");
+            status = deflate(ip->out_compress, Z_SYNC_FLUSH);
 
-    b->length = length;
-    b->pos = 0;
-    b->flags = flags;
-    b->next = NULL;
-    memcpy(b->buffer, buf, length);
+            if (status != Z_OK && status != Z_BUF_ERROR)
+            {
+                fprintf(stderr, "%s comm: MCCP compression error: %d\n"
+                              , time_stamp(), status);
+                return MY_FALSE;
+            }
 
-     /* Chain in the new buffer */
-    if (ip->write_first)
-        ip->write_last = ip->write_last->next = b;
-    else
-        ip->write_last = ip->write_first = b;
+            if (ip->out_compress->next_out != mccp_compress_buf
+             && !comm_socket_send((char *)mccp_compress_buf
+                                 , ip->out_compress->next_out - mccp_compress_buf
+                                 , ip, flags))
+                return MY_FALSE;
+        } while (ip->out_compress->avail_out == 0);
 
-    ip->write_size += length;
-    ip->msg_discarded = DM_NONE;
+        return MY_TRUE;
+    }
+#endif /* USE_MCCP */
 
-    return MY_TRUE;
+    return comm_socket_send(msg, size, ip, flags);
 } /* comm_socket_write() */
 
 /*-------------------------------------------------------------------------*/
 static void
 comm_write_pending (interactive_t * ip)
 
-/* Send as much from the write buffer of <ip> as possible.
+/* Send as much from the write buffer of <ip> as possible, passing
+ * several buffers at once to the system.
  */
 
 {
+    int max_iov = WRITE_PENDING_IOV;
+
+#ifdef USE_TLS
+    if (ip->tls_status != TLS_INACTIVE)
+        max_iov = 1;
+#endif
+
     while (ip->write_first != NULL)
     {
+        struct iovec iov[WRITE_PENDING_IOV];
         struct write_buffer_s *buf;
+        int num;
         ssize_t n;
 
-        buf = ip->write_first;
-        n = comm_send_buf(buf->buffer + buf->pos, buf->length - buf->pos, ip);
+        for ( num = 0, buf = ip->write_first
+            ; buf != NULL && num < max_iov
+            ; num++, buf = buf->next)
+        {
+            iov[num].iov_base = buf->buffer + buf->pos;
+            iov[num].iov_len = buf->length - buf->pos;
+        }
 
-        if (n == -1)
+        n = comm_send_iov(iov, num, ip);
+        if (n <= 0)
             return;
 
-        buf->pos += n;
-        if (buf->pos < buf->length)
-            return;
+        /* Remove the buffers which were sent completely. */
+        while (n > 0)
+        {
+            buf = ip->write_first;
 
-        ip->write_first = buf->next;
-        ip->write_size -= buf->length;
-        xfree(buf);
+            if ((size_t)n < buf->length - buf->pos)
+            {
+                /* The socket is full. */
+                buf->pos += n;
+                return;
+            }
+
+            n -= buf->length - buf->pos;
+            ip->write_first = buf->next;
+            ip->write_size -= buf->length;
+            xfree(buf);
+        }
     }
+
+    /* Everything is sent, stop waiting for the socket to become writable. */
+    update_poller(ip);
 } /* comm_write_pending() */
 
 /*-------------------------------------------------------------------------*/
@@ -1845,7 +1998,7 @@ add_message (const char *fmt, ...)
              * This may cause a recursive call to add_message()!.
              */
 
-            if (shadow_catch_message(command_giver, source))
+            if (shadow_catch_message(command_giver, source, srcstr))
             {
                 return;
             }
@@ -2216,17 +2369,17 @@ get_message (char *buff)
  *
  * Internally, get_message() scans the array of interactive users in
  * search for one with a complete message in its incoming buffer. If
- * an earlier select() marked the socket for the current user as pending
+ * an earlier poller_wait() marked the socket for the current user as pending
  * with data, this data is read into the buffer before the check for
  * a message is performed. get_message() returns for the first user found
  * with a complete message. Since get_message() keeps its own
  * status of which user was looked at last, the next call to get_message()
  * will continue the scan where it left off.
  *
- * If no user has a complete message, a call to select() waits for more
+ * If no user has a complete message, a call to poller_wait() waits for more
  * incoming data. If this succeeds (and no heartbeat requires an
  * immediate return), the cycle begins again. If a heart_beat is due
- * even before select() executed, the waiting time for select() is
+ * even before poller_wait() executed, the waiting time for it is
  * set to 0 so that only the status of the sockets is recorded and
  * get_message returns (almost) immediately.
  *
@@ -2240,23 +2393,19 @@ get_message (char *buff)
  *
  * If a heart_beat occurs during the reading and returning of player
  * commands, the comm_time_c_h_b variable is set, but not evaluated.
- * This evaluation happens only when a select() is performed (therefore
+ * This evaluation happens only when a poller_wait() is performed (therefore
  * the second variable time_to_c_h_b). This way every user can issure
  * at least one command in one backend cycle, even if that takes longer
  * than one heart_beat time. This makes it also legal for comm_to_c_h_b
  * to be set upon entering get_message().
  *
  * For short latency, the UDP socket is checked on every call to
- * get_message(), even if a previous select() did not mark it as ready
+ * get_message(), even if a previous poller_wait() did not mark it as ready
  * (this is disabled under BeOS and Windows).
  */
 
 {
     /* State information: */
-    static fd_set readfds, writefds, pexceptfds;
-      /* List of sockets with pending data.
-       * You can ignore a 'could be used uninitialized' warning.
-       */
     static int NextCmdGiver = -1;
       /* Index of current user to check */
     static int CmdsGiven = 0;
@@ -2267,7 +2416,6 @@ get_message (char *buff)
 
     int    i;
     interactive_t * ip = NULL;
-    fd_set exceptfds;
 
 
     /* The endless loop */
@@ -2276,9 +2424,8 @@ get_message (char *buff)
     {
         struct sockaddr_in addr;
         length_t length; /* length of <addr> */
-        struct timeval timeout;
 
-        /* --- select() on the sockets and handle ERQ --- */
+        /* --- Wait for the sockets and handle ERQ --- */
 
         /* This also removes users which connection is marked
          * as to be closed.
@@ -2286,10 +2433,9 @@ get_message (char *buff)
 
         if (NextCmdGiver < 0)
         {
-            int nfds;     /* number of fds for select() */
-            int res;      /* result from select() */
-            int twait;    /* wait time in seconds for select() */
-            int retries;  /* retries of select() after EINTR */
+            int res;      /* result from poller_wait() */
+            int twait;    /* wait time in seconds for poller_wait() */
+            int retries;  /* retries of poller_wait() after EINTR */
 
             flush_all_player_mess();
             twait = comm_time_to_call_heart_beat ? 0 : 1;
@@ -2297,15 +2443,13 @@ get_message (char *buff)
                * of the sockets, but don't wait.
                */
 
-            /* Set up fd-sets. */
-
-            FD_ZERO(&readfds);
-            FD_ZERO(&writefds);
-            FD_ZERO(&pexceptfds);
-            for (i = 0; i < numports; i++) {
-                FD_SET(sos[i], &readfds);
-            } /* for */
-            nfds = min_nfds;
+            /* The events we're waiting for need no update here: the
+             * login ports, UDP and ERQ sockets are registered once when
+             * they are opened, player sockets for input when they connect
+             * and for output by update_poller() while they have buffered
+             * data. Users with a complete command stay registered, the
+             * scan below just doesn't read from them.
+             */
             for (i = max_player + 1; --i >= 0;)
             {
                 ip = all_players[i];
@@ -2324,53 +2468,28 @@ get_message (char *buff)
                     /* If telnet is ready for commands, react quickly. */
                     twait = 0;
                 }
-                else
-                {
-                    FD_SET(ip->socket, &readfds);
-                    if (socket_number(ip->socket) >= nfds)
-                        nfds = socket_number(ip->socket)+1;
-                }
-
-                if (ip->write_first != NULL)
-                {
-                    /* There is something to write. */
-                    FD_SET(ip->socket, &writefds);
-                }
-
             } /* for (all players) */
-#ifdef ERQ_DEMON
-            if (erq_demon >= 0)
-            {
-                FD_SET(erq_demon, &readfds);
-            }
-#endif
-            if (udp_s >= 0)
-            {
-                FD_SET(udp_s, &readfds);
-            }
 
 #ifdef USE_PGSQL
-            pg_setfds(&readfds, &writefds, &nfds);
+            pg_setfds();
 #endif
 #ifdef USE_PYTHON
-           python_set_fds(&readfds, &writefds, &pexceptfds, &nfds);
+            python_set_fds();
 #endif
 
-            /* select() until time is up or there is data */
+            /* Wait until time is up or there is data */
 
             for (retries = 6;;)
             {
                 check_alarm();
-                timeout.tv_sec = twait;
-                timeout.tv_usec = 0;
-                res = socket_select(nfds, &readfds, &writefds, &pexceptfds, &timeout);
+                res = poller_wait(twait);
                 if (res == -1)
                 {
                     if (errno == EINTR)
                     {
                         /* We got an alarm, probably need heart_beat.
-                         * But finish the select call since we already have
-                         * prepared readfds.
+                         * But finish the wait since we already have
+                         * prepared the sockets.
                          */
                         if (comm_time_to_call_heart_beat)
                             twait = 0;
@@ -2379,14 +2498,13 @@ get_message (char *buff)
                     }
                     else
                     {
-                        perror("select");
+                        perror("poller_wait");
                     }
 
-                    /* Despite the failure, pretend select() suceeded with
+                    /* Despite the failure, pretend the wait suceeded with
                      * zero sockets to read, and process heart_beat / buffered
                      * commands.
                      */
-                    FD_ZERO(&readfds);
                 }
                 break;
             } /* for (retries) */
@@ -2395,38 +2513,71 @@ get_message (char *buff)
              */
             if (urgent_data)
             {
+                static struct pollfd *pfds = NULL;
+                static int *pfds_player = NULL;
+                static int pfds_size = 0;
+                  /* The player sockets to check, with the index
+                   * into all_players[] of each in pfds_player[].
+                   */
+                int num_pfds = 0;
+                int j;
+                Bool got_urgent = MY_FALSE;
+
                 DTN(("telnet wants to sync\n"));
                 check_alarm();
                 urgent_data = MY_FALSE;
-                timeout.tv_sec = 0;
-                timeout.tv_usec = 0;
-                memset((char *)&exceptfds, 255, (size_t)(nfds + 7) >> 3);
-                if (socket_select(nfds, 0, 0, &exceptfds, &timeout) > 0)
+
+                /* Check all player sockets with a single poll(). */
+                if (pfds_size < max_player + 1)
+                {
+                    pfds_size = max_player + 1;
+                    pfds = prexalloc(pfds, (size_t)pfds_size * sizeof(*pfds));
+                    pfds_player = prexalloc(pfds_player
+                                          , (size_t)pfds_size * sizeof(*pfds_player));
+                    if (!pfds || !pfds_player)
+                        fatal("Out of memory (%d sockets) for the telnet sync.\n"
+                             , pfds_size);
+                }
+
+                for (i = max_player + 1; --i >= 0;)
                 {
-                    for (i = max_player + 1; --i >= 0;)
+                    ip = all_players[i];
+                    if (!ip)
+                        continue;
+
+                    pfds[num_pfds].fd = socket_number(ip->socket);
+                    pfds[num_pfds].events = POLLPRI;
+                    pfds[num_pfds].revents = 0;
+                    pfds_player[num_pfds] = i;
+                    num_pfds++;
+                }
+
+                if (num_pfds && poll(pfds, (nfds_t)num_pfds, 0) <= 0)
+                    num_pfds = 0;
+
+                for (j = 0; j < num_pfds; j++)
+                {
+                    if (pfds[j].revents & POLLPRI)
                     {
-                        ip = all_players[i];
-                        if (!ip)
-                            continue;
-                        if (FD_ISSET(ip->socket, &exceptfds))
+                        ip = all_players[pfds_player[j]];
+                        got_urgent = MY_TRUE;
+                        DTN(("ts_data = TS_SYNCH\n"));
+                        ip->ts_data = TS_SYNCH;
+                        switch (ip->tn_state)
                         {
-                            DTN(("ts_data = TS_SYNCH\n"));
-                            ip->ts_data = TS_SYNCH;
-                            switch (ip->tn_state)
-                            {
-                              case TS_DATA:
-                              case TS_READY:
-                                ip->tn_state = TS_SYNCH;
-                                ip->gobble_char = '\0';
-                                DTN(("tn_state = TS_SYNCH\n"));
-                            }
+                          case TS_DATA:
+                          case TS_READY:
+                            ip->tn_state = TS_SYNCH;
+                            ip->gobble_char = '\0';
+                            DTN(("tn_state = TS_SYNCH\n"));
                         }
-                    } /* for (all players) */
-                }
+                    }
+                } /* for (all polled sockets) */
+
                 /* Maybe the data didn't arrive yet, so try again later.
                  * But don't waste time doing it for too long.
                  */
-                else if (current_time - urgent_data_time < 600)
+                if (!got_urgent && current_time - urgent_data_time < 600)
                 {
                     urgent_data = MY_TRUE;
                 }
@@ -2436,7 +2587,7 @@ get_message (char *buff)
             pg_process_all();
 #endif
 #ifdef USE_PYTHON
-            python_handle_fds(&readfds, &writefds, &exceptfds, nfds);
+            python_handle_fds();
 #endif
 
             /* Initialise the user scan */
@@ -2449,7 +2600,8 @@ get_message (char *buff)
              * TODO: This should be a function on its own.
              * TODO: Define the erq messages as structs.
              */
-            if (erq_demon >= 0 && FD_ISSET(erq_demon, &readfds))
+            if (erq_demon >= 0
+             && (poller_ready(socket_number(erq_demon)) & POLLER_READ))
             {
                 mp_int l;
                 mp_int msglen;  /* Length of the current erq message */
@@ -2457,7 +2609,7 @@ get_message (char *buff)
                 int32  handle;
                 char  *rp;      /* Read pointer into buf_from_erq[] */
 
-                FD_CLR(erq_demon, &readfds);
+                poller_clear(socket_number(erq_demon), POLLER_READ);
 
                 /* Try six times to read data from the ERQ, appending
                  * it to what is already in buf_from_erq[].
@@ -2535,16 +2687,28 @@ get_message (char *buff)
                             /* The result of a hostname lookup. */
 
                             if (msglen < 13 || rp[msglen-1]) {
-#ifdef DEBUG
                               if (msglen == 12) {
+                                uint32 naddr;
+                                struct in_addr net_addr;
+
+#ifdef DEBUG
                                 if (d_flag > 1)
                                   debug_message("%s Host lookup failed\n"
                                                , time_stamp());
+#endif
+                                memcpy((char*)&naddr, rp+8, sizeof(naddr));
+#ifndef USE_IPV6
+                                net_addr.s_addr = naddr;
+#else
+                                CREATE_IPV6_MAPPED(&net_addr, naddr);
+#endif
+                                fail_ip_entry(net_addr);
                               } else {
+#ifdef DEBUG
                                 debug_message("%s Bogus reverse name lookup.\n"
                                              , time_stamp());
-                              }
 #endif
+                              }
                             } else {
                                 uint32 naddr;
                                 struct in_addr net_addr;
@@ -2578,6 +2742,11 @@ get_message (char *buff)
 
                                 if (space == NULL)
                                 {
+                                    /* The answer doesn't tell the address,
+                                     * so the entry stays pending until
+                                     * the lookup is retried.
+                                     */
+                                    ip_cache_failures++;
                                     debug_message("%s IP6 Host lookup failed: %s\n"
                                                  , time_stamp(), rp+8);
                                 }
@@ -2691,7 +2860,7 @@ get_message (char *buff)
             /* --- Try to get a new player --- */
             for (i = 0; i < numports; i++)
             {
-                if (FD_ISSET(sos[i], &readfds))
+                if (poller_ready(socket_number(sos[i])) & POLLER_READ)
                 {
                     SOCKET_T new_socket;
 
@@ -2736,18 +2905,18 @@ get_message (char *buff)
         } /* if (no NextCmdGiver) */
 
         /* See if we got any udp messages.
-         * We don't test readfds so that we can accept udp messages with
-         * short latency. But for the same reason, it was necessary to
-         * include the descriptor number in the set to be selected on.
+         * We don't test the poller result so that we can accept udp
+         * messages with short latency. But for the same reason, it was
+         * necessary to register the descriptor with the poller.
          * Note for Cygwin: since making sockets non-blocking
          *   is a bit tricky, we check if the socket is actually ready,
          *   to prevent freezing.
-         * TODO: Always use the readfds information.
+         * TODO: Always use the poller information.
          */
 #if !defined(CYGWIN)
         if (udp_s >= 0)
 #else
-        if (udp_s >= 0 && FD_ISSET(udp_s, &readfds))
+        if (udp_s >= 0 && (poller_ready(socket_number(udp_s)) & POLLER_READ))
 #endif
         {
             char *ipaddr_str;
@@ -2809,7 +2978,7 @@ get_message (char *buff)
             }
 #endif
 
-            if (FD_ISSET(ip->socket, &writefds))
+            if (poller_ready(socket_number(ip->socket)) & POLLER_WRITE)
             {
                 comm_write_pending(ip);
             }
@@ -2823,7 +2992,11 @@ get_message (char *buff)
 
             /* Get the data (if any), at max enough to fill .text[] */
 
-            if (FD_ISSET(ip->socket, &readfds)) {
+            /* A user with a complete command gets no more data until
+             * the command is handled; it stays pending on the socket.
+             */
+            if (ip->tn_state != TS_READY
+             && (poller_ready(socket_number(ip->socket)) & POLLER_READ)) {
                 int l;
 
                 l = MAX_TEXT - ip->text_end;
@@ -3173,7 +3346,7 @@ get_message (char *buff)
                  && CmdsGiven < ALLOWED_ED_CMDS)
                 {
                     CmdsGiven++;
-                    FD_CLR(ip->socket, &readfds);
+                    poller_clear(socket_number(ip->socket), POLLER_READ);
                 }
                 else
                 {
@@ -3350,6 +3523,7 @@ remove_interactive (object_t *ob, Bool force)
 
         erq_demon = interactive->socket;
         erq_proto_demon = -1;
+        poller_set(socket_number(erq_demon), POLLER_READ);
         socket_write(erq_demon, erq_welcome, sizeof erq_welcome);
     }
     else
@@ -3379,6 +3553,7 @@ remove_interactive (object_t *ob, Bool force)
         tls_deinit_connection(interactive);
 #endif
         shutdown(interactive->socket, 2);
+        poller_set(socket_number(interactive->socket), 0);
         socket_close(interactive->socket);
     } /* if (erq or user) */
 
@@ -3403,8 +3578,6 @@ remove_interactive (object_t *ob, Bool force)
     }
 
 #ifdef USE_MCCP
-    if (interactive->out_compress_buf)
-       xfree(interactive->out_compress_buf);
     if (interactive->out_compress)
        xfree(interactive->out_compress);
 #endif
@@ -3641,7 +3814,9 @@ new_player ( object_t *ob, SOCKET_T new_socket
 #ifdef USE_MCCP
     new_interactive->compressing = 0;
     new_interactive->out_compress = NULL;
-    new_interactive->out_compress_buf=NULL;
+    new_interactive->mccp_level = mccp_default_level;
+    new_interactive->mccp_window_bits = mccp_default_window_bits;
+    new_interactive->mccp_mem_level = mccp_default_mem_level;
 #endif
 #ifdef USE_TLS
     new_interactive->tls_status = TLS_INACTIVE;
@@ -3689,6 +3864,7 @@ new_player ( object_t *ob, SOCKET_T new_socket
     new_interactive->write_first = new_interactive->write_last = NULL;
     new_interactive->write_size = 0;
     new_interactive->write_max_size = -2;
+    update_poller(new_interactive);
 
     /* Add the new interactive structure to the list of users */
 
@@ -5067,7 +5243,6 @@ telnet_neg (interactive_t *ip)
  */
 
 {
-    fd_set exceptfds;
     char *from;   /* Next char to process */
     char *to;     /* Where to store the extracted command text */
     int   state;
@@ -5320,14 +5495,16 @@ telnet_neg (interactive_t *ip)
             data_mark:
                 if (ip->ts_data == TS_SYNCH)
                 {
-                    struct timeval timeout;
-
-                    FD_ZERO(&exceptfds);
-                    FD_SET(ip->socket, &exceptfds);
-                    timeout.tv_sec = 0;
-                    timeout.tv_usec = 0;
-                    if (! socket_select(ip->socket + 1, 0, 0, &exceptfds,
-                        &timeout))
+                    struct pollfd pfd;
+
+                    /* poll() instead of select(): the socket may be
+                     * beyond FD_SETSIZE.
+                     */
+                    pfd.fd = socket_number(ip->socket);
+                    pfd.events = POLLPRI;
+                    pfd.revents = 0;
+                    if (poll(&pfd, 1, 0) >= 0
+                     && !(pfd.revents & POLLPRI))
                     {
                         if (d_flag)
                             debug_message("%s Synch operation finished.\n"
@@ -5586,9 +5763,7 @@ start_erq_demon (const char *suffix, size_t suffixlen)
     erq_demon = sockets[1];
     set_socket_nonblocking(erq_demon);
     set_socket_nosigpipe(erq_demon);
-    
-    if (socket_number(erq_demon) >= min_nfds)
-        min_nfds = socket_number(erq_demon)+1;
+    poller_set(socket_number(erq_demon), POLLER_READ);
 } /* start_erq_demon() */
 
 /*-------------------------------------------------------------------------*/
@@ -5604,6 +5779,7 @@ shutdown_erq_demon (void)
     if (erq_demon < 0)
         return;
 
+    poller_set(socket_number(erq_demon), 0);
     socket_close(erq_demon);
     erq_demon = FLAG_NO_ERQ;
     erq_pending_len = 0;
@@ -5940,6 +6116,126 @@ read_32 (char *str)
     return (long)p[0]<<24 | (long)p[1]<<16 | (long)p[2]<<8 | p[3];
 }
 
+/*-------------------------------------------------------------------------*/
+static INLINE int
+ip_hash (struct in_addr addr)
+
+/* Return the index of <addr> in iphash[].
+ */
+
+{
+    unsigned char *p = (unsigned char *)&addr.s_addr;
+    uint32 h = 2166136261UL;
+    size_t i;
+
+    for (i = 0; i < sizeof(addr.s_addr); i++)
+        h = (h ^ p[i]) * 16777619UL;
+
+    return (int)(h % IPSIZE);
+} /* ip_hash() */
+
+/*-------------------------------------------------------------------------*/
+static void
+touch_ip_entry (struct ipentry *entry)
+
+/* Move the used <entry> to the front of the LRU list.
+ */
+
+{
+    if (entry == ip_lru_first)
+        return;
+
+    /* Unlink the entry (it's not the first one) */
+    entry->lru_prev->lru_next = entry->lru_next;
+    if (entry->lru_next)
+        entry->lru_next->lru_prev = entry->lru_prev;
+    else
+        ip_lru_last = entry->lru_prev;
+
+    entry->lru_prev = NULL;
+    entry->lru_next = ip_lru_first;
+    ip_lru_first->lru_prev = entry;
+    ip_lru_first = entry;
+} /* touch_ip_entry() */
+
+/*-------------------------------------------------------------------------*/
+static struct ipentry *
+find_ip_entry (struct in_addr addr)
+
+/* Return the iptable[] entry for <addr>, or NULL if there is none.
+ */
+
+{
+    struct ipentry *entry;
+
+    for (entry = iphash[ip_hash(addr)]; entry != NULL; entry = entry->next_hash)
+    {
+        if (!memcmp(&entry->addr.s_addr, &addr.s_addr, sizeof(addr.s_addr)))
+            return entry;
+    }
+
+    return NULL;
+} /* find_ip_entry() */
+
+/*-------------------------------------------------------------------------*/
+static struct ipentry *
+new_ip_entry (struct in_addr addr, string_t *name)
+
+/* Create a new iptable[] entry for <addr> (which must not be in the
+ * table yet) with the tabled string <name> (the reference is adopted).
+ * If all entries are in use, the least recently used one is replaced.
+ * The new entry has the state ipUnresolved and is already expired.
+ */
+
+{
+    struct ipentry *entry, **link;
+    int ix;
+
+    if (num_ip_entries < IPSIZE)
+    {
+        entry = iptable + num_ip_entries++;
+    }
+    else
+    {
+        /* Remove the least recently used entry */
+
+        entry = ip_lru_last;
+
+        for ( link = &iphash[ip_hash(entry->addr)]
+            ; *link != entry
+            ; link = &(*link)->next_hash)
+            NOOP;
+        *link = entry->next_hash;
+
+        ip_lru_last = entry->lru_prev;
+        if (ip_lru_last)
+            ip_lru_last->lru_next = NULL;
+        else
+            ip_lru_first = NULL;
+
+        free_mstring(entry->name);
+    }
+
+    entry->addr = addr;
+    entry->name = name;
+    entry->state = ipUnresolved;
+    entry->expires = current_time;
+
+    ix = ip_hash(addr);
+    entry->next_hash = iphash[ix];
+    iphash[ix] = entry;
+
+    entry->lru_prev = NULL;
+    entry->lru_next = ip_lru_first;
+    if (ip_lru_first)
+        ip_lru_first->lru_prev = entry;
+    else
+        ip_lru_last = entry;
+    ip_lru_first = entry;
+
+    return entry;
+} /* new_ip_entry() */
+
 /*-------------------------------------------------------------------------*/
 static void
 add_ip_entry (struct in_addr addr, const char *name)
@@ -5950,34 +6246,42 @@ add_ip_entry (struct in_addr addr, const char *name)
  */
 
 {
-    int i, ix;
-    Bool new_entry;
+    struct ipentry *entry;
 
-    ix = -1;
-    new_entry = MY_FALSE;
-    for (i = 0; i < IPSIZE; i++)
+    entry = find_ip_entry(addr);
+    if (entry)
     {
-        if (!memcmp(&(iptable[i].addr.s_addr), &addr.s_addr, sizeof(iptable[i].addr.s_addr)))
-        {
-            ix = i;
-            break;
-        }
+        free_mstring(entry->name);
+        entry->name = new_tabled(name);
+        touch_ip_entry(entry);
     }
+    else
+        entry = new_ip_entry(addr, new_tabled(name));
 
-    if (ix < 0)
-    {
-        ix = ipcur;
-        new_entry = MY_TRUE;
-    }
+    entry->state = ipResolved;
+    entry->expires = current_time + ip_name_ttl;
+} /* add_ip_entry() */
+
+/*-------------------------------------------------------------------------*/
+static void
+fail_ip_entry (struct in_addr addr)
 
-    iptable[ix].addr = addr;
-    if (iptable[ix].name)
-        free_mstring(iptable[ix].name);
-    iptable[ix].name = new_tabled(name);
+/* The hostname of <addr> couldn't be found: remember that for a while,
+ * so that the ERQ isn't asked again at every lookup.
+ */
 
-    if (new_entry)
-        ipcur = (ipcur+1) % IPSIZE;
-} /* add_ip_entry() */
+{
+    struct ipentry *entry;
+
+    ip_cache_failures++;
+
+    entry = find_ip_entry(addr);
+    if (entry && entry->state == ipPending)
+    {
+        entry->state = ipFailed;
+        entry->expires = current_time + ip_name_failed_ttl;
+    }
+} /* fail_ip_entry() */
 
 /*-------------------------------------------------------------------------*/
 #ifdef USE_IPV6
@@ -5985,26 +6289,15 @@ add_ip_entry (struct in_addr addr, const char *name)
 static void
 update_ip_entry (const char *oldname, const char *newname)
 
-/* Change the IP name <oldname> in the iptable[] to <newname>.
- * If the <oldname> is not in the table, nothing happens.
+/* Change the IP name <oldname> (the numeric address) in the iptable[]
+ * to <newname>.
  */
 
 {
-    int i, ix;
-    Bool new_entry;
+    struct in_addr addr;
 
-    ix = -1;
-    new_entry = MY_FALSE;
-    for (i = 0; i < IPSIZE; i++)
-    {
-        if (iptable[i].name
-         && !strncmp(get_txt(iptable[i].name), oldname, mstrsize(iptable[i].name))
-           )
-        {
-            free_mstring(iptable[i].name);
-            iptable[i].name = new_tabled(newname);
-        }
-    }
+    if (inet_pton(AF_INET6, oldname, &addr) == 1)
+        add_ip_entry(addr, newname);
 } /* update_ip_entry() */
 
 /*-------------------------------------------------------------------------*/
@@ -6017,65 +6310,75 @@ lookup_ip_entry (struct in_addr addr, Bool useErq)
 
 /* Lookup the IP address <addr> and return an uncounted pointer to
  * a shared string with the hostname. The function looks first in the
- * iptable[], then, if not found there and <useErq> is true, asks the ERQ.
+ * iptable[], then, if not found there or if the entry is expired and
+ * <useErq> is true, asks the ERQ. While the lookup is pending, the
+ * numeric address (resp. the previous hostname) is returned.
  * If the hostname can not be found, NULL is returned.
  */
 
 {
-    int i;
-    string_t *ipname;
-    struct in_addr tmp;
-
-    /* Search for the address backwards from the last added entry,
-     * hoping that its one of the more recently added ones.
-     */
-    i = ipcur;
-    do {
-        i--;
-        if (i < 0)
-            i += IPSIZE;
-
-        if (!memcmp(&(iptable[i].addr.s_addr), &addr.s_addr, sizeof(iptable[i].addr.s_addr))
-         && iptable[i].name)
-        {
-            return iptable[i].name;
-        }
-    } while (i != ipcur );
+    struct ipentry *entry;
 
-    /* The address is new to us.
-     * Add a temporary entry into the iptable[] to bridge
-     * the time until the erq has finished the lookup.
-     * This also handles the case of an unresolvable hostname.
-     */
+    entry = find_ip_entry(addr);
+    if (entry)
+    {
+        ip_cache_hits++;
+        touch_ip_entry(entry);
+    }
+    else
+    {
+        struct in_addr tmp;
+        string_t *ipname;
 
-    iptable[ipcur].addr = addr;
-    if (iptable[ipcur].name)
-        free_mstring(iptable[ipcur].name);
+        /* The address is new to us.
+         * Add a temporary entry into the iptable[] to bridge
+         * the time until the erq has finished the lookup.
+         * This also handles the case of an unresolvable hostname.
+         */
+        ip_cache_misses++;
 
-    memcpy(&tmp, &addr, sizeof(tmp));
+        memcpy(&tmp, &addr, sizeof(tmp));
 #ifndef USE_IPV6
-    ipname = new_tabled(inet_ntoa(tmp));
+        ipname = new_tabled(inet_ntoa(tmp));
 #else
-    ipname = new_tabled(inet6_ntoa(tmp));
+        ipname = new_tabled(inet6_ntoa(tmp));
 #endif
+        entry = new_ip_entry(addr, ipname);
+    }
 
-    iptable[ipcur].name = ipname;
-
-    ipcur = (ipcur+1) % IPSIZE;
-
-    /* If we have the erq and may use it, lookup the real hostname */
-    if (erq_demon >= 0 && useErq)
+    /* If we have the erq and may use it, lookup the real hostname,
+     * unless it is known or already being looked up.
+     */
+    if (erq_demon >= 0 && useErq && entry->expires <= current_time)
     {
+        Bool sent;
+
 #ifndef USE_IPV6
-        send_erq(ERQ_HANDLE_RLOOKUP, ERQ_RLOOKUP, (char *)&addr.s_addr, sizeof(addr.s_addr));
+        sent = send_erq(ERQ_HANDLE_RLOOKUP, ERQ_RLOOKUP, (char *)&addr.s_addr, sizeof(addr.s_addr));
 #else
-        send_erq(ERQ_HANDLE_RLOOKUPV6, ERQ_RLOOKUPV6, get_txt(ipname)
-                , mstrsize(ipname));
+        {
+            struct in_addr tmp;
+            string_t *ipname;
+
+            memcpy(&tmp, &addr, sizeof(tmp));
+            ipname = new_mstring(inet6_ntoa(tmp));
+            sent = ipname != NULL
+                && send_erq(ERQ_HANDLE_RLOOKUPV6, ERQ_RLOOKUPV6, get_txt(ipname)
+                           , mstrsize(ipname));
+            if (ipname)
+                free_mstring(ipname);
+        }
 #endif
+        if (sent)
+        {
+            ip_cache_requests++;
+            entry->state = ipPending;
+            entry->expires = current_time + IP_NAME_PENDING_TTL;
+        }
     }
 
-    return iptable[ipcur].name;
-}
+    return entry->name;
+} /* lookup_ip_entry() */
 
 #endif /* ERQ_DEMON */
 
@@ -6160,15 +6463,13 @@ remove_stale_player_data (void)
 
 /*-------------------------------------------------------------------------*/
 size_t
-show_comm_status (strbuf_t * sbuf, Bool verbose UNUSED)
+show_comm_status (strbuf_t * sbuf, Bool verbose)
 
 /* Return the amount of memory used by the comm module.
+ * If <verbose> is TRUE, also print the IP name cache statistics.
  */
 
 {
-#if defined(__MWERKS__)
-#    pragma unused(verbose)
-#endif
     size_t sum;
     int i;
 
@@ -6199,11 +6500,72 @@ show_comm_status (strbuf_t * sbuf, Bool verbose UNUSED)
             }
     }
 
+#ifdef ERQ_DEMON
+    sum += sizeof(iptable) + sizeof(iphash);
+
+    if (verbose && sbuf)
+    {
+        strbuf_add(sbuf, "\nIP name cache status:\n");
+        strbuf_add(sbuf, "---------------------\n");
+        strbuf_addf(sbuf, "Entries (size)               %d (%d)\n"
+                   , num_ip_entries, IPSIZE);
+        strbuf_addf(sbuf, "Lookups: hits/misses         %"PRIuSTATCOUNTER
+                          " / %"PRIuSTATCOUNTER"\n"
+                   , ip_cache_hits, ip_cache_misses);
+        strbuf_addf(sbuf, "ERQ requests (failed)        %"PRIuSTATCOUNTER
+                          " (%"PRIuSTATCOUNTER")\n"
+                   , ip_cache_requests, ip_cache_failures);
+    }
+#endif /* ERQ_DEMON */
+
     if (sbuf)
         strbuf_addf(sbuf, "Comm structures\t\t\t\t %9zu\n", sum);
     return sum;
 } /* show_comm_status() */
 
+/*-------------------------------------------------------------------------*/
+void
+ipcache_driver_info (svalue_t *svp, int value)
+
+/* Returns the IP name cache information for driver_info(<what>).
+ * <svp> points to the svalue for the result.
+ */
+
+{
+    switch (value)
+    {
+#ifdef ERQ_DEMON
+        case DI_NUM_IP_NAME_LOOKUP_HITS:
+            put_number(svp, ip_cache_hits);
+            break;
+
+        case DI_NUM_IP_NAME_LOOKUP_MISSES:
+            put_number(svp, ip_cache_misses);
+            break;
+
+        case DI_NUM_IP_NAME_REQUESTS:
+            put_number(svp, ip_cache_requests);
+            break;
+
+        case DI_NUM_IP_NAME_REQUESTS_FAILED:
+            put_number(svp, ip_cache_failures);
+            break;
+
+        case DI_NUM_IP_NAMES:
+            put_number(svp, num_ip_entries);
+            break;
+
+        case DI_NUM_IP_NAME_TABLE_SLOTS:
+            put_number(svp, IPSIZE);
+            break;
+
+        default:
+            fatal("Unknown option for ipcache_driver_info(): %d\n", value);
+            break;
+#endif /* ERQ_DEMON */
+    }
+} /* ipcache_driver_info() */
+
 #ifdef GC_SUPPORT
 
 /*-------------------------------------------------------------------------*/
@@ -8447,6 +8809,55 @@ f_configure_interactive (svalue_t *sp)
             start_compress(ip, mccpver);
         }
         break;
+
+    case IC_MCCP_LEVEL:
+    case IC_MCCP_WINDOW_BITS:
+    case IC_MCCP_MEM_LEVEL:
+        {
+            p_int value, min, max;
+
+            if (sp->type != T_NUMBER)
+                efun_exp_arg_error(3, TF_NUMBER, sp->type, sp);
+
+            value = sp->u.number;
+            switch (sp[-1].u.number)
+            {
+            case IC_MCCP_LEVEL:       min = 0; max = 9; break;
+            case IC_MCCP_WINDOW_BITS: min = 9; max = 15; break;
+            default:                  min = 1; max = 9; break;
+            }
+
+            if (value < min || value > max)
+                errorf("Illegal value to arg 3 of configure_interactive: %"PRIdPINT
+                       ", expected %"PRIdPINT"..%"PRIdPINT".\n"
+                      , value, min, max);
+
+            /* The settings apply to the next start of the compression. */
+            switch (sp[-1].u.number)
+            {
+            case IC_MCCP_LEVEL:
+                if (!ip)
+                    mccp_default_level = value;
+                else
+                    ip->mccp_level = value;
+                break;
+
+            case IC_MCCP_WINDOW_BITS:
+                if (!ip)
+                    mccp_default_window_bits = value;
+                else
+                    ip->mccp_window_bits = value;
+                break;
+
+            default:
+                if (!ip)
+                    mccp_default_mem_level = value;
+                else
+                    ip->mccp_mem_level = value;
+                break;
+            }
+            break;
+        }
 #endif /* USE_MCCP*/
 
     case IC_PROMPT:
@@ -8651,6 +9062,18 @@ f_interactive_info (svalue_t *sp)
 
         put_number(&result, ip->compressing);
         break;
+
+    case IC_MCCP_LEVEL:
+        put_number(&result, ip ? ip->mccp_level : mccp_default_level);
+        break;
+
+    case IC_MCCP_WINDOW_BITS:
+        put_number(&result, ip ? ip->mccp_window_bits : mccp_default_window_bits);
+        break;
+
+    case IC_MCCP_MEM_LEVEL:
+        put_number(&result, ip ? ip->mccp_mem_level : mccp_default_mem_level);
+        break;
 #endif /* USE_MCCP*/
 
     case IC_PROMPT:
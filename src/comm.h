@@ -115,10 +115,10 @@
 /* --- struct write_buffer_s: async write datastructure
  *
  * This data structure holds all the information for pending messages
- * which are to be written by a background thread. The structure is
- * allocated to the necessary length to hold the full message.
- * The instances are kept in a linked list from the interactive_t
- * structure.
+ * which couldn't be written to the socket yet. The structure is
+ * allocated large enough to hold the full message, small messages
+ * are collected in one buffer. The instances are kept in a linked
+ * list from the interactive_t structure.
  */
 enum write_buffer_flags
 {
@@ -130,10 +130,11 @@ typedef uint32 write_buffer_flag_t;
 struct write_buffer_s
 {
     struct write_buffer_s *next;
-    size_t length;
-    size_t pos;
+    size_t length;  /* Number of bytes in .buffer[] */
+    size_t size;    /* Allocated size of .buffer[] */
+    size_t pos;     /* Number of bytes already sent */
     write_buffer_flag_t flags;
-    char buffer[1 /* .length */ ];
+    char buffer[1 /* .size */ ];
 };
 
 /* Indicates discarded messages. */
@@ -268,7 +269,10 @@ struct interactive_s {
 #ifdef USE_MCCP
     unsigned char   compressing;
     z_stream      * out_compress;
-    unsigned char * out_compress_buf;
+    signed char     mccp_level;        /* zlib compression level */
+    signed char     mccp_window_bits;  /* zlib window size (log2) */
+    signed char     mccp_mem_level;    /* zlib memory level */
+      /* Settings for the next start of the compression. */
 #endif
 
     struct write_buffer_s *write_first;  /* List of buffers to write */
@@ -381,6 +385,8 @@ extern int num_player;
 extern char *domain_name;
 
 extern p_int write_buffer_max_size;
+extern p_int ip_name_ttl;
+extern p_int ip_name_failed_ttl;
 
 #ifdef COMM_STAT
 extern statcounter_t add_message_calls;
@@ -417,6 +423,7 @@ extern svalue_t *f_send_erq(svalue_t *sp);
 #endif
 
 extern size_t show_comm_status (strbuf_t * sbuf, Bool verbose);
+extern void ipcache_driver_info (svalue_t *svp, int value);
 extern void remove_stale_player_data (void);
 extern void check_for_out_connections (void);
 
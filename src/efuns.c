@@ -286,6 +286,144 @@ f_implode (svalue_t * sp)
     return sp;
 } /* f_implode() */
 
+/*-------------------------------------------------------------------------*/
+/* The case conversion handles the string a word at a time: a word of
+ * ASCII characters is searched for letters and converted as a whole.
+ * Other words are handled one character at a time, following the
+ * locale.
+ */
+
+#define WORD_ONES  (~(p_uint)0 / UCHAR_MAX)  /* 0x01 in every byte */
+#define WORD_HIGHS (WORD_ONES * 0x80)         /* 0x80 in every byte */
+
+static INLINE p_uint
+ascii_letters (p_uint word, char first)
+
+/* For a <word> of ASCII characters return a mask with 0x80 in every
+ * byte which holds a letter from <first> to <first>+25.
+ * No byte can overflow into the next during the additions.
+ */
+
+{
+    p_uint ge_first = word + WORD_ONES * (0x80 - first);
+    p_uint gt_last = word + WORD_ONES * (0x7f - (first + 25));
+
+    return ge_first & ~gt_last & WORD_HIGHS;
+} /* ascii_letters() */
+
+static Bool
+plain_ascii_case (void)
+
+/* Return whether the locale converts the case of exactly the ASCII
+ * letters, in which case ASCII words can be converted as a whole.
+ */
+
+{
+    static int plain = -1;
+
+    if (plain < 0)
+    {
+        plain = 1;
+        for (int c = 0; c < 0x80; c++)
+        {
+            int lower = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+            int upper = (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+
+            if (tolower(c) != lower || toupper(c) != upper)
+                plain = 0;
+        }
+    }
+
+    return plain != 0;
+} /* plain_ascii_case() */
+
+static size_t
+find_cased_char (const char *txt, size_t len, Bool upper)
+
+/* Return the position of the first character in <txt> (of <len> bytes)
+ * which is an uppercase (<upper> is false) or lowercase (<upper> is
+ * true) letter. Return <len> if there is none.
+ */
+
+{
+    size_t ix = 0;
+    char first = upper ? 'a' : 'A';
+
+    while (ix < len)
+    {
+        size_t end = len;
+
+        if (len - ix >= sizeof(p_uint))
+        {
+            p_uint word;
+
+            memcpy(&word, txt + ix, sizeof(word));
+            if (!(word & WORD_HIGHS) && !ascii_letters(word, first))
+            {
+                ix += sizeof(word);
+                continue;
+            }
+            end = ix + sizeof(word);
+        }
+
+        /* Check this word (or the rest of the string) the slow way. */
+        for ( ; ix < end; ix++)
+        {
+            unsigned char c = (unsigned char)txt[ix];
+
+            if (c != '\0' && (upper ? islower(c) : isupper(c)))
+                return ix;
+        }
+    }
+
+    return len;
+} /* find_cased_char() */
+
+static void
+convert_case (char *txt, size_t start, size_t len, Bool upper)
+
+/* Convert all characters in <txt> (of <len> bytes) from position <start>
+ * on to upper case (<upper> is true) or lower case.
+ */
+
+{
+    size_t ix = start;
+    char first = upper ? 'a' : 'A';
+    Bool plain = plain_ascii_case();
+
+    while (ix < len)
+    {
+        size_t end = len;
+
+        if (plain && len - ix >= sizeof(p_uint))
+        {
+            p_uint word;
+
+            memcpy(&word, txt + ix, sizeof(word));
+            if (!(word & WORD_HIGHS))
+            {
+                /* Flip the 0x20 bit of every letter to convert. */
+                word ^= ascii_letters(word, first) >> 2;
+                memcpy(txt + ix, &word, sizeof(word));
+                ix += sizeof(word);
+                continue;
+            }
+            end = ix + sizeof(word);
+        }
+
+        for ( ; ix < end; ix++)
+        {
+            unsigned char c = (unsigned char)txt[ix];
+
+            if (c != '\0' && (upper ? islower(c) : isupper(c)))
+                txt[ix] = (char)(upper ? toupper(c) : tolower(c));
+        }
+    }
+} /* convert_case() */
+
+#undef WORD_ONES
+#undef WORD_HIGHS
+
 /*-------------------------------------------------------------------------*/
 svalue_t *
 f_lower_case (svalue_t *sp)
@@ -299,14 +437,11 @@ f_lower_case (svalue_t *sp)
  */
 
 {
-    char *s, c;
     size_t count, len;
 
     /* Find the first uppercase character */
     len = mstrsize(sp->u.str);
-    for ( s = get_txt(sp->u.str), count = 0
-        ; count < len && ('\0' == (c = *s) || !isupper((unsigned char)c))
-        ; s++, count++) NOOP;
+    count = find_cased_char(get_txt(sp->u.str), len, MY_FALSE);
 
     if (count < len)
     {
@@ -316,12 +451,7 @@ f_lower_case (svalue_t *sp)
         memsafe(new = unshare_mstring(sp->u.str), mstrsize(sp->u.str), "result string");
         sp->u.str = new;
 
-        for ( s = get_txt(sp->u.str)+count; count < len; s++, count++)
-        {
-            c = *s;
-            if (c != '\0' && isupper((unsigned char)c))
-                *s = (char)tolower((unsigned char)c);
-        }
+        convert_case(get_txt(sp->u.str), count, len, MY_FALSE);
     }
 
     return sp;
@@ -1973,15 +2103,11 @@ f_upper_case (svalue_t *sp)
  */
 
 {
-    char *s, c;
     size_t count, len;
 
-    /* Find the first non-uppercase character in the string */
+    /* Find the first lowercase character in the string */
     len = mstrsize(sp->u.str);
-    for (s = get_txt(sp->u.str), count = 0
-        ; count < len && ('\0' == (c = *s) || !islower((unsigned char)c))
-        ; s++, count++)
-        NOOP;
+    count = find_cased_char(get_txt(sp->u.str), len, MY_TRUE);
 
     if (count < len)  /* there are lowercase characters */
     {
@@ -1989,13 +2115,7 @@ f_upper_case (svalue_t *sp)
         memsafe(new = unshare_mstring(sp->u.str), mstrsize(sp->u.str), "result string");
         sp->u.str = new;
 
-        for (s = get_txt(sp->u.str)+count; count < len; s++, count++)
-        {
-            c = *s;
-
-            if ('\0' != c && islower((unsigned char)c))
-                *s = (char)toupper((unsigned char)c);
-        }
+        convert_case(get_txt(sp->u.str), count, len, MY_TRUE);
     }
 
     /* That's it */
@@ -4535,7 +4655,23 @@ f_configure_object (svalue_t *sp)
         if (sp->type != T_NUMBER)
             efun_arg_error(2, T_NUMBER, sp->type, sp);
 
-        set_heart_beat(ob, sp->u.number != 0);
+        /* An active heart beat keeps its interval. */
+        if (!sp->u.number)
+            set_heart_beat(ob, 0);
+        else if (!(ob->flags & O_HEART_BEAT))
+            set_heart_beat(ob, 1);
+        break;
+
+    case OC_HEART_BEAT_INTERVAL:
+        if (!ob)
+            errorf("Default value for OC_HEART_BEAT_INTERVAL is not supported.\n");
+        if (sp->type != T_NUMBER)
+            efun_arg_error(2, T_NUMBER, sp->type, sp);
+
+        if (sp->u.number < 0)
+            errorf("Illegal heart beat interval %"PRIdPINT" for OC_HEART_BEAT_INTERVAL.\n", sp->u.number);
+
+        set_heart_beat(ob, sp->u.number);
         break;
 
     case OC_EUID:
@@ -4557,6 +4693,26 @@ f_configure_object (svalue_t *sp)
             efun_arg_error(2, T_STRING, sp->type, sp);
 
         break;
+
+    case OC_IDS:
+        if (!ob)
+            errorf("Default value for OC_IDS is not supported.\n");
+
+        if (sp->type == T_NUMBER)
+        {
+            if (sp->u.number != 0)
+                efun_arg_error(2, T_POINTER, sp->type, sp);
+
+            set_object_ids(ob, NULL);
+        }
+        else if (sp->type == T_POINTER)
+        {
+            set_object_ids(ob, sp->u.vec);
+        }
+        else
+            efun_arg_error(2, T_POINTER, sp->type, sp);
+
+        break;
     }
 
     sp = pop_n_elems(3, sp);
@@ -4620,6 +4776,12 @@ f_object_info (svalue_t *sp)
         put_number(&result, (ob->flags & O_HEART_BEAT) ? 1 : 0);
         break;
 
+    case OC_HEART_BEAT_INTERVAL:
+        if (!ob)
+            errorf("Default value for OC_HEART_BEAT_INTERVAL is not supported.\n");
+        put_number(&result, query_heart_beat(ob));
+        break;
+
     case OC_EUID:
         if (!ob)
             errorf("Default value for OC_EUID is not supported.\n");
@@ -4629,6 +4791,15 @@ f_object_info (svalue_t *sp)
             put_number(&result, 0);
         break;
 
+    case OC_IDS:
+        if (!ob)
+            errorf("Default value for OC_IDS is not supported.\n");
+        if (ob->ids)
+            put_array(&result, slice_array(ob->ids, 0, (mp_int)VEC_SIZE(ob->ids) - 1));
+        else
+            put_number(&result, 0);
+        break;
+
     /* Object flags */
     case OI_ONCE_INTERACTIVE:
         put_number(&result, (ob->flags & O_ONCE_INTERACTIVE) ? 1 : 0);
@@ -8291,6 +8462,14 @@ f_configure_driver (svalue_t *sp)
  *        - DC_DATA_CLEAN_TIME     (3): time delay between data cleans
  *        - DC_TLS_CERTIFICATE     (4): TLS certificate to use (fingerprint)
  *        - DC_TLS_DHE_PARAMETER   (5): TLS Diffie-Hellman paramter to use
+ *        - DC_PROFILE_SAMPLING_RATE (10): rate of the sampling profiler
+ *        - DC_FUNCTION_PROFILING  (11): activate/deactivate function profiling
+ *        - DC_DATA_CLEAN_SLICE_TIME (12): time for one slice of a data clean
+ *        - DC_REGEX_CACHE_SIZE    (13): memory budget of the regexp cache
+ *        - DC_SWAP_TIME           (14): time until programs are swapped
+ *        - DC_SWAP_VAR_TIME       (15): time until variables are swapped
+ *        - DC_IP_NAME_TTL         (16): time until hostnames are looked up again
+ *        - DC_IP_NAME_FAILED_TTL  (17): time until failed lookups are retried
  * 
  * <data> is dependent on <what>:
  *   DC_MEMORY_LIMIT:        ({soft-limit, hard-limit}) both <int>, given in Bytes.
@@ -8299,6 +8478,14 @@ f_configure_driver (svalue_t *sp)
  *   DC_DATA_CLEAN_TIME:     0 - __INT_MAX__/9 (int), given in seconds
  *   DC_TLS_CERTIFICATE      (string) SHA1 fingerprint
  *   DC_TLS_DHE_PARAMETER    (string) TLS Diffie-Hellman paramter (PEM-encoded)
+ *   DC_PROFILE_SAMPLING_RATE: 0 - 1000000 (int), samples per second
+ *   DC_FUNCTION_PROFILING:  0/1 (int)
+ *   DC_DATA_CLEAN_SLICE_TIME: 0 - __INT_MAX__ (int), given in microseconds
+ *   DC_REGEX_CACHE_SIZE:    0 - __INT_MAX__ (int), given in Bytes
+ *   DC_SWAP_TIME:           0 - __INT_MAX__ (int), given in seconds
+ *   DC_SWAP_VAR_TIME:       0 - __INT_MAX__ (int), given in seconds
+ *   DC_IP_NAME_TTL:         0 - __INT_MAX__ (int), given in seconds
+ *   DC_IP_NAME_FAILED_TTL:  0 - __INT_MAX__ (int), given in seconds
  *
  */
 
@@ -8505,6 +8692,76 @@ f_configure_driver (svalue_t *sp)
             swap_compact_mode = (sp->u.number != 0);
             break;
 
+        case DC_PROFILE_SAMPLING_RATE:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            if (!set_profile_sampling_rate(sp->u.number))
+                errorf("Could not set the profile sampling rate "
+                       "(%"PRIdPINT") in configure_driver()\n",
+                       sp->u.number);
+            break;
+
+        case DC_FUNCTION_PROFILING:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            set_function_profiling(sp->u.number != 0);
+            break;
+
+        case DC_DATA_CLEAN_SLICE_TIME:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            if (sp->u.number >= 0)
+                data_clean_slice_time = sp->u.number;
+            else
+                errorf("DC_DATA_CLEAN_SLICE_TIME must be >= 0, "
+                    "but is (%"PRIdPINT") in configure_driver()\n",
+                    sp->u.number);
+            break;
+
+        case DC_REGEX_CACHE_SIZE:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            if (sp->u.number >= 0)
+                rxcache_set_size_limit(sp->u.number);
+            else
+                errorf("DC_REGEX_CACHE_SIZE must be >= 0, "
+                    "but is (%"PRIdPINT") in configure_driver()\n",
+                    sp->u.number);
+            break;
+
+        case DC_SWAP_TIME:
+        case DC_SWAP_VAR_TIME:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            if (sp->u.number < 0)
+                errorf("%s must be >= 0, but is (%"PRIdPINT
+                    ") in configure_driver()\n",
+                    sp[-1].u.number == DC_SWAP_TIME ? "DC_SWAP_TIME"
+                                                    : "DC_SWAP_VAR_TIME",
+                    sp->u.number);
+            if (sp[-1].u.number == DC_SWAP_TIME)
+                time_to_swap = (long)sp->u.number;
+            else
+                time_to_swap_variables = (long)sp->u.number;
+            reschedule_swapping();
+            break;
+
+        case DC_IP_NAME_TTL:
+        case DC_IP_NAME_FAILED_TTL:
+            if (sp->type != T_NUMBER)
+                efun_arg_error(2, T_NUMBER, sp->type, sp);
+            if (sp->u.number < 0)
+                errorf("%s must be >= 0, but is (%"PRIdPINT
+                    ") in configure_driver()\n",
+                    sp[-1].u.number == DC_IP_NAME_TTL ? "DC_IP_NAME_TTL"
+                                                      : "DC_IP_NAME_FAILED_TTL",
+                    sp->u.number);
+            if (sp[-1].u.number == DC_IP_NAME_TTL)
+                ip_name_ttl = sp->u.number;
+            else
+                ip_name_failed_ttl = sp->u.number;
+            break;
+
     }
 
     // free arguments
@@ -8610,6 +8867,38 @@ f_driver_info (svalue_t *sp)
             put_number(&result, swap_compact_mode);
             break;
 
+        case DC_PROFILE_SAMPLING_RATE:
+            put_number(&result, get_profile_sampling_rate());
+            break;
+
+        case DC_FUNCTION_PROFILING:
+            put_number(&result, get_function_profiling() ? 1 : 0);
+            break;
+
+        case DC_DATA_CLEAN_SLICE_TIME:
+            put_number(&result, data_clean_slice_time);
+            break;
+
+        case DC_REGEX_CACHE_SIZE:
+            put_number(&result, rxcache_get_size_limit());
+            break;
+
+        case DC_SWAP_TIME:
+            put_number(&result, time_to_swap);
+            break;
+
+        case DC_SWAP_VAR_TIME:
+            put_number(&result, time_to_swap_variables);
+            break;
+
+        case DC_IP_NAME_TTL:
+            put_number(&result, ip_name_ttl);
+            break;
+
+        case DC_IP_NAME_FAILED_TTL:
+            put_number(&result, ip_name_failed_ttl);
+            break;
+
         /* Driver Environment */
         case DI_BOOT_TIME:
             put_number(&result, boot_time);
@@ -8708,6 +8997,15 @@ f_driver_info (svalue_t *sp)
                 put_number(&result, 0);
             break;
 
+        /* Sampling profiler */
+        case DI_PROFILE_SAMPLES:
+            /* FALLTHROUGH */
+        case DI_NUM_PROFILE_SAMPLES:
+            /* FALLTHROUGH */
+        case DI_FUNCTION_PROFILE:
+            profile_driver_info(&result, what);
+            break;
+
         /* LPC Runtime statistics */
 #ifdef APPLY_CACHE_STAT
         case DI_NUM_FUNCTION_NAME_CALLS:
@@ -8729,6 +9027,12 @@ f_driver_info (svalue_t *sp)
         case DI_NUM_HEARTBEAT_ACTIVE_CYCLES:
             /* FALLTHROUGH */
         case DI_NUM_HEARTBEATS_LAST_PROCESSED:
+            /* FALLTHROUGH */
+        case DI_HEARTBEAT_WHEEL_OBJECTS:
+            /* FALLTHROUGH */
+        case DI_HEARTBEAT_WHEEL_LAST_PROCESSED:
+            /* FALLTHROUGH */
+        case DI_HEARTBEAT_WHEEL_LAST_TIME:
             hbeat_driver_info(&result, what);
             break;
 
@@ -8749,6 +9053,8 @@ f_driver_info (svalue_t *sp)
         case DI_NUM_STRING_TABLE_HITS_BY_INDEX:
             /* FALLTHROUGH */
         case DI_NUM_STRING_TABLE_COLLISIONS:
+            /* FALLTHROUGH */
+        case DI_STRING_TABLE_CHAIN_LENGTHS:
             string_driver_info(&result, what);
             break;
 
@@ -8759,9 +9065,50 @@ f_driver_info (svalue_t *sp)
         case DI_NUM_REGEX_LOOKUP_MISSES:
             /* FALLTHROUGH */
         case DI_NUM_REGEX_LOOKUP_COLLISIONS:
+            /* FALLTHROUGH */
+        case DI_NUM_REGEX_LOOKUP_EVICTIONS:
+            /* FALLTHROUGH */
+        case DI_NUM_REGEX_JIT_COMPILES:
             rxcache_driver_info(&result, what);
             break;
 
+        case DI_NUM_CALLOUT_LOOKUPS:
+            /* FALLTHROUGH */
+        case DI_NUM_CALLOUT_LOOKUP_STEPS:
+            /* FALLTHROUGH */
+        case DI_NUM_CALLOUTS_REMOVED_BY_DESTRUCT:
+            callout_driver_info(&result, what);
+            break;
+
+        case DI_NUM_OBJECTS_IN_RESET_QUEUE:
+            /* FALLTHROUGH */
+        case DI_NUM_OBJECTS_IN_CLEAN_UP_QUEUE:
+            /* FALLTHROUGH */
+        case DI_NUM_OBJECTS_IN_DATA_CLEANUP_QUEUE:
+            /* FALLTHROUGH */
+        case DI_NUM_OBJECTS_IN_SWAP_QUEUE:
+            backend_driver_info(&result, what);
+            break;
+
+        case DI_GC_PAUSE_HISTOGRAM:
+            /* FALLTHROUGH */
+        case DI_DATA_CLEAN_PAUSE_HISTOGRAM:
+        {
+            vector_t *v;
+
+            memsafe(v = get_pause_histogram(what == DI_GC_PAUSE_HISTOGRAM)
+                   , PAUSE_HISTOGRAM_SIZE * sizeof(svalue_t)
+                   , "pause histogram");
+            put_array(&result, v);
+            break;
+        }
+
+        case DI_NUM_CYCLE_ROOTS:
+            /* FALLTHROUGH */
+        case DI_NUM_CYCLE_GARBAGE_FREED:
+            cycle_driver_info(&result, what);
+            break;
+
         /* Network statistics */
 #ifdef COMM_STAT
         case DI_NUM_MESSAGES_OUT:
@@ -8785,6 +9132,20 @@ f_driver_info (svalue_t *sp)
             break;
 #endif
 
+        case DI_NUM_IP_NAME_LOOKUP_HITS:
+            /* FALLTHROUGH */
+        case DI_NUM_IP_NAME_LOOKUP_MISSES:
+            /* FALLTHROUGH */
+        case DI_NUM_IP_NAME_REQUESTS:
+            /* FALLTHROUGH */
+        case DI_NUM_IP_NAME_REQUESTS_FAILED:
+            /* FALLTHROUGH */
+        case DI_NUM_IP_NAMES:
+            /* FALLTHROUGH */
+        case DI_NUM_IP_NAME_TABLE_SLOTS:
+            ipcache_driver_info(&result, what);
+            break;
+
         /* Load */
         case DI_LOAD_AVERAGE_COMMANDS:
             put_float(&result, stat_load.weighted_avg);
@@ -8806,6 +9167,16 @@ f_driver_info (svalue_t *sp)
             hbeat_driver_info(&result, what);
             break;
 
+        case DI_LOAD_AVERAGE_RESET_LATENESS:
+            /* FALLTHROUGH */
+        case DI_LOAD_AVERAGE_CLEAN_UP_LATENESS:
+            /* FALLTHROUGH */
+        case DI_LOAD_AVERAGE_DATA_CLEANUP_LATENESS:
+            /* FALLTHROUGH */
+        case DI_LOAD_AVERAGE_SWAP_LATENESS:
+            backend_driver_info(&result, what);
+            break;
+
         /* Memory use statistics */
         case DI_NUM_ACTIONS:
             simulate_driver_info(&result, what);
@@ -8874,7 +9245,7 @@ f_driver_info (svalue_t *sp)
             break;
 
         case DI_NUM_MAPPINGS_CLEAN:
-            put_number(&result, num_mappings - num_hash_mappings - num_dirty_mappings);
+            put_number(&result, num_mappings - num_dirty_mappings);
             break;
 
         case DI_NUM_MAPPINGS_HASH:
@@ -9012,6 +9383,18 @@ f_driver_info (svalue_t *sp)
         case DI_SIZE_SWAP_BLOCKS_REUSED:
             /* FALLTHROUGH */
         case DI_SWAP_RECYCLE_PHASE:
+            /* FALLTHROUGH */
+        case DI_NUM_SWAP_WRITES_QUEUED:
+            /* FALLTHROUGH */
+        case DI_SIZE_SWAP_WRITES_QUEUED:
+            /* FALLTHROUGH */
+        case DI_NUM_SWAP_READS_QUEUED:
+            /* FALLTHROUGH */
+        case DI_NUM_SWAP_PREFETCHES:
+            /* FALLTHROUGH */
+        case DI_SWAP_WRITE_LATENCY:
+            /* FALLTHROUGH */
+        case DI_SWAP_READ_LATENCY:
             swap_driver_info(&result, what);
             break;
 
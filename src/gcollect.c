@@ -127,6 +127,7 @@
 #include "i-eval_cost.h"
 
 #include "../mudlib/sys/driver_hook.h"
+#include "../mudlib/sys/driver_info.h"
 
 /*-------------------------------------------------------------------------*/
 
@@ -173,7 +174,186 @@ static lambda_t *stale_lambda_closures;
 
 #endif /* GC_SUPPORT */
 
+long data_clean_slice_time = DEFAULT_DATA_CLEAN_SLICE_TIME;
+  /* Time in microseconds one slice of an incremental data-clean of
+   * all objects may take. 0 means no limit.
+   */
+
+static Bool cleanup_pass_active = MY_FALSE;
+  /* TRUE while an incremental data-clean of all objects is in progress.
+   */
+
+static object_t *cleanup_pass_next = NULL;
+  /* The next object to clean up in the current pass. The objects
+   * are cleaned up in the order of the obj_list, objects created
+   * during the pass are not considered.
+   */
+
+static long cleanup_pass_objects;
+static unsigned long cleanup_pass_values;
+static long cleanup_pass_slices;
+  /* Statistics of the current pass.
+   */
+
+static struct cleanup_s *cleanup_pass_context = NULL;
+  /* The cleanup context of the current pass. It is kept from one slice
+   * to the next, so that arrays and mappings shared by several objects
+   * are cleaned up only once per pass.
+   */
+
+static unsigned long gc_pause_histogram[PAUSE_HISTOGRAM_SIZE];
+static unsigned long data_clean_pause_histogram[PAUSE_HISTOGRAM_SIZE];
+  /* The durations of the garbage collections resp. the slices of
+   * the incremental data-cleans. Entry 0 counts the pauses shorter than
+   * 1 ms, entry i the pauses of 2^(i-1) ms up to 2^i ms, the last
+   * entry all longer pauses.
+   */
+
+#define CYCLE_ROOT_TABLE_SIZE  16384
+  /* Number of entries in the table of possible cycle roots,
+   * must be a power of 2. At most half of it is used.
+   */
+
+#define CYCLE_BATCH_SIZE  256
+  /* Number of roots examined together by the cycle collector.
+   */
+
+#define CYCLE_MAX_BATCH_NODES  10000
+  /* Number of containers the cycle collector examines for one batch
+   * of roots at most. If the roots reach more containers, the batch
+   * is abandoned and left to the garbage collection.
+   */
+
+#define CYCLE_MAX_NODES  100000
+  /* Number of containers the cycle collector examines per backend
+   * cycle at most (give or take one batch).
+   */
+
+typedef struct cycle_root_s cycle_root_t;
+typedef struct cycle_node_s cycle_node_t;
+typedef struct cycle_graph_s cycle_graph_t;
+
+/* --- struct cycle_root_s: a possible root of a reference cycle
+ */
+
+struct cycle_root_s
+{
+    void   * ptr;   /* The container, NULL for an unused entry */
+    ph_int   type;  /* T_POINTER, T_MAPPING or T_STRUCT */
+};
+
+/* --- struct cycle_node_s: one container examined by the cycle collector
+ */
+
+struct cycle_node_s
+{
+    void   * ptr;       /* The container */
+    ph_int   type;      /* T_POINTER, T_MAPPING, T_STRUCT or T_CLOSURE */
+    Bool     black;     /* TRUE if the container is referenced from
+                         * outside of the examined containers.
+                         */
+    p_int    internal;  /* Number of references from the examined
+                         * containers.
+                         */
+};
+
+/* --- struct cycle_graph_s: the containers examined by the cycle collector
+ *
+ * The containers are registered in a pointer table, their .id_number
+ * is the index of the node in .nodes[].
+ */
+
+struct cycle_graph_s
+{
+    struct pointer_table * ptable;
+    cycle_node_t * nodes;      /* The containers */
+    mp_int         num_nodes;  /* Number of used entries in .nodes[] */
+    mp_int       * stack;      /* Stack of nodes to mark black */
+    mp_int         stack_top;  /* Number of entries on .stack[] */
+    Bool           complete;
+      /* FALSE if the containers exceeded CYCLE_MAX_BATCH_NODES,
+       * or memory ran out.
+       */
+    Bool           marking;
+      /* FALSE while counting the internal references, TRUE while
+       * marking the externally referenced containers.
+       */
+    p_int          map_width;  /* Number of values of the walked mapping */
+};
+
+static cycle_root_t cycle_roots[CYCLE_ROOT_TABLE_SIZE];
+  /* The possible roots of reference cycles: arrays, mappings and structs
+   * which lost a reference but are still alive. The table is an open
+   * addressed hash table with linear probing.
+   */
+
+static mp_int num_cycle_roots = 0;
+  /* Number of used entries in cycle_roots[].
+   */
+
+static mp_int cycle_root_scan = 0;
+  /* The index in cycle_roots[] where the next batch is taken from.
+   */
+
+static unsigned long num_cycle_garbage_freed = 0;
+  /* Number of containers freed by the cycle collector.
+   */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+pause_usecs (struct timeval * t_begin)
+
+/* Return the microseconds passed since <t_begin>.
+ */
+
+{
+    struct timeval t_end;
+
+    if (gettimeofday(&t_end, NULL))
+        return 0;
+
+    return (mp_int)(t_end.tv_sec - t_begin->tv_sec) * 1000000
+           + (t_end.tv_usec - t_begin->tv_usec);
+} /* pause_usecs() */
+
+/*-------------------------------------------------------------------------*/
+static void
+count_pause (unsigned long * histogram, mp_int usecs)
+
+/* Count a pause of <usecs> microseconds in <histogram>.
+ */
+
+{
+    int i;
+
+    for (i = 0; i < PAUSE_HISTOGRAM_SIZE - 1 && usecs >= 1000; i++)
+        usecs /= 2;
+    histogram[i]++;
+} /* count_pause() */
+
 /*-------------------------------------------------------------------------*/
+vector_t *
+get_pause_histogram (Bool gc)
+
+/* Return the pause histogram of the garbage collection (<gc> is TRUE)
+ * or of the incremental data-cleans as an array.
+ */
+
+{
+    unsigned long * histogram = gc ? gc_pause_histogram
+                                   : data_clean_pause_histogram;
+    vector_t * v;
+    int i;
+
+    v = allocate_array(PAUSE_HISTOGRAM_SIZE);
+    if (v == NULL)
+        return NULL;
+
+    for (i = 0; i < PAUSE_HISTOGRAM_SIZE; i++)
+        put_number(v->item + i, (p_int)histogram[i]);
+
+    return v;
+} /* get_pause_histogram() */
 
 /*=========================================================================*/
 
@@ -291,6 +471,28 @@ cleanup_reset (cleanup_t * context)
     return MY_TRUE;
 } /* cleanup_reset() */
 
+/*-------------------------------------------------------------------------*/
+static Bool
+cleanup_reset_mappings (cleanup_t * context)
+
+/* Reallocate the mapping pointertable in the context, after the mappings
+ * listed in it have been compacted.
+ * Return TRUE if successful, and FALSE when out of memory.
+ */
+
+{
+    free_pointer_table(context->mtable);
+
+    context->mtable = new_pointer_table();
+    if (context->mtable == NULL)
+    {
+        outofmemory("object cleanup pointertable");
+        return MY_FALSE;
+    }
+
+    return MY_TRUE;
+} /* cleanup_reset_mappings() */
+
 /*-------------------------------------------------------------------------*/
 static void
 cleanup_free (cleanup_t * context)
@@ -301,7 +503,8 @@ cleanup_free (cleanup_t * context)
 {
     if (context->ptable)
         free_pointer_table(context->ptable);
-    free_pointer_table(context->mtable);
+    if (context->mtable)
+        free_pointer_table(context->mtable);
     xfree(context);
 } /* cleanup_free() */
 
@@ -445,10 +648,11 @@ cleanup_vector (svalue_t *svp, size_t num, cleanup_t * context)
 
                 /* Remember the mapping for later compaction (unless
                  * we have it already).
-                 * Only 'dirty' mappings need to be listed, as the cleanup
-                 * can't cause a mapping to add a hash part.
+                 * Only 'dirty' mappings need to be listed, ie. those
+                 * with unused entries (check_map_for_destr() above
+                 * already removed the keys of destructed objects).
                  */
-                if (p->u.map->hash
+                if (MAP_IS_DIRTY(p->u.map)
                  && NULL != register_pointer(context->mtable, p->u.map)
                   )
                 {
@@ -792,22 +996,97 @@ static mp_int time_cleanup = 0;
 #endif /* LOG_CLEANUP */
 } /* cleanup_driver_structures() */
 
+/*-------------------------------------------------------------------------*/
+static void
+cleanup_next_objects (mp_int budget)
+
+/* Clean up the objects of the current data-clean of all objects,
+ * starting with <cleanup_pass_next>, until all objects are done or
+ * <budget> microseconds have passed (0 means no limit). When all objects
+ * are done, the driver structures are cleaned up as well and the pass
+ * ends.
+ *
+ * The pointertable of the pass context stays valid between the slices:
+ * a memory block freed and reused in the meantime just isn't looked at
+ * again in this pass. The mappings to compact are referenced, so they
+ * are compacted at the end of every slice and not kept beyond it.
+ */
+
+{
+    cleanup_t      * context;
+    struct timeval   t_begin;
+
+    if (gettimeofday(&t_begin, NULL))
+        budget = 0;
+
+    if (cleanup_pass_context == NULL)
+        cleanup_pass_context = cleanup_new(MY_TRUE);
+    context = cleanup_pass_context;
+    if (context == NULL)
+    {
+        cleanup_pass_next = NULL;
+        cleanup_pass_active = MY_FALSE;
+        return;
+    }
+
+    while (cleanup_pass_next != NULL)
+    {
+        object_t * ob = cleanup_pass_next;
+
+        cleanup_pass_next = ob->next_all;
+        cleanup_pass_objects++;
+
+        /* If the object is swapped for the cleanup, throw away
+         * the pointertable afterwards as the memory locations
+         * are no longer unique.
+         */
+        if ( cleanup_single_object(ob, context)
+         && !cleanup_reset(context))
+        {
+            /* Out of memory: abandon this pass. */
+            cleanup_pass_next = NULL;
+            break;
+        }
+
+        if (budget && pause_usecs(&t_begin) >= budget)
+            break;
+    }
+
+    if (cleanup_pass_next == NULL)
+    {
+        if (context->ptable != NULL)
+            cleanup_structures(context);
+        cleanup_pass_active = MY_FALSE;
+    }
+    cleanup_compact_mappings(context);
+    cleanup_pass_values += context->numValues;
+    context->numValues = 0;
+    cleanup_pass_slices++;
+
+    if (!cleanup_pass_active
+     || context->ptable == NULL
+     || !cleanup_reset_mappings(context))
+    {
+        cleanup_free(context);
+        cleanup_pass_context = NULL;
+        cleanup_pass_next = NULL;
+        cleanup_pass_active = MY_FALSE;
+    }
+} /* cleanup_next_objects() */
+
 /*-------------------------------------------------------------------------*/
 void
 cleanup_all_objects (void)
 
 /* Cleanup all objects in the game, and force the mapping compaction.
- * This function is called by the garbage-collector right at the start,
- * and also by the backend.
+ * This function is called by the garbage-collector right at the start.
+ * An incremental data-clean in progress is completed by this.
  */
 
 {
-    cleanup_t      * context = NULL;
 #ifdef LOG_CLEANUP_ALL
     struct timeval   t_begin, t_end;
 #endif /* LOG_CLEANUP_ALL */
-    long             numObjects = 0;
-    unsigned long    numValues = 0;
 
 #ifdef LOG_CLEANUP_ALL
     if (gettimeofday(&t_begin, NULL))
@@ -822,36 +1101,29 @@ cleanup_all_objects (void)
           );
 #endif /* LOG_CLEANUP_ALL */
 
-    context = cleanup_new(MY_TRUE);
-    if (context != NULL)
+    /* Start over with a fresh context: the objects cleaned up so far
+     * in an incremental pass may have changed since.
+     */
+    if (cleanup_pass_context != NULL)
     {
-        object_t   * ob;
-        for (ob = obj_list; ob; ob = ob->next_all)
-        {
-            /* If the object is swapped for the cleanup, throw away
-             * the pointertable afterwards as the memory locations
-             * are no longer unique.
-             */
-            if ( cleanup_single_object(ob, context)
-             && !cleanup_reset(context))
-            {
-                cleanup_free(context);
-                return;
-            }
-            numObjects++;
-        }
-        cleanup_structures(context);
-        cleanup_compact_mappings(context);
-        numValues = context->numValues;
-        cleanup_free(context);
+        cleanup_free(cleanup_pass_context);
+        cleanup_pass_context = NULL;
     }
 
+    cleanup_pass_active = MY_TRUE;
+    cleanup_pass_next = obj_list;
+    cleanup_pass_objects = 0;
+    cleanup_pass_values = 0;
+    cleanup_pass_slices = 0;
+
+    cleanup_next_objects(0);
+
 #ifdef LOG_CLEANUP_ALL
     if (t_begin.tv_sec == 0
      || gettimeofday(&t_end, NULL))
     {
-        debug_message("%s Data-Cleaned %ld objects: %lu values.\n", time_stamp(), numObjects, numValues);
-        printf("%s Data-Cleaned %ld objects: %lu values.\n", time_stamp(), numObjects, numValues);
+        debug_message("%s Data-Cleaned %ld objects: %lu values.\n", time_stamp(), cleanup_pass_objects, cleanup_pass_values);
+        printf("%s Data-Cleaned %ld objects: %lu values.\n", time_stamp(), cleanup_pass_objects, cleanup_pass_values);
     }
     else
     {
@@ -864,19 +1136,683 @@ cleanup_all_objects (void)
         }
 
         debug_message("%s Data-Cleaned %ld objects in %ld.%06ld s, %6lu values.\n"
-                     , time_stamp(), numObjects
+                     , time_stamp(), cleanup_pass_objects
                      , (long)t_end.tv_sec, (long)t_end.tv_usec
-                     , numValues
+                     , cleanup_pass_values
                      );
         printf("%s Data-Cleaned %ld objects in %ld.%06ld s, %6lu values.\n"
-              , time_stamp(), numObjects
+              , time_stamp(), cleanup_pass_objects
               , (long)t_end.tv_sec, (long)t_end.tv_usec
-              , numValues
+              , cleanup_pass_values
               );
     }
 #endif /* LOG_CLEANUP_ALL */
 } /* cleanup_all_objects() */
 
+/*-------------------------------------------------------------------------*/
+void
+start_cleanup_all_objects (void)
+
+/* Start an incremental data-clean of all objects, unless one is already
+ * in progress. The work is done by subsequent calls to
+ * continue_cleanup_all_objects().
+ */
+
+{
+    if (cleanup_pass_active)
+        return;
+
+#ifdef LOG_CLEANUP_ALL
+    debug_message("%s Data-Clean: All Objects (incremental)\n"
+                 , time_stamp()
+                 );
+    printf("%s Data-Clean: All Objects (incremental)\n"
+          , time_stamp()
+          );
+#endif /* LOG_CLEANUP_ALL */
+
+    cleanup_pass_active = MY_TRUE;
+    cleanup_pass_next = obj_list;
+    cleanup_pass_objects = 0;
+    cleanup_pass_values = 0;
+    cleanup_pass_slices = 0;
+} /* start_cleanup_all_objects() */
+
+/*-------------------------------------------------------------------------*/
+void
+continue_cleanup_all_objects (void)
+
+/* If an incremental data-clean of all objects is in progress, clean up
+ * the next objects for at most <data_clean_slice_time> microseconds.
+ *
+ * This function is called by the backend once per cycle.
+ */
+
+{
+    struct timeval t_begin;
+
+    if (!cleanup_pass_active)
+        return;
+
+    if (gettimeofday(&t_begin, NULL))
+        t_begin.tv_sec = t_begin.tv_usec = 0;
+
+    cleanup_next_objects(data_clean_slice_time);
+
+    if (t_begin.tv_sec != 0)
+        count_pause(data_clean_pause_histogram, pause_usecs(&t_begin));
+
+#ifdef LOG_CLEANUP_ALL
+    if (!cleanup_pass_active)
+    {
+        debug_message("%s Data-Cleaned %ld objects in %ld slices, %6lu values.\n"
+                     , time_stamp(), cleanup_pass_objects
+                     , cleanup_pass_slices, cleanup_pass_values
+                     );
+        printf("%s Data-Cleaned %ld objects in %ld slices, %6lu values.\n"
+              , time_stamp(), cleanup_pass_objects
+              , cleanup_pass_slices, cleanup_pass_values
+              );
+    }
+#endif /* LOG_CLEANUP_ALL */
+} /* continue_cleanup_all_objects() */
+
+/*-------------------------------------------------------------------------*/
+void
+cleanup_remove_object (object_t * ob)
+
+/* Object <ob> is about to be removed from the obj_list: make sure
+ * that the incremental data-clean doesn't continue with it.
+ */
+
+{
+    if (ob == cleanup_pass_next)
+        cleanup_pass_next = ob->next_all;
+} /* cleanup_remove_object() */
+
+/*=========================================================================*/
+
+/*            Cycle collection
+ *
+ * Reference cycles between arrays, mappings, structs and inline closures
+ * keep each other alive, even when nothing else references them anymore.
+ * To reclaim them without waiting for the next garbage collection,
+ * every such container which loses a reference without being freed
+ * is noted as a possible root of a garbage cycle.
+ *
+ * Once per backend cycle the roots are examined in batches by trial
+ * deletion (following Bacon and Rajan): all containers reachable from
+ * the roots are collected, and for each the number of references from
+ * within this graph is counted. Containers with more references than
+ * that are referenced from outside, and so is everything reachable from
+ * them. All other containers are garbage: their contents are freed,
+ * which frees the containers themselves.
+ *
+ * The refcounts of the containers are not touched while examining
+ * the graph, all the bookkeeping happens in the cycle_graph_t.
+ */
+
+/*-------------------------------------------------------------------------*/
+static INLINE mp_int
+cycle_root_hash (void * p)
+
+/* Return the index of <p> in cycle_roots[].
+ */
+
+{
+    p_uint h = (p_uint)p >> 3;
+
+    h ^= (h >> 14) ^ (h >> 28);
+    return (mp_int)(h & (CYCLE_ROOT_TABLE_SIZE - 1));
+} /* cycle_root_hash() */
+
+/*-------------------------------------------------------------------------*/
+static void
+remove_cycle_root_at (mp_int ix)
+
+/* Remove entry <ix> from cycle_roots[], moving the following entries
+ * of the same probe sequence back as necessary.
+ */
+
+{
+    mp_int next = ix;
+
+    for (;;)
+    {
+        mp_int home;
+
+        next = (next + 1) & (CYCLE_ROOT_TABLE_SIZE - 1);
+        if (cycle_roots[next].ptr == NULL)
+            break;
+
+        /* The entry may move to <ix> if its home position is not
+         * (cyclically) in (ix, next].
+         */
+        home = cycle_root_hash(cycle_roots[next].ptr);
+        if (next > ix ? (home <= ix || home > next)
+                      : (home <= ix && home > next))
+        {
+            cycle_roots[ix] = cycle_roots[next];
+            ix = next;
+        }
+    }
+
+    cycle_roots[ix].ptr = NULL;
+    num_cycle_roots--;
+} /* remove_cycle_root_at() */
+
+/*-------------------------------------------------------------------------*/
+void
+note_cycle_root (void * p, ph_int type)
+
+/* Container <p> of <type> (T_POINTER, T_MAPPING or T_STRUCT) lost
+ * a reference but is still alive: note it as a possible cycle root.
+ * If the table is full, the root is ignored; cycles rooted there are
+ * left to the garbage collection.
+ */
+
+{
+    mp_int ix;
+
+    if (num_cycle_roots >= CYCLE_ROOT_TABLE_SIZE / 2)
+        return;
+
+    for ( ix = cycle_root_hash(p)
+        ; cycle_roots[ix].ptr != NULL
+        ; ix = (ix + 1) & (CYCLE_ROOT_TABLE_SIZE - 1))
+    {
+        if (cycle_roots[ix].ptr == p)
+            return;
+    }
+
+    cycle_roots[ix].ptr = p;
+    cycle_roots[ix].type = type;
+    num_cycle_roots++;
+} /* note_cycle_root() */
+
+/*-------------------------------------------------------------------------*/
+void
+forget_cycle_root (void * p)
+
+/* Container <p> is about to be deallocated: remove it from the
+ * possible cycle roots.
+ */
+
+{
+    mp_int ix;
+
+    if (!num_cycle_roots)
+        return;
+
+    for ( ix = cycle_root_hash(p)
+        ; cycle_roots[ix].ptr != NULL
+        ; ix = (ix + 1) & (CYCLE_ROOT_TABLE_SIZE - 1))
+    {
+        if (cycle_roots[ix].ptr == p)
+        {
+            remove_cycle_root_at(ix);
+            return;
+        }
+    }
+} /* forget_cycle_root() */
+
+/*-------------------------------------------------------------------------*/
+void
+clear_cycle_roots (void)
+
+/* Forget all possible cycle roots. This is called after a garbage
+ * collection, which frees unreferenced containers directly.
+ */
+
+{
+    memset(cycle_roots, 0, sizeof(cycle_roots));
+    num_cycle_roots = 0;
+} /* clear_cycle_roots() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+find_cycle_node (cycle_graph_t * graph, void * p, ph_int type)
+
+/* Return the index of container <p> of <type> in <graph>. While counting
+ * the references, the container is added to the graph if necessary.
+ * Return -1 if the container is not part of the graph, or it can't
+ * be added.
+ */
+
+{
+    struct pointer_record * prc;
+    cycle_node_t * node;
+
+    if (graph->marking)
+    {
+        prc = lookup_pointer(graph->ptable, p);
+        return prc ? prc->id_number : -1;
+    }
+
+    if (!graph->complete)
+        return -1;
+
+    prc = find_add_pointer(graph->ptable, p, MY_TRUE);
+    if (prc == NULL)
+    {
+        graph->complete = MY_FALSE;
+        return -1;
+    }
+
+    if (prc->ref_count >= 0)
+        return prc->id_number;
+
+    /* A new container */
+
+    if (graph->num_nodes >= CYCLE_MAX_BATCH_NODES)
+    {
+        graph->complete = MY_FALSE;
+        return -1;
+    }
+
+    prc->ref_count = 0;
+    prc->id_number = graph->num_nodes;
+
+    node = graph->nodes + graph->num_nodes++;
+    node->ptr = p;
+    node->type = type;
+    node->black = MY_FALSE;
+    node->internal = 0;
+
+    return prc->id_number;
+} /* find_cycle_node() */
+
+/*-------------------------------------------------------------------------*/
+static void
+visit_cycle_value (svalue_t * svp, cycle_graph_t * graph)
+
+/* The value <svp> is referenced from a container in <graph>. If it is
+ * a container itself, count the reference (resp. mark the container
+ * as referenced from outside if <graph> is marking).
+ */
+
+{
+    void * p;
+    ph_int type;
+    mp_int ix;
+
+    switch (svp->type)
+    {
+    case T_POINTER:
+    case T_QUOTED_ARRAY:
+        if (!VEC_SIZE(svp->u.vec))
+            return;
+        p = svp->u.vec;
+        type = T_POINTER;
+        break;
+
+    case T_MAPPING:
+        p = svp->u.map;
+        type = T_MAPPING;
+        break;
+
+    case T_STRUCT:
+        p = svp->u.strct;
+        type = T_STRUCT;
+        break;
+
+    case T_CLOSURE:
+        /* Only inline closures with context variables can be
+         * part of a cycle.
+         */
+        if (svp->x.closure_type != CLOSURE_LFUN
+         || !svp->u.lambda->function.lfun.context_size)
+            return;
+        p = svp->u.lambda;
+        type = T_CLOSURE;
+        break;
+
+    default:
+        return;
+    }
+
+    ix = find_cycle_node(graph, p, type);
+    if (ix < 0)
+        return;
+
+    if (!graph->marking)
+        graph->nodes[ix].internal++;
+    else if (!graph->nodes[ix].black)
+    {
+        graph->nodes[ix].black = MY_TRUE;
+        graph->stack[graph->stack_top++] = ix;
+    }
+} /* visit_cycle_value() */
+
+/*-------------------------------------------------------------------------*/
+static void
+visit_cycle_map_entry (svalue_t * key, svalue_t * data, void * extra)
+
+/* Callback from walk_mapping() for visit_cycle_node().
+ */
+
+{
+    cycle_graph_t * graph = (cycle_graph_t *)extra;
+    p_int i;
+
+    visit_cycle_value(key, graph);
+    for (i = 0; i < graph->map_width; i++)
+        visit_cycle_value(data + i, graph);
+} /* visit_cycle_map_entry() */
+
+/*-------------------------------------------------------------------------*/
+static void
+visit_cycle_node (cycle_graph_t * graph, mp_int ix)
+
+/* Visit all values referenced by node <ix> of <graph>.
+ */
+
+{
+    cycle_node_t * node = graph->nodes + ix;
+    svalue_t * svp;
+    mp_int num;
+
+    switch (node->type)
+    {
+    case T_POINTER:
+        svp = ((vector_t *)node->ptr)->item;
+        num = VEC_SIZE((vector_t *)node->ptr);
+        break;
+
+    case T_STRUCT:
+        svp = ((struct_t *)node->ptr)->member;
+        num = struct_size((struct_t *)node->ptr);
+        break;
+
+    case T_CLOSURE:
+        svp = ((lambda_t *)node->ptr)->context;
+        num = ((lambda_t *)node->ptr)->function.lfun.context_size;
+        break;
+
+    case T_MAPPING:
+        graph->map_width = ((mapping_t *)node->ptr)->num_values;
+        walk_mapping((mapping_t *)node->ptr, visit_cycle_map_entry, graph);
+        return;
+
+    default:
+        return;
+    }
+
+    for ( ; num > 0; num--, svp++)
+        visit_cycle_value(svp, graph);
+} /* visit_cycle_node() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+is_cycle_node_external (cycle_node_t * node)
+
+/* Return TRUE if <node> has references from outside of the graph.
+ */
+
+{
+    switch (node->type)
+    {
+    case T_POINTER:
+        return ((vector_t *)node->ptr)->ref > node->internal;
+
+    case T_STRUCT:
+        return ((struct_t *)node->ptr)->ref > node->internal;
+
+    case T_CLOSURE:
+        return ((lambda_t *)node->ptr)->ref > node->internal;
+
+    case T_MAPPING:
+      {
+        mapping_t * m = (mapping_t *)node->ptr;
+
+        /* Mappings with protected entries are in use. */
+        return m->ref > node->internal || (m->hash && m->hash->ref);
+      }
+    }
+
+    return MY_TRUE;
+} /* is_cycle_node_external() */
+
+/*-------------------------------------------------------------------------*/
+static void
+free_cycle_garbage (cycle_graph_t * graph)
+
+/* Free all nodes of <graph> which are not marked black.
+ */
+
+{
+    mp_int ix;
+    cycle_node_t * node;
+
+    /* Keep the garbage alive while its contents are freed. */
+    for (ix = 0, node = graph->nodes; ix < graph->num_nodes; ix++, node++)
+    {
+        if (node->black)
+            continue;
+
+        switch (node->type)
+        {
+        case T_POINTER: ((vector_t *)node->ptr)->ref++; break;
+        case T_MAPPING: ((mapping_t *)node->ptr)->ref++; break;
+        case T_STRUCT:  ((struct_t *)node->ptr)->ref++; break;
+        case T_CLOSURE: ((lambda_t *)node->ptr)->ref++; break;
+        }
+    }
+
+    /* Free the contents, breaking the cycles. */
+    for (ix = 0, node = graph->nodes; ix < graph->num_nodes; ix++, node++)
+    {
+        svalue_t * svp;
+        mp_int num;
+
+        if (node->black)
+            continue;
+
+        switch (node->type)
+        {
+        case T_POINTER:
+            svp = ((vector_t *)node->ptr)->item;
+            num = VEC_SIZE((vector_t *)node->ptr);
+            break;
+
+        case T_STRUCT:
+            svp = ((struct_t *)node->ptr)->member;
+            num = struct_size((struct_t *)node->ptr);
+            break;
+
+        case T_CLOSURE:
+            svp = ((lambda_t *)node->ptr)->context;
+            num = ((lambda_t *)node->ptr)->function.lfun.context_size;
+            break;
+
+        case T_MAPPING:
+            clear_mapping((mapping_t *)node->ptr);
+            /* FALLTHROUGH */
+        default:
+            continue;
+        }
+
+        for ( ; num > 0; num--, svp++)
+        {
+            free_svalue(svp);
+            put_number(svp, 0);
+        }
+    }
+
+    /* Free the containers themselves. */
+    for (ix = 0, node = graph->nodes; ix < graph->num_nodes; ix++, node++)
+    {
+        if (node->black)
+            continue;
+
+        switch (node->type)
+        {
+        case T_POINTER:
+            free_array((vector_t *)node->ptr);
+            break;
+
+        case T_MAPPING:
+            free_mapping((mapping_t *)node->ptr);
+            break;
+
+        case T_STRUCT:
+            free_struct((struct_t *)node->ptr);
+            break;
+
+        case T_CLOSURE:
+          {
+            svalue_t closure;
+
+            closure.type = T_CLOSURE;
+            closure.x.closure_type = CLOSURE_LFUN;
+            closure.u.lambda = (lambda_t *)node->ptr;
+            free_closure(&closure);
+            break;
+          }
+        }
+
+        num_cycle_garbage_freed++;
+    }
+} /* free_cycle_garbage() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+collect_cycle_batch (cycle_graph_t * graph)
+
+/* Take the next batch of roots from cycle_roots[] and free the
+ * garbage cycles among them, using the node and stack memory
+ * in <graph>.
+ *
+ * Return the number of containers examined.
+ */
+
+{
+    cycle_root_t batch[CYCLE_BATCH_SIZE];
+    mp_int num_batch, ix;
+
+    /* Take the roots out of the table. */
+    for ( num_batch = 0, ix = cycle_root_scan
+        ; num_batch < CYCLE_BATCH_SIZE && num_cycle_roots > 0
+        ; )
+    {
+        if (cycle_roots[ix].ptr != NULL)
+        {
+            /* The removal may move the next entry into this slot. */
+            batch[num_batch++] = cycle_roots[ix];
+            remove_cycle_root_at(ix);
+        }
+        else
+            ix = (ix + 1) & (CYCLE_ROOT_TABLE_SIZE - 1);
+    }
+    cycle_root_scan = ix;
+
+    graph->ptable = new_pointer_table();
+    if (graph->ptable == NULL)
+        return num_batch;
+
+    graph->num_nodes = 0;
+    graph->stack_top = 0;
+    graph->complete = MY_TRUE;
+    graph->marking = MY_FALSE;
+
+    /* Collect the reachable containers, counting the internal references.
+     * The nodes array doubles as the queue of containers to visit.
+     */
+    for (ix = 0; ix < num_batch; ix++)
+        (void)find_cycle_node(graph, batch[ix].ptr, batch[ix].type);
+
+    for (ix = 0; ix < graph->num_nodes && graph->complete; ix++)
+        visit_cycle_node(graph, ix);
+
+    if (graph->complete)
+    {
+        /* Mark everything reachable from outside. */
+        graph->marking = MY_TRUE;
+
+        for (ix = 0; ix < graph->num_nodes; ix++)
+        {
+            if (is_cycle_node_external(graph->nodes + ix))
+            {
+                graph->nodes[ix].black = MY_TRUE;
+                graph->stack[graph->stack_top++] = ix;
+            }
+        }
+
+        while (graph->stack_top > 0)
+            visit_cycle_node(graph, graph->stack[--graph->stack_top]);
+
+        free_cycle_garbage(graph);
+    }
+
+    free_pointer_table(graph->ptable);
+    graph->ptable = NULL;
+
+    return graph->num_nodes > num_batch ? graph->num_nodes : num_batch;
+} /* collect_cycle_batch() */
+
+/*-------------------------------------------------------------------------*/
+void
+collect_cycles (void)
+
+/* Examine the possible cycle roots noted so far, and free the garbage
+ * cycles among them. The work is limited to about CYCLE_MAX_NODES
+ * examined containers, remaining roots are examined in the next call.
+ *
+ * This function is called by the backend once per cycle.
+ */
+
+{
+    cycle_graph_t graph;
+    mp_int num_examined;
+
+    if (!num_cycle_roots)
+        return;
+
+    graph.nodes = xalloc(CYCLE_MAX_BATCH_NODES * sizeof(*graph.nodes));
+    graph.stack = xalloc(CYCLE_MAX_BATCH_NODES * sizeof(*graph.stack));
+    if (graph.nodes == NULL || graph.stack == NULL)
+    {
+        if (graph.nodes)
+            xfree(graph.nodes);
+        if (graph.stack)
+            xfree(graph.stack);
+        return;
+    }
+
+    for ( num_examined = 0
+        ; num_cycle_roots > 0 && num_examined < CYCLE_MAX_NODES
+        ; )
+        num_examined += collect_cycle_batch(&graph);
+
+    xfree(graph.nodes);
+    xfree(graph.stack);
+} /* collect_cycles() */
+
+/*-------------------------------------------------------------------------*/
+void
+cycle_driver_info (svalue_t *svp, int value)
+
+/* Returns the cycle collector information for driver_info(<what>).
+ * <svp> points to the svalue for the result.
+ */
+
+{
+    switch (value)
+    {
+        case DI_NUM_CYCLE_ROOTS:
+            put_number(svp, num_cycle_roots);
+            break;
+
+        case DI_NUM_CYCLE_GARBAGE_FREED:
+            put_number(svp, (p_int)num_cycle_garbage_freed);
+            break;
+
+        default:
+            fatal("Unknown option for cycle_driver_info(): %d\n", value);
+            break;
+    }
+} /* cycle_driver_info() */
+
 /*=========================================================================*/
 
 /*            The real collector - only if the allocator allows it.
@@ -1408,16 +2344,6 @@ clear_ref_in_vector (svalue_t *svp, size_t num)
                 mapping_t *m;
                 p_int num_values;
 
-#ifdef DEBUG
-                /* The initial cleanup phase should take care of compacting
-                 * all dirty mappings, however just in case one slips
-                 * through...
-                 */
-                if (p->u.map->hash != NULL)
-                    dprintf1(gcollect_outfd
-                            , "Mapping %x still has a hash part.\n"
-                            , (p_int)p->u.map);
-#endif
                 m = p->u.map;
                 m->ref = 0;
                 num_values = m->num_values;
@@ -1981,6 +2907,10 @@ garbage_collection(void)
     lambda_t *l, *next_l;
     int i;
     long dobj_count;
+    struct timeval t_begin;
+
+    if (gettimeofday(&t_begin, NULL))
+        t_begin.tv_sec = t_begin.tv_usec = 0;
 
     if (gcollect_outfd != 1 && gcollect_outfd != 2)
     {
@@ -2064,6 +2994,12 @@ garbage_collection(void)
     }
 #endif /* CHECK_OBJECT_REF */
 
+    /* Release the write queue of the swapper, it must not hold any memory
+     * during the GC. Until the GC is done, the swapper writes directly
+     * into the swap file.
+     */
+    sync_swap_file();
+
 
     /* --- Pass 1: clear the 'referenced' flag in all malloced blocks ---
      */
@@ -2119,6 +3055,11 @@ garbage_collection(void)
         ob->ref = 0;
         clear_string_ref(ob->name);
         clear_ref_in_vector(ob->variables, ob->prog->num_variables);
+        if (ob->ids && ob->ids->ref)
+        {
+            ob->ids->ref = 0;
+            clear_ref_in_vector(ob->ids->item, VEC_SIZE(ob->ids));
+        }
 
         if (ob->sent)
         {
@@ -2308,6 +3249,23 @@ garbage_collection(void)
                 note_action_ref((action_t *)sent);
         }
 
+        if (ob->action_index)
+            note_ref(ob->action_index);
+
+        if (ob->ids)
+        {
+            /* Don't use CHECK_REF on the null vector */
+            if (ob->ids != &null_vector && CHECK_REF(ob->ids))
+            {
+                count_array_size(ob->ids);
+                count_ref_in_vector(ob->ids->item, VEC_SIZE(ob->ids));
+            }
+            ob->ids->ref++;
+        }
+
+        if (ob->id_index)
+            note_ref(ob->id_index);
+
         if (was_swapped)
         {
             swap(ob, was_swapped);
@@ -2343,8 +3301,6 @@ garbage_collection(void)
 #ifdef USE_MCCP
         if (all_players[i]->out_compress != NULL)
             note_ref(all_players[i]->out_compress);
-        if (all_players[i]->out_compress_buf != NULL)
-            note_ref(all_players[i]->out_compress_buf);
 #endif /* USE_MCCP */
 
         /* There are no destructed interactives, or interactives
@@ -2411,6 +3367,7 @@ garbage_collection(void)
     count_interpreter_refs();
     count_heart_beat_refs();
     count_rxcache_refs();
+    count_action_table_refs();
 #ifdef USE_PGSQL
     pg_count_refs();
 #endif /* USE_PGSQL */
@@ -2514,7 +3471,14 @@ garbage_collection(void)
 
     reallocate_reserved_areas();
 
+    /* The collection freed unreferenced containers directly, the
+     * cycle roots might be among them.
+     */
+    clear_cycle_roots();
+
     time_last_gc = time(NULL);
+    if (t_begin.tv_sec != 0)
+        count_pause(gc_pause_histogram, pause_usecs(&t_begin));
     dprintf2(gcollect_outfd, "%s GC freed %d destructed objects.\n"
             , (long)time_stamp(), dobj_count);
 #if defined(CHECK_OBJECT_REF) && defined(DEBUG)
@@ -3048,6 +4012,11 @@ garbage_collection (void)
  */
 
 {
+    struct timeval t_begin;
+
+    if (gettimeofday(&t_begin, NULL))
+        t_begin.tv_sec = t_begin.tv_usec = 0;
+
     assert_master_ob_loaded();
     handle_newly_destructed_objects();
     free_save_object_buffers();
@@ -3088,6 +4057,8 @@ garbage_collection (void)
 
     reallocate_reserved_areas();
     time_last_gc = time(NULL);
+    if (t_begin.tv_sec != 0)
+        count_pause(gc_pause_histogram, pause_usecs(&t_begin));
 }
 #endif /* GC_SUPPORT */
 
@@ -125,14 +125,33 @@ extern void new_default_gc_log (int fd);
 /* Default interval for a data-clean of all objects.
  */
 
+#define DEFAULT_DATA_CLEAN_SLICE_TIME 10000
+/* Default time in microseconds for one slice of an incremental
+ * data-clean of all objects.
+ */
+
+#define PAUSE_HISTOGRAM_SIZE 20
+/* Number of entries in the pause time histograms.
+ */
+
 /* --- Variables --- */
 
 extern time_t time_last_gc;
+extern long data_clean_slice_time;
 
 /* --- Prototypes --- */
 
 extern void cleanup_object (object_t * obj);
 extern void cleanup_all_objects (void);
+extern void start_cleanup_all_objects (void);
+extern void continue_cleanup_all_objects (void);
+extern void cleanup_remove_object (object_t * ob);
+extern vector_t *get_pause_histogram (Bool gc);
+extern void note_cycle_root (void * p, ph_int type);
+extern void forget_cycle_root (void * p);
+extern void clear_cycle_roots (void);
+extern void collect_cycles (void);
+extern void cycle_driver_info (svalue_t *svp, int value);
 extern void cleanup_driver_structures (void);
 extern void garbage_collection(void);
 extern void setup_print_block_dispatcher(void);
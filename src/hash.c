@@ -2,8 +2,19 @@
  * String Hashing Functions
  *
  *---------------------------------------------------------------------------
- * We currently use MurmurHash3, by Austin Appleby, which he placed
- * into public domain.
+ * Strings are hashed with wyhash, by Wang Yi, which he placed into the
+ * public domain. It reads the string in 64 bit words and mixes them
+ * with 64x64->128 bit multiplications, which makes it much faster than
+ * MurmurHash3 for longer strings.
+ *
+ * https://github.com/wangyi-fudan/wyhash
+ *
+ * The hash is seeded with a random <hash_seed> chosen at startup, so
+ * that strings colliding in the driver's tables can't be computed
+ * in advance (hash flooding through player input).
+ *
+ * MurmurHash3, by Austin Appleby, is used for the pointer hash on
+ * unusual platforms.
  *
  * https://code.google.com/p/smhasher/
  * 
@@ -44,8 +55,15 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include "driver.h"
 
+#include "hash.h"
+
+uint64_t hash_seed = INITIAL_HASH;
+  /* The seed for all string hashes, set by seed_hash().
+   */
+
 // this does not force inlining, I just don't want to change the original code.
 #define FORCE_INLINE static INLINE
 
@@ -245,3 +263,125 @@ void MurmurHash3_x64_128 ( const void * key, const int len,
 }
 
 //-----------------------------------------------------------------------------
+
+//-----------------------------------------------------------------------------
+// wyhash (final version 4), slightly adapted to C99 and the driver.
+//
+// Like MurmurHash3 it reads the data in the native byte order, so the
+// same note applies: do not store these hashes anywhere. And as they
+// depend on the random seed, they differ between runs of the driver.
+
+static const uint64_t wyp[4] = {
+    BIG_CONSTANT(0x2d358dccaa6c78a5), BIG_CONSTANT(0x8bb84b93962eacc9),
+    BIG_CONSTANT(0x4b33a62ed433d4a3), BIG_CONSTANT(0x4d5a2da51de1aa47)
+};
+
+// Multiply <A> and <B> to 128 bit and return the low half in <A>
+// and the high half in <B>.
+FORCE_INLINE void wymum ( uint64_t * A, uint64_t * B )
+{
+#ifdef __SIZEOF_INT128__
+    __uint128_t r = *A;
+    r *= *B;
+    *A = (uint64_t)r;
+    *B = (uint64_t)(r >> 64);
+#else
+    uint64_t ha = *A >> 32, hb = *B >> 32;
+    uint64_t la = (uint32_t)*A, lb = (uint32_t)*B;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32), c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    *A = lo;
+    *B = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+}
+
+FORCE_INLINE uint64_t wymix ( uint64_t A, uint64_t B )
+{
+    wymum(&A, &B);
+    return A ^ B;
+}
+
+FORCE_INLINE uint64_t wyr8 ( const uint8_t * p )
+{
+    uint64_t v;
+    memcpy(&v, p, 8);
+    return v;
+}
+
+FORCE_INLINE uint64_t wyr4 ( const uint8_t * p )
+{
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+FORCE_INLINE uint64_t wyr3 ( const uint8_t * p, size_t k )
+{
+    return (((uint64_t)p[0]) << 16) | (((uint64_t)p[k >> 1]) << 8) | p[k - 1];
+}
+
+uint64_t wyhash ( const void * key, size_t len, uint64_t seed )
+{
+    const uint8_t * p = (const uint8_t *)key;
+    uint64_t a, b;
+
+    seed ^= wymix(seed ^ wyp[0], wyp[1]);
+
+    if (len <= 16)
+    {
+        if (len >= 4)
+        {
+            a = (wyr4(p) << 32) | wyr4(p + ((len >> 3) << 2));
+            b = (wyr4(p + len - 4) << 32) | wyr4(p + len - 4 - ((len >> 3) << 2));
+        }
+        else if (len > 0)
+        {
+            a = wyr3(p, len);
+            b = 0;
+        }
+        else
+            a = b = 0;
+    }
+    else
+    {
+        size_t i = len;
+
+        if (i > 48)
+        {
+            uint64_t see1 = seed, see2 = seed;
+
+            do
+            {
+                seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+                see1 = wymix(wyr8(p + 16) ^ wyp[2], wyr8(p + 24) ^ see1);
+                see2 = wymix(wyr8(p + 32) ^ wyp[3], wyr8(p + 40) ^ see2);
+                p += 48;
+                i -= 48;
+            } while (i > 48);
+            seed ^= see1 ^ see2;
+        }
+
+        while (i > 16)
+        {
+            seed = wymix(wyr8(p) ^ wyp[1], wyr8(p + 8) ^ seed);
+            i -= 16;
+            p += 16;
+        }
+
+        a = wyr8(p + i - 16);
+        b = wyr8(p + i - 8);
+    }
+
+    a ^= wyp[1];
+    b ^= seed;
+    wymum(&a, &b);
+    return wymix(a ^ wyp[0] ^ len, b ^ wyp[1]);
+}
+
+//-----------------------------------------------------------------------------
+void seed_hash ( uint64_t seed )
+{
+    hash_seed = seed;
+}
@@ -20,8 +20,15 @@ typedef uint32_t  hash32_t;
 #define hashsize(n) (((uint32_t)1<<(n))-1)
 #define hashmask(n) (hashsize(n) - 1)
 
+extern uint64_t hash_seed;
+
 extern void MurmurHash3_x86_32 ( const void * key, int len,
                                 uint32_t seed, void * out );
+extern uint64_t wyhash ( const void * key, size_t len, uint64_t seed );
+
+// Set the random seed for the string hashes. This must happen before
+// the first string is hashed.
+extern void seed_hash ( uint64_t seed );
 
 // Hash <len> characters into a uint32_t integer and return the result.
 static INLINE hash32_t hashmem32(void const * key, size_t len)
@@ -41,16 +48,14 @@ static INLINE hash32_t hashpointer(void const * ptr)
 
 static INLINE hash32_t hashmem32(void const * key, size_t len)
 {
-    uint32_t result;
-    MurmurHash3_x86_32(key, len, INITIAL_HASH, &result);
-    return result;
+    uint64_t result = wyhash(key, len, hash_seed);
+    return (hash32_t)(result ^ (result >> 32));
 }
 
 static INLINE hash32_t hashmem32_chained(void const * key, size_t len, hash32_t initval)
 {
-    uint32_t result;
-    MurmurHash3_x86_32(key, len, initval, &result);
-    return result;
+    uint64_t result = wyhash(key, len, hash_seed ^ initval);
+    return (hash32_t)(result ^ (result >> 32));
 }
 
 
@@ -5,29 +5,37 @@
  * This module holds the datastructures and function related to the
  * handling of heartbeats.
  *
- * Objects with active heartbeats are referenced from a list which
- * is sorted in ascending order of the object pointers. However, these
- * object pointers do not count as 'refs'. The sorting prevents that
- * objects with a rapid change of the heartbeat status are called more
- * often than others.
+ * Every object with an active heartbeat has an interval <n>: its
+ * heart_beat() is called every <n> * heart_beat_interval seconds. The
+ * nodes of the objects are filed into a timing wheel of HB_WHEEL_SIZE
+ * slots, one slot per second: a node due at time <t> is kept in the slot
+ * <t> % HB_WHEEL_SIZE. However, these object pointers do not count as
+ * 'refs'.
  *
  * The backend will call call_heart_beat() in every cycle right after
- * starting a new alarm(). The function evaluates as many heartbeats
- * as possible before the alarm sets comm_time_to_call_heart_beat,
- * and then returns. If some heartbeats are left unprocessed, the first
- * of them is remembered in a pointer so that the next call can
- * continue from there.
+ * starting a new alarm(). The function moves the slots of all seconds
+ * passed since the last call into the list of due heartbeats and
+ * evaluates as many of these as possible before the alarm sets
+ * comm_time_to_call_heart_beat, and then returns. Heartbeats left
+ * unprocessed stay in the due list and are done first in the next call.
+ * Each evaluated heartbeat files its node into the slot of its next
+ * heartbeat, so objects with long intervals cost nothing in the cycles
+ * in between. Nodes due more than HB_WHEEL_SIZE seconds ahead just pass
+ * through the due list when their slot comes around.
+ *
+ * All lists are circular doubly linked lists with their head being
+ * a dummy node, so that a node can be removed or refiled without
+ * knowing in which list it is.
  *
  * However, no heartbeats are executed at all if there is no player
  * in the game.
  *
- * TODO: Make the list a skiplist or similar.
  * TODO: Add an object flag O_IN_HB_LIST so that several toggles of the
  * TODO:: heart beat status only toggle O_HEARTBEAT, but leave the object
  * TODO:: in the list until call_heart_beat() can remove it. This would
- * TODO:: also remove the need for a double-linked or skiplist, but
- * TODO:: require the object-pointer to count as ref and it could let
- * TODO:: keep destructed objects in the list for a while.
+ * TODO:: also remove the need to search the lists when the heart beat
+ * TODO:: is turned off, but require the object-pointer to count as ref
+ * TODO:: and it could let keep destructed objects in the list for a while.
  *---------------------------------------------------------------------------
  */
 
@@ -37,6 +45,7 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <sys/types.h>
+#include <sys/time.h>
 #include <math.h>
 
 #include "heartbeat.h"
@@ -48,6 +57,7 @@
 #include "exec.h"
 #include "gcollect.h"
 #include "interpret.h"
+#include "main.h"
 #include "mstrings.h"
 #include "object.h"
 #include "sent.h"
@@ -63,16 +73,29 @@
 
 /*-------------------------------------------------------------------------*/
 
+#define HB_WHEEL_SIZE 256
+  /* Number of slots in the timing wheel, must be a power of 2.
+   * Each slot covers one second, so all heartbeats with an period
+   * of up to 256 seconds are handled without passing through the
+   * due list in between.
+   */
+
+#define HB_DUE_LIST (-1)
+  /* The slot number of nodes in the due list.
+   */
+
 /* Listnode for one object with a heartbeat
  * It is no use pooling the nodes to reduce allocation overhead, as
  * the average heartbeat use is usually much lower than the peak usage.
  */
 
 struct hb_info {
-    struct hb_info * next;  /* next node in list */
-    struct hb_info * prev;  /* previous node in list */
-    mp_int           tlast; /* time of last heart_beat */
-    object_t       * obj;   /* the object itself */
+    struct hb_info * next;     /* next node in list */
+    struct hb_info * prev;     /* previous node in list */
+    mp_int           due;      /* time of the next heart_beat */
+    p_int            interval; /* heart beat cycles between heart_beats */
+    int              slot;     /* wheel slot or HB_DUE_LIST */
+    object_t       * obj;      /* the object itself, NULL for list heads */
 };
 
 
@@ -86,13 +109,31 @@ object_t *current_heart_beat = NULL;
    * simulate.c test this in the errorf() function to react properly.
    */
 
-static struct hb_info * hb_list = NULL;
-  /* Head of the list of heart_beat infos.
+static struct hb_info hb_wheel[HB_WHEEL_SIZE];
+  /* Heads of the lists of heart_beat infos in the timing wheel.
+   */
+
+static struct hb_info hb_due;
+  /* Head of the list of heart_beat infos which are due.
+   */
+
+static mp_int hb_wheel_time = 0;
+  /* The time of the last wheel slot moved into the due list.
+   * 0 if the lists are not initialized yet.
    */
 
-static struct hb_info * next_hb = NULL;
-  /* Next hb_info whose objects' heartbeat must be executed.
-   * If NULL, the first info in the list is meant.
+static mp_int hb_slot_objs[HB_WHEEL_SIZE];
+  /* Number of objects in each wheel slot.
+   */
+
+static mp_int hb_slot_done[HB_WHEEL_SIZE];
+static mp_int hb_slot_usecs[HB_WHEEL_SIZE];
+  /* Number of heartbeats done and the microseconds spent for them
+   * when the wheel slot was due last.
+   */
+
+static mp_int hb_num_due = 0;
+  /* Number of objects in the due list.
    */
 
 #if defined(DEBUG)
@@ -109,7 +150,7 @@ static mp_int hb_num_done;
 
 static long avg_num_hb_objs = 0;
 static long avg_num_hb_done = 0;
-  /* Decaying average of num_hb_objs and hb_num_done.
+  /* Decaying average of the number of due heartbeats and hb_num_done.
    */
 
 static long num_hb_calls = 0;
@@ -120,14 +161,148 @@ static long total_hb_calls = 0;
   /* Total number of calls to call_heart_beat().
    */
 
+/*-------------------------------------------------------------------------*/
+static void
+init_hb_lists (void)
+
+/* Initialize the empty list heads of the wheel and the due list.
+ */
+
+{
+    int i;
+
+    for (i = 0; i < HB_WHEEL_SIZE; i++)
+    {
+        hb_wheel[i].next = hb_wheel[i].prev = &hb_wheel[i];
+        hb_wheel[i].obj = NULL;
+    }
+    hb_due.next = hb_due.prev = &hb_due;
+    hb_due.obj = NULL;
+
+    hb_wheel_time = current_time;
+} /* init_hb_lists() */
+
+/*-------------------------------------------------------------------------*/
+static INLINE void
+unlink_hb (struct hb_info *this)
+
+/* Remove the node <this> from its list.
+ */
+
+{
+    this->prev->next = this->next;
+    this->next->prev = this->prev;
+
+    if (this->slot == HB_DUE_LIST)
+        hb_num_due--;
+    else
+        hb_slot_objs[this->slot]--;
+} /* unlink_hb() */
+
+/*-------------------------------------------------------------------------*/
+static void
+file_hb (struct hb_info *this)
+
+/* Append the node <this> (which is not in any list) to the wheel slot
+ * of its due time. Nodes due at the time of an already processed slot
+ * (the clock went backwards) are filed into the next slot to process.
+ */
+
+{
+    struct hb_info *head;
+    mp_int time;
+
+    time = this->due > hb_wheel_time ? this->due : hb_wheel_time + 1;
+    this->slot = (int)(time & (HB_WHEEL_SIZE-1));
+    hb_slot_objs[this->slot]++;
+
+    head = &hb_wheel[this->slot];
+    this->next = head;
+    this->prev = head->prev;
+    head->prev->next = this;
+    head->prev = this;
+} /* file_hb() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+next_hb_time (p_int interval)
+
+/* Return the time of the next heartbeat for an object with <interval>,
+ * starting now.
+ */
+
+{
+    if (interval > (PINT_MAX - current_time) / heart_beat_interval)
+        return PINT_MAX;
+    return current_time + interval * heart_beat_interval;
+} /* next_hb_time() */
+
+/*-------------------------------------------------------------------------*/
+static void
+advance_hb_wheel (void)
+
+/* Move the wheel slots of all seconds up to the current time into
+ * the due list.
+ */
+
+{
+    /* If the heartbeats have been paused for a complete turn of
+     * the wheel, all the slots are due.
+     */
+    if (current_time - hb_wheel_time > HB_WHEEL_SIZE)
+        hb_wheel_time = current_time - HB_WHEEL_SIZE;
+
+    while (hb_wheel_time < current_time)
+    {
+        struct hb_info *head, *this;
+        int slot;
+
+        hb_wheel_time++;
+        slot = (int)(hb_wheel_time & (HB_WHEEL_SIZE-1));
+        head = &hb_wheel[slot];
+
+        hb_slot_done[slot] = 0;
+        hb_slot_usecs[slot] = 0;
+
+        if (head->next == head)
+            continue;
+
+        for (this = head->next; this != head; this = this->next)
+            this->slot = HB_DUE_LIST;
+        hb_num_due += hb_slot_objs[slot];
+        hb_slot_objs[slot] = 0;
+
+        /* Append the slot's list to the due list */
+        head->next->prev = hb_due.prev;
+        head->prev->next = &hb_due;
+        hb_due.prev->next = head->next;
+        hb_due.prev = head->prev;
+        head->next = head->prev = head;
+    }
+} /* advance_hb_wheel() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+hb_usecs (void)
+
+/* Return the current time in microseconds for the timing statistics.
+ */
+
+{
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return (mp_int)tv.tv_sec * 1000000 + tv.tv_usec;
+} /* hb_usecs() */
+
 /*-------------------------------------------------------------------------*/
 void
 call_heart_beat (void)
 
-/* Call the heart_beat() lfun in all registered heart beat objects; or at
- * at least call as many as possible until the next alarm timeout (as
- * registered in comm_time_to_call_heart_beat) occurs. If a timeout occurs,
- * next_hb will point to the next object with a due heartbeat.
+/* Call the heart_beat() lfun in all registered heart beat objects which
+ * are due; or at least call as many as possible until the next alarm
+ * timeout (as registered in comm_time_to_call_heart_beat) occurs. If a
+ * timeout occurs, the remaining objects stay in the due list.
  *
  * If the object in question (or one of its shadows) is living, command_giver
  * is set to the object, else it is set to NULL. If heart_beats_active is 
@@ -139,10 +314,12 @@ call_heart_beat (void)
 
 {
     struct hb_info *this;
-      /* Current list pointer, static so that longjmp() won't clobber it */
+      /* Current list pointer */
 
     static mp_int num_hb_to_do;
-      /* For statistics only */
+    static mp_int start_usecs;
+    static int slot;
+      /* For statistics only, static so that longjmp() won't clobber them */
 
     struct error_recovery_info error_recovery_info;
 
@@ -155,13 +332,14 @@ call_heart_beat (void)
     hb_num_done = 0;
 
     if (!heart_beats_enabled || !num_hb_objs)
-    {
-        next_hb = NULL;
         return;
-    }
 
-    num_hb_to_do = num_hb_objs;
+    advance_hb_wheel();
+
+    num_hb_to_do = hb_num_due;
     num_hb_calls++;
+    slot = (int)(hb_wheel_time & (HB_WHEEL_SIZE-1));
+    start_usecs = hb_usecs();
 
     /* Activate the local error recovery context */
 
@@ -179,39 +357,25 @@ call_heart_beat (void)
         debug_message("%s Error in heartbeat.\n", time_stamp());
     }
 
-    /* Set this to the next hb to be execute.
-     * This is the loop invariant.
+    /* The next hb to execute is always the first in the due list,
+     * the nodes are refiled before their heart_beat() is called.
      */
-    this = next_hb;
-
-    while (num_hb_objs && !comm_time_to_call_heart_beat)
+    while ((this = hb_due.next) != &hb_due && !comm_time_to_call_heart_beat)
     {
         object_t * obj;
 
-        /* If 'this' object is NULL, we reached the end of the
-         * list and have to wrap around.
+        unlink_hb(this);
+
+        /* Nodes due only in a later turn of the wheel just pass
+         * through.
          */
-        if (!this)
+        if (this->due > current_time)
         {
-#ifdef DEBUG
-            if (!hb_list)
-                fatal("hb_list is NULL, but num_hb_objs is %ld\n", (long)num_hb_objs);
-#endif
-            this = hb_list;
+            file_hb(this);
+            continue;
         }
 
-        /* Check the time of the last heartbeat to see, if we
-         * processed all objects.
-         */
-        if (current_time < this->tlast + heart_beat_interval)
-            break;
-
-        this->tlast = current_time;
-
         obj = this->obj;
-        next_hb = this->next;
-
-        hb_num_done++;
 
 #ifdef DEBUG
         if (!(obj->flags & O_HEART_BEAT))
@@ -231,17 +395,16 @@ call_heart_beat (void)
 
             obj->flags &= ~O_HEART_BEAT;
             num_hb_objs--;
-            if (this->prev)
-                this->prev->next = this->next;
-            if (this->next)
-                this->next->prev = this->prev;
-            if (this == hb_list)
-                hb_list = this->next;
-
             xfree(this);
         }
         else
         {
+            this->due = next_hb_time(this->interval);
+            file_hb(this);
+
+            hb_num_done++;
+            hb_slot_done[slot]++;
+
             /* Prepare to call <ob>->heart_beat().
              */
             current_prog = obj->prog;
@@ -290,14 +453,12 @@ call_heart_beat (void)
             mark_end_evaluation();
 
         } /* if (object has heartbeat) */
-
-        /* Step to next object with heart beat */
-        this = next_hb;
     } /* while (not done) */
 
     rt_context = error_recovery_info.rt.last;
 
     /* Update stats */
+    hb_slot_usecs[slot] += hb_usecs() - start_usecs;
     avg_num_hb_objs += num_hb_to_do - (avg_num_hb_objs >> 10);
     avg_num_hb_done += hb_num_done  - (avg_num_hb_done >> 10);
 
@@ -305,14 +466,41 @@ call_heart_beat (void)
     current_prog = NULL;
 } /* call_heart_beat() */
 
+/*-------------------------------------------------------------------------*/
+static struct hb_info *
+find_hb (object_t *ob)
+
+/* Return the node of object <ob> which must have a heartbeat.
+ */
+
+{
+    struct hb_info *head, *this;
+    int i;
+
+    for (i = -1; i < HB_WHEEL_SIZE; i++)
+    {
+        head = i < 0 ? &hb_due : &hb_wheel[i];
+        for (this = head->next; this != head; this = this->next)
+            if (this->obj == ob)
+                return this;
+    }
+
+#ifdef DEBUG
+    fatal("Object '%s' not found in heart beat list.\n", get_txt(ob->name));
+#endif
+    return NULL;
+} /* find_hb() */
+
 /*-------------------------------------------------------------------------*/
 int
-set_heart_beat (object_t *ob, Bool to)
+set_heart_beat (object_t *ob, p_int interval)
 
-/* EFUN set_heart_beat() and internal use.
+/* EFUN configure_object(OC_HEART_BEAT) and internal use.
  *
- * Add (<to> != 0) or remove (<to> == 0) object <ob> to/from the list
- * of heartbeat objects, thus activating/deactivating its heart beat.
+ * Activate the heart beat of object <ob> with its heart_beat() being
+ * called every <interval> heart beat cycles (<interval> > 0), or
+ * deactivate it (<interval> == 0). An active heart beat is just set to
+ * the new interval, which then counts from now.
  * Return 0 on failure (including calls for destructed objects or if
  * the object is already in the desired state) and 1 on success.
  *
@@ -324,67 +512,50 @@ set_heart_beat (object_t *ob, Bool to)
     /* Safety checks */
     if (ob->flags & O_DESTRUCTED)
         return 0;
-    if (to)
-        to = O_HEART_BEAT; /* ...so that the following comparison works */
-    if (to == (ob->flags & O_HEART_BEAT))
+    if (interval < 0)
+        interval = 0;
+    if (!interval && !(ob->flags & O_HEART_BEAT))
         return 0;
 
-    if (to)  /* Add a new heartbeat */
+    if (!hb_wheel_time)
+        init_hb_lists();
+
+    if (interval && !(ob->flags & O_HEART_BEAT))  /* Add a new heartbeat */
     {
         struct hb_info *new;
 
         /* Get a new node */
         new = xalloc(sizeof(*new));
 
-        new->tlast = current_time;
+        new->interval = interval;
+        new->due = next_hb_time(interval);
         new->obj = ob;
-
-        /* Insert the new node at the proper place in the list */
-        if (!hb_list || !next_hb || !next_hb->prev)
-        {
-            new->next = hb_list;
-            new->prev = NULL;
-            if (hb_list)
-                hb_list->prev = new;
-            hb_list = new;
-	    
-	    /* Handle all the other objects first. */
-	    if(!next_hb)
-		next_hb = new->next;
-        }
-        else
-        {
-	    /* Insert it just before next_hb, so this is the last object. */
-            new->next = next_hb;
-            new->prev = next_hb->prev;
-            next_hb->prev->next = new;
-	    next_hb->prev = new;
-        }
+        file_hb(new);
 
         num_hb_objs++;
         ob->flags |= O_HEART_BEAT;
     }
-    else  /* remove an existing heartbeat */
+    else if (interval) /* change the interval */
     {
-        struct hb_info *this;
+        struct hb_info *this = find_hb(ob);
 
-        /* Remove the node from the list */
-        for (this = hb_list; this && this->obj != ob; this = this->next)
-            NOOP;
-#ifdef DEBUG
-        if (!this)
-            fatal("Object '%s' not found in heart beat list.\n", get_txt(ob->name));
-#endif
-        if (this->next)
-            this->next->prev = this->prev;
-        if (this->prev)
-            this->prev->next = this->next;
-        if (this == hb_list)
-            hb_list = this->next;
-        if (this == next_hb)
-            next_hb = this->next;
+        if (!this || this->interval == interval)
+            return 0;
 
-        xfree(this);
+        unlink_hb(this);
+        this->interval = interval;
+        this->due = next_hb_time(interval);
+        file_hb(this);
+    }
+    else  /* remove an existing heartbeat */
+    {
+        struct hb_info *this = find_hb(ob);
+
+        if (this)
+        {
+            unlink_hb(this);
+            xfree(this);
+        }
 
         num_hb_objs--;
         ob->flags &= ~O_HEART_BEAT;
@@ -394,6 +565,24 @@ set_heart_beat (object_t *ob, Bool to)
     return 1;
 } /* set_heart_beat() */
 
+/*-------------------------------------------------------------------------*/
+p_int
+query_heart_beat (object_t *ob)
+
+/* Return the heart beat interval of object <ob>, 0 if it has no
+ * heart beat.
+ */
+
+{
+    struct hb_info *this;
+
+    if (!(ob->flags & O_HEART_BEAT))
+        return 0;
+
+    this = find_hb(ob);
+    return this ? this->interval : 0;
+} /* query_heart_beat() */
+
 /*-------------------------------------------------------------------------*/
 #ifdef GC_SUPPORT
 
@@ -404,10 +593,18 @@ count_heart_beat_refs (void)
  */
 
 {
-    struct hb_info *this;
+    struct hb_info *head, *this;
+    int i;
 
-    for (this = hb_list; this != NULL; this = this->next)
-        note_malloced_block_ref(this);
+    if (!hb_wheel_time)
+        return;
+
+    for (i = -1; i < HB_WHEEL_SIZE; i++)
+    {
+        head = i < 0 ? &hb_due : &hb_wheel[i];
+        for (this = head->next; this != head; this = this->next)
+            note_malloced_block_ref(this);
+    }
 }
 #endif
 
@@ -430,11 +627,11 @@ heart_beat_status (strbuf_t * sbuf, Bool verbose)
 #if defined(__MWERKS__) && !defined(WARN_ALL)
 #    pragma warn_largeargs off
 #endif
-        strbuf_addf(sbuf, "HB calls completed in last cycle:  %ld (%.2f%%)\n"
+        strbuf_addf(sbuf, "HB calls completed in last cycle:  %ld\n"
                    , (long)hb_num_done
-                   , num_hb_objs && hb_num_done <= num_hb_objs
-                     ? 100.0 * (float)hb_num_done / (float)num_hb_objs
-                     : 100.0
+                   );
+        strbuf_addf(sbuf, "HB calls still due:                %ld\n"
+                   , (long)hb_num_due
                    );
         strbuf_addf(sbuf
                    , "Average of HB calls completed:     %.2f%%\n"
@@ -446,7 +643,7 @@ heart_beat_status (strbuf_t * sbuf, Bool verbose)
 #    pragma warn_largeargs reset
 #endif
     }
-    return num_hb_objs * sizeof(struct hb_info);
+    return num_hb_objs * sizeof(struct hb_info) + sizeof(hb_wheel);
 } /* heart_beat_status() */
 
 /*-------------------------------------------------------------------------*/
@@ -476,8 +673,32 @@ hbeat_driver_info (svalue_t *svp, int value)
             put_number(svp, num_hb_objs);
             break;
 
+        case DI_HEARTBEAT_WHEEL_OBJECTS:
+            /* FALLTHROUGH */
+        case DI_HEARTBEAT_WHEEL_LAST_PROCESSED:
+            /* FALLTHROUGH */
+        case DI_HEARTBEAT_WHEEL_LAST_TIME:
+        {
+            vector_t *vec;
+            mp_int *stat;
+            int i;
+
+            memsafe(vec = allocate_array(HB_WHEEL_SIZE), sizeof(*vec), "result array");
+
+            stat = value == DI_HEARTBEAT_WHEEL_OBJECTS
+                   ? hb_slot_objs
+                   : value == DI_HEARTBEAT_WHEEL_LAST_PROCESSED
+                     ? hb_slot_done
+                     : hb_slot_usecs;
+            for (i = 0; i < HB_WHEEL_SIZE; i++)
+                put_number(vec->item + i, stat[i]);
+
+            put_array(svp, vec);
+            break;
+        }
+
         case DI_SIZE_HEARTBEATS:
-            put_number(svp, num_hb_objs * sizeof(struct hb_info));
+            put_number(svp, num_hb_objs * sizeof(struct hb_info) + sizeof(hb_wheel));
             break;
 
         case DI_LOAD_AVERAGE_PROCESSED_HEARTBEATS_RELATIVE:
@@ -515,21 +736,26 @@ f_heart_beat_info (svalue_t *sp)
  */
 
 {
-    int i;
+    int i, slot;
     vector_t *vec;
     svalue_t *v;
-    struct hb_info *this;
+    struct hb_info *head, *this;
 
     vec = allocate_array(i = num_hb_objs);
-    for (v = vec->item, this = hb_list; i >= 0 && this; this = this->next)
+    v = vec->item;
+    for (slot = -1; i > 0 && slot < HB_WHEEL_SIZE; slot++)
     {
+        head = slot < 0 ? &hb_due : &hb_wheel[slot];
+        for (this = head->next; i > 0 && this != head; this = this->next)
+        {
 #ifdef DEBUG
-        if (this->obj->flags & O_DESTRUCTED)  /* TODO: Can't happen. */
-            continue;
+            if (this->obj->flags & O_DESTRUCTED)  /* TODO: Can't happen. */
+                continue;
 #endif
-        put_ref_object(v, this->obj, "heart_beat_info");
-        v++;
-        i--;
+            put_ref_object(v, this->obj, "heart_beat_info");
+            v++;
+            i--;
+        }
     }
 
     push_array(sp, vec);
@@ -17,7 +17,8 @@ extern mp_int num_hb_objs;
 /* --- Prototypes --- */
 
 extern void  call_heart_beat(void);
-extern int   set_heart_beat (object_t *ob, Bool to);
+extern int   set_heart_beat (object_t *ob, p_int interval);
+extern p_int query_heart_beat (object_t *ob);
 extern int   heart_beat_status (strbuf_t *sbuf, Bool verbose);
 extern void  hbeat_driver_info (svalue_t *svp, int value) __attribute__((nonnull(1)));
 extern svalue_t *f_heart_beat_info (svalue_t *sp);
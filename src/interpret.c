@@ -689,6 +689,15 @@ static int opcount[MAXOPC];
    * opcode) is used as index.
    */
 
+static int opcpair[256][256];
+static int opcpair_last = 0;
+  /* Counter array for instruction pair profiling: opcpair[a][b] counts
+   * how often opcode <b> was executed directly after opcode <a>.
+   * Here the single-byte opcodes as fetched by eval_instruction() are
+   * used, as these are the candidates for superinstructions.
+   * <opcpair_last> is the opcode executed last.
+   */
+
 #endif
 
 #ifdef DEBUG
@@ -730,6 +739,74 @@ struct timeval profiling_timevalue = {0, 0};
 
 static Bool received_prof_signal = MY_FALSE;
 
+#define PROFILE_TABLE_SIZE 4096
+  /* Number of hash chains for the profile samples, must be a power of 2.
+   */
+
+#define PROFILE_MAX_STACKS 65536
+  /* Maximum number of distinct stacks recorded by the profiler, further
+   * stacks are counted under PROFILE_TRUNCATED.
+   */
+
+#define PROFILE_DRIVER     "[driver]"
+#define PROFILE_TRUNCATED  "[truncated]"
+  /* The pseudo stacks for samples outside of LPC code resp.
+   * beyond PROFILE_MAX_STACKS.
+   */
+
+struct profile_sample_s
+{
+    struct profile_sample_s * next;   /* Next sample in the hash chain */
+    string_t                * stack;  /* The collapsed stack (tabled) */
+    p_int                     count;  /* Number of samples */
+};
+
+static struct profile_sample_s * profile_table[PROFILE_TABLE_SIZE];
+  /* The hash table of the recorded stacks. As the stack strings are
+   * tabled, they are hashed and compared by their address.
+   */
+
+static long profile_sampling_rate = 0;
+  /* Samples per second of CPU time taken by the sampling profiler,
+   * 0 if the profiler is off.
+   */
+
+static p_int num_profile_samples = 0;
+static p_int num_profile_stacks = 0;
+  /* Number of samples taken and of distinct stacks recorded.
+   */
+
+static volatile Bool received_sample_signal = MY_FALSE;
+  /* Set by the SIGVTALRM handler when the next sample is due.
+   */
+
+#define FUNCTION_PROFILE_TABLE_SIZE 4096
+  /* Number of hash chains for the function profiles, must be a power of 2.
+   */
+
+struct function_profile_s
+{
+    struct function_profile_s * next;  /* Next profile in the hash chain */
+    int32       prog_id;        /* The id_number of the program */
+    int         fun_ix;         /* The index of the function header */
+    string_t  * prog_name;      /* The name of the program (counted) */
+    string_t  * fun_name;       /* The name of the function (counted) */
+    p_int       calls;          /* Number of calls */
+    p_int       cost;           /* Eval cost including the callees */
+    p_int       excl_cost;      /* Eval cost excluding the callees */
+    p_int       usecs;          /* Time including the callees */
+    p_int       excl_usecs;     /* Time excluding the callees */
+};
+
+static struct function_profile_s * function_profile_table[FUNCTION_PROFILE_TABLE_SIZE];
+  /* The table of the function profiles, hashed by program id and
+   * function index.
+   */
+
+static Bool function_profiling = MY_FALSE;
+  /* True if calls, eval cost and time of each function are counted.
+   */
+
 p_int used_memory_at_eval_start = 0;
   /* used memory (in bytes) at the beginning of the current execution,
    * set by mark_start_evaluation() (and v_limited()).
@@ -746,6 +823,11 @@ enum { APPLY_NOT_FOUND = 0, APPLY_FOUND, APPLY_DEFAULT_FOUND };
 static int int_apply(string_t *, object_t *, int, Bool, Bool);
 static int expand_argument(svalue_t *sp);
 static void call_simul_efun(unsigned int code, object_t *ob, int num_arg);
+static void record_profile_sample(Bool in_lpc);
+static void start_function_profile(bytecode_p funstart);
+static void finish_function_profile(struct control_stack *p);
+static void unwind_function_profiles(struct control_stack *target);
+static vector_t *get_function_profiles(void);
 #ifdef DEBUG
 static void check_extra_ref_in_vector(svalue_t *svp, size_t num);
 #endif
@@ -808,6 +890,17 @@ handle_profiling_signal(int ignored)
     received_prof_signal = MY_TRUE;
 } // handle_prof()
 
+/*-------------------------------------------------------------------------*/
+void
+handle_sample_signal(int ignored)
+/* signal handler for the SIGVTALRM signal of the sampling profiler. Just
+ * sets a flag which is checked in eval_instruction() at the end of each
+ * instruction.
+ */
+{
+    received_sample_signal = MY_TRUE;
+} // handle_sample_signal()
+
 /*-------------------------------------------------------------------------*/
 void
 mark_start_evaluation (void)
@@ -822,6 +915,10 @@ mark_start_evaluation (void)
     total_evalcost = 0;
     eval_number++;
 
+    // a sample due since the last evaluation was spent in the driver
+    if (received_sample_signal)
+        record_profile_sample(MY_FALSE);
+
     // start the profiling timer if enabled
     if (profiling_timevalue.tv_usec || profiling_timevalue.tv_sec)
     {
@@ -5836,6 +5933,8 @@ check_function_args(int fx, program_t *progp, bytecode_p funstart)
                     csp++;
 
                     // This one we saved, but also pull back into reality.
+                    // The saved copy keeps the function profile.
+                    csp->profile = NULL;
                     pop_control_stack();
 
                     // warnf will return (errors are caught).
@@ -6393,6 +6492,7 @@ pull_error_context (svalue_t *sp, svalue_t *msg)
     }
 
     /* Restore the global variables and the evaluator stack */
+    unwind_function_profiles(p->save_csp);
     csp = p->save_csp;
     pop_n_elems(sp - p->save_sp);
     command_giver = p->save_command_giver;
@@ -6465,6 +6565,7 @@ push_control_stack ( svalue_t   *sp
     csp->variable_index_offset = variable_index_offset;
     csp->current_variables = current_variables;
     csp->break_sp = break_sp;
+    csp->profile = NULL;
 #ifdef EVAL_COST_TRACE
     csp->eval_cost = eval_cost;
 #endif
@@ -6499,6 +6600,8 @@ pop_control_stack (void)
     variable_index_offset = csp->variable_index_offset;
     current_variables     = csp->current_variables;
     break_sp = csp->break_sp;
+    if (csp->profile)
+        finish_function_profile(csp);
     csp--;
 } /* pop_control_stack() */
 
@@ -6879,7 +6982,10 @@ setup_new_frame2 (bytecode_p funstart, svalue_t *sp
      * the first available svalue.
      */
     break_sp = sp+1;
-    
+
+    if (function_profiling && !is_lambda)
+        start_function_profile(funstart);
+
     return sp;
 } /* setup_new_frame2() */
 
@@ -7013,6 +7119,7 @@ reset_machine (Bool first)
         if (current_lambda.type == T_CLOSURE)
             free_closure(&current_lambda);
         put_number(&current_lambda, 0);
+        unwind_function_profiles(CONTROL_STACK - 1);
         while (csp >= CONTROL_STACK)
         {
             if (csp->lambda.type == T_CLOSURE)
@@ -7329,15 +7436,65 @@ eval_instruction (bytecode_p first_instruction
       /* Test the type of a certain argument.
        */
 
-#   ifdef MARK
+#   if defined(USE_COMPUTED_GOTO) && defined(MARK)
+#        define CASE(x) case (x): L_##x: MARK(x);
+#   elif defined(USE_COMPUTED_GOTO)
+#        define CASE(x) case (x): L_##x:
+#   elif defined(MARK)
 #        define CASE(x) case (x): MARK(x);
 #   else
 #        define CASE(x) case (x):
 #   endif
       /* Macro to build the case: labels for the evaluator switch.
+       * With USE_COMPUTED_GOTO, every case also gets a label L_<x> for
+       * the dispatch table.
        * 'MARK' adds profiling support.
        */
 
+#   if defined(USE_COMPUTED_GOTO) && !defined(DEBUG) \
+    && !defined(TRACE_CODE) && !defined(OPCPROF)
+#       define DIRECT_DISPATCH
+#   endif
+
+#   ifdef DIRECT_DISPATCH
+#       define NEXT_INSTRUCTION \
+        do { \
+            if ((sp - VALUE_STACK) >= SIZEOF_STACK - 1 \
+             || received_prof_signal || received_sample_signal \
+             || max_memory || trace_exec_active \
+             || add_eval_cost(1)) \
+                goto end_instruction; \
+            runtime_no_warn_deprecated = MY_FALSE; \
+            runtime_array_range_check = MY_FALSE; \
+            instruction = LOAD_CODE(pc); \
+            inter_sp = sp; \
+            inter_pc = pc; \
+            goto *dispatch_table[instruction]; \
+        } while(0)
+#   else
+#       define NEXT_INSTRUCTION break
+#   endif
+      /* End of an instruction: jump directly to the next one.
+       * This is the part of the work between two instructions in the
+       * evaluation loop below that is needed in the normal case, and
+       * each instruction has its own indirect jump for the processor
+       * to predict. Anything unusual (stack near its end, a pending
+       * signal, a memory limit, tracing or the end of the eval cost)
+       * goes to the end of the switch() instead.
+       * Builds with DEBUG, TRACE_CODE or OPCPROF do more work for each
+       * instruction, and always take the way through the loop.
+       */
+
+#   ifdef USE_COMPUTED_GOTO
+#       define DISPATCH_LABEL(x) &&L_##x
+    static void * const dispatch_table[256]
+      = { INSTR_DISPATCH_TABLE(DISPATCH_LABEL, &&L_default) };
+#       undef DISPATCH_LABEL
+      /* The address of the implementation of every single-byte
+       * instruction, indexed by the instruction code.
+       */
+#   endif
+
     /* Setup the variables.
      * The next F_RETURN at this level will return out of eval_instruction().
      */
@@ -7411,6 +7568,8 @@ again:
 
 #   ifdef OPCPROF
         opcount[full_instr]++;
+        opcpair[opcpair_last][instruction]++;
+        opcpair_last = instruction;
 #   endif
 
     /* If requested, trace the instruction.
@@ -7502,7 +7661,11 @@ again:
     /* The monster switch to execute the instruction.
      * The order of the cases is held (mostly) in the order
      * the instructions appear in func_spec.
+     *
+     * Superinstructions which can't handle their operands themselves
+     * jump back here to execute their last instruction.
      */
+dispatch:
     inter_sp = sp;
     inter_pc = pc;
       /* TODO: This continual update is crude, but circumvents a lot
@@ -7511,9 +7674,21 @@ again:
        * TODO:: the long run, we should do this only for efuns (which are by
        * TODO:: then hopefully all tabled).
        */
+#ifdef USE_COMPUTED_GOTO
+    /* Jump directly to the implementation, saving the range check
+     * of the switch(). The switch() is still used for its case labels and
+     * so that 'break' leads to the end of the instruction.
+     */
+    goto *dispatch_table[instruction];
+#endif
     switch(instruction)
     {
     default:
+#ifdef USE_COMPUTED_GOTO
+    L_default:
+    L_F_LAND_EQ: /* Only used by the compiler */
+    L_F_LOR_EQ:  /* Only used by the compiler */
+#endif
         fatal("Undefined instruction '%s' (%d)\n", get_f_name(instruction),
               instruction);
         /* NOTREACHED */
@@ -7592,7 +7767,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EFUN1);                  /* --- efun1 <code>        --- */
@@ -7642,7 +7817,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EFUN2);                  /* --- efun2 <code>        --- */
@@ -7692,7 +7867,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EFUN3);                  /* --- efun3 <code>        --- */
@@ -7743,7 +7918,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EFUN4);                  /* --- efun4 <code>        --- */
@@ -7793,7 +7968,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EFUNV);                  /* --- efunv <code>        --- */
@@ -7841,7 +8016,7 @@ again:
 #ifdef CHECK_OBJECT_REF
         check_all_object_shadows();
 #endif /* CHECK_OBJECT_REF */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     /* --- Predefined functions with counterparts in LPC --- */
@@ -7855,7 +8030,7 @@ again:
          */
         sp++;
         assign_rvalue_no_free(sp, find_value((int)(LOAD_UINT8(pc))) );
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_STRING);                /* --- string <ix>          --- */
     {
@@ -7867,7 +8042,7 @@ again:
 
         LOAD_SHORT(string_number, pc);
         push_ref_string(sp, current_strings[string_number]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CSTRING3);               /* --- cstring3 <ix>       --- */
@@ -7877,7 +8052,7 @@ again:
          */
         unsigned int ix = LOAD_UINT8(pc);
         push_ref_string(sp, current_strings[ix+0x300]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CSTRING2);               /* --- cstring2 <ix>       --- */
@@ -7887,7 +8062,7 @@ again:
          */
         unsigned int ix = LOAD_UINT8(pc);
         push_ref_string(sp, current_strings[ix+0x200]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CSTRING1);               /* --- cstring1 <ix>       --- */
@@ -7897,7 +8072,7 @@ again:
          */
         unsigned int ix = LOAD_UINT8(pc);
         push_ref_string(sp, current_strings[ix+0x100]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CSTRING0);               /* --- cstring0 <ix>       --- */
@@ -7907,7 +8082,7 @@ again:
          */
         unsigned int ix = LOAD_UINT8(pc);
         push_ref_string(sp, current_strings[ix]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_NUMBER);                 /* --- number <num>        --- */
@@ -7922,26 +8097,26 @@ again:
         sp->type = T_NUMBER;
         memcpy(&sp->u.number, pc, sizeof sp->u.number);
         pc += sizeof sp->u.number;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CONST0);                 /* --- const0              --- */
         /* Push the number 0 onto the stack.
          */
         push_number(sp, 0);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_CONST1);                 /* --- const1              --- */
         /* Push the number 1 onto the stack.
          */
         push_number(sp, 1);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NCONST1);                /* --- nconst1             --- */
         /* Push the number -1 onto the stack.
          */
         push_number(sp, -1);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_CLIT);                   /* --- clit <num>          --- */
     {
@@ -7949,7 +8124,7 @@ again:
          * <num> is a 8-Bit uint.
          */
         push_number(sp, (p_int)LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_NCLIT);                  /* --- nclit <num>         --- */
@@ -7958,7 +8133,7 @@ again:
          * <num> is a 8-Bit uint.
          */
         push_number(sp, -(p_int)LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FCONST0);                /* --- fconst0             --- */
@@ -7971,7 +8146,7 @@ again:
         sp++;
         sp->type = T_FLOAT;
         STORE_DOUBLE(sp, 0.0);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FLOAT);                  /* --- float <mant> <exp>  --- */
@@ -7994,7 +8169,7 @@ again:
         sp->u.mantissa = mantissa;
         sp->x.exponent = exponent;
 #endif // FLOAT_FORMAT_2
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CLOSURE);            /* --- closure <ix> <inhIndex> --- */
@@ -8139,7 +8314,7 @@ again:
                             : ix);
             }
         }
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_SYMBOL);                 /* --- symbol <ix> <num>   --- */
@@ -8157,7 +8332,7 @@ again:
         sp->type = T_SYMBOL;
         sp->x.quotes = LOAD_UINT8(pc);
         sp->u.str = ref_mstring(current_strings[string_number]);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_DEFAULT_RETURN);         /* --- default_return      --- */
@@ -8273,6 +8448,9 @@ again:
 
         tracedepth--; /* We leave this level */
 
+        if (csp->profile)
+            finish_function_profile(csp);
+
         if (csp->extern_call)
         {
             /* eval_instruction() must be left - setup the globals */
@@ -8305,7 +8483,7 @@ again:
         pc = csp->pc;
         fp = csp->fp;
         csp--;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_BREAK);                  /* --- break               --- */
@@ -8316,7 +8494,7 @@ again:
 
         pc = break_sp->u.break_addr;
         break_sp++;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_SWITCH);            /* --- switch <lots of data...> --- */
@@ -8909,7 +9087,7 @@ again:
 
         /* o1 is now the offset to jump to. */
         pc += o1;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_SSCANF);                 /* --- sscanf <numarg>     --- */
@@ -8939,7 +9117,7 @@ again:
         pop_n_elems(num_arg-1);
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
 #ifdef USE_PARSE_COMMAND
@@ -8988,7 +9166,7 @@ again:
                            , &arg[3], num_arg-3);
         pop_n_elems(num_arg);        /* Get rid of all arguments */
         push_number(sp, i ? 1 : 0);      /* Push the result value */
-        break;
+        NEXT_INSTRUCTION;
     }
 #endif /* USE_PARSE_COMMAND */
 
@@ -8999,7 +9177,7 @@ again:
          */
         sp++;
         assign_rvalue_no_free(sp, fp + LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_CATCH);       /* --- catch <flags> <offset> <guarded code> --- */
     {
@@ -9102,7 +9280,7 @@ again:
 #ifdef DEBUG
         expected_stack = NULL;
 #endif
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_INC);                    /* --- inc                 --- */
@@ -9117,7 +9295,7 @@ again:
         inter_sp = sp;
         add_number_to_lvalue("++", sp, 1, NULL, NULL);
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_DEC);                    /* --- dec                 --- */
@@ -9133,7 +9311,7 @@ again:
         inter_sp = sp;
         add_number_to_lvalue("--", sp, -1, NULL, NULL);
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_POST_INC);               /* --- post_inc            --- */
@@ -9153,7 +9331,7 @@ again:
         add_number_to_lvalue("++", sp, 1, &result, NULL);
         free_svalue(sp);
         transfer_svalue_no_free(sp, &result);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_POST_DEC);               /* --- post_dec            --- */
@@ -9173,7 +9351,7 @@ again:
         add_number_to_lvalue("--", sp, -1, &result, NULL);
         free_svalue(sp);
         transfer_svalue_no_free(sp, &result);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_PRE_INC);                /* --- pre_inc             --- */
@@ -9193,7 +9371,7 @@ again:
         add_number_to_lvalue("++", sp, 1, NULL, &result);
         free_svalue(sp);
         transfer_svalue_no_free(sp, &result);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_PRE_DEC);                /* --- pre_dec             --- */
@@ -9213,7 +9391,7 @@ again:
         add_number_to_lvalue("--", sp, -1, NULL, &result);
         free_svalue(sp);
         transfer_svalue_no_free(sp, &result);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LAND);                   /* --- land <offset>       --- */
@@ -9229,7 +9407,7 @@ again:
             {
                 uint offset = LOAD_UINT8(pc);
                 pc += offset;
-                break;
+                NEXT_INSTRUCTION;
             }
             /* No need to explicitely free_svalue(), it's just a number */
         }
@@ -9239,7 +9417,7 @@ again:
         }
         sp--;
         pc++;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LOR);                    /* --- lor <offset>        --- */
@@ -9254,7 +9432,7 @@ again:
         else
             pc += GET_UINT8(pc);
         pc++;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_ASSIGN);                 /* --- assign              --- */
@@ -9276,7 +9454,7 @@ again:
 #endif
         assign_svalue(sp, sp-1);
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_VOID_ASSIGN);            /* --- void_assign         --- */
@@ -9298,7 +9476,7 @@ again:
         transfer_svalue(sp, sp-1);
         pop_stack();
         sp--;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_ADD);                    /* --- add                 --- */
@@ -9563,7 +9741,7 @@ again:
             /* NOTREACHED */
         }
 
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_SUBTRACT);               /* --- subtract            --- */
     {
@@ -9595,13 +9773,13 @@ again:
                     ERRORF(("Numeric overflow: %"PRIdPINT" - %"PRIdPINT"\n"
                            , left, right));
                     /* NOTREACHED */
-                    break;
+                    NEXT_INSTRUCTION;
                 }
 
                 i = left - right;
                 sp--;
                 sp->u.number = i;
-                break;
+                NEXT_INSTRUCTION;
             }
             if (sp->type == T_FLOAT)
             {
@@ -9615,7 +9793,7 @@ again:
                 sp--;
                 STORE_DOUBLE(sp, diff);
                 sp->type = T_FLOAT;
-                break;
+                NEXT_INSTRUCTION;
             }
             OP_ARG_ERROR(2, TF_FLOAT|TF_NUMBER, sp->type);
             /* NOTREACHED */
@@ -9633,7 +9811,7 @@ again:
                            , READ_DOUBLE(sp-1), READ_DOUBLE(sp)));
                 sp--;
                 STORE_DOUBLE(sp, diff);
-                break;
+                NEXT_INSTRUCTION;
             }
             if (sp->type == T_NUMBER)
             {
@@ -9643,7 +9821,7 @@ again:
                            , READ_DOUBLE(sp-1), sp->u.number));
                 sp--;
                 STORE_DOUBLE(sp, diff);
-                break;
+                NEXT_INSTRUCTION;
             }
             OP_ARG_ERROR(2, TF_FLOAT|TF_NUMBER, sp->type);
             /* NOTREACHED */
@@ -9662,7 +9840,7 @@ again:
             sp--;
             /* subtract_array already takes care of destructed objects */
             sp->u.vec = subtract_array(sp->u.vec, v);
-            break;
+            NEXT_INSTRUCTION;
         }
         else if ((sp-1)->type == T_MAPPING)
         {
@@ -9674,7 +9852,7 @@ again:
             sp--;
             free_mapping(sp->u.map);
             sp->u.map = m;
-            break;
+            NEXT_INSTRUCTION;
         }
         else if ((sp-1)->type == T_STRING)
         {
@@ -9687,7 +9865,7 @@ again:
             sp--;
             free_string_svalue(sp);
             put_string(sp, result);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         OP_ARG_ERROR(1, TF_POINTER|TF_MAPPING|TF_STRING|TF_FLOAT|TF_NUMBER
@@ -9978,7 +10156,7 @@ again:
                           , sp[-1].type);
             /* NOTREACHED */
         }
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_DIVIDE);                 /* --- divide              --- */
@@ -10008,7 +10186,7 @@ again:
                 i = (sp-1)->u.number / sp->u.number;
                 sp--;
                 sp->u.number = i;
-                break;
+                NEXT_INSTRUCTION;
             }
             if (sp->type == T_FLOAT)
             {
@@ -10025,7 +10203,7 @@ again:
                            , (sp)->u.number, READ_DOUBLE(sp+1)));
                 STORE_DOUBLE(sp, dtmp);
                 sp->type = T_FLOAT;
-                break;
+                NEXT_INSTRUCTION;
             }
             OP_ARG_ERROR(2, TF_FLOAT|TF_NUMBER, sp->type);
             /* NOTREACHED */
@@ -10048,7 +10226,7 @@ again:
                     ERRORF(("Numeric overflow: %g / %g\n"
                            , READ_DOUBLE(sp), READ_DOUBLE(sp+1)));
                 STORE_DOUBLE(sp, dtmp);
-                break;
+                NEXT_INSTRUCTION;
             }
             if (sp->type == T_NUMBER)
             {
@@ -10063,14 +10241,14 @@ again:
                     ERRORF(("Numeric overflow: %g / %"PRIdPINT"\n"
                            , READ_DOUBLE(sp), (sp+1)->u.number));
                 STORE_DOUBLE(sp, dtmp);
-                break;
+                NEXT_INSTRUCTION;
             }
             OP_ARG_ERROR(2, TF_FLOAT|TF_NUMBER, sp->type);
             /* NOTREACHED */
         }
         OP_ARG_ERROR(1, TF_FLOAT|TF_NUMBER, sp[-1].type);
         /* NOTREACHED */
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MOD);                    /* --- mod                 --- */
@@ -10091,13 +10269,13 @@ again:
         if (sp->u.number == 0)
         {
             ERROR("Modulus by zero.\n");
-            break;
+            NEXT_INSTRUCTION;
         }
         else
             i = (sp-1)->u.number % sp->u.number;
         sp--;
         sp->u.number = i;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_GT);                     /* --- gt                  --- */
@@ -10118,7 +10296,7 @@ again:
             sp--;
             free_string_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_NUMBER)
@@ -10126,7 +10304,7 @@ again:
             i = (sp-1)->u.number > sp->u.number;
             sp--;
             sp->u.number = i;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_FLOAT)
@@ -10134,7 +10312,7 @@ again:
             i = READ_DOUBLE( sp-1 ) > READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_FLOAT)
@@ -10142,7 +10320,7 @@ again:
             i = (double)((sp-1)->u.number) > READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_NUMBER)
@@ -10150,7 +10328,7 @@ again:
             i = READ_DOUBLE( sp-1 ) > (double)(sp->u.number);
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         TYPE_TEST_EXP_LEFT((sp-1), TF_NUMBER|TF_STRING|TF_FLOAT);
@@ -10178,7 +10356,7 @@ again:
             sp--;
             free_string_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_NUMBER)
@@ -10186,7 +10364,7 @@ again:
             i = (sp-1)->u.number >= sp->u.number;
             sp--;
             sp->u.number = i;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_FLOAT)
@@ -10194,7 +10372,7 @@ again:
             i = READ_DOUBLE( sp-1 ) >= READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_FLOAT)
@@ -10202,7 +10380,7 @@ again:
             i = (double)((sp-1)->u.number) >= READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_NUMBER)
@@ -10210,7 +10388,7 @@ again:
             i = READ_DOUBLE( sp-1 ) >= (double)(sp->u.number);
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         TYPE_TEST_EXP_LEFT((sp-1), TF_NUMBER|TF_STRING|TF_FLOAT);
@@ -10238,7 +10416,7 @@ again:
             sp--;
             free_string_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_NUMBER)
@@ -10246,7 +10424,7 @@ again:
             i = (sp-1)->u.number < sp->u.number;
             sp--;
             sp->u.number = i;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_FLOAT)
@@ -10254,7 +10432,7 @@ again:
             i = READ_DOUBLE( sp-1 ) < READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_FLOAT)
@@ -10262,7 +10440,7 @@ again:
             i = (double)((sp-1)->u.number) < READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_NUMBER)
@@ -10270,7 +10448,7 @@ again:
             i = READ_DOUBLE( sp-1 ) < (double)(sp->u.number);
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         TYPE_TEST_EXP_LEFT((sp-1), TF_NUMBER|TF_STRING|TF_FLOAT);
@@ -10298,7 +10476,7 @@ again:
             sp--;
             free_string_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_NUMBER)
@@ -10306,7 +10484,7 @@ again:
             i = (sp-1)->u.number <= sp->u.number;
             sp--;
             sp->u.number = i;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_FLOAT)
@@ -10314,7 +10492,7 @@ again:
             i = READ_DOUBLE( sp-1 ) <= READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_NUMBER && sp->type == T_FLOAT)
@@ -10322,7 +10500,7 @@ again:
             i = (double)((sp-1)->u.number) <= READ_DOUBLE( sp );
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if ((sp-1)->type == T_FLOAT && sp->type == T_NUMBER)
@@ -10330,7 +10508,7 @@ again:
             i = READ_DOUBLE( sp-1 ) <= (double)(sp->u.number);
             sp--;
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         TYPE_TEST_EXP_LEFT((sp-1), TF_NUMBER|TF_STRING|TF_FLOAT);
@@ -10418,7 +10596,7 @@ again:
         pop_stack();
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_NE);                     /* --- ne                  --- */
@@ -10493,7 +10671,7 @@ again:
         pop_stack();
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_COMPL);                  /* --- compl               --- */
@@ -10502,7 +10680,7 @@ again:
          */
         TYPE_TEST1(sp, T_NUMBER);
         sp->u.number = ~ sp->u.number;
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AND);                    /* --- and                 --- */
     {
@@ -10524,7 +10702,7 @@ again:
             inter_sp = sp - 2;
             (sp-1)->u.vec = intersect_array((sp-1)->u.vec, sp->u.vec);
             sp--;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp[-1].type == T_POINTER
@@ -10533,7 +10711,7 @@ again:
             inter_sp = sp - 2;
             (sp-1)->u.vec = map_intersect_array(sp[-1].u.vec, sp->u.map);
             sp--;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_STRING && (sp-1)->type == T_STRING)
@@ -10546,7 +10724,7 @@ again:
             free_string_svalue(sp);
             put_string(sp-1, result);
             sp--;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_NUMBER && (sp-1)->type == T_NUMBER)
@@ -10554,7 +10732,7 @@ again:
             p_int i = (sp-1)->u.number & sp->u.number;
             sp--;
             sp->u.number = i;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp[-1].type == T_MAPPING
@@ -10563,7 +10741,7 @@ again:
             inter_sp = sp - 2;
             (sp-1)->u.map = map_intersect(sp[-1].u.map, sp);
             sp--;
-            break;
+            NEXT_INSTRUCTION;
         }
 
         TYPE_TEST_EXP_LEFT((sp-1), TF_NUMBER|TF_STRING|TF_POINTER|TF_MAPPING);
@@ -10603,7 +10781,7 @@ again:
             sp->u.vec = join_array(sp->u.vec, (sp+1)->u.vec);
         }
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_XOR);                    /* --- xor                 --- */
@@ -10633,7 +10811,7 @@ again:
             sp->u.vec = symmetric_diff_array(sp->u.vec, (sp+1)->u.vec);
         }
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LSH);                    /* --- lsh                 --- */
@@ -10654,7 +10832,7 @@ again:
         p_uint shift = sp->u.number;
         sp--;
         sp->u.number = shift > MAX_SHIFT ? 0 : sp->u.number << shift;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_RSH);                    /* --- rsh                 --- */
@@ -10679,7 +10857,7 @@ again:
             sp->u.number = 0;
         else
             sp->u.number = -1;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_RSHL);                   /* --- rshl                --- */
@@ -10702,7 +10880,7 @@ again:
             sp->u.number = 0;
         else
             sp->u.number = (p_uint)sp->u.number >> shift;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_NOT);                    /* --- not                 --- */
@@ -10715,12 +10893,12 @@ again:
             if (sp->u.number == 0)
             {
                 sp->u.number = 1;
-                break;
+                NEXT_INSTRUCTION;
             }
         } else
             free_svalue(sp);
         put_number(sp, 0);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NX_RANGE);               /* --- nx_range            --- */
         /* Push '1' onto the stack to make up for the missing
@@ -10732,7 +10910,7 @@ again:
         /* FALLTHROUGH */
     CASE(F_NR_RANGE);               /* --- nr_range            --- */
         sp = push_range_value(NR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RX_RANGE);               /* --- rx_range            --- */
         sp++;
@@ -10740,7 +10918,7 @@ again:
         /* FALLTHROUGH */
     CASE(F_RR_RANGE);               /* --- rr_range            --- */
         sp = push_range_value(RR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AX_RANGE);               /* --- ax_range            --- */
         sp++;
@@ -10748,31 +10926,31 @@ again:
         /* FALLTHROUGH */
     CASE(F_AR_RANGE);               /* --- ar_range            --- */
         sp = push_range_value(AR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RANGE);                  /* --- range               --- */
         sp = push_range_value(NN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RN_RANGE);               /* --- rn_range            --- */
         sp = push_range_value(RN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NA_RANGE);               /* --- na_range            --- */
         sp = push_range_value(NA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AN_RANGE);               /* --- an_range            --- */
         sp = push_range_value(AN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RA_RANGE);               /* --- ra_range            --- */
         sp = push_range_value(RA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AA_RANGE);               /* --- aa_range            --- */
         sp = push_range_value(AA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_ADD_EQ);                 /* --- add_eq              --- */
     CASE(F_VOID_ADD_EQ);            /* --- void_add_eq         --- */
@@ -10860,7 +11038,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch(argp->type)
@@ -11080,7 +11258,7 @@ again:
             sp++;
             assign_svalue_no_free(sp, argp);
         }
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_SUB_EQ);                 /* --- sub_eq              --- */
@@ -11161,7 +11339,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -11314,7 +11492,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MULT_EQ);                /* --- mult_eq             --- */
@@ -11416,7 +11594,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -11623,7 +11801,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_DIV_EQ);                 /* --- div_eq              --- */
@@ -11684,7 +11862,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -11767,7 +11945,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MOD_EQ);                 /* --- mod_eq              --- */
@@ -11828,7 +12006,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -11854,7 +12032,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_AND_EQ);                 /* --- and_eq              --- */
@@ -11914,7 +12092,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12015,7 +12193,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_OR_EQ);                  /* --- or_eq               --- */
@@ -12071,7 +12249,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12118,7 +12296,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_XOR_EQ);                 /* --- xor_eq              --- */
@@ -12176,7 +12354,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12221,7 +12399,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LSH_EQ);                 /* --- lsh_eq              --- */
@@ -12284,7 +12462,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12308,7 +12486,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_RSH_EQ);                 /* --- rsh_eq              --- */
@@ -12369,7 +12547,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12393,7 +12571,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_RSHL_EQ);               /* --- rshl_eq              --- */
@@ -12454,7 +12632,7 @@ again:
         }
 
         if(argp == NULL) /* Already handled. */
-            break;
+            NEXT_INSTRUCTION;
 
         /* Now do it */
         switch (argp->type)
@@ -12481,7 +12659,7 @@ again:
 
         pop_n_elems(2);
         assign_svalue_no_free(++sp, argp);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     /* --- Machine internal instructions --- */
@@ -12491,7 +12669,7 @@ again:
          * Simple, huh?
          */
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_POP_SECOND);             /* --- pop_second          --- */
         /* Pop the value under the topmost value and put the
@@ -12499,14 +12677,14 @@ again:
          */
         free_svalue(--sp);
         *sp = sp[1];
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_DUP);                    /* --- dup                 --- */
         /* Push a duplicate of sp[0] onto the stack.
          */
         sp++;
         assign_svalue_no_free(sp, sp-1);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_LDUP);                   /* --- ldup                --- */
       {
@@ -12516,7 +12694,7 @@ again:
         sp++;
         normalize_svalue(sp-1, false);
         internal_assign_rvalue_no_free(sp, sp-1);
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_SWAP_VALUES);            /* --- swap_values         --- */
@@ -12526,7 +12704,7 @@ again:
         svalue_t sv = sp[0];
         sp[0] = sp[-1];
         sp[-1] = sv;
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_CLEAR_LOCALS);    /* --- clear_locals <first> <num> --- */
@@ -12546,7 +12724,7 @@ again:
             free_svalue(plocal);
             *plocal = const0;
         }
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_SAVE_ARG_FRAME);         /* --- save_arg_frame      --- */
@@ -12559,7 +12737,7 @@ again:
         sp->type = T_INVALID;
         sp->u.lvalue = ap;
         ap = sp+1;
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_RESTORE_ARG_FRAME);      /* --- restore_arg_frame   --- */
@@ -12571,7 +12749,7 @@ again:
         ap = sp[-1].u.lvalue;
         sp[-1] = sp[0];
         sp--;
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_USE_ARG_FRAME);          /* --- use_arg_frame       --- */
@@ -12589,7 +12767,7 @@ again:
             fatal("Previous use_arg_frame hasn't been consumed.\n");
 #endif
         use_ap = MY_TRUE;
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_FLATTEN_XARG);           /* --- flatten_xarg        --- */
@@ -12601,7 +12779,7 @@ again:
          * to implement flexible varargs.
          */
         sp += expand_argument(sp) - 1;
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_FBRANCH);                /* --- fbranch <offset>    --- */
@@ -12611,7 +12789,7 @@ again:
          */
 
         pc += get_bc_offset(pc);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LBRANCH);                /* --- lbranch <offset>    --- */
@@ -12621,7 +12799,7 @@ again:
          */
 
         pc += get_bc_shortoffset(pc);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LBRANCH_WHEN_ZERO); /* --- lbranch_when_zero <offset> --- */
@@ -12635,11 +12813,11 @@ again:
         {
             pc += get_bc_shortoffset(pc);
             sp--;
-            break;
+            NEXT_INSTRUCTION;
         }
         pc += sizeof(bc_shortoffset_t);
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LBRANCH_WHEN_NON_ZERO); /* --- lbranch_when_non_zero <offset> --- */
@@ -12653,11 +12831,11 @@ again:
         {
             pc += get_bc_shortoffset(pc);
             pop_stack();
-            break;
+            NEXT_INSTRUCTION;
         }
         pc += sizeof(bc_shortoffset_t);
         sp--;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_BRANCH);                 /* --- branch <offset>     --- */
@@ -12667,7 +12845,7 @@ again:
          */
 
         pc += get_uint8(pc) + sizeof(bytecode_t);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_BRANCH_WHEN_ZERO); /* --- branch_when_zero <offset> --- */
@@ -12683,18 +12861,18 @@ again:
             {
                 sp--;
                 pc += GET_UINT8(pc) + sizeof(bytecode_t);
-                break;
+                NEXT_INSTRUCTION;
             }
             sp--;
             pc += sizeof(uint8_t);
-            break;
+            NEXT_INSTRUCTION;
         }
         else
         {
             free_svalue(sp);
             sp--;
             pc += sizeof(uint8_t);
-            break;
+            NEXT_INSTRUCTION;
         }
     }
 
@@ -12711,7 +12889,7 @@ again:
             {
                 sp--;
                 pc += sizeof(uint8_t);
-                break;
+                NEXT_INSTRUCTION;
             }
         }
         else
@@ -12720,7 +12898,7 @@ again:
         }
         sp--;
         pc += GET_UINT8(pc) + sizeof(bytecode_t);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_BBRANCH_WHEN_ZERO);  /* --- bbranch_when_zero <offset> --- */
@@ -12734,11 +12912,11 @@ again:
         {
             sp--;
             pc -= GET_UINT8(pc);
-            break;
+            NEXT_INSTRUCTION;
         }
         pc += sizeof(bytecode_t);
         pop_stack();
-        break;
+        NEXT_INSTRUCTION;
     }
     CASE(F_BBRANCH_WHEN_NON_ZERO); /* --- branch_when_non_zero <offset> --- */
     {
@@ -12753,14 +12931,14 @@ again:
             {
                 pc += sizeof(bytecode_t);
                 sp--;
-                break;
+                NEXT_INSTRUCTION;
             }
         }
         else
             free_svalue(sp);
         sp--;
         pc -= GET_UINT8(pc);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CALL_FUNCTION)         /* --- call_function <index> --- */
@@ -12862,7 +13040,7 @@ again:
         pc = funstart;
         csp->extern_call = MY_FALSE;
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
                    /* --- call_inherited        <prog> <index> --- */
@@ -12931,7 +13109,7 @@ again:
              */
             pop_control_stack();
             push_number(sp, 0);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         /* Search for the function definition and determine the offsets.
@@ -12963,7 +13141,7 @@ again:
             current_variables += variable_index_offset;
         current_strings = current_prog->strings;
         csp->extern_call = MY_FALSE;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CALL_CLOSURE); /* --- call_closure --- */
@@ -13013,7 +13191,7 @@ again:
             push_number(sp, 0);
         }
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CONTEXT_IDENTIFIER);  /* --- context_identifier <var_ix> --- */
@@ -13033,7 +13211,7 @@ again:
 
         sp++;
         assign_rvalue_no_free(sp, inter_context+LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
                                /* --- context_identifier16 <var_ix> --- */
     CASE(F_CONTEXT_IDENTIFIER16);
@@ -13057,7 +13235,7 @@ again:
         LOAD_SHORT(var_index, pc);
         sp++;
         assign_rvalue_no_free(sp, inter_context+var_index);
-        break;
+        NEXT_INSTRUCTION;
      }
 
     CASE(F_PUSH_CONTEXT_LVALUE);   /* --- push_context_lvalue <num> --- */
@@ -13075,7 +13253,7 @@ again:
 
         sp++;
         assign_lvalue_no_free(sp, inter_context + LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
                                  /* --- push_context16_lvalue <num> --- */
     CASE(F_PUSH_CONTEXT16_LVALUE);
@@ -13097,7 +13275,7 @@ again:
         LOAD_SHORT(var_index, pc);
         sp++;
         assign_lvalue_no_free(sp, inter_context + var_index);
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_PUSH_IDENTIFIER_LVALUE);  /* --- push_identifier_lvalue <num> --- */
@@ -13109,7 +13287,7 @@ again:
          */
         sp++;
         assign_lvalue_no_free(sp, find_value((int)(LOAD_UINT8(pc) )));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_VIRTUAL_VARIABLE);         /* --- virtual_variable <num> --- */
         /* Push the virtual object-global variable <num> onto the stack.
@@ -13121,7 +13299,7 @@ again:
          */
         sp++;
         assign_rvalue_no_free(sp, find_virtual_value((int)(LOAD_UINT8(pc))));
-        break;
+        NEXT_INSTRUCTION;
 
                           /* --- push_virtual_variable_lvalue <num> --- */
     CASE(F_PUSH_VIRTUAL_VARIABLE_LVALUE);
@@ -13133,7 +13311,7 @@ again:
          */
         sp++;
         assign_lvalue_no_free(sp, find_virtual_value((int)(LOAD_UINT8(pc) )));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_IDENTIFIER16);         /* --- identifier16 <var_ix> --- */
     {
@@ -13148,7 +13326,7 @@ again:
         LOAD_SHORT(var_index, pc);
         sp++;
         assign_rvalue_no_free(sp, find_value((int)var_index));
-        break;
+        NEXT_INSTRUCTION;
     }
 
                        /* --- push_identifier16_lvalue <var_ix> --- */
@@ -13165,7 +13343,7 @@ again:
         LOAD_SHORT(var_index, pc);
         sp++;
         assign_lvalue_no_free(sp, find_value((int)var_index));
-        break;
+        NEXT_INSTRUCTION;
     }
                          /* --- push_local_variable_lvalue <num> --- */
     CASE(F_PUSH_LOCAL_VARIABLE_LVALUE);
@@ -13175,7 +13353,7 @@ again:
          */
         sp++;
         assign_lvalue_no_free(sp, fp + LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_S_INDEX_LVALUE);         /* --- s_index_lvalue     --- */
         /* Op. (struct v=sp[-2], mixed i=sp[-1], short idx=sp[0])
@@ -13190,7 +13368,7 @@ again:
 
         sp = check_struct_op(sp, pc, NULL);
         sp = push_index_lvalue(sp, pc, REGULAR_INDEX, false);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_MAP_INDEX_LVALUE);       /* --- map_index_lvalue   --- */
         /* Operator F_MAP_INDEX_LVALUE( mapping m=sp[-2]
@@ -13201,7 +13379,7 @@ again:
          * and the lvalue refers to that variable.
          */
         sp = push_map_index_lvalue(sp, pc, false);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_INDEX_LVALUE);           /* --- index_lvalue       --- */
         /* Operator F_INDEX_LVALUE (string|vector &v=sp[-1], int   i=sp[0])
@@ -13226,7 +13404,7 @@ again:
             }
         }
         sp = push_index_lvalue(sp, pc, REGULAR_INDEX, false);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RINDEX_LVALUE);          /* --- rindex_lvalue      --- */
         /* Operator F_RINDEX_LVALUE (string|vector &v=sp[-1], int   i=sp[0])
@@ -13239,7 +13417,7 @@ again:
          */
 
         sp = push_index_lvalue(sp, pc, REVERSE_INDEX, false);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AINDEX_LVALUE);          /* --- aindex_lvalue      --- */
         /* Operator F_AINDEX_LVALUE (string|vector &v=sp[-1], int   i=sp[0])
@@ -13252,7 +13430,7 @@ again:
          */
 
         sp = push_index_lvalue(sp, pc, ARITHMETIC_INDEX, false);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_S_INDEX);                /* --- s_index            --- */
     {
@@ -13270,7 +13448,7 @@ again:
         bool ignore_error = false;
         sp = check_struct_op(sp, pc, &ignore_error);
         sp = push_index_value(sp, pc, ignore_error, REGULAR_INDEX);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_INDEX);                  /* --- index              --- */
@@ -13292,7 +13470,7 @@ again:
             /* NOTREACHED */
         }
         sp = push_index_value(sp, pc, false, REGULAR_INDEX);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RINDEX);                 /* --- rindex              --- */
         /* Operator F_RINDEX (string|vector v=sp[-1], int   i=sp[0])
@@ -13303,7 +13481,7 @@ again:
          */
 
         sp = push_index_value(sp, pc, false, REVERSE_INDEX);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AINDEX);                 /* --- aindex              --- */
         /* Operator F_AINDEX (string|vector v=sp[-1], int   i=sp[0])
@@ -13314,7 +13492,7 @@ again:
          */
 
         sp = push_index_value(sp, pc, false, ARITHMETIC_INDEX);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RANGE_LVALUE);           /* --- range_lvalue        --- */
         /* Operator F_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13330,7 +13508,7 @@ again:
          */
 
         sp = push_range_lvalue(NN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NR_RANGE_LVALUE);           /* --- nr_range_lvalue     --- */
         /* Operator F_NR_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13343,7 +13521,7 @@ again:
          */
 
         sp = push_range_lvalue(NR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RN_RANGE_LVALUE);           /* --- rn_range_lvalue     --- */
         /* Operator F_RN_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13356,7 +13534,7 @@ again:
          */
 
         sp = push_range_lvalue(RN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RR_RANGE_LVALUE);           /* --- rr_range_lvalue     --- */
         /* Operator F_RR_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13369,7 +13547,7 @@ again:
          */
 
         sp = push_range_lvalue(RR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NA_RANGE_LVALUE);           /* --- na_range_lvalue     --- */
         /* Operator F_NA_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13382,7 +13560,7 @@ again:
          */
 
         sp = push_range_lvalue(NA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AN_RANGE_LVALUE);           /* --- an_range_lvalue     --- */
         /* Operator F_AN_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13395,7 +13573,7 @@ again:
          */
 
         sp = push_range_lvalue(AN_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RA_RANGE_LVALUE);           /* --- ra_range_lvalue     --- */
         /* Operator F_RA_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13408,7 +13586,7 @@ again:
          */
 
         sp = push_range_lvalue(RA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AR_RANGE_LVALUE);           /* --- ar_range_lvalue     --- */
         /* Operator F_AR_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13421,7 +13599,7 @@ again:
          */
 
         sp = push_range_lvalue(AR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AA_RANGE_LVALUE);           /* --- aa_range_lvalue     --- */
         /* Operator F_AA_RANGE_LVALUE (string|vector &v=sp[-2]
@@ -13434,7 +13612,7 @@ again:
          */
 
         sp = push_range_lvalue(AA_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_NX_RANGE_LVALUE);           /* --- nx_range_lvalue     --- */
         /* Operator F_NX_RANGE_LVALUE (string|vector &v=sp[-1]
@@ -13451,7 +13629,7 @@ again:
 
         push_number(sp, 1);  /* 'Push' the 1 for the upper bound */
         sp = push_range_lvalue(NR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RX_RANGE_LVALUE);           /* --- rx_range_lvalue     --- */
         /* Operator F_RX_RANGE_LVALUE (string|vector &v=sp[-1]
@@ -13468,7 +13646,7 @@ again:
 
         push_number(sp, 1);  /* 'Push' the 1 for the upper bound */
         sp = push_range_lvalue(RR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AX_RANGE_LVALUE);           /* --- ax_range_lvalue     --- */
         /* Operator F_AX_RANGE_LVALUE (string|vector &v=sp[-1]
@@ -13485,7 +13663,7 @@ again:
 
         push_number(sp, 1);  /* 'Push' the 1 for the upper bound */
         sp = push_range_lvalue(AR_RANGE, sp, pc);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_MAKE_PROTECTED);
         /* Operator &(ref=sp[0])
@@ -13501,7 +13679,7 @@ again:
 
         /* Now we don't need the quickfix anymore. */
         free_svalue(&indexing_quickfix);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_MAKE_RVALUE);
     {
@@ -13516,7 +13694,7 @@ again:
 
         inter_pc = pc;
         transfer_rvalue_no_free(sp, &val);
-        break;
+        NEXT_INSTRUCTION;
     }
 
                           /* --- push_virtual_variable_vlvalue <num> --- */
@@ -13529,7 +13707,7 @@ again:
          */
         sp++;
         assign_var_lvalue_no_free(sp, find_virtual_value((int)(LOAD_UINT8(pc) )));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_PUSH_IDENTIFIER_VLVALUE);  /* --- push_identifier_vlvalue <num> --- */
         /* Push a variable-lvalue onto the stack pointing to object-global
@@ -13540,7 +13718,7 @@ again:
          */
         sp++;
         assign_var_lvalue_no_free(sp, find_value((int)(LOAD_UINT8(pc) )));
-        break;
+        NEXT_INSTRUCTION;
 
                        /* --- push_identifier16_vlvalue <var_ix> --- */
     CASE(F_PUSH_IDENTIFIER16_VLVALUE);
@@ -13556,7 +13734,7 @@ again:
         LOAD_SHORT(var_index, pc);
         sp++;
         assign_var_lvalue_no_free(sp, find_value((int)var_index));
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_PUSH_CONTEXT_VLVALUE);   /* --- push_context_vlvalue <num> --- */
@@ -13575,7 +13753,7 @@ again:
 
         sp++;
         assign_var_lvalue_no_free(sp, inter_context + LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
                          /* --- push_local_variable_vlvalue <num> --- */
     CASE(F_PUSH_LOCAL_VARIABLE_VLVALUE);
@@ -13586,7 +13764,7 @@ again:
          */
         sp++;
         assign_var_lvalue_no_free(sp, fp + LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_INDEX_VLVALUE);          /* --- index_vlvalue       --- */
         /* Operator F_INDEX (vector  v=sp[-1], int   i=sp[0])
@@ -13606,7 +13784,7 @@ again:
             /* NOTREACHED */
         }
         sp = push_index_lvalue(sp, pc, REGULAR_INDEX, true);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_RINDEX_VLVALUE);         /* --- rindex_vlvalue      --- */
         /* Operator F_RINDEX_VLVALUE (string|vector &v=sp[-1], int   i=sp[0])
@@ -13618,7 +13796,7 @@ again:
          */
 
         sp = push_index_lvalue(sp, pc, REVERSE_INDEX, true);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_AINDEX_VLVALUE);         /* --- aindex_vlvalue      --- */
         /* Operator F_AINDEX_VLVALUE (string|vector &v=sp[-1], int   i=sp[0])
@@ -13630,7 +13808,7 @@ again:
          */
 
         sp = push_index_lvalue(sp, pc, ARITHMETIC_INDEX, true);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_S_INDEX_VLVALUE);        /* --- s_index_vlvalue     --- */
         /* Op. (struct v=sp[-2], mixed i=sp[-1], short idx=sp[0])
@@ -13649,7 +13827,7 @@ again:
 
         sp = check_struct_op(sp, pc, NULL);
         sp = push_index_lvalue(sp, pc, REGULAR_INDEX, true);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_MAP_INDEX_VLVALUE);      /* --- map_index_vlvalue   --- */
         /* Operator F_MAP_INDEX_VLVALUE( mapping m=sp[-2]
@@ -13664,7 +13842,7 @@ again:
          * stack. The computed index is a lvalue itself.
          */
         sp = push_map_index_lvalue(sp, pc, true);
-        break;
+        NEXT_INSTRUCTION;
 
 
     CASE(F_SIMUL_EFUN);             /* --- simul_efun <code>   --- */
@@ -13735,7 +13913,7 @@ again:
             push_number(sp, 0);
             WARNF(("Call from destructed object '%s' ignored.\n"
                   , get_txt(current_object->name)));
-            break;
+            NEXT_INSTRUCTION;
         }
 
         /* Make sure the simul_efun object exists; loading it when
@@ -13797,7 +13975,7 @@ again:
             /*
              * The result of the function call is on the stack.
              */
-            break;
+            NEXT_INSTRUCTION;
         }
 
         /* At this point the simul_efun was discarded meanwhile and
@@ -13812,7 +13990,7 @@ again:
         /*
          * The result of the function call is on the stack.
          */
-        break;
+        NEXT_INSTRUCTION;
     }
 
 #ifdef USE_PYTHON
@@ -13838,7 +14016,7 @@ again:
         /*
          * The result of the function call is on the stack.
          */
-        break;
+        NEXT_INSTRUCTION;
     }
 #endif /* USE_PYTHON */
 
@@ -13878,7 +14056,7 @@ again:
 
         /* Leave the array on the stack (ref count is already ok) */
         put_array(sp, v);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_M_AGGREGATE);     /* --- m_aggregate <size> <width> --- */
@@ -13956,7 +14134,7 @@ again:
 
         /* Put the mapping onto the stack */
         put_mapping(sp, m);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_S_AGGREGATE);
@@ -14056,7 +14234,7 @@ again:
         sp++;
         put_struct(sp, st);
 
-        break;
+        NEXT_INSTRUCTION;
    }
 
     CASE(F_PREVIOUS_OBJECT0);       /* --- previous_object0    --- */
@@ -14075,7 +14253,7 @@ again:
             push_number(sp, 0);
         else
             push_ref_object(sp, previous_ob, "previous_object0");
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_LAMBDA_CCONSTANT);    /* --- lambda_cconstant <num> --- */
     {
@@ -14097,7 +14275,7 @@ again:
                                    - LAMBDA_VALUE_OFFSET);
         sp++;
         assign_svalue_no_free(sp, cstart - ix);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_LAMBDA_CONSTANT);     /* --- lambda_constant <num> --- */
@@ -14120,7 +14298,7 @@ again:
                                    - LAMBDA_VALUE_OFFSET);
         sp++;
         assign_svalue_no_free(sp, cstart - ix);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MAP_INDEX);              /* --- map_index           --- */
@@ -14170,7 +14348,7 @@ again:
             assign_rvalue_no_free(sp, data + n);
         }
         free_mapping(m);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FOREACH);       /* --- foreach     <nargs> <offset> --- */
@@ -14417,7 +14595,7 @@ again:
         /* Now branch to the FOREACH_NEXT */
         pc += offset;
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FOREACH_NEXT);         /* --- foreach_next <offset> --- */
@@ -14449,7 +14627,7 @@ again:
         {
             /* Is there something left to iterate? */
             if (0 == sp[-1].u.number)
-                break; /* Nope */
+                NEXT_INSTRUCTION; /* Nope */
 
         }
         sp->u.number++;    /* next number */
@@ -14479,7 +14657,7 @@ again:
                  * index on the stack has been incremented already.
                  */
                 pc -= 3;
-                break;
+                NEXT_INSTRUCTION;
             }
 
             /* Assign the index we used */
@@ -14552,7 +14730,7 @@ again:
             else if (sp[-2].type == T_POINTER)
             {
                 if (ix >= VEC_SIZE(sp[-2].u.vec))
-                    break;
+                    NEXT_INSTRUCTION;
                     /* Oops, this array shrunk while we're looping over it.
                      * We stop processing and continue with the following
                      * FOREACH_END instruction.
@@ -14571,7 +14749,7 @@ again:
             else if (sp[-2].type == T_STRUCT)
             {
                 if (ix >= struct_size(sp[-2].u.strct))
-                    break;
+                    NEXT_INSTRUCTION;
                     /* Oops, somehow the struct managed to shring while
                      * we're looping over it.
                      * We stop processing and continue with the following
@@ -14595,7 +14773,7 @@ again:
 
         /* All that is left is to branch back. */
         pc -= offset;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FOREACH_END);            /* --- foreach_end         --- */
@@ -14623,7 +14801,7 @@ again:
         csp->num_local_variables -= nargs;
 #endif
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_END_CATCH);                  /* --- end_catch       --- */
@@ -14641,7 +14819,7 @@ again:
          */
 
         return MY_TRUE;
-        break;
+        NEXT_INSTRUCTION;
 
                           /* --- breakn_continue <num> <offset> ---*/
     CASE(F_BREAKN_CONTINUE);
@@ -14668,7 +14846,7 @@ again:
          */
         break_sp++;
         pc += get_bc_offset(pc);
-        break;
+        NEXT_INSTRUCTION;
     }
 
 #ifdef F_JUMP
@@ -14678,7 +14856,7 @@ again:
          */
 
         pc = current_prog->program + get_bc_offset(pc);
-        break;
+        NEXT_INSTRUCTION;
     }
 #endif /* F_JUMP */
 
@@ -14713,7 +14891,7 @@ again:
         LOAD_SHORT(size, pc);
         v = allocate_array(size);
         push_array(sp, v);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MOVE_VALUE);             /* --- move_value <offset>  --- */
@@ -14734,7 +14912,7 @@ again:
             ap = sp+i+1;
         else if (ap > sp+i)
             ap++;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_DUP_N);                  /* --- dup_n <offset> <num>  --- */
@@ -14751,7 +14929,7 @@ again:
         inter_sp = sp;
         push_svalue_block(num, sp-offset-num+1);
         sp = inter_sp;
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_POP_N);                  /* --- pop_n <num>  --- */
@@ -14760,7 +14938,7 @@ again:
          */
 
         pop_n_elems(LOAD_UINT8(pc));
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_PUT_ARRAY_ELEMENT); /* --- put_array_element <offset> <ix>  --- */
@@ -14784,9 +14962,216 @@ again:
 
         transfer_svalue_no_free(sp[-offset-1].u.vec->item+ix, sp);
         sp--;
-        break;
+        NEXT_INSTRUCTION;
+    }
+
+    /* --- Superinstructions ---
+     *
+     * These combine frequent sequences of the instructions above into one,
+     * they are created by the compiler (see ins_binary_op() and
+     * insert_pop_value() in prolang.y). If the operands are not plain
+     * numbers, they are pushed onto the stack and the last instruction
+     * of the sequence is executed normally.
+     *
+     * A superinstruction costs as many eval ticks as the sequence it
+     * replaces, the loop charges the first one and CHARGE_FUSED() the
+     * others.
+     *
+     * The sequences were chosen from the counts of consecutive opcodes
+     * which an --enable-opcprof driver gathers in opcpair[] and writes
+     * with dump_driver_info(DDI_OPCODES).
+     */
+
+#   define CHARGE_FUSED(n) \
+        if (add_eval_cost(n)) { pc--; goto again; } else NOOP
+      /* Charge the <n> further instructions the current one replaces.
+       * If this exceeds the eval cost, the current instruction is
+       * fetched again at the top of the loop, which raises the error.
+       */
+
+#   define PUSH_LOCAL() \
+        (sp++, assign_rvalue_no_free(sp, fp + LOAD_UINT8(pc)))
+#   define PUSH_CLIT() \
+        (sp++, put_number(sp, LOAD_UINT8(pc)))
+#   define COMPARE_NUMBERS(op, base) \
+        if ((sp-1)->type == T_NUMBER && sp->type == T_NUMBER) \
+        { \
+            sp--; \
+            sp->u.number = sp->u.number op (sp+1)->u.number; \
+            NEXT_INSTRUCTION; \
+        } \
+        instruction = base; \
+        goto dispatch;
+
+    CASE(F_LOCAL_LOCAL);            /* --- local_local <ix1> <ix2> --- */
+        /* local <ix1>; local <ix2> */
+        CHARGE_FUSED(1);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        NEXT_INSTRUCTION;
+
+    CASE(F_LOCAL_CLIT);             /* --- local_clit <ix> <num>  --- */
+        /* local <ix>; clit <num> */
+        CHARGE_FUSED(1);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        NEXT_INSTRUCTION;
+
+    CASE(F_LOCAL_LOCAL_LT);         /* --- local_local_lt <ix1> <ix2> --- */
+        /* local <ix1>; local <ix2>; lt */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(<, F_LT);
+
+    CASE(F_LOCAL_LOCAL_LE);         /* --- local_local_le <ix1> <ix2> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(<=, F_LE);
+
+    CASE(F_LOCAL_LOCAL_GT);         /* --- local_local_gt <ix1> <ix2> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(>, F_GT);
+
+    CASE(F_LOCAL_LOCAL_GE);         /* --- local_local_ge <ix1> <ix2> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(>=, F_GE);
+
+    CASE(F_LOCAL_LOCAL_EQ);         /* --- local_local_eq <ix1> <ix2> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(==, F_EQ);
+
+    CASE(F_LOCAL_LOCAL_NE);         /* --- local_local_ne <ix1> <ix2> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_LOCAL();
+        COMPARE_NUMBERS(!=, F_NE);
+
+    CASE(F_LOCAL_CLIT_LT);          /* --- local_clit_lt <ix> <num> --- */
+        /* local <ix>; clit <num>; lt */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(<, F_LT);
+
+    CASE(F_LOCAL_CLIT_LE);          /* --- local_clit_le <ix> <num> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(<=, F_LE);
+
+    CASE(F_LOCAL_CLIT_GT);          /* --- local_clit_gt <ix> <num> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(>, F_GT);
+
+    CASE(F_LOCAL_CLIT_GE);          /* --- local_clit_ge <ix> <num> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(>=, F_GE);
+
+    CASE(F_LOCAL_CLIT_EQ);          /* --- local_clit_eq <ix> <num> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(==, F_EQ);
+
+    CASE(F_LOCAL_CLIT_NE);          /* --- local_clit_ne <ix> <num> --- */
+        CHARGE_FUSED(2);
+        PUSH_LOCAL();
+        PUSH_CLIT();
+        COMPARE_NUMBERS(!=, F_NE);
+
+#   undef PUSH_LOCAL
+#   undef PUSH_CLIT
+#   undef COMPARE_NUMBERS
+
+    CASE(F_VOID_ASSIGN_LOCAL);      /* --- void_assign_local <ix> --- */
+        /* push_local_variable_lvalue <ix>; void_assign
+         *
+         * Assigning to the variable itself is the same as assigning
+         * to the lvalue F_PUSH_LOCAL_VARIABLE_LVALUE would create for it.
+         */
+        CHARGE_FUSED(1);
+        transfer_svalue(fp + LOAD_UINT8(pc), sp);
+        sp--;
+        NEXT_INSTRUCTION;
+
+    CASE(F_VOID_ADD_EQ_LOCAL);      /* --- void_add_eq_local <ix> --- */
+    {
+        /* push_local_variable_lvalue <ix>; void_add_eq */
+        svalue_t *var;
+
+        CHARGE_FUSED(1);
+        var = fp + LOAD_UINT8(pc);
+
+        if (var->type == T_NUMBER && sp->type == T_NUMBER
+         && (sp->u.number >= 0 ? var->u.number <= PINT_MAX - sp->u.number
+                               : var->u.number >= PINT_MIN - sp->u.number)
+           )
+        {
+            var->u.number += sp->u.number;
+            sp--;
+            NEXT_INSTRUCTION;
+        }
+
+        sp++;
+        assign_lvalue_no_free(sp, var);
+        instruction = F_VOID_ADD_EQ;
+        goto dispatch;
+    }
+
+    CASE(F_INC_LOCAL);              /* --- inc_local <ix>          --- */
+    {
+        /* push_local_variable_lvalue <ix>; inc */
+        svalue_t *var;
+
+        CHARGE_FUSED(1);
+        var = fp + LOAD_UINT8(pc);
+
+        if (var->type == T_NUMBER && var->u.number < PINT_MAX)
+        {
+            var->u.number++;
+            NEXT_INSTRUCTION;
+        }
+
+        sp++;
+        assign_lvalue_no_free(sp, var);
+        instruction = F_INC;
+        goto dispatch;
+    }
+
+    CASE(F_DEC_LOCAL);              /* --- dec_local <ix>          --- */
+    {
+        /* push_local_variable_lvalue <ix>; dec */
+        svalue_t *var;
+
+        CHARGE_FUSED(1);
+        var = fp + LOAD_UINT8(pc);
+
+        if (var->type == T_NUMBER && var->u.number > PINT_MIN)
+        {
+            var->u.number--;
+            NEXT_INSTRUCTION;
+        }
+
+        sp++;
+        assign_lvalue_no_free(sp, var);
+        instruction = F_DEC;
+        goto dispatch;
     }
 
+#   undef CHARGE_FUSED
+
     /* --- Efuns: Miscellaneous --- */
 
     CASE(F_CLONEP);                 /* --- clonep              --- */
@@ -14822,7 +15207,7 @@ again:
             i = 0;
         free_svalue(sp);
         put_number(sp, i ? 1 : 0);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_CLOSUREP);               /* --- closurep            --- */
@@ -14839,7 +15224,7 @@ again:
         i = sp->type == T_CLOSURE;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_FLOATP);                 /* --- floatp              --- */
@@ -14856,7 +15241,7 @@ again:
         i = sp->type == T_FLOAT;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_INTP);                   /* --- intp                --- */
@@ -14873,7 +15258,7 @@ again:
         i = sp->type == T_NUMBER;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_MAPPINGP);               /* --- mappingp            --- */
@@ -14890,7 +15275,7 @@ again:
         i = sp->type == T_MAPPING;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_OBJECTP);                /* --- objectp              --- */
@@ -14907,7 +15292,7 @@ again:
         i = sp->type == T_OBJECT;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_POINTERP);               /* --- pointerp            --- */
@@ -14924,7 +15309,7 @@ again:
         i = sp->type == T_POINTER;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_REFERENCEP);                /* --- referencep      --- */
@@ -14968,7 +15353,7 @@ again:
         }
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_STRINGP);                /* --- stringp             --- */
@@ -14985,7 +15370,7 @@ again:
         i = sp->type == T_STRING;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_STRUCTP);                /* --- structp             --- */
@@ -15002,7 +15387,7 @@ again:
         i = sp->type == T_STRUCT;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_SYMBOLP);                /* --- symbolp             --- */
@@ -15019,7 +15404,7 @@ again:
         i = sp->type == T_SYMBOL;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_TYPEOF);                    /* --- typeof          --- */
@@ -15035,7 +15420,7 @@ again:
         mp_int i = sp->type;
         free_svalue(sp);
         put_number(sp, i);
-        break;
+        NEXT_INSTRUCTION;
       }
 
     CASE(F_NEGATE);                 /* --- negate              --- */
@@ -15053,7 +15438,7 @@ again:
             if (sp->u.number == PINT_MIN)
                 ERRORF(("Numeric overflow: - %"PRIdPINT"\n", sp->u.number));
             sp->u.number = - sp->u.number;
-            break;
+            NEXT_INSTRUCTION;
         }
         else if (sp->type == T_FLOAT)
         {
@@ -15064,7 +15449,7 @@ again:
             if (d < (-DBL_MAX) || d > DBL_MAX)
                 ERRORF(("Numeric overflow: -(%g)\n", READ_DOUBLE(sp)));
             STORE_DOUBLE(sp,d);
-            break;
+            NEXT_INSTRUCTION;
         }
         ERRORF(("Bad arg to unary minus: got %s, expected number/float\n"
                , typename(sp->type)
@@ -15101,7 +15486,7 @@ again:
         inter_sp = --sp;
         inter_pc = pc;
         throw_error(sp+1); /* do the longjump, with extra checks... */
-        break;
+        NEXT_INSTRUCTION;
 
     /* --- Efuns: Arrays and Mappings --- */
 
@@ -15125,7 +15510,7 @@ again:
             i = mstrsize(sp->u.str);
             free_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_POINTER)
@@ -15133,7 +15518,7 @@ again:
             i = VEC_SIZE(sp->u.vec);
             free_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_STRUCT)
@@ -15141,7 +15526,7 @@ again:
             i = struct_size(sp->u.strct);
             free_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_MAPPING)
@@ -15151,11 +15536,11 @@ again:
             i = MAP_SIZE(m);
             free_svalue(sp);
             put_number(sp, i);
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (sp->type == T_NUMBER && sp->u.number == 0)
-            break;
+            NEXT_INSTRUCTION;
 
         RAISE_ARG_ERROR(1, TF_NULL|TF_MAPPING|TF_POINTER, sp->type);
         /* NOTREACHED */
@@ -15228,7 +15613,7 @@ again:
             push_number(sp, 0);
             WARNF(("Call from destructed object '%s' ignored.\n"
                   , get_txt(current_object->name)));
-            break;
+            NEXT_INSTRUCTION;
         }
 
         if (arg[0].type != T_POINTER)
@@ -15274,7 +15659,7 @@ again:
                     pop_n_elems(num_arg-2);
                 pop_n_elems(2);
                 push_number(sp, 0);
-                break;
+                NEXT_INSTRUCTION;
             }
             sp -= num_arg - 3;
 
@@ -15419,7 +15804,7 @@ again:
             free_string_svalue(sp); sp--;
         }
 
-        break;
+        NEXT_INSTRUCTION;
     }
 
     CASE(F_EXTERN_CALL);               /* --- extern_call     --- */
@@ -15440,7 +15825,7 @@ again:
 
         while (pt->catch_call) pt--;
         push_number(sp, (pt->extern_call & ~CS_PRETEND) ? 1 : 0);
-        break;
+        NEXT_INSTRUCTION;
       }
 
     /* --- Efuns: Objects --- */
@@ -15468,7 +15853,7 @@ again:
             put_ref_object(sp, master_ob, "master");
         else
             put_number(sp, 0);
-        break;
+        NEXT_INSTRUCTION;
      }
 
     CASE(F_THIS_INTERACTIVE);       /* --- this_interactive    --- */
@@ -15485,7 +15870,7 @@ again:
             push_ref_object(sp, current_interactive, "this_interactive");
         else
             push_number(sp, 0);
-        break;
+        NEXT_INSTRUCTION;
 
     CASE(F_THIS_OBJECT);            /* --- this_object         --- */
         /* EFUN this_object()
@@ -15498,10 +15883,10 @@ again:
         if (current_object->flags & O_DESTRUCTED)
         {
             push_number(sp, 0);
-            break;
+            NEXT_INSTRUCTION;
         }
         push_ref_object(sp, current_object, "this_object");
-        break;
+        NEXT_INSTRUCTION;
 
     /* --- Efuns: Verbs and Commands --- */
 
@@ -15521,7 +15906,7 @@ again:
             push_ref_object(sp, command_giver, "this_player");
         else
             push_number(sp, 0);
-        break;
+        NEXT_INSTRUCTION;
 
     /* --- Optional Efuns: Technical --- */
 
@@ -15539,7 +15924,7 @@ again:
 
         if (sp - fp - csp->num_local_variables + 1 != 0)
             fatal("Bad stack pointer.\n");
-        break;
+        NEXT_INSTRUCTION;
 #endif
 
 #ifdef F_SWAP
@@ -15570,13 +15955,16 @@ again:
                 (void)swap_variables(ob);
         }
         free_svalue(sp--);
-        break;
+        NEXT_INSTRUCTION;
       }
 #endif
 
     } /* end of the monumental switch */
 
     /* Instruction executed */
+#ifdef DIRECT_DISPATCH
+end_instruction:
+#endif
 
     /* Reset the no-warn-deprecated flag */
     if (instruction != F_NO_WARN_DEPRECATED)
@@ -15640,6 +16028,13 @@ again:
         printf("%s ... execution continues.\n", ts);
     }
     
+    // Is a sample of the sampling profiler due?
+    if (received_sample_signal)
+    {
+        inter_pc = pc;
+        record_profile_sample(MY_TRUE);
+    }
+
     // Did we allocate too much memory in this execution/evaluation thread?
     if (max_memory
         && xalloc_used() - used_memory_at_eval_start > max_memory)
@@ -15669,6 +16064,8 @@ again:
 #   undef TYPE_TEST_EXP_LEFT
 #   undef TYPE_TEST_EXP_RIGHT
 #   undef CASE
+#   undef NEXT_INSTRUCTION
+#   undef DIRECT_DISPATCH
 #   undef ARG_ERROR_TEMPL
 #   undef OP_ARG_ERROR_TEMPL
 #   undef TYPE_TEST_TEMPL
@@ -16740,6 +17137,7 @@ assert_master_ob_loaded (void)
             if (!obj_list_end)
                 obj_list_end = ob;
             num_listed_objs++;
+            schedule_object(ob);
             ob->super = NULL;
             ob->contains = NULL;
             ob->next_inv = NULL;
@@ -18295,6 +18693,29 @@ count_interpreter_refs (void)
         if (cache[i].name)
             count_ref_from_string(cache[i].name);
     }
+
+    for (i = 0; i < PROFILE_TABLE_SIZE; i++)
+    {
+        struct profile_sample_s *sample;
+
+        for (sample = profile_table[i]; sample != NULL; sample = sample->next)
+        {
+            note_malloced_block_ref(sample);
+            count_ref_from_string(sample->stack);
+        }
+    }
+
+    for (i = 0; i < FUNCTION_PROFILE_TABLE_SIZE; i++)
+    {
+        struct function_profile_s *prof;
+
+        for (prof = function_profile_table[i]; prof != NULL; prof = prof->next)
+        {
+            note_malloced_block_ref(prof);
+            count_ref_from_string(prof->prog_name);
+            count_ref_from_string(prof->fun_name);
+        }
+    }
 #ifdef TRACE_CODE
     for (i = TOTAL_TRACE_LENGTH; --i >= 0; )
     {
@@ -18356,6 +18777,23 @@ opcdump (string_t * fname)
             fprintf(f,"%d: %d\n", i, opcount[i]);
 #endif
     }
+
+    /* The pair counts follow the single counts, one pair per line. */
+    for (i = 0; i < 256; i++)
+    {
+        int j;
+
+        for (j = 0; j < 256; j++)
+        {
+            if (opcpair[i][j])
+#ifdef VERBOSE_OPCPROF
+                fprintf(f,"%d %d: \"%-16s\" \"%-16s\" %6d\n", i, j
+                       , get_f_name(i), get_f_name(j), opcpair[i][j]);
+#else
+                fprintf(f,"%d %d: %d\n", i, j, opcpair[i][j]);
+#endif
+        }
+    }
     fclose(f);
 
     return MY_TRUE;
@@ -19969,5 +20407,496 @@ get_profiling_time_limit()
 {
     return profiling_timevalue.tv_sec * 1000000 + profiling_timevalue.tv_usec;
 } /* get_memory_limit */
+
+/*-------------------------------------------------------------------------*/
+static void
+clear_profile_samples (void)
+
+/* Remove all samples recorded by the sampling profiler.
+ */
+
+{
+    int i;
+
+    for (i = 0; i < PROFILE_TABLE_SIZE; i++)
+    {
+        struct profile_sample_s *sample, *next;
+
+        for (sample = profile_table[i]; sample != NULL; sample = next)
+        {
+            next = sample->next;
+            free_mstring(sample->stack);
+            xfree(sample);
+        }
+        profile_table[i] = NULL;
+    }
+
+    num_profile_samples = 0;
+    num_profile_stacks = 0;
+} /* clear_profile_samples() */
+
+/*-------------------------------------------------------------------------*/
+static void
+count_profile_sample (string_t *stack)
+
+/* Count one sample of <stack>, which must be a tabled string. The
+ * reference of <stack> is adopted.
+ */
+
+{
+    struct profile_sample_s *sample;
+    int ix;
+
+    ix = (int)(((p_uint)stack >> 4) & (PROFILE_TABLE_SIZE-1));
+    for (sample = profile_table[ix]; sample != NULL; sample = sample->next)
+    {
+        if (sample->stack == stack)
+        {
+            sample->count++;
+            free_mstring(stack);
+            return;
+        }
+    }
+
+    if (num_profile_stacks >= PROFILE_MAX_STACKS)
+    {
+        string_t *truncated = new_tabled(PROFILE_TRUNCATED);
+
+        if (truncated != stack)
+        {
+            free_mstring(stack);
+            if (truncated)
+                count_profile_sample(truncated);
+            return;
+        }
+
+        /* This is the first truncated sample. */
+        free_mstring(truncated);
+    }
+
+    sample = xalloc(sizeof(*sample));
+    if (!sample)
+    {
+        free_mstring(stack);
+        return;
+    }
+
+    sample->stack = stack;
+    sample->count = 1;
+    sample->next = profile_table[ix];
+    profile_table[ix] = sample;
+    num_profile_stacks++;
+} /* count_profile_sample() */
+
+/*-------------------------------------------------------------------------*/
+static void
+record_profile_sample (Bool in_lpc)
+
+/* Record a sample for the sampling profiler: if <in_lpc> is true, it is
+ * the current control stack, otherwise the time was spent in the driver
+ * outside of any LPC code.
+ *
+ * The stack is recorded in the collapsed format of the flame graph tools:
+ * the frames from the outermost to the innermost, separated by ';'.
+ * LPC functions are given as '<file>:<function>:<line>'.
+ */
+
+{
+    struct control_stack *p;
+    strbuf_t sbuf;
+    string_t *stack;
+
+    received_sample_signal = MY_FALSE;
+    num_profile_samples++;
+
+    if (!in_lpc || !current_prog || csp < &CONTROL_STACK[0])
+    {
+        stack = new_tabled(PROFILE_DRIVER);
+        if (stack)
+            count_profile_sample(stack);
+        return;
+    }
+
+    /* As in collect_trace(), the pc and program of a frame
+     * are stored in the next frame.
+     */
+    strbuf_zero(&sbuf);
+    for (p = &CONTROL_STACK[0]; p <= csp; p++)
+    {
+        bytecode_p  frame_pc = (p == csp) ? inter_pc : p[1].pc;
+        program_t  *prog = (p == csp) ? current_prog : p[1].prog;
+
+        /* Skip the dummy frames of closure calls. */
+        if (!prog || !frame_pc)
+            continue;
+
+        if (sbuf.length)
+            strbuf_addc(&sbuf, ';');
+
+        if (p->funstart == SIMUL_EFUN_FUNSTART)
+            strbuf_add(&sbuf, "<simul_efun_closure>");
+        else if (p->funstart == EFUN_FUNSTART)
+        {
+            if (instrs[p->instruction].name)
+                strbuf_addf(&sbuf, "#'%s", instrs[p->instruction].name);
+            else
+                strbuf_add(&sbuf, "<efun_closure>");
+        }
+        else if (p->funstart < prog->program
+              || p->funstart > PROGRAM_END(*prog))
+            strbuf_addf(&sbuf, "%s:<lambda>", get_txt(prog->name));
+        else
+        {
+            string_t *file;
+            string_t *name;
+            int line;
+
+            line = get_line_number(frame_pc, prog, &file);
+            name = prog->function_headers[FUNCTION_HEADER_INDEX(p->funstart)].name;
+            strbuf_addf(&sbuf, "%s:%s:%d"
+                       , get_txt(file), get_txt(name), line);
+            free_mstring(file);
+        }
+    }
+
+    /* The flame graph tools separate the count by a space, so remove
+     * the spaces, e.g. of 'prog.c (include.h)' file names.
+     */
+    if (sbuf.length)
+    {
+        char *src, *dest, *end;
+
+        end = sbuf.buf + sbuf.length;
+        for (src = dest = sbuf.buf; src < end; src++)
+        {
+            if (*src != ' ')
+                *dest++ = *src;
+        }
+        sbuf.length = dest - sbuf.buf;
+    }
+
+    if (sbuf.length)
+        stack = new_n_tabled(sbuf.buf, sbuf.length);
+    else
+        stack = new_tabled(PROFILE_DRIVER);
+    strbuf_free(&sbuf);
+    if (stack)
+        count_profile_sample(stack);
+} /* record_profile_sample() */
+
+/*-------------------------------------------------------------------------*/
+Bool
+set_profile_sampling_rate (p_int rate)
+
+/* Start the sampling profiler with <rate> samples per second of CPU time,
+ * or stop it if <rate> is 0. Starting the profiler discards the samples
+ * of the previous run.
+ *
+ * Return TRUE on success and FALSE otherwise.
+ */
+
+{
+    struct itimerval timer = { {0,0}, {0,0} };
+
+    if (rate < 0 || rate > 1000000)
+        return MY_FALSE;
+
+    if (rate && !profile_sampling_rate)
+        clear_profile_samples();
+
+    if (rate)
+    {
+        /* tv_usec must stay below one second. */
+        timer.it_interval.tv_sec = 1 / rate;
+        timer.it_interval.tv_usec = (1000000 / rate) % 1000000;
+        timer.it_value = timer.it_interval;
+    }
+
+    if (setitimer(ITIMER_VIRTUAL, &timer, NULL))
+        return MY_FALSE;
+
+    profile_sampling_rate = rate;
+    received_sample_signal = MY_FALSE;
+    return MY_TRUE;
+} /* set_profile_sampling_rate() */
+
+/*-------------------------------------------------------------------------*/
+p_int
+get_profile_sampling_rate (void)
+
+/* Return the sampling rate of the sampling profiler.
+ */
+
+{
+    return profile_sampling_rate;
+} /* get_profile_sampling_rate() */
+
+/*-------------------------------------------------------------------------*/
+void
+profile_driver_info (svalue_t *svp, int value)
+
+/* Returns the profiler information for driver_info(<what>).
+ * <svp> points to the svalue for the result.
+ */
+
+{
+    switch (value)
+    {
+        case DI_PROFILE_SAMPLES:
+        {
+            /* Print the samples in the collapsed stack format:
+             * one line per stack with the frames and the number of
+             * samples separated by a space.
+             */
+            strbuf_t sbuf;
+            int i;
+
+            strbuf_zero(&sbuf);
+            for (i = 0; i < PROFILE_TABLE_SIZE; i++)
+            {
+                struct profile_sample_s *sample;
+
+                for (sample = profile_table[i]; sample != NULL; sample = sample->next)
+                    strbuf_addf(&sbuf, "%s %"PRIdPINT"\n"
+                               , get_txt(sample->stack), sample->count);
+            }
+            strbuf_store(&sbuf, svp);
+            break;
+        }
+
+        case DI_NUM_PROFILE_SAMPLES:
+            put_number(svp, num_profile_samples);
+            break;
+
+        case DI_FUNCTION_PROFILE:
+            put_array(svp, get_function_profiles());
+            break;
+
+        default:
+            fatal("Unknown option for profile_driver_info(): %d\n", value);
+            break;
+    }
+} /* profile_driver_info() */
+
+/*-------------------------------------------------------------------------*/
+static mp_int
+function_profile_usecs (void)
+
+/* Return the current time in microseconds for the function profiles.
+ */
+
+{
+    struct timeval tv;
+
+    if (gettimeofday(&tv, NULL))
+        return 0;
+    return (mp_int)tv.tv_sec * 1000000 + tv.tv_usec;
+} /* function_profile_usecs() */
+
+/*-------------------------------------------------------------------------*/
+static void
+start_function_profile (bytecode_p funstart)
+
+/* Called by setup_new_frame2() when the function at <funstart> in
+ * current_prog is entered with function profiling active: find
+ * or create the profile of the function and start its counters in
+ * the current frame.
+ */
+
+{
+    struct function_profile_s *prof;
+    int fun_ix;
+    int ix;
+
+    fun_ix = FUNCTION_HEADER_INDEX(funstart);
+    ix = (int)(((p_uint)current_prog->id_number * 31 + fun_ix)
+               & (FUNCTION_PROFILE_TABLE_SIZE-1));
+
+    for (prof = function_profile_table[ix]; prof != NULL; prof = prof->next)
+    {
+        if (prof->prog_id == current_prog->id_number && prof->fun_ix == fun_ix)
+            break;
+    }
+
+    if (!prof)
+    {
+        prof = xalloc(sizeof(*prof));
+        if (!prof)
+            return;
+
+        prof->prog_id = current_prog->id_number;
+        prof->fun_ix = fun_ix;
+        prof->prog_name = ref_mstring(current_prog->name);
+        prof->fun_name = ref_mstring(current_prog->function_headers[fun_ix].name);
+        prof->calls = 0;
+        prof->cost = prof->excl_cost = 0;
+        prof->usecs = prof->excl_usecs = 0;
+        prof->next = function_profile_table[ix];
+        function_profile_table[ix] = prof;
+    }
+
+    csp->profile = prof;
+    csp->profile_eval_cost = eval_cost;
+    csp->profile_usecs = function_profile_usecs();
+    csp->profile_child_cost = 0;
+    csp->profile_child_usecs = 0;
+} /* start_function_profile() */
+
+/*-------------------------------------------------------------------------*/
+static void
+finish_function_profile (struct control_stack *p)
+
+/* The function of the control frame <p> returns: add its eval cost and
+ * time to its profile and to the callee counters of the calling
+ * profiled function.
+ */
+
+{
+    struct function_profile_s *prof = p->profile;
+    struct control_stack *q;
+    mp_int cost, usecs;
+
+    cost = eval_cost - p->profile_eval_cost;
+    usecs = function_profile_usecs() - p->profile_usecs;
+    if (cost < 0)
+        cost = 0;
+    if (usecs < 0)
+        usecs = 0;
+
+    prof->calls++;
+    prof->cost += cost;
+    prof->usecs += usecs;
+    if (cost > p->profile_child_cost)
+        prof->excl_cost += cost - p->profile_child_cost;
+    if (usecs > p->profile_child_usecs)
+        prof->excl_usecs += usecs - p->profile_child_usecs;
+
+    for (q = p - 1; q >= CONTROL_STACK; q--)
+    {
+        if (q->profile)
+        {
+            q->profile_child_cost += cost;
+            q->profile_child_usecs += usecs;
+            break;
+        }
+    }
+
+    p->profile = NULL;
+} /* finish_function_profile() */
+
+/*-------------------------------------------------------------------------*/
+static void
+unwind_function_profiles (struct control_stack *target)
+
+/* The control stack is unwound to <target> after an error: finish the
+ * profiles of all functions left.
+ */
+
+{
+    struct control_stack *p;
+
+    for (p = csp; p > target; p--)
+    {
+        if (p->profile)
+            finish_function_profile(p);
+    }
+} /* unwind_function_profiles() */
+
+/*-------------------------------------------------------------------------*/
+void
+set_function_profiling (Bool enable)
+
+/* Activate (<enable> is true) or deactivate the function profiling.
+ * Activating it discards the profiles of the previous run.
+ */
+
+{
+    if (enable && !function_profiling)
+    {
+        struct control_stack *p;
+        int i;
+
+        /* The functions still running from the previous run
+         * must not count anymore.
+         */
+        for (p = CONTROL_STACK; p <= csp; p++)
+            p->profile = NULL;
+
+        for (i = 0; i < FUNCTION_PROFILE_TABLE_SIZE; i++)
+        {
+            struct function_profile_s *prof, *next;
+
+            for (prof = function_profile_table[i]; prof != NULL; prof = next)
+            {
+                next = prof->next;
+                free_mstring(prof->prog_name);
+                free_mstring(prof->fun_name);
+                xfree(prof);
+            }
+            function_profile_table[i] = NULL;
+        }
+    }
+
+    function_profiling = enable;
+} /* set_function_profiling() */
+
+/*-------------------------------------------------------------------------*/
+Bool
+get_function_profiling (void)
+
+/* Return true if the function profiling is active.
+ */
+
+{
+    return function_profiling;
+} /* get_function_profiling() */
+
+/*-------------------------------------------------------------------------*/
+static vector_t *
+get_function_profiles (void)
+
+/* Return an array with the function profiles for
+ * driver_info(DI_FUNCTION_PROFILE).
+ */
+
+{
+    vector_t *vec;
+    mp_int num = 0;
+    int i;
+
+    for (i = 0; i < FUNCTION_PROFILE_TABLE_SIZE; i++)
+    {
+        struct function_profile_s *prof;
+
+        for (prof = function_profile_table[i]; prof != NULL; prof = prof->next)
+            num++;
+    }
+
+    memsafe(vec = allocate_array(num), sizeof(*vec), "result array");
+
+    num = 0;
+    for (i = 0; i < FUNCTION_PROFILE_TABLE_SIZE; i++)
+    {
+        struct function_profile_s *prof;
+
+        for (prof = function_profile_table[i]; prof != NULL; prof = prof->next)
+        {
+            vector_t *entry;
+
+            memsafe(entry = allocate_array(FUNCTION_PROFILE_MAX), sizeof(*entry), "result array");
+            put_ref_string(entry->item + FUNCTION_PROFILE_PROGRAM, prof->prog_name);
+            put_ref_string(entry->item + FUNCTION_PROFILE_FUNCTION, prof->fun_name);
+            put_number(entry->item + FUNCTION_PROFILE_CALLS, prof->calls);
+            put_number(entry->item + FUNCTION_PROFILE_COST, prof->cost);
+            put_number(entry->item + FUNCTION_PROFILE_EXCL_COST, prof->excl_cost);
+            put_number(entry->item + FUNCTION_PROFILE_TIME, prof->usecs);
+            put_number(entry->item + FUNCTION_PROFILE_EXCL_TIME, prof->excl_usecs);
+            put_array(vec->item + num, entry);
+            num++;
+        }
+    }
+
+    return vec;
+} /* get_function_profiles() */
                             
 /***************************************************************************/
@@ -82,6 +82,15 @@ struct control_stack {
     int32 eval_cost;
       /* The eval cost at that moment. */
 #endif
+
+    struct function_profile_s *profile;
+      /* With function profiling active, the counters for the function
+       * of this frame, otherwise NULL.
+       */
+    int32  profile_eval_cost;   /* The eval cost at the function entry */
+    mp_int profile_usecs;       /* The time at the function entry */
+    mp_int profile_child_cost;  /* Eval cost spent in the callees */
+    mp_int profile_child_usecs; /* Time spent in the callees */
 };
 
 /* An error handler is simply a function that is given the
@@ -312,6 +321,16 @@ extern void handle_profiling_signal(int ignored);
 extern Bool set_profiling_time_limit(mp_int limit);
 extern mp_int get_profiling_time_limit();
 
+// sampling profiler (SIGVTALRM)
+extern void handle_sample_signal(int ignored);
+extern Bool set_profile_sampling_rate(p_int rate);
+extern p_int get_profile_sampling_rate(void);
+extern void profile_driver_info(svalue_t *svp, int value) __attribute__((nonnull(1)));
+
+// function profiling
+extern void set_function_profiling(Bool enable);
+extern Bool get_function_profiling(void);
+
 extern size_t interpreter_overhead(void);
 
 #ifdef GC_SUPPORT
@@ -54,6 +54,7 @@
 #include "comm.h"
 #include "filestat.h"
 #include "gcollect.h"
+#include "hash.h"
 #include "interpret.h"
 #include "lex.h"
 #include "mapping.h"
@@ -478,6 +479,14 @@ main (int argc, char **argv)
           /* This also assures the existance of the fd for the debug log */
 
         reserve_memory();
+
+        /* Choose the seed of the string hashes before the first string
+         * is hashed. It is taken from the PRNG, so --random-seed also
+         * reproduces the layout of the hash tables.
+         */
+        seed_hash(((uint64_t)random_number(UINT32_MAX) << 32)
+                  ^ random_number(UINT32_MAX));
+
         mstring_init();
           /* Also initializes the standard strings, which may be required
            * early on should an error happen.
@@ -1141,6 +1150,7 @@ typedef enum OptNumber {
  , cNoERQ           /* --no-erq             */
  , cNoTimers        /* --no-timers          */
  , cNoPreload       /* --no-preload         */
+ , cOTableSize      /* --otable-size        */
  , cPidFile         /* --pidfile            */
  , cRandomdevice    /* --randomdevice       */
  , cRandomSeed      /* --random-seed        */
@@ -1486,6 +1496,13 @@ static Option aOptions[]
         "    --hard-malloc-limit.\n"
       }
 
+    , { 0,   "otable-size",        cOTableSize,     MY_TRUE
+      , "  --otable-size <number>\n"
+      , "  --otable-size <number>\n"
+        "    The initial number of chains in the object name table, which grows\n"
+        "    as more objects are loaded. It is rounded up to a power of two.\n"
+      }
+
     , { 0,   "min-malloc",         cMinMalloc,      MY_TRUE
       , "  --min-malloc <size>\n"
       , "  --min-malloc <size>\n"
@@ -1976,6 +1993,9 @@ options (void)
 #ifdef USE_IPV6
                               , "IPv6 supported\n"
 #endif
+#ifdef USE_EPOLL
+                              , "epoll() supported\n"
+#endif
 #ifdef USE_MCCP
                               , "MCCP supported\n"
 #endif
@@ -2173,7 +2193,7 @@ options (void)
         printf("unlimited\n");
     
   printf("Internal tables: shared string hash:      %6d entries\n"
-         "                 object hash:             %6d entries\n"
+         "                 object hash (initial):   %6d entries\n"
          "                 reserved name hash:      %6d entries\n"
          "                 apply cache:             %6d entries\n"
 #ifdef RXCACHE_TABLE
@@ -2237,6 +2257,12 @@ options (void)
 #       if defined(APPLY_CACHE_STAT)
                               , "APPLY_CACHE_STAT"
 #       endif
+#       if defined(USE_COMPUTED_GOTO)
+                              , "USE_COMPUTED_GOTO"
+#       endif
+#       if defined(USE_SWAP_THREAD)
+                              , "USE_SWAP_THREAD"
+#       endif
 #       if defined(OPCPROF)
                               , "OPCPROF"
 #           if defined(OPCPROF_VERBOSE)
@@ -2603,6 +2629,17 @@ eval_arg (int eOption, const char * pValue)
         break;
       }
 
+    case cOTableSize:
+      {
+        long val = atoi(pValue);
+
+        if (val > 0)
+            otable_initial_size = val;
+        else
+            fprintf(stderr, "Illegal value for table size '%s' ignored.\n", pValue);
+        break;
+      }
+
     case cMaxWriteBuffer:
       {
         long val = atoi(pValue);
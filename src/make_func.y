@@ -3182,6 +3182,33 @@ create_instrs (void)
         }
     }
 
+    /* The jump table for the interpreter: <op> is applied to all
+     * single-byte instructions in the order of their codes, the remaining
+     * codes up to 255 are filled with <none>.
+     */
+    fprintf(fpw,
+"\n"
+"/* --- dispatch table --- */\n"
+"\n"
+"#define INSTR_DISPATCH_TABLE(op, none) \\\n"
+           );
+    j = instr_offset[C_EFUN] + num_instr[C_EFUN];
+    for (i = 0; i < 256; i++)
+    {
+        if (i < j)
+            fprintf(fpw, "    /* %3d */ op(%s)%s \\\n"
+                       , i, make_f_name(instr[i].key), i < 255 ? "," : "");
+        else
+            fprintf(fpw, "    /* %3d */ none%s \\\n"
+                       , i, i < 255 ? "," : "");
+    }
+    fprintf(fpw,
+"\n"
+"  /* The single-byte instruction codes in order, padded to 256 entries.\n"
+"   * Used by eval_instruction() to build its table of label addresses.\n"
+"   */\n"
+           );
+
     fprintf(fpw,
 "\n"
 "/************************************************************************/\n"
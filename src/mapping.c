@@ -7,14 +7,6 @@
  * TODO:: provide wrapper functions which do throw errorf()s, so that every
  * TODO:: caller can handle the errors himself (like the swapper).
  *
- * TODO: A better mapping implementation would utilise the to-be-written
- * TODO:: small block pools. The mapping entries would be unified to
- * TODO:: (hash header:key:values) tuples and stored in a pool.
- * TODO:: The 'compacted' part of the mapping would obviously go away,
- * TODO:: and all indexing would be done through hash table.
- * TODO:: The pool is not absolutely required, but would reduce overhead if
- * TODO:: MALLOC_TRACE is in effect.
- *
  * TODO: Check if the use of mp_int is reasonable for values for num_values
  * TODO::and num_entries (which are in the struct p_int). And check as
  * TODO::the wild mixture of mp_int, p_int, size_t (and maybe still int?)
@@ -34,69 +26,56 @@
  * NB: Where strings are used as index value, they are made shared strings.
  *
  *
- * A mapping consists of several structures (defined in mapping.h):
+ * A mapping consists of several structures (defined in mapping.h
+ * and here):
  *
  *  - the mapping_t is the base of all mappings.
- *  - mapping_cond_t holds the condensed entries
- *  - mapping_hash_t holds the hashed entries added since the
- *      creation of the mapping_cond_t block.
- *
- * Using this approach, mappings manage to combine a low memory overhead
- * with fast operation. Both the hashed and the condensed part may
- * be absent.
- *
- * The key values are sorted according to svalue_cmp(), that is in principle
- * by (.type, .u.number >> 1, .x.generic), with the exception of closures and
- * strings which have their own sorting order within their .type.
- *
- * Since the x.generic information is also used to generate the hash value for
- * hashing, for values which don't have a secondary information, x.generic is
- * set to .u.number << 1.
- *
- * The mapping_cond_t block holds mapping entries in sorted order.
- * Deleted entries are signified by a T_INVALID key value and can appear
- * out of order. The data values for a deleted entry are set to svalue-0.
- *
- * The mapping_hash_t block is used to record all the new additions to
- * the mapping since the last compaction. The new entries' data is kept
- * directly in the hash entries. The hash table grows with the
- * number of hashed entries, so that the average chain length is
- * no more than 2. For easier computations,the number of buckets
- * is always a power of 2.
- *
- * All mappings with a mapping_hash_t structure are considered 'dirty'
- * (and vice versa, only 'dirty' mappings have a mapping_hash_t).
- * During the regular object cleanup, the backend will find and 'clean'
- * the dirty mappings by sorting the hashed entries into the condensed part,
- * removing the hashed part by this.
- *
- * To be compacted, a mapping has to conform to a number of conditions:
- *  - it has been at least TIME_TO_COMPACT seconds (typical 10 minutes)
- *    since the last addition or deletion of an entry
- * and
- *     - it was to be at least 2*TIME_TO_COMPACT seconds (typical 20 minutes)
- *       since the last addition or deletion of an entry
- *  or - the number of condensed-deleted entries is at least half the capacity
- *       of the condensed part
- *  or - the number of hashed entries exceeds the number non-deleted condensed
- *       entries.
- *
- * The idea is to minimize reallocations of the (potentially large) condensed
- * block, as it easily runs into fragmentation of the large block heap.
- *
- * A garbage collection however compacts all mappings unconditionally.
+ *  - mapping_hash_t holds the hash index over all entries.
+ *  - map_block_t holds the entries themselves: the key of each
+ *      entry followed by its values.
+ *
+ * The index and the blocks are allocated with the first entry, so an
+ * empty mapping may consist of the mapping_t alone.
+ *
+ * The index is an open-addressed hash table using linear probing. Each slot
+ * holds the hash value of a key together with a pointer to its entry, so
+ * that full key comparisons are only made for matching hash values, and
+ * that the index can be rebuilt without rehashing the keys. The number
+ * of slots is always a power of 2; the index is rebuilt before more than
+ * 3/4 of the slots are in use (including those of deleted entries). The
+ * slot of a deleted entry is marked as MAP_SLOT_DELETED to keep the
+ * probe sequences of other entries intact; these marks vanish when the
+ * index is rebuilt.
+ *
+ * The entries are not stored in the index itself, because the interpreter
+ * holds plain pointers to mapping values (e.g. the lvalue for m[k] in
+ * 'm[k] = (m[j] = 1)', or the values passed by walk_mapping()), which must
+ * survive the addition of other entries. Instead, entries are allocated
+ * from blocks which never move. Each new block is as big as all previous
+ * blocks together, so the entries of a mapping are spread over
+ * O(log(entries)) blocks, and iterating over the blocks visits the
+ * entries mostly in the order of their insertion. The entries of
+ * deleted keys are put into a free list and reused by later additions.
+ *
+ * The hash value is generated from .type, .u and .x.generic, with the
+ * exception of strings, closures and floats which have their own hash
+ * functions. For values which don't have a secondary information,
+ * x.generic is set to .u.number << 1.
+ *
+ * There is no periodic compaction of mappings. Only if deletions
+ * left more unused than used entries (or in a garbage collection), the
+ * cleanup code calls compact_mapping() to move the entries into one
+ * block of the exact size.
  *
  *
  * Mappings maintain two refcounts: the main refcount for all references,
  * and in the hash structure a protector refcount for references as
- * PROTECTED_MAPPING. The latter references are used for 'dirty' mappings
- * (ie. mappings with a hash part) which are passed fully or in part as a
- * reference to a function. As long as the protector refcount is not 0, all
- * entry deletions are not executed immediately. Instead, the 'deleted'
- * entries are kept in a separate list until all protective references
- * are removed. PROTECTED_MAPPINGs don't need to protect the condensed
- * part of a mapping as that changes only during compact_mapping()s
- * in the backend.
+ * PROTECTED_MAPPING. The latter references are used for mappings
+ * which are passed fully or in part as a reference to a function.
+ * As long as the protector refcount is not 0, entries removed from the
+ * mapping are not freed or reused immediately. Instead, the 'deleted'
+ * entries are kept in a separate list with their values intact until
+ * all protective references are removed.
  *
  *
  * -- mapping_t --
@@ -107,7 +86,6 @@
  *       int             num_values;
  *       p_int           num_entries;
  *
- *       mapping_cond_t * cond;
  *       mapping_hash_t * hash;
  *
  *       mapping_t      * next;
@@ -120,9 +98,7 @@
  *   .num_values and .num_entries give the width (excluding the key!)
  *   and number of valid entries in the mapping.
  *
- *   .cond and .hash are the condensed resp. hashed data blocks.
- *   .hash also serves as indicator if the mapping is 'dirty',
- *   and therefore contains all the information about the dirtyness.
+ *   .hash is the index structure, which also holds the entry blocks.
  *
  *   The .next pointer is not used by the mapping module itself,
  *   but is provided as courtesy for the cleanup code and the GC, to
@@ -131,56 +107,37 @@
  *   GC uses it to keep its list of stale mappings (ie. mappings with
  *   keys referencing destructed objects).
  *
- * -- mapping_cond_t --
- *
- *   mapping_cond_t {
- *       size_t    size;
- *       svalue_t *data[(mapping->num_values+1) * .size];
- *   }
- *
- *   This structure holds the .size compacted entries for a mapping (.size
- *   includes the deleted entries as well, if any).
- *
- *   The first .size svalues in .data[] are the keys. Follwing are the
- *   actual data values, the values for one entry each in one row.
- *
- *   If a key is .data[ix], its data values are in
- *   .data[.size + ix * mapping->num_values] through
- *   .data[.size + (ix+1) * mapping->num_values - 1].
- *
- *   If an entry is deleted, the key's .type is set to T_INVALID and
- *   the data values are zeroed out (and mapping->hash->cond_deleted is
- *   incremented), but the entry is otherwise left in place.
- *
  * -- mapping_hash_t --
  *
- *   hash_mapping_t {
+ *   mapping_hash_t {
  *       p_int        mask;
  *       p_int        used;
- *       p_int        cond_deleted;
+ *       p_int        deleted_slots;
  *       p_int        ref;
- *       mp_int       last_used;
- *       map_chain_t *deleted;
- *       map_chain_t *chains[ 1 +.mask ];
+ *       p_int        num_free;
+ *       p_int        fill;
+ *       p_int        capacity;
+ *       svalue_t    *free;
+ *       svalue_t    *deleted;
+ *       map_block_t *first;
+ *       map_block_t *last;
+ *       map_slot_t   slots[ 1 +.mask ];
  *   }
  *
- *   This structure keeps track of the changes to a mapping. Every mapping
- *   with a hash part is considered 'dirty'.
+ *   The index is made up by .slots[]. There are .mask+1 slots, with
+ *   .mask+1 always being a power of two. This way, .mask can be used in
+ *   a binary-& operation to convert a hash value into the index of the
+ *   first slot to probe. .used is the number of slots referencing an
+ *   entry, .deleted_slots the number of slots marked as deleted.
+ *   When the index has to grow, the whole structure is reallocated.
  *
- *   New entries to the mapping are kept in the hashtable made up by
- *   .chains[]. There are .mask+1 different chains, with .mask+1 always
- *   being a power of two. This way, .mask can be used in a binary-&
- *   operation to convert a hash value into a chain index. The number
- *   of entries in the hashtable is listed in .used.
+ *   .first and .last are the first and last of the entry blocks,
+ *   .capacity is the total number of entries in all blocks. The entries
+ *   of all blocks but the last are in use (or in the free list);
+ *   of the last block, only the first .fill entries have been used so
+ *   far.
  *
- *   The driver imposes an upper limit onto the average length of the
- *   chains: if the average length exceeds two elements, the size of
- *   the hashtable is doubled (by reallocating the hash_mapping structure).
- *   This is the reason why you can allocate a mapping with a given 'size':
- *   it reduces the number of reallocations in the long run.
- *
- *   .condensed_deleted gives the number of deleted entries in
- *   the mappings condensed_part.
+ *   .free is the list of unused entries, .num_free their number.
  *
  *   .ref and .deleted come into use when the mapping is used as
  *   protector mapping. Protector mappings are necessary whenever
@@ -192,23 +149,19 @@
  *   protection is in effect. If the .ref falls back to 0, all
  *   the pending deletions of the .deleted entries are performed.
  *
- *   .last_used holds the time (seconds since the epoch) of the last addition
- *   or removal of an entry. It is used by the compaction algorithm to
- *   determine whether the mapping should be compacted or not.
- *
- * -- map_chain_t --
+ * -- map_block_t --
  *
- *   This structure is used to keep single entries in the hash chains
- *   of hash_mapping, and occasionally, in the .deleted list of
- *   protector mappings.
- *
- *   map_chain_t {
- *       map_chain_t *next;
- *       svalue_t data[ mapping->num_values+1 ];
+ *   map_block_t {
+ *       map_block_t *next;
+ *       p_int        size;
+ *       svalue_t     data[ .size * (mapping->num_values+1) ];
  *   }
  *
- *   .next is the next struct map_chain in the hash chain (or .deleted list).
- *   .data holds the key and it's data values.
+ *   The block holds .size entries, each consisting of the key
+ *   followed by the mapping->num_values values. The key of an unused
+ *   entry (one in the free list or pending deletion) has the .type
+ *   T_INVALID, and its .u.lvalue links the entries of the list. The values
+ *   of an entry in the free list are svalue-0.
  *
  *---------------------------------------------------------------------------
  */
@@ -225,6 +178,7 @@
 #include "backend.h"
 #include "closure.h"
 #include "gcollect.h"
+#include "hash.h"
 #include "interpret.h"
 #include "main.h"
 #include "mstrings.h"
@@ -237,33 +191,35 @@
 
 #include "i-svalue_cmp.h"
 
-#define TIME_TO_COMPACT (600) /* 10 Minutes */
-   /* TODO: Make this configurable.
-    * TODO:: When doing so, also implement the shrinking of the hashtable
-    */
+#define MAP_MIN_BLOCK_SIZE (2)
+  /* Minimum number of entries in an entry block.
+   */
 
 /*-------------------------------------------------------------------------*/
 /* Types */
 
 /* The local typedefs */
-typedef struct map_chain_s    map_chain_t;
+typedef struct map_block_s    map_block_t;
 typedef struct walk_mapping_s walk_mapping_t;
 
-/* --- struct map_chain_s: one entry in a hash chain ---
- *
- * The hashed mapping entries.
+/* --- struct map_block_s: a block of mapping entries ---
  */
 
-struct map_chain_s {
-    map_chain_t * next;  /* next entry */
-    svalue_t      data[1 /* +mapping->num_values */];
-      /* [0]: the key, [1..]: the data */
+struct map_block_s {
+    map_block_t * next;  /* next (younger) block */
+    p_int         size;  /* number of entries in this block */
+    svalue_t      data[1 /* +.size * (mapping->num_values+1) - 1 */];
+      /* the entries, each the key followed by the values */
 };
 
-#define SIZEOF_MCH(mch, nv) ( \
-    sizeof(*mch) + (nv) * sizeof(svalue_t) \
-                            )
-  /* Allocation size of a map_chain_t for <nv> values per key.
+#define SIZEOF_MB(mb, nv) ( \
+    sizeof(*(mb)) + ((mb)->size * ((nv)+1) - 1) * sizeof(svalue_t) \
+                          )
+  /* Allocation size of a given map_block_t for <nv> values per key.
+   */
+
+#define BLOCK_FILL(hm, mb) ((mb) == (hm)->last ? (hm)->fill : (mb)->size)
+  /* Number of entries used so far in block <mb> of index <hm>.
    */
 
 
@@ -285,11 +241,11 @@ mp_int num_mappings = 0;
    */
 
 mp_int num_hash_mappings = 0;
-  /* Number of allocated mappings with only a hash part.
+  /* Number of allocated mappings with a hash index.
    */
 
 mp_int num_dirty_mappings = 0;
-  /* Number of allocated mappings with a hash and a condensed part.
+  /* Number of allocated mappings with unused entries in the free list.
    */
 
 mapping_t *stale_mappings;
@@ -300,6 +256,11 @@ mapping_t *stale_mappings;
    * of the GC.
    */
 
+static svalue_t deleted_slot_marker;
+#define MAP_SLOT_DELETED (&deleted_slot_marker)
+  /* The .entry of a slot whose entry has been deleted.
+   */
+
 /*-------------------------------------------------------------------------*/
 /* Forward declarations */
 
@@ -329,193 +290,238 @@ printf("DEBUG: %s: m %p user %p total %ld - %ld = %ld\n", where, (m), (m)->user,
 #endif
 
 /*-------------------------------------------------------------------------*/
-static INLINE map_chain_t *
-new_map_chain (mapping_t * m)
+static INLINE p_int
+index_size (p_int num_entries)
 
-/* Return a fresh map_chain_t for mapping <m>.
- * The .data[] values are not initialised.
- *
- * Return NULL if out of memory.
+/* Return the number of slots (a power of 2) for an index to hold
+ * <num_entries> entries without exceeding the maximum load of 3/4.
  */
 
 {
-    map_chain_t *rc;
+    p_int size = 2;
 
-    rc = xalloc(SIZEOF_MCH(rc, m->num_values));
-    if (rc)
-    {
-        LOG_ALLOC("new_map_chain", SIZEOF_MCH(rc, m->num_values), SIZEOF_MCH(rc, m->num_values));
-        m->user->mapping_total += SIZEOF_MCH(rc, m->num_values);
-    }
+    while (size * 3 < num_entries * 4)
+        size <<= 1;
 
-    return rc;
-} /* new_map_chain() */
+    return size;
+} /* index_size() */
 
 /*-------------------------------------------------------------------------*/
-static INLINE void
-free_map_chain (mapping_t * m, map_chain_t *mch, Bool no_data)
+static mapping_hash_t *
+get_new_hash (mapping_t *m, p_int size)
 
-/* Free the map_chain <mch> of mapping <m>.
- * If <no_data> is TRUE, the svalues themselves are supposed to be empty.
+/* Allocate a new hash structure for mapping <m> with an empty index
+ * of <size> slots (a power of 2) and no entry blocks. The structure
+ * is NOT linked into <m>.
+ *
+ * Return the new structure, or NULL when out of memory.
  */
 
 {
-    p_int ix;
+    mapping_hash_t *hm;
+    map_slot_t *slot;
 
-    if (!no_data)
+    /* size must not exceed the accessible indexing range. This is
+     * a possibility because size as a p_int may have a different
+     * range than array indices which are size_t.
+     */
+    if (size > (p_int)((SIZE_MAX - sizeof *hm) / sizeof *slot)
+     || !(hm = xalloc(sizeof *hm + sizeof *slot * (size - 1)) ) )
     {
-        for (ix = m->num_values; ix >= 0; ix--)
-        {
-            free_svalue(mch->data+ix);
-        }
+        return NULL;
     }
 
-    LOG_SUB("free_map_chain", SIZEOF_MCH(mch, m->num_values));
-    m->user->mapping_total -= SIZEOF_MCH(mch, m->num_values);
-    xfree(mch);
-} /* free_map_chain() */
+    hm->mask = size - 1;
+    hm->used = hm->deleted_slots = hm->ref = 0;
+    hm->num_free = hm->fill = hm->capacity = 0;
+    hm->free = hm->deleted = NULL;
+    hm->first = hm->last = NULL;
+
+    for (slot = hm->slots; size > 0; size--, slot++)
+        slot->entry = NULL;
+
+    LOG_ALLOC("get_new_hash", SIZEOF_MH(hm), SIZEOF_MH(hm));
+    m->user->mapping_total += SIZEOF_MH(hm);
+
+    return hm;
+} /* get_new_hash() */
 
 /*-------------------------------------------------------------------------*/
-static INLINE mapping_hash_t *
-get_new_hash ( mapping_t *m, mp_int hash_size)
+static Bool
+new_map_block (mapping_t *m, p_int size)
 
-/* Allocate a new hash structure for mapping <m>, prepared to take
- * <hash_size> entries. The hash structure is NOT linked into <m>.
+/* Append a new entry block for <size> entries to the hash structure of
+ * mapping <m>, making it the block to allocate new entries from.
  *
- * Return the new structure, or NULL when out of memory.
+ * Return FALSE when out of memory.
  */
-/* TODO: hash_size of mp_int seems unnecessarily large to me, because 
- * TODO::mappings can only have p_int values? */
+
 {
-    mapping_hash_t *hm;
-    map_chain_t **mcp;
-
-    /* Compute the number of hash buckets to 2**k, where
-     * k is such that 2**(k+1) > size >= 2**k.
-     *
-     * To do this, compute 'size' to (2**k)-1 by first setting
-     * all bits after the leading '1' and then shifting the
-     * number right once. The result is then also the mask
-     * required for indexing.
-     */
-    hash_size |= hash_size >> 1;
-    hash_size |= hash_size >> 2;
-    hash_size |= hash_size >> 4;
-    if (hash_size & ~0xff)
+    mapping_hash_t *hm = m->hash;
+    map_block_t *mb;
+    size_t width = (size_t)m->num_values + 1;
+
+    if ((size_t)size > (SIZE_MAX - sizeof *mb) / sizeof(svalue_t) / width
+     || !(mb = xalloc(sizeof *mb + sizeof(svalue_t) * (size * width - 1))) )
     {
-        hash_size |= hash_size >> 8;
-        hash_size |= hash_size >> 16;
+        return MY_FALSE;
     }
-    hash_size >>= 1;
 
-    /* Allocate the hash_mapping big enough to hold (size+1) hash
-     * buckets.
-     * size must not exceed the accessible indexing range. This is
-     * a possibility because size as a mp_int may have a different
-     * range than array indices which are size_t.
-     * TODO: The 0x100000 seems to be a safety offset, but is it?
-     */
-    if (hash_size > (mp_int)((SIZE_MAX - sizeof *hm - 0x100000) / sizeof *mcp)
-     || !(hm = xalloc(sizeof *hm + sizeof *mcp * hash_size) ) )
+    mb->next = NULL;
+    mb->size = size;
+
+    if (hm->last)
+        hm->last->next = mb;
+    else
+        hm->first = mb;
+    hm->last = mb;
+    hm->fill = 0;
+    hm->capacity += size;
+
+    LOG_ALLOC("new_map_block", SIZEOF_MB(mb, m->num_values), SIZEOF_MB(mb, m->num_values));
+    m->user->mapping_total += SIZEOF_MB(mb, m->num_values);
+
+    return MY_TRUE;
+} /* new_map_block() */
+
+/*-------------------------------------------------------------------------*/
+static size_t
+mapping_storage_size (mapping_t *m)
+
+/* Return the size of the hash structure and all entry blocks of <m>.
+ */
+
+{
+    mapping_hash_t *hm = m->hash;
+    map_block_t *mb;
+    size_t size;
+
+    if (!hm)
+        return 0;
+
+    size = SIZEOF_MH(hm);
+    for (mb = hm->first; mb != NULL; mb = mb->next)
+        size += SIZEOF_MB(mb, m->num_values);
+
+    return size;
+} /* mapping_storage_size() */
+
+/*-------------------------------------------------------------------------*/
+static void
+free_map_storage (mapping_t *m, Bool no_data)
+
+/* Free the hash structure and all entry blocks of mapping <m>, including
+ * all keys and values unless <no_data> is TRUE.
+ */
+
+{
+    mapping_hash_t *hm = m->hash;
+    map_block_t *mb, *next;
+    p_int num_values = m->num_values;
+
+    if (!hm)
+        return;
+
+    for (mb = hm->first; mb != NULL; mb = next)
     {
-        return NULL;
+        next = mb->next;
+
+        if (!no_data)
+        {
+            svalue_t *entry = mb->data;
+            p_int i, j;
+
+            for (i = BLOCK_FILL(hm, mb); i > 0; i--)
+            {
+                /* Values of entries pending deletion are still valid,
+                 * those of unused entries are svalue-0.
+                 */
+                if (entry->type != T_INVALID)
+                    free_svalue(entry);
+                entry++;
+                for (j = num_values; j > 0; j--)
+                    free_svalue(entry++);
+            }
+        }
+
+        LOG_SUB("free_map_storage block", SIZEOF_MB(mb, num_values));
+        m->user->mapping_total -= SIZEOF_MB(mb, num_values);
+        xfree(mb);
     }
 
-    hm->mask = hash_size;
-    hm->used = hm->cond_deleted = hm->ref = 0;
-    hm->last_used = current_time;
+    LOG_SUB("free_map_storage hash", SIZEOF_MH(hm));
+    m->user->mapping_total -= SIZEOF_MH(hm);
+    check_total_mapping_size();
 
-    /* These members don't really need a default initialisation
-     * but it's here to catch bogies.
-     */
-    hm->deleted = NULL;
+    num_hash_mappings--;
+    if (hm->num_free)
+        num_dirty_mappings--;
 
-    /* Initialise the hashbuckets (there is at least one) */
-    mcp = hm->chains;
-    do *mcp++ = NULL; while (--hash_size >= 0);
+    xfree(hm);
+    m->hash = NULL;
+} /* free_map_storage() */
 
-    LOG_ALLOC("get_new_hash", SIZEOF_MH(hm), sizeof *hm + sizeof *mcp * hm->mask);
-    m->user->mapping_total += SIZEOF_MH(hm);
+/*-------------------------------------------------------------------------*/
+static INLINE void
+release_map_entry (mapping_t *m, svalue_t *entry)
 
-    return hm;
-} /* get_new_hash() */
+/* Free the values of the unused <entry> of mapping <m> and put it into the
+ * free list. The key must already be T_INVALID.
+ */
+
+{
+    mapping_hash_t *hm = m->hash;
+    p_int i;
+    svalue_t *data;
+
+    for (i = m->num_values, data = entry+1; i > 0; i--, data++)
+    {
+        free_svalue(data);
+        put_number(data, 0);
+    }
+
+    entry->u.lvalue = hm->free;
+    hm->free = entry;
+    if (!hm->num_free++)
+        num_dirty_mappings++;
+} /* release_map_entry() */
 
 /*-------------------------------------------------------------------------*/
 static mapping_t *
-get_new_mapping ( wiz_list_t * user, mp_int num_values
-                , mp_int hash_size, mp_int cond_size)
+get_new_mapping ( wiz_list_t * user, mp_int num_values, mp_int size)
 
 /* Allocate a basic mapping with <num_values> values per key, and set it
- * up to have an initial datablock of <data_size> entries, a hash
- * suitable for <hash_size> entries, and a condensed block for <cond_size>
- * entries.
+ * up with an index and an entry block for <size> entries.
  *
  * The .user is of the mapping is set to <user>.
  *
  * Return the new mapping, or NULL when out of memory.
  */
-/* TODO: hash_size of mp_int seems unnecessarily large to me, because 
- * TODO::mappings can only have p_int values? */
+
 {
-    mapping_cond_t *cm;
-    mapping_hash_t *hm;
     mapping_t *m;
-/* DEBUG: */  size_t cm_size;
 
     /* Check if the new size is too big */
     if (num_values > 0)
     {
         if (num_values > SSIZE_MAX /* TODO: SIZET_MAX, see port.h */
          || (   num_values != 0
-             && (SSIZE_MAX - sizeof(map_chain_t)) / num_values < sizeof(svalue_t))
+             && (SSIZE_MAX - sizeof(map_block_t)) / num_values < sizeof(svalue_t))
            )
             return NULL;
     }
+    if (size > (mp_int)(SSIZE_MAX / sizeof(svalue_t)))
+        return NULL;
 
     /* Allocate the structures */
     m = xalloc(sizeof *m);
     if (!m)
         return NULL;
 
-    m->user = user; /* Already needed for statistics */
-
-    /* Set up the key block for <cond_size> entries */
-
-    cm = NULL;
-    if (cond_size > 0)
-    {
-
-        /* !DEBUG: size_t */ cm_size = (size_t)cond_size;
-        cm = xalloc(sizeof(*cm) + sizeof(svalue_t) * cm_size * (num_values+1) - 1);
-        if (!cm)
-        {
-            xfree(m);
-            return NULL;
-        }
-
-        cm->size = cm_size;
-    }
-
-    /* Set up the hash block for <hash_size> entries.
-     * Do this last because get_new_hash() modifies the statistics.
-     */
-
-    hm = NULL;
-    if (hash_size > 0)
-    {
-        hm = get_new_hash(m, hash_size);
-        if (!hm)
-        {
-            if (cm) xfree(cm);
-            xfree(m);
-            return NULL;
-        }
-    }
-
     /* Initialise the mapping */
 
-    m->cond = cm;
-    m->hash = hm;
+    m->user = user;
+    m->hash = NULL;
     m->next = NULL;
     m->num_values = num_values;
     m->num_entries = 0;
@@ -527,18 +533,26 @@ get_new_mapping ( wiz_list_t * user, mp_int num_values
     /* Statistics */
     LOG_ADD("get_new_mapping - base", sizeof *m);
     m->user->mapping_total += sizeof *m;
-    if (cm)
+    num_mappings++;
+
+    /* Set up the index and the block for <size> entries */
+    if (size > 0)
     {
-        LOG_ALLOC("get_new_mapping - cond", SIZEOF_MC(cm, num_values), sizeof(*cm) + sizeof(svalue_t) * cm_size * (num_values+1) - 1);
-        m->user->mapping_total += SIZEOF_MC(cm, num_values);
+        m->hash = get_new_hash(m, index_size(size));
+        if (!m->hash)
+        {
+            free_empty_mapping(m);
+            return NULL;
+        }
+        num_hash_mappings++;
+
+        if (!new_map_block(m, size))
+        {
+            free_empty_mapping(m);
+            return NULL;
+        }
     }
-    /* hm has already been counted */
 
-    num_mappings++;
-    if (m->cond && m->hash)
-        num_dirty_mappings++;
-    else if (m->hash)
-        num_hash_mappings++;
     check_total_mapping_size();
 
     return m;
@@ -550,23 +564,21 @@ mapping_t *
 allocate_mapping (mp_int size, mp_int num_values)
 
 /* Allocate a mapping with <num_values> values per key, and setup the
- * hash part for (initially) <size> entries. The condensed part will
- * not be allocated.
+ * index and entries for (initially) <size> entries.
  *
  * Return the new mapping, or NULL when out of memory.
  */
 
 {
-    return get_new_mapping(current_object->user, num_values, size, 0);
+    return get_new_mapping(current_object->user, num_values, size);
 } /* allocate_mapping() */
 
 /*-------------------------------------------------------------------------*/
 mapping_t *
-allocate_cond_mapping (wiz_list_t * user, mp_int size, mp_int num_values)
+allocate_user_mapping (wiz_list_t * user, mp_int size, mp_int num_values)
 
 /* Allocate for <user> a mapping with <num_values> values per key, and
- * setup the condensed part for <size> entries. The hash part will not be
- * allocated.
+ * setup the index and entries for <size> entries.
  *
  * The swapper uses this function.
  *
@@ -574,8 +586,8 @@ allocate_cond_mapping (wiz_list_t * user, mp_int size, mp_int num_values)
  */
 
 {
-    return get_new_mapping(user, num_values, 0, size);
-} /* allocate_cond_mapping() */
+    return get_new_mapping(user, num_values, size);
+} /* allocate_user_mapping() */
 
 /*-------------------------------------------------------------------------*/
 Bool
@@ -589,16 +601,10 @@ _free_mapping (mapping_t *m, Bool no_data)
  *
  * If <no_data> is TRUE, all the svalues are assumed to be freed already
  * (the swapper uses this after swapping out a mapping). The function still
- * will deallocate any map_chain entries, if existing.
- *
- * If the mapping is 'dirty' (ie. contains a hash_mapping part), it
- * is not deallocated immediately, but instead counts 1 to the empty_mapping-
- * _load (with regard to the threshold).
+ * will deallocate the index and entry blocks, if existing.
  */
 
 {
-    mapping_hash_t *hm;  /* Hashed part of <m> */
-
 #ifdef DEBUG
     if (!m)
         fatal("NULL pointer passed to free_mapping().\n");
@@ -607,15 +613,14 @@ _free_mapping (mapping_t *m, Bool no_data)
         fatal("No wizlist pointer for mapping");
 
     if (!no_data && m->ref > 0)
-        fatal("Mapping with %"PRIdPINT" refs passed to _free_mapping().\n", 
+        fatal("Mapping with %"PRIdPINT" refs passed to _free_mapping().\n",
               m->ref);
+
+    if (m->hash && m->hash->ref)
+        fatal("Ref count in freed hash mapping: %"PRIdPINT"\n", m->hash->ref);
 #endif
 
     num_mappings--;
-    if (m->cond && m->hash)
-        num_dirty_mappings--;
-    else if (m->hash)
-        num_hash_mappings--;
 
     m->ref = 0;
       /* In case of free_empty_mapping(), this is neither guaranteed nor a
@@ -623,55 +628,8 @@ _free_mapping (mapping_t *m, Bool no_data)
        * dirty list the refcount needs to be correct.
        */
 
-    /* Free the condensed data */
-    if (m->cond != NULL)
-    {
-        p_int left = m->cond->size * (m->num_values + 1);
-        svalue_t *data = &(m->cond->data[0]);
-
-        for (; !no_data && left > 0; left--, data++)
-            free_svalue(data);
-
-        LOG_SUB("free_mapping cond", SIZEOF_MC(m->cond, m->num_values));
-        m->user->mapping_total -= SIZEOF_MC(m->cond, m->num_values);
-        check_total_mapping_size();
-        xfree(m->cond);
-        m->cond = NULL;
-
-    }
-
-    /* Free the hashed data */
-    if ( NULL != (hm = m->hash) )
-    {
-        map_chain_t **mcp, *mc, *next;
-        p_int i;
-
-#ifdef DEBUG
-        if (hm->ref)
-            fatal("Ref count in freed hash mapping: %"PRIdPINT"\n", hm->ref);
-#endif
-        LOG_SUB("free_mapping hash", SIZEOF_MH(hm));
-        m->user->mapping_total -= SIZEOF_MH(hm);
-        check_total_mapping_size();
-
-        mcp = hm->chains;
-
-        /* Loop through all chains */
-
-        i = hm->mask + 1;
-        do {
-
-            /* Free this chain */
-
-            for (next = *mcp++; NULL != (mc = next); )
-            {
-                next = mc->next;
-                free_map_chain(m, mc, no_data);
-            }
-        } while (--i);
-
-        xfree(hm);
-    }
+    /* Free the index and the entries */
+    free_map_storage(m, no_data);
 
     /* Free the base structure.
      */
@@ -679,11 +637,26 @@ _free_mapping (mapping_t *m, Bool no_data)
     LOG_SUB("free_mapping base", sizeof(*m));
     m->user->mapping_total -= sizeof(*m);
     check_total_mapping_size();
+    forget_cycle_root(m);
     xfree(m);
 
     return MY_TRUE;
 } /* _free_mapping() */
 
+/*-------------------------------------------------------------------------*/
+void
+clear_mapping (mapping_t *m)
+
+/* Remove all entries from mapping <m>, which must not be walked
+ * at the moment. This is used by the cycle collector to break up
+ * cyclic garbage.
+ */
+
+{
+    free_map_storage(m, MY_FALSE);
+    m->num_entries = 0;
+} /* clear_mapping() */
+
 /*-------------------------------------------------------------------------*/
 static INLINE mp_int
 mhash (svalue_t * svp)
@@ -691,16 +664,20 @@ mhash (svalue_t * svp)
 /* Compute and return the hash value for svalue *<svp>.
  * The function requires that x.generic is valid even for types without
  * a secondary type information.
+ *
+ * Strings use their (seeded) string hash. All other values are mixed
+ * together with the hash seed, so that neither keys differing in only
+ * a few bits (like aligned pointers) nor crafted numbers pile up in
+ * one region of the linearly probed hash table.
  */
 
 {
-    mp_int i;
+    p_int i;
 
     switch (svp->type)
     {
     case T_STRING:
-        i = mstr_get_hash(svp->u.str);
-        break;
+        return mstr_get_hash(svp->u.str);
 
     case T_CLOSURE:
         if (CLOSURE_REFERENCES_CODE(svp->x.closure_type))
@@ -729,152 +706,266 @@ mhash (svalue_t * svp)
         break;
     }
 
-    i = i ^ i >> 16;
-    i = i ^ i >> 8;
-
-    return i;
+#if SIZEOF_PINT > 4
+    return hash6432shift((uint64_t)i ^ hash_seed);
+#else
+    return hash32shiftmult((uint32_t)i ^ (uint32_t)hash_seed);
+#endif
 } /* mhash() */
 
 /*-------------------------------------------------------------------------*/
-static svalue_t *
-find_map_entry ( mapping_t *m, svalue_t *map_index
-               , p_int * pKeys, map_chain_t ** ppChain
-               , Bool bMakeTabled
-               )
+static INLINE map_slot_t *
+find_map_slot (mapping_hash_t *hm, svalue_t *key, mp_int hash)
 
-/* Index mapping <m> with key value <map_index> and if found, return a pointer
- * to the entry block for this key (ie. the result pointer will point to
- * the stored key value).
- * If the key was found in the condensed data, *<pKeys> will be set
- * to key index; otherwise *<ppChain> will point to the hash map chain entry.
- * The 'not found' values for the two variables are -1 and NULL resp.
- *
- * If <bMakeTabled> is TRUE and <map_index> is a string, it is made tabled.
- *
- * If the key is not found, NULL is returned.
- *
- * Sideeffect: <map_index>.x.generic information is generated for types
- *   which usually have none (required for hashing) and keys referencing
- *   destructed objects are replaced by const0.
+/* Search the index <hm> for the entry with <key> (with the hash value
+ * <hash>) and return the slot referencing it, or NULL if not found.
  */
 
 {
-    *pKeys = -1;
-    *ppChain = NULL;
+    p_int ix;
 
-    /* If the key is a string, make it tabled */
-    if (map_index->type == T_STRING && !mstr_tabled(map_index->u.str)
-     && bMakeTabled)
+    for (ix = hash & hm->mask; ; ix = (ix + 1) & hm->mask)
     {
-        map_index->u.str = make_tabled(map_index->u.str);
-    }
-
-    /* Check if it's a destructed object.
-     */
-    if (destructed_object_ref(map_index))
-        assign_svalue(map_index, &const0);
+        map_slot_t *slot = &(hm->slots[ix]);
 
-    /* Generate secondary information for types which usually
-     * have none (required for hashing).
-     */
-    if (map_index->type != T_CLOSURE
-     && map_index->type != T_FLOAT
-     && map_index->type != T_SYMBOL
-     && map_index->type != T_QUOTED_ARRAY
-     && map_index->type != T_LVALUE
-       )
-        map_index->x.generic = (short)(map_index->u.number << 1);
+        if (slot->entry == NULL)
+            return NULL;
 
-    /* Search in the condensed part first.
-     */
+        if (slot->hash == hash
+         && slot->entry != MAP_SLOT_DELETED
+         && !svalue_eq(slot->entry, key))
+            return slot;
+    }
 
-    if (m->cond && m->cond->size != 0)
-    {
-        mapping_cond_t *cm = m->cond;
-        mp_int size = cm->size;
-        svalue_t *key, * keystart, * keyend;
+    /* NOTREACHED: there is always an unused slot */
+} /* find_map_slot() */
 
-        keystart = &cm->data[0];
-        keyend = keystart + size;
+/*-------------------------------------------------------------------------*/
+static INLINE void
+enter_map_slot (mapping_hash_t *hm, svalue_t *entry, mp_int hash)
 
-        /* Skip eventual deleted entries at start or end */
-        while (size > 0 && keystart->type == T_INVALID)
-        {
-            keystart++;
-            size--;
-        }
+/* Enter <entry> with the hash value <hash> into the index <hm>, which
+ * must have an unused slot left.
+ */
 
-        while (size > 0 && keyend[-1].type == T_INVALID)
-        {
-            keyend--;
-            size--;
-        }
+{
+    p_int ix;
 
-        while (keyend > keystart)
-        {
-            int cmp;
+    for ( ix = hash & hm->mask
+        ; hm->slots[ix].entry != NULL && hm->slots[ix].entry != MAP_SLOT_DELETED
+        ; ix = (ix + 1) & hm->mask)
+        NOOP;
 
-            key = (keyend - keystart) / 2 + keystart;
+    if (hm->slots[ix].entry == MAP_SLOT_DELETED)
+        hm->deleted_slots--;
+    hm->slots[ix].hash = hash;
+    hm->slots[ix].entry = entry;
+    hm->used++;
+} /* enter_map_slot() */
 
-            while (key > keystart && key->type == T_INVALID)
-                key--;
+/*-------------------------------------------------------------------------*/
+static Bool
+rebuild_index (mapping_t *m, p_int size)
 
-            cmp = svalue_cmp(map_index, key);
+/* Replace the index of mapping <m> by one with <size> slots (a power of 2),
+ * dropping all deleted slots on the way. The entry blocks are taken over
+ * unchanged.
+ *
+ * Return FALSE when out of memory.
+ */
 
-            if (cmp == 0)
-            {
-                /* Found it */
-                *pKeys = (p_int)(key - &(cm->data[0]));
-                return key;
-            }
+{
+    mapping_hash_t *hm, *hm2;
+    map_slot_t *slot;
+    p_int i;
 
-            if (cmp > 0)
-            {
-                /* The map_index value is after key */
-                for ( keystart = key+1
-                    ; keystart < keyend && keystart->type == T_INVALID
-                    ; keystart++)
-                  NOOP;
-            }
-            else
-            {
-                /* The map_index value is before key */
-                for ( keyend = key
-                    ; keystart < keyend && keyend[-1].type == T_INVALID
-                    ; keyend--)
-                  NOOP;
-            }
-        }
-    }
+    hm2 = m->hash;
+    hm = get_new_hash(m, size);
+    if (!hm)
+        return MY_FALSE;
 
-    /* At this point, the key was not found in the condensed index
-     * of the mapping. Try the hashed index next.
-     */
+    /* Take over everything but the slots */
+    hm->ref = hm2->ref;
+    hm->num_free = hm2->num_free;
+    hm->fill = hm2->fill;
+    hm->capacity = hm2->capacity;
+    hm->free = hm2->free;
+    hm->deleted = hm2->deleted;
+    hm->first = hm2->first;
+    hm->last = hm2->last;
 
-    if (m->hash && m->hash->used)
+    /* Reenter the entries with their known hash values */
+    for (i = hm2->mask + 1, slot = hm2->slots; i > 0; i--, slot++)
     {
-        mapping_hash_t *hm = m->hash;
-        map_chain_t *mc;
-
-        mp_int idx = mhash(map_index) & hm->mask;
-
-        /* Look for the value in the chain determined by index */
-
-        for (mc = hm->chains[idx]; mc != NULL; mc = mc->next)
-        {
-            if (!svalue_eq(&(mc->data[0]), map_index))
-            {
-                /* Found it */
-                *ppChain = mc;
-                return &(mc->data[0]);
-            }
-        }
+        if (slot->entry != NULL && slot->entry != MAP_SLOT_DELETED)
+            enter_map_slot(hm, slot->entry, slot->hash);
     }
 
-    /* Not found at all */
+    m->hash = hm;
 
-    return NULL;
-} /* find_map_entry() */
+    LOG_SUB("rebuild_index", SIZEOF_MH(hm2));
+    m->user->mapping_total -= SIZEOF_MH(hm2);
+    check_total_mapping_size();
+    xfree(hm2);
+
+    return MY_TRUE;
+} /* rebuild_index() */
+
+/*-------------------------------------------------------------------------*/
+static svalue_t *
+new_map_entry (mapping_t *m, mp_int hash)
+
+/* Allocate a new entry in mapping <m> and enter it with the hash value
+ * <hash> into the index, creating or growing the index as necessary.
+ * The entry is counted in m->num_entries, but neither the key nor the
+ * values are initialised: that is the job of the caller.
+ *
+ * Return a pointer to the entry, or NULL when out of memory.
+ */
+
+{
+    mapping_hash_t *hm;
+    svalue_t *entry;
+
+    /* Create the index if necessary, resp. make sure it has room
+     * for one more entry.
+     */
+    if ( !(hm = m->hash) )
+    {
+        hm = get_new_hash(m, index_size(1));
+        if (!hm)
+            return NULL;
+        m->hash = hm;
+        num_hash_mappings++;
+    }
+    else if ((hm->used + hm->deleted_slots + 1) * 4 > (hm->mask + 1) * 3)
+    {
+        /* The new size is chosen so that the index is half full
+         * afterwards. If most of the slots were deleted ones, that
+         * might even shrink the index.
+         */
+        p_int num = hm->used + 1;
+
+        if (!rebuild_index(m, index_size(num + num / 2)))
+            return NULL;
+        hm = m->hash;
+    }
+
+    /* Get the entry from the free list or from the last block,
+     * which is replaced by a new one if it is full.
+     */
+    if (hm->free)
+    {
+        entry = hm->free;
+        hm->free = entry->u.lvalue;
+        if (!--hm->num_free)
+            num_dirty_mappings--;
+    }
+    else
+    {
+        if (!hm->last || hm->fill == hm->last->size)
+        {
+            p_int size = hm->capacity;
+
+            if (size < MAP_MIN_BLOCK_SIZE)
+                size = MAP_MIN_BLOCK_SIZE;
+            if (!new_map_block(m, size))
+                return NULL;
+        }
+
+        entry = hm->last->data + hm->fill * (m->num_values + 1);
+        hm->fill++;
+    }
+
+    enter_map_slot(hm, entry, hash);
+    m->num_entries++;
+
+    return entry;
+} /* new_map_entry() */
+
+/*-------------------------------------------------------------------------*/
+static void
+remove_map_slot (mapping_t *m, map_slot_t *slot)
+
+/* Remove the entry referenced by the index <slot> from mapping <m>.
+ *
+ * If the mapping is a protector mapping, the entry is put into the
+ * 'deleted' list with its values, else the values are freed and the entry
+ * is put into the free list.
+ */
+
+{
+    mapping_hash_t *hm = m->hash;
+    svalue_t *entry = slot->entry;
+
+    slot->entry = MAP_SLOT_DELETED;
+    hm->used--;
+    hm->deleted_slots++;
+    m->num_entries--;
+
+    free_svalue(entry);
+    entry->type = T_INVALID;
+
+    if (hm->ref)
+    {
+        entry->u.lvalue = hm->deleted;
+        hm->deleted = entry;
+    }
+    else
+        release_map_entry(m, entry);
+} /* remove_map_slot() */
+
+/*-------------------------------------------------------------------------*/
+static map_slot_t *
+find_map_entry ( mapping_t *m, svalue_t *map_index, mp_int *pHash
+               , Bool bMakeTabled
+               )
+
+/* Index mapping <m> with key value <map_index> and if found, return
+ * the index slot of the entry for this key (ie. the slot's .entry will
+ * point to the stored key value). The hash value of <map_index> is stored
+ * in *<pHash> in any case.
+ *
+ * If <bMakeTabled> is TRUE and <map_index> is a string, it is made tabled.
+ *
+ * If the key is not found, NULL is returned.
+ *
+ * Sideeffect: <map_index>.x.generic information is generated for types
+ *   which usually have none (required for hashing) and keys referencing
+ *   destructed objects are replaced by const0.
+ */
+
+{
+    /* If the key is a string, make it tabled */
+    if (map_index->type == T_STRING && !mstr_tabled(map_index->u.str)
+     && bMakeTabled)
+    {
+        map_index->u.str = make_tabled(map_index->u.str);
+    }
+
+    /* Check if it's a destructed object.
+     */
+    if (destructed_object_ref(map_index))
+        assign_svalue(map_index, &const0);
+
+    /* Generate secondary information for types which usually
+     * have none (required for hashing).
+     */
+    if (map_index->type != T_CLOSURE
+     && map_index->type != T_FLOAT
+     && map_index->type != T_SYMBOL
+     && map_index->type != T_QUOTED_ARRAY
+     && map_index->type != T_LVALUE
+       )
+        map_index->x.generic = (short)(map_index->u.number << 1);
+
+    *pHash = mhash(map_index);
+
+    if (!m->hash || !m->hash->used)
+        return NULL;
+
+    return find_map_slot(m->hash, map_index, *pHash);
+} /* find_map_entry() */
 
 /*-------------------------------------------------------------------------*/
 svalue_t *
@@ -907,10 +998,10 @@ _get_map_lvalue (mapping_t *m, svalue_t *map_index
  */
 
 {
-    map_chain_t    * mc;
-    mapping_hash_t * hm;
+    map_slot_t     * slot;
     svalue_t       * entry;
-    mp_int           idx;
+    mp_int           hash;
+    p_int            i;
     svalue_t         real_index;
 
 static svalue_t local_const0;
@@ -920,20 +1011,17 @@ static svalue_t local_const0;
 
     assign_rvalue_no_free(&real_index, map_index);
 
-    entry = find_map_entry(m, &real_index, (p_int *)&idx, &mc, need_lvalue);
+    slot = find_map_entry(m, &real_index, &hash, need_lvalue);
 
     /* If we found the entry, return the values */
-    if (entry != NULL)
+    if (slot != NULL)
     {
         free_svalue(&real_index);
 
         if (!m->num_values)
             return &const1;
 
-        if (mc != NULL)
-            return entry+1;
-
-        return COND_DATA(m->cond, idx, m->num_values);
+        return slot->entry+1;
     }
 
     if (!need_lvalue)
@@ -943,8 +1031,7 @@ static svalue_t local_const0;
     }
 
     /* We didn't find key and the caller wants the data.
-     * So create a new entry and enter it into the hash index (also
-     * created if necessary).
+     * So create a new entry and enter it into the index.
      */
 
     /* Size limit exceeded? */
@@ -976,130 +1063,22 @@ static svalue_t local_const0;
         }
     }
 
-    /* Get the new entry svalues, but don't assign the key value
-     * yet - further steps might still fail.
-     */
-    mc = new_map_chain(m);
-    if (NULL == mc)
+    entry = new_map_entry(m, hash);
+    if (NULL == entry)
     {
         free_svalue(&real_index);
         return NULL;
     }
 
-    /* If the mapping has no hashed index, create one with just one
-     * chain and put the new entry in there.
+    /* With the new entry in the index, we can copy the key value
+     * into it.
      */
-
-    if ( !(hm = m->hash) )
-    {
-        /* Create the hash part of the mapping and put
-         * it into the dirty list.
-         */
-
-        hm = get_new_hash(m, 1);
-        if (!hm)
-        {
-            free_svalue(&real_index);
-            free_map_chain(m, mc, MY_TRUE);
-            return NULL; /* Oops */
-        }
-        m->hash = hm;
-
-        /* Now insert the map_chain structure into its chain */
-        hm->chains[0] = mc;
-        mc->next = NULL;
-
-        if (m->cond)
-            num_dirty_mappings++;
-        else
-            num_hash_mappings++;
-    }
-    else
-    {
-
-        /* The hashed index exists, so we can insert the new entry there.
-         *
-         * However, if the average number of map_chains per chain exceeds 2,
-         * double the size of the bucket array first.
-         */
-        if (hm->used & ~hm->mask<<1)
-        {
-            mapping_hash_t *hm2;
-            mp_int size, mask, j;
-            map_chain_t **mcp, **mcp2, *next;
-
-            hm2 = hm;
-
-            /* Compute new size and mask, and allocate the structure */
-
-            size = (hm->mask << 1) + 2;
-            mask = size - 1;
-
-            hm = xalloc(sizeof *hm - sizeof *mcp + sizeof *mcp * size);
-            if (!hm)
-            {
-                free_svalue(&real_index);
-                free_map_chain(m, mc, MY_TRUE);
-                return NULL;
-            }
-
-            /* Initialise the new structure except for the chains */
-
-            *hm = *hm2;
-            hm->mask = mask;
-            mcp = hm->chains;
-            do *mcp++ = NULL; while (--size);
-
-            /* Copy the old chains into the new buckets by rehashing
-             * them.
-             */
-            mcp = hm->chains;
-            mcp2 = hm2->chains;
-            for (j = hm2->mask + 1; --j >= 0; )
-            {
-                map_chain_t *mc2;
-
-                for (mc2 = *mcp2++; mc2; mc2 = next)
-                {
-                    next = mc2->next;
-                    idx = mhash(&(mc2->data[0])) & mask;
-                    mc2->next = mcp[idx];
-                    mcp[idx] = mc2;
-                }
-            }
-            m->hash = hm;
-
-            LOG_ALLOC("get_map_lvalue - existing hash", SIZEOF_MH(hm) - SIZEOF_MH(hm2), sizeof *hm - sizeof *mcp + sizeof *mcp * size);
-            m->user->mapping_total += SIZEOF_MH(hm) - SIZEOF_MH(hm2);
-            check_total_mapping_size();
-
-            /* Away, old data! */
-
-            xfree(hm2);
-        }
-
-        /* Finally, insert the new entry into its chain */
-
-        idx = mhash(&real_index) & hm->mask;
-        mc->next = hm->chains[idx];
-        hm->chains[idx] = mc;
-    }
-
-    /* With the new map_chain structure inserted, we can adjust
-     * the statistics and copy the key value into the structure.
-     */
-
-    transfer_svalue_no_free(&(mc->data[0]), &real_index);
-    for (idx = m->num_values, entry = &(mc->data[1]); idx > 0
-        ; idx--, entry++)
-        put_number(entry, 0);
-
-    hm->last_used = current_time;
-    hm->used++;
-    m->num_entries++;
+    transfer_svalue_no_free(entry, &real_index);
+    for (i = m->num_values; i > 0; i--)
+        put_number(entry+i, 0);
 
     if (m->num_values)
-        return &(mc->data[1]);
+        return entry+1;
 
     /* Return a reference to the local static svalue-0 instance, so that
      * buggy code doesn't accidentally changes the global const0.
@@ -1108,6 +1087,40 @@ static svalue_t local_const0;
     return &local_const0;
 } /* _get_map_lvalue() */
 
+/*-------------------------------------------------------------------------*/
+svalue_t *
+add_new_map_entry (mapping_t *m, svalue_t *key)
+
+/* Add an entry for <key> to mapping <m> and return a pointer to its
+ * values (which are set to svalue-0). The key svalue is moved into the
+ * mapping as it is, without adding a reference.
+ *
+ * The key must not be in <m> yet, and must already have the form used
+ * for keys (ie. tabled strings and x.generic generated for types without
+ * secondary information) - as have keys taken from another mapping.
+ * No size limits are checked.
+ *
+ * The swapper uses this function to restore mappings during a
+ * garbage collection, where no refcounts may be touched.
+ *
+ * Return NULL when out of memory.
+ */
+
+{
+    svalue_t *entry;
+    p_int i;
+
+    entry = new_map_entry(m, mhash(key));
+    if (NULL == entry)
+        return NULL;
+
+    *entry = *key;
+    for (i = m->num_values; i > 0; i--)
+        put_number(entry+i, 0);
+
+    return entry+1;
+} /* add_new_map_entry() */
+
 /*-------------------------------------------------------------------------*/
 Bool
 mapping_references_objects (mapping_t *m)
@@ -1121,48 +1134,21 @@ mapping_references_objects (mapping_t *m)
  */
 
 {
-    mapping_cond_t *cm;
     mapping_hash_t *hm;
+    map_slot_t *slot;
+    p_int i;
 
-    /* Scan the condensed part for object references used as keys.
-     */
-
-    if (NULL != (cm = m->cond))
-    {
-        size_t ix;
-        svalue_t * entry;
-
-        for (ix = 0, entry = &(cm->data[0]); ix < cm->size; ++ix, ++entry)
-        {
-            if (T_OBJECT == entry->type || T_CLOSURE == entry->type)
-                return MY_TRUE;
-        } /* for (all keys) */
-
-    } /* if (m->cond) */
-
-    /* If it exists, scan the hash part for object references.
-     */
+    if ( NULL == (hm = m->hash) )
+        return MY_FALSE;
 
-    if ( NULL != (hm = m->hash) )
+    for (i = hm->mask + 1, slot = hm->slots; i > 0; i--, slot++)
     {
-        map_chain_t **mcp, *mc;
-        p_int i;
-
-        /* Walk all chains */
+        svalue_t * entry = slot->entry;
 
-        for (mcp = hm->chains, i = hm->mask + 1; --i >= 0;)
-        {
-            /* Walk this chain */
-
-            for (mc = *mcp++; NULL != mc; mc = mc->next)
-            {
-                svalue_t * entry = &(mc->data[0]);
-
-                if (T_OBJECT == entry->type || T_CLOSURE == entry->type)
-                    return MY_TRUE;
-            } /* walk this chain */
-        } /* walk all chains */
-    } /* if (hash part exists) */
+        if (entry != NULL && entry != MAP_SLOT_DELETED
+         && (T_OBJECT == entry->type || T_CLOSURE == entry->type))
+            return MY_TRUE;
+    }
 
     return MY_FALSE;
 } /* mapping_references_objects() */
@@ -1176,119 +1162,28 @@ check_map_for_destr_keys (mapping_t *m)
  */
 
 {
-    p_int             num_values;
-    mapping_cond_t *cm;
     mapping_hash_t *hm;
+    p_int i;
 
     // If no object was destructed since the last check, there can't be a
     // key referencing a destructed object in the mapping.
     if (m->last_destr_check == destructed_ob_counter)
         return;
-    
-    num_values = m->num_values;
-    
-    /* Scan the condensed part for destructed object references used as keys.
-     */
-    if (NULL != (cm = m->cond))
-    {
-        size_t ix;
-        svalue_t * entry;
-        
-        /* Scan the keys */
-        for (ix = 0, entry = &(cm->data[0]); ix < cm->size; ++ix, ++entry)
-        {
-            if (T_INVALID == entry->type)
-                continue;
-            
-            if (destructed_object_ref(entry))
-            {
-                p_int i;
-                svalue_t * data = COND_DATA(cm, ix, num_values);
-                
-                /* Destructed key: remove the whole entry */
-                m->num_entries--;
-                
-                free_svalue(entry);
-                entry->type = T_INVALID;
-                
-                for (i = num_values; i > 0; --i, data++)
-                {
-                    free_svalue(data);
-                    put_number(data, 0);
-                }
-                
-                /* Count the deleted entry in the hash part.
-                 * Create it if necessary.
-                 */
-                if ( !(hm = m->hash) )
-                {
-                    hm = get_new_hash(m, 0);
-                    if (!hm)
-                    {
-                        outofmem(sizeof *hm, "hash mapping");
-                        /* NOTREACHED */
-                        return;
-                    }
-                    m->hash = hm;
-                    num_dirty_mappings++;
-                }
-                
-                hm->cond_deleted++;
-                
-                continue;
-            }
-        } /* for (all keys) */
-        
-    } /* if (m->cond) */
-    
-    /* If it exists, scan the hash part for destructed objects.
-     */
-    
+
     if ( NULL != (hm = m->hash) )
     {
-        map_chain_t **mcp, **mcp2, *mc;
-        p_int i;
-        
-        /* Walk all chains */
-        
-        for (mcp = hm->chains, i = hm->mask + 1; --i >= 0;)
+        /* Walk all slots. Removing an entry only marks its slot
+         * as deleted, so the index stays the same.
+         */
+        for (i = 0; i <= hm->mask; i++)
         {
-            /* Walk this chain */
-            
-            for (mcp2 = mcp++; NULL != (mc = *mcp2); )
-            {
-                /* Destructed object as key: remove entry */
-                
-                svalue_t * entry = &(mc->data[0]);
-                
-                if (destructed_object_ref(entry))
-                {
-                    m->num_entries--;
-                    
-                    *mcp2 = mc->next;
-                    
-                    /* If the mapping is a protector mapping, move
-                     * the entry into the 'deleted' list, else
-                     * just deallocate it.
-                     */
-                    if (hm->ref)
-                    {
-                        mc->next = hm->deleted;
-                        hm->deleted = mc;
-                    }
-                    else
-                    {
-                        free_map_chain(m, mc, MY_FALSE);
-                    }
-                    hm->used--;
-                    continue;
-                }
+            map_slot_t *slot = &(hm->slots[i]);
 
-                mcp2 = &mc->next;
-                
-            } /* walk this chain */
-        } /* walk all chains */
-    } /* if (hash part exists) */
+            if (slot->entry != NULL && slot->entry != MAP_SLOT_DELETED
+             && destructed_object_ref(slot->entry))
+                remove_map_slot(m, slot);
+        }
+    }
 
     // finally, record the current counter of destructed objects.
     m->last_destr_check = destructed_ob_counter;
@@ -1304,64 +1199,35 @@ check_map_for_destr_values (mapping_t *m)
  */
 
 {
-    p_int             num_values;
-    mapping_cond_t *cm;
     mapping_hash_t *hm;
-        
+    map_block_t *mb;
+    p_int num_values;
+
+    if ( NULL == (hm = m->hash) )
+        return;
+
     num_values = m->num_values;
-    
-    /* Scan the condensed part for destructed object references in values
+
+    /* Scan the values of all entries in the blocks. The values of
+     * unused entries are svalue-0, those of entries pending deletion
+     * don't hurt to check.
      */
-    if (NULL != (cm = m->cond))
+    for (mb = hm->first; mb != NULL; mb = mb->next)
     {
-        size_t ix;
-        svalue_t * entry;
-                
-        /* Scan the values */
-        for ( ix = 0, entry = &(cm->data[cm->size])
-             ; ix < num_values * cm->size; ++ix, ++entry)
-        {
-            if (destructed_object_ref(entry))
-            {
-                assign_svalue(entry, &const0);
-            }
-        } /* for (all values) */
-    } /* if (m->cond) */
-    
-    /* If it exists, scan the hash part for destructed objects.
-     */
-    
-    if ( NULL != (hm = m->hash) )
-    {
-        map_chain_t **mcp, **mcp2, *mc;
+        svalue_t * entry = mb->data;
         p_int i, j;
-        
-        /* Walk all chains */
-        
-        for (mcp = hm->chains, i = hm->mask + 1; --i >= 0;)
+
+        for (i = BLOCK_FILL(hm, mb); i > 0; i--)
         {
-            /* Walk this chain */
-            
-            for (mcp2 = mcp++; NULL != (mc = *mcp2); )
+            for (++entry, j = num_values; j > 0; --j, ++entry)
             {
-
-                svalue_t * entry = &(mc->data[0]); // this is the key
-                                
-                /* Scan the values of this entry */
-                for (++entry, j = num_values; j > 0; --j, ++entry)
+                if (destructed_object_ref(entry))
                 {
-                    if (destructed_object_ref(entry))
-                    {
-                        assign_svalue(entry, &const0);
-                    }
+                    assign_svalue(entry, &const0);
                 }
-                
-                mcp2 = &mc->next;
-                
-            } /* walk this chain */
-        } /* walk all chains */
-    } /* if (hash part exists) */
-        
+            }
+        }
+    }
 } /* check_map_for_destr_values() */
 
 /*-------------------------------------------------------------------------*/
@@ -1395,106 +1261,16 @@ remove_mapping (mapping_t *m, svalue_t *map_index)
  */
 
 {
-    p_int            key_ix;
-    svalue_t       * entry;
-    map_chain_t    * mc;
-    mapping_hash_t * hm;
-    p_int            num_values;
-    svalue_t         real_index;
-
-    num_values = m->num_values;
+    map_slot_t * slot;
+    mp_int       hash;
+    svalue_t     real_index;
 
     assign_rvalue_no_free(&real_index, map_index);
-    entry = find_map_entry(m, &real_index, &key_ix, &mc, MY_FALSE);
+    slot = find_map_entry(m, &real_index, &hash, MY_FALSE);
     free_svalue(&real_index);
 
-    if (NULL != entry)
-    {
-        /* The entry exists - now remove it */
-
-        m->num_entries--;
-
-        if (key_ix >= 0)
-        {
-            /* The entry is in the condensed part */
-            p_int i;
-
-            free_svalue(entry); entry->type = T_INVALID;
-            entry = COND_DATA(m->cond, key_ix, num_values);
-            for (i = num_values; i > 0; i--, entry++)
-            {
-                free_svalue(entry);
-                put_number(entry, 0);
-            }
-
-            /* Count the deleted entry in the hash part.
-             * Create it if necessary.
-             */
-            if ( !(hm = m->hash) )
-            {
-                hm = get_new_hash(m, 0);
-                if (!hm)
-                {
-                    outofmem(sizeof *hm, "hash mapping");
-                    /* NOTREACHED */
-                    return;
-                }
-                m->hash = hm;
-
-                if (m->cond)
-                    num_dirty_mappings++;
-                else
-                    num_hash_mappings++;
-            }
-
-            hm->last_used = current_time;
-            hm->cond_deleted++;
-        }
-        else if (mc != NULL && NULL != (hm = m->hash))
-        {
-            /* The key is in the hash mapping */
-
-            map_chain_t *prev, *mc2;
-            mp_int idx = mhash(entry) & hm->mask;
-
-            for ( prev = 0, mc2 = hm->chains[idx]
-                ; mc2 != NULL && mc2 != mc
-                ; prev = mc2, mc2 = mc2->next)
-                NOOP;
-
-            if (mc2 == NULL)
-                fatal("Mapping entry didn't hash to the same spot.\n");
-
-            /* Unlink the found entry */
-            if (prev)
-                prev->next = mc->next;
-            else
-                hm->chains[idx] = mc->next;
-
-            /* If the mapping is a protector mapping, move
-             * the entry into the 'deleted' list, else
-             * just deallocate it.
-             */
-            if (hm->ref)
-            {
-                mc->next = hm->deleted;
-                hm->deleted = mc;
-            }
-            else
-            {
-                free_map_chain(m, mc, MY_FALSE);
-            }
-
-            hm->last_used = current_time;
-            hm->used--;
-            /* TODO: Reduce the size of the hashtable if the average
-             * TODO:: number of entries per chain is <= 1 (or better <= 0.5
-             * TODO:: to provide some breathing space for new entries).
-             */
-        }
-        else
-            fatal("Mapping entry found in neither condensed nor hash index.\n");
-    }
+    if (NULL != slot)
+        remove_map_slot(m, slot);
     /* else the entry wasn't found */
 
 } /* remove_mapping() */
@@ -1513,10 +1289,9 @@ resize_mapping (mapping_t *m, mp_int new_width)
 
 {
     mapping_t      * m2;
-    mapping_hash_t * hm, *hm2 = NULL;
-    mapping_cond_t * cm, *cm2 = NULL;
+    mapping_hash_t * hm;
+    map_block_t    * mb;
     mp_int common_width;  /* == min(num_values, new_width) */
-    p_int  num_entries;
 
     /* Set the width variables */
     if (m->num_values >= new_width)
@@ -1533,7 +1308,7 @@ resize_mapping (mapping_t *m, mp_int new_width)
     {
         if (new_width > SSIZE_MAX /* TODO: SIZET_MAX, see port.h */
          || (   new_width != 0
-             && (SSIZE_MAX - sizeof(map_chain_t)) / new_width < sizeof(svalue_t))
+             && (SSIZE_MAX - sizeof(map_block_t)) / new_width < sizeof(svalue_t))
            )
         {
             errorf("Mapping width too big (%"PRIdMPINT")\n", new_width);
@@ -1542,174 +1317,56 @@ resize_mapping (mapping_t *m, mp_int new_width)
         }
 
     }
-    
-    num_entries = m->num_entries;
 
-    /* Get the target mapping without a hash, but with a condensed block
-     * big enough to hold all entries.
+    /* Get the target mapping with room for all entries.
      */
+    m2 = get_new_mapping(current_object->user, new_width, m->num_entries);
+    if (!m2)
     {
-        p_int cm_size = 0;
-        if (m->cond)
-        {
-            cm_size = m->cond->size;
-            if (m->hash)
-                cm_size -= m->hash->cond_deleted;
-        }
-        m2 = get_new_mapping(current_object->user, new_width, 0, cm_size);
-        if (!m2)
-        {
-            outofmem(sizeof *m2 + (mp_int)sizeof(svalue_t) * m->num_entries * new_width
-                    , "result mapping base structure");
-            /* NOTREACHED */
-            return NULL;
-        }
+        outofmem(sizeof *m2 + (mp_int)sizeof(svalue_t) * m->num_entries * new_width
+                , "result mapping base structure");
+        /* NOTREACHED */
+        return NULL;
     }
 
-    /* --- Copy the hash part, if existent ---
-     */
+    if ( NULL == (hm = m->hash) )
+        return m2;
 
-    if ( NULL != (hm = m->hash) )
+    /* Copy the entries in the order of the blocks, so that the copy
+     * is iterated in the same order as the original.
+     */
+    for (mb = hm->first; mb != NULL; mb = mb->next)
     {
-        map_chain_t **mcp, **mcp2;
-        mp_int size;
-
-        /* Allocate and initialize the hash structure */
+        svalue_t *src = mb->data;
+        p_int ix;
 
-        size = hm->mask + 1;
-        hm2 = xalloc(sizeof *hm - sizeof *mcp + sizeof *mcp * size);
-        if (!hm2)
+        for (ix = BLOCK_FILL(hm, mb); ix > 0; ix--, src += m->num_values + 1)
         {
-            outofmem(sizeof *hm - sizeof *mcp + sizeof *mcp * size, "hash structure");
-            /* NOTREACHED */
-            return NULL;
-        }
-
-        hm2->mask = hm->mask;
-        hm2->used = hm->used;
-        hm2->last_used = current_time;
-        hm2->cond_deleted = 0;
-        hm2->deleted = NULL;
-        hm2->ref = 0;
-
-        /* Now copy the hash chains */
-
-        mcp = hm->chains;
-        mcp2 = hm2->chains;
-        do {
-            map_chain_t *last = NULL, *mc, *mc2;
-
-            for (mc = *mcp++; mc; mc = mc->next)
-                if(destructed_object_ref(&(mc->data[0])))
-                {
-                    --num_entries;
-                    --hm2->used;
-                }
-                else
-                {
-                    svalue_t *src, *dest;
-                    p_int i;
-
-                    mc2 = new_map_chain(m2);
-                    if (!mc2)
-                    {
-                        xfree(hm2);
-                        outofmem(SIZEOF_MCH(mc, new_width), "hash link");
-                        /* NOTREACHED */
-                        return NULL;
-                    }
-
-                    /* Copy the key and the common values */
-                    for (src = &(mc->data[0]), dest = &(mc2->data[0]), i = common_width
-                        ; i >= 0
-                        ; --i, src++, dest++)
-                    {
-                        assign_svalue_no_free(dest, src);
-                    }
-
-                    /* Zero out any extraneous values */
-                    for (dest = &(mc2->data[common_width+1]), i = new_width - common_width
-                        ; i > 0
-                        ; --i, dest++)
-                    {
-                        put_number(dest, 0);
-                    }
-
-
-                    mc2->next = last;
-                    last = mc2;
-                }
-            *mcp2++ = last;
-        } while (--size);
-
-        /* Plug the new hash into the new mapping */
-        m2->hash = hm2;
-        LOG_ALLOC("copy_mapping - hash", SIZEOF_MH(hm2), sizeof *hm - sizeof *mcp + sizeof *mcp * size);
-        m->user->mapping_total += SIZEOF_MH(hm2);
-        check_total_mapping_size();
-        if (m->cond)
-            num_dirty_mappings++;
-        else
-            num_hash_mappings++;
-    }
-
+            svalue_t *dest;
+            p_int i;
 
-    /* --- Copy the condensed part ---
-     */
+            if (src->type == T_INVALID || destructed_object_ref(src))
+                continue;
 
-    if (NULL != (cm = m->cond) && NULL != (cm2 = m2->cond))
-    {
-        size_t src_ix;
-        svalue_t * src_key, * src_data;
-        svalue_t * dest_key, * dest_data;
-
-        for (   src_ix = 0
-              , src_key = &(cm->data[0])
-              , dest_key = &(cm2->data[0])
-              , dest_data = COND_DATA(cm2, 0, new_width)
-            ; src_ix < cm->size
-            ; src_ix++, src_key++)
-        {
-            if (src_key->type == T_INVALID)
-                ; /* Do nothing */
-            else if (destructed_object_ref(src_key))
+            dest = new_map_entry(m2, mhash(src));
+            if (!dest)
             {
-                /* We have to fill the space.
-                 * (Alternatively we could decrease m->cond->size.)
-                 */
-                p_int i;
-
-                num_entries--;
-
-                dest_key->type = T_INVALID;
-                dest_key++;
-
-                for (i = new_width; i > 0; i--, dest_data++)
-                    put_number(dest_data, 0);
+                free_mapping(m2);
+                outofmem(sizeof(svalue_t) * (new_width + 1), "mapping entry");
+                /* NOTREACHED */
+                return NULL;
             }
-            else
-            {
-                p_int i;
 
-                src_data = COND_DATA(cm, src_ix, m->num_values);
+            /* Copy the key and the common values */
+            for (i = 0; i <= common_width; i++)
+                assign_svalue_no_free(dest+i, src+i);
 
-                /* Copy the key and the common data */
-                assign_svalue_no_free(dest_key++, src_key);
-                for (i = common_width; i > 0; i--)
-                    assign_svalue_no_free(dest_data++, src_data++);
-
-                /* Zero out any extraneous values */
-                for (i = new_width - common_width; i > 0; i--, dest_data++)
-                    put_number(dest_data, 0);
-            }
-        } /* for (all keys) */
+            /* Zero out any extraneous values */
+            for ( ; i <= new_width; i++)
+                put_number(dest+i, 0);
+        }
     }
 
-    /* --- Finalize the basis structure ---
-     */
-
-    m2->num_entries = num_entries;
-
     /* That's it. */
     return m2;
 } /* resize_mapping() */
@@ -1727,12 +1384,9 @@ add_mapping (mapping_t *m1, mapping_t *m2)
  *
  * Return NULL if out of memory.
  *
- * To keep the function fast, the condensed part of m3 is always
- * the sum of the condensed parts of m1 and m2: this allows to operate
- * with static limits. To achieve this, entries from m1
- * overwritten by m2 are counted as cond_deleted entries in m3.
- * We leave it to the later compaction phase to get rid of all these
- * entries - if the mapping is still alive then.
+ * The result is allocated for the sum of the entries in m1 and m2; if
+ * they have keys in common, the remaining entries will be used by
+ * later additions.
  *
  * Note: Skips keys referencing destructed objects.
  */
@@ -1741,257 +1395,90 @@ add_mapping (mapping_t *m1, mapping_t *m2)
     mp_int      num_values = m1->num_values;
     mapping_t * m3;       /* The result mapping */
     mapping_hash_t * hm;
-    p_int cm3size;
-
-    /* Special case: number of values per entry differs.
-     * If one of the mappings is empty, the other one is returned.
-     * If both mappings contain data, an error is thrown.
-     */
-
-    if (m2->num_values != num_values)
-    {
-        if (!m1->num_entries)
-        {
-            return copy_mapping(m2);
-        }
-
-        if (!m2->num_entries)
-        {
-            return copy_mapping(m1);
-        }
-
-        errorf("Mappings to be added are of different width: %"PRIdMPINT
-               " vs. %"PRIdPINT"\n",
-               num_values, m2->num_values);
-    }
-
-
-    /* Allocate the result mapping *m3 and initialise it.
-     */
-
-    {
-        p_int hsize = 1; /* Force the creation of the hash */
-
-        if (m1->hash) hsize += m1->hash->used;
-        if (m2->hash) hsize += m2->hash->used;
-
-        cm3size = 0;
-        if (m1->cond) cm3size += m1->cond->size;
-        if (m2->cond) cm3size += m2->cond->size;
-
-        m3 = get_new_mapping(current_object->user, num_values, hsize, cm3size);
-
-        if (!m3)
-        {
-            outofmem(sizeof *m3 + sizeof(svalue_t) * hsize * cm3size * num_values
-                    , "result mapping base structure");
-            /* NOTREACHED */
-            return NULL;
-        }
-    }
-
-    /* Merge the condensed entries.
-     * Since the keys are sorted, a simple walk through both mappings
-     * in parallel with proper selection does the trick.
-     */
-
-    if (NULL != m3->cond)
-    {
-        mapping_cond_t *cm1, *cm2, *cm3;
-        svalue_t *src1_key, *src2_key, *dest_key, *dest_data;
-        size_t cm1size, cm2size;
-        size_t cm1_ix, cm2_ix, num_entries;
-
-        cm1 = m1->cond;
-        cm1size = cm1 ? cm1->size : 0;
-
-        cm2 = m2->cond;
-        cm2size = cm2 ? cm2->size : 0;
-
-        cm3 = m3->cond;
-
-        /* Loop over the mappings in parallel */
-        for (   cm1_ix = cm2_ix = 0
-              , src1_key = cm1 ? &(cm1->data[0]) : NULL
-              , src2_key = cm2 ? &(cm2->data[0]) : NULL
-              , dest_key = &(cm3->data[0])
-              , dest_data = COND_DATA(cm3, 0, num_values)
-              , num_entries = 0
-            ; cm1_ix < cm1size && cm2_ix < cm2size
-            ; NOOP )
-        {
-            int cmp;
-            p_int i;
-
-            if (src1_key->type == T_INVALID
-             || destructed_object_ref(src1_key)
-               )
-            {
-                cm1_ix++;
-                src1_key++;
-                continue;
-            }
-
-            if (src2_key->type == T_INVALID
-             || destructed_object_ref(src2_key)
-               )
-            {
-                cm2_ix++;
-                src2_key++;
-                continue;
-            }
-
-            /* Ok, it's a new entry */
-            m3->num_entries++;
-
-            cmp = svalue_cmp(src1_key, src2_key);
-
-            if (cmp < 0)
-            {
-                svalue_t *src_data = COND_DATA(cm1, cm1_ix, num_values);
-
-                /* Copy the key and the values */
-                assign_svalue_no_free(dest_key++, src1_key);
-                for (i = num_values; i > 0; i--)
-                    assign_svalue_no_free(dest_data++, src_data++);
-
-                num_entries++;
-                cm1_ix++;
-                src1_key++;
-            }
-            else if (cmp >= 0)
-            {
-                svalue_t *src_data = COND_DATA(cm2, cm2_ix, num_values);
-
-                /* Copy the key and the values */
-                assign_svalue_no_free(dest_key++, src2_key);
-                for (i = num_values; i > 0; i--)
-                    assign_svalue_no_free(dest_data++, src_data++);
-
-                num_entries++;
-                cm2_ix++;
-                src2_key++;
-
-                if (cmp == 0)
-                {
-                    cm1_ix++;
-                    src1_key++;
-                }
-            }
-        } /* for(mappings in parallel) */
-
-        /* Copy remaining values from m1 */
-        for ( ; cm1_ix < cm1size; cm1_ix++, src1_key++)
-        {
-            svalue_t *data = COND_DATA(cm1, cm1_ix, num_values);
-            p_int i;
-
-            if (src1_key->type != T_INVALID
-             && !destructed_object_ref(src1_key))
-            {
-                /* Copy the key and the values */
-                assign_svalue_no_free(dest_key++, src1_key);
-                for (i = num_values; i > 0; i--)
-                    assign_svalue_no_free(dest_data++, data++);
+    map_block_t * mb;
 
-                num_entries++;
-            }
-        } /* for (remaining values in m1) */
+    /* Special case: number of values per entry differs.
+     * If one of the mappings is empty, the other one is returned.
+     * If both mappings contain data, an error is thrown.
+     */
 
-        /* Copy remaining values from m2 */
-        for ( ; cm2_ix < cm2size; cm2_ix++, src2_key++)
+    if (m2->num_values != num_values)
+    {
+        if (!m1->num_entries)
         {
-            svalue_t *data = COND_DATA(cm2, cm2_ix, num_values);
-            p_int i;
-
-            if (src2_key->type != T_INVALID
-             && !destructed_object_ref(src2_key))
-            {
-                /* Copy the key and the values */
-                assign_svalue_no_free(dest_key++, src2_key);
-                for (i = num_values; i > 0; i--)
-                    assign_svalue_no_free(dest_data++, data++);
+            return copy_mapping(m2);
+        }
 
-                num_entries++;
-            }
-        } /* for (remaining values in m2) */
+        if (!m2->num_entries)
+        {
+            return copy_mapping(m1);
+        }
 
-        /* We have now num_entries entries in m3.
-         * Any remaining space in cm3 counts as 'deleted', so
-         * initialise it accordingly.
-         */
-        m3->num_entries = num_entries;
-        m3->hash->cond_deleted = cm3size - num_entries;
+        errorf("Mappings to be added are of different width: %"PRIdMPINT
+               " vs. %"PRIdPINT"\n",
+               num_values, m2->num_values);
+    }
 
-        for ( ; (p_int)num_entries < cm3size; num_entries++)
-        {
-            p_int i;
 
-            dest_key->type = T_INVALID; dest_key++;
+    /* Allocate the result mapping *m3 and initialise it.
+     */
 
-            for (i = num_values; i > 0; i--, dest_data++)
-            {
-                put_number(dest_data, 0);
-            }
+    m3 = get_new_mapping(current_object->user, num_values
+                        , m1->num_entries + m2->num_entries);
 
-        }
-    } /* Merge condensed entries */
+    if (!m3)
+    {
+        outofmem(sizeof *m3 + sizeof(svalue_t) * (m1->num_entries + m2->num_entries) * (num_values+1)
+                , "result mapping base structure");
+        /* NOTREACHED */
+        return NULL;
+    }
 
-    /* Now copy the two hash parts, using get_map_lvalue() to create
-     * the new hashed entries
-     *
-     * First m1...
+    /* Copy the entries of m1: these are all new in m3, so they don't
+     * need to be looked up.
      */
     if ( NULL != (hm = m1->hash) )
     {
-        map_chain_t **mcp;
-        p_int size;
-
-        size = hm->mask + 1;
-        mcp = hm->chains;
-        do {
-            map_chain_t *mc;
+        for (mb = hm->first; mb != NULL; mb = mb->next)
+        {
+            svalue_t *src = mb->data;
+            p_int ix;
 
-            for (mc = *mcp++; mc; mc = mc->next)
+            for (ix = BLOCK_FILL(hm, mb); ix > 0; ix--, src += num_values + 1)
             {
-                svalue_t * src, * dest;
+                svalue_t *dest;
                 p_int i;
 
-                src = &(mc->data[0]);
-                if (destructed_object_ref(src))
+                if (src->type == T_INVALID || destructed_object_ref(src))
                     continue;
 
-                dest = get_map_lvalue_unchecked(m3, src);
+                dest = new_map_entry(m3, mhash(src));
                 if (!dest)
                 {
                     free_mapping(m3);
                     return NULL;
                 }
-                for (src++, i = num_values; --i >= 0; )
-                    assign_svalue(dest++, src++);
+                for (i = 0; i <= num_values; i++)
+                    assign_svalue_no_free(dest+i, src+i);
             }
-        } while (--size);
+        }
     }
 
-    /* ...now m2, potentially overwriting the entries from m1.
+    /* ...now m2, using get_map_lvalue() to overwrite the entries from m1.
      */
     if ( NULL != (hm = m2->hash) )
     {
-        map_chain_t **mcp;
-        p_int size;
-
-        size = hm->mask + 1;
-        mcp = hm->chains;
-        do {
-            map_chain_t *mc;
+        for (mb = hm->first; mb != NULL; mb = mb->next)
+        {
+            svalue_t *src = mb->data;
+            p_int ix;
 
-            for (mc = *mcp++; mc; mc = mc->next)
+            for (ix = BLOCK_FILL(hm, mb); ix > 0; ix--, src += num_values + 1)
             {
-                svalue_t * src, * dest;
+                svalue_t *dest, *data;
                 p_int i;
 
-                src = &(mc->data[0]);
-                if (destructed_object_ref(src))
+                if (src->type == T_INVALID || destructed_object_ref(src))
                     continue;
 
                 dest = get_map_lvalue_unchecked(m3, src);
@@ -2000,10 +1487,10 @@ add_mapping (mapping_t *m1, mapping_t *m2)
                     free_mapping(m3);
                     return NULL;
                 }
-                for (src++, i = num_values; --i >= 0; )
-                    assign_svalue(dest++, src++);
+                for (data = src+1, i = num_values; --i >= 0; )
+                    assign_svalue(dest++, data++);
             }
-        } while (--size);
+        }
     }
 
     /* And that's it :-) */
@@ -2022,54 +1509,46 @@ walk_mapping ( mapping_t *m
  * current key, the current value(s) and the parameter <extra> to the
  * function.
  *
- * <func> may modify the value(s), but not the key.
+ * <func> may modify the value(s), but not the key. Entries which <func>
+ * adds to the mapping may or may not be visited.
  * Deals correctly with keys referencing destructed objects.
  */
 
 {
-    mapping_cond_t *cm;
     mapping_hash_t *hm;
-    svalue_t *key, *data;
+    map_block_t *mb, *last;
+    p_int last_fill;
     mp_int num_values;
 
+    if (NULL == (hm = m->hash))
+        return;
+
     num_values = m->num_values;
 
-    /* Walk through the condensed data */
+    /* Remember the end of the entries now, as the blocks may be
+     * extended by <func>.
+     */
+    last = hm->last;
+    last_fill = hm->fill;
 
-    if (NULL != (cm = m->cond))
+    for (mb = hm->first; mb != NULL; mb = mb->next)
     {
-        size_t ix;
+        svalue_t *key = mb->data;
+        p_int ix;
 
-        for ( ix = 0, key = &(cm->data[0]), data = COND_DATA(cm, 0, num_values)
-            ; ix < cm->size
-            ; ix++, key++, data += num_values
+        for ( ix = (mb == last) ? last_fill : mb->size
+            ; ix > 0
+            ; ix--, key += num_values + 1
             )
         {
             if (key->type != T_INVALID
              && !destructed_object_ref(key)
                )
-              (*func)(key, data, extra);
+              (*func)(key, key+1, extra);
         }
-    }
-
-    /* Walk through the hashed data */
-
-    if (NULL != (hm = m->hash))
-    {
-        mp_int size;
 
-        for (size = hm->mask; size >= 0; size--)
-        {
-            map_chain_t *mc;
-
-            for (mc = hm->chains[size]; mc != NULL; )
-            {
-                map_chain_t *next = mc->next;
-                if (!destructed_object_ref(&(mc->data[0])))
-                    (*func)(&(mc->data[0]), &(mc->data[1]), extra);
-                mc = next;
-            }
-        }
+        if (mb == last)
+            break;
     }
 
 } /* walk_mapping() */
@@ -2078,60 +1557,28 @@ walk_mapping ( mapping_t *m
 Bool
 compact_mapping (mapping_t *m, Bool force)
 
-/* Compact the mapping <m>.
+/* Compact the mapping <m>: give back the memory of the entries which
+ * deletions left unused by moving all entries into one block of the
+ * exact size.
  *
  * If <force> is TRUE, always compact the mapping.
- * If <force> is FALSE, the mappings is compacted if
- *   - have a .last_used time of 2*TIME_TO_COMPACT or more seconds earlier,
- *   - or have to have at least half of their condensed entries deleted
- *     and have a .last_used time of TIME_TO_COMPACT or more seconds earlier.
+ * If <force> is FALSE, the mappings is compacted only if it has at least
+ *   as many unused entries as used ones.
+ *
+ * Since this moves the entries, it must only be called when no pointers
+ * to mapping values are held (ie. from the backend).
  *
  * Return TRUE if the mapping has been freed altogether in the function
  * (ie. <m> is now invalid), or FALSE if it still exists.
- *
- * The merger is a two step process: first, all hashed entries are
- * sorted, then the sorted entries are merged with the condensed part.
- * The sort itself is done using Mergesort, with special treatment for those
- * portions that don't make up the current power of 2.
- *
- * The function is big, but functionally simple: there is only so
- * much complexity in a Mergesort.
  */
 
 {
     int old_malloc_privilege = malloc_privilege;
       /* Since it will be set temporarily to MALLOC_SYSTEM */
 
-    mapping_hash_t *hm;
-      /* The hash part of m (guaranteed to exist!) */
-    mapping_cond_t *cm;
-      /* The condensed part of m */
-    int num_values;
-      /* Number of values per entry */
-
-    mapping_t *m2;
-      /* Temporary holder for the compacted result mapping */
-    mapping_cond_t *cm2;
-      /* The new condensed part of the mapping */
-
-    map_chain_t *hook1, *hook2;
-      /* All hashed entries in two long chains.
-       */
-
-    mp_int count1, count2;
-    map_chain_t **mcpp, *mcp, *next;
-    map_chain_t *last_hash;
-      /* Auxiliaries */
-
-    mp_int runlength;
-      /* Current Mergesort partition length */
-
-    malloc_privilege = MALLOC_SYSTEM;
-      /* compact_mappings() may be called in very low memory situations,
-       * so it has to be allowed to use the system reserve.
-       * Neat sideeffect: all allocations are guaranteed to work (or
-       * the driver terminates).
-       */
+    mapping_hash_t *hm, *hm2;
+    map_block_t *mb, *next;
+    p_int num_values;
 
 #ifdef DEBUG
     if (!m->user)
@@ -2142,396 +1589,108 @@ compact_mapping (mapping_t *m, Bool force)
                * mappings referenced by a deleted value
                */
 
-    hm = m->hash;
-    cm = m->cond;
-
-    if (hm && hm->ref) {
+    if (m->hash && m->hash->ref) {
         fatal("compact_mapping(): remaining protector ref count %"
-              PRIdPINT"!\n", hm->ref);
+              PRIdPINT"!\n", m->hash->ref);
     }
 
-    /* First test if the mapping is dirty at all.
+    /* Remove all keys referencing destructed objects, so that their
+     * entries can be reclaimed as well.
      */
-    if (!hm)
-    {
-        check_map_for_destr_keys(m); // may create a hash part
-        hm = m->hash;
-        cm = m->cond;
-    }
+    check_map_for_destr_keys(m);
 
-    if (!hm)
-    {
-        LOG_SUB("compact_mapping(): no hash part", 0);
-        malloc_privilege = old_malloc_privilege;
-        check_total_mapping_size();
+    hm = m->hash;
 
+    if (!hm)
         return free_mapping(m);
-    }
-
-    /* Test the compaction criterium.
-     * By testing it before check_map_for_destr_keys(), the size related
-     * criterias might trigger later than desired, but the time criterium
-     * makes sure that we won't miss one.
-     */
-    if (!force
-     && !(   current_time - hm->last_used >= TIME_TO_COMPACT
-          && (   hm->cond_deleted * 2 >= m->num_entries - hm->used 
-              || hm->used >= m->num_entries - hm->used - hm->cond_deleted
-              || current_time - hm->last_used >= 2*TIME_TO_COMPACT
-             )
-         )
-       )
-    {
-        /* This mapping doesn't qualify for compaction.
-         */
-        m->ref--; /* undo the ref increment from above */
-        malloc_privilege = old_malloc_privilege;
-        return MY_FALSE;
-    }
-
-    /* Detect all keys referencing destructed keys - the compaction algorithm
-     * relies on it.
-     * Note: it will not check the keys (again) if not necessary.
-     */
-    check_map_for_destr_keys(m);
-    hm = m->hash;
-    cm = m->cond;
 
-    /* Test if the mapping needs compaction at all.
-     * If not, just delete the hash part (if any).
+    /* An empty mapping doesn't need any index or entries.
      */
-    if (!hm->used && !hm->cond_deleted)
+    if (!m->num_entries)
     {
-        LOG_SUB("compact_mapping(): no need to", SIZEOF_MH(hm));
-        malloc_privilege = old_malloc_privilege;
-        m->user->mapping_total -= SIZEOF_MH(hm);
-        m->hash = NULL;
-
-        if (m->cond)
-            num_dirty_mappings--;
-        else
-            num_hash_mappings--;
-        check_total_mapping_size();
-
-        xfree(hm);
+        free_map_storage(m, MY_TRUE);
 
         /* the ref count has been incremented above; on the other
          * hand, the last real reference might have gone with the
          * deleted keys. If that is the case, free_mapping() will
-         * deallocate it (since we NULLed out the .hash).
+         * deallocate it.
          */
         return free_mapping(m);
     }
 
-    /* This mapping can be compacted, and there is something to compact. */
+    /* Test the compaction criterium.
+     */
+    if (!hm->num_free || (!force && hm->num_free < m->num_entries))
+    {
+        return free_mapping(m);
+    }
 
-    /* Get the temporary result mapping (we need the condensed block
-     * anyway, and this way it's simple to keep the statistics
-     * straight).
+    /* This mapping can be compacted, and there is something to compact.
+     * Get the new structures for the entries and move them over,
+     * then free the old ones.
      */
 
-    if (m->cond && m->hash)
-        num_dirty_mappings--;
-    else if (m->hash)
-        num_hash_mappings--;
+    malloc_privilege = MALLOC_SYSTEM;
+      /* compact_mappings() may be called in very low memory situations,
+       * so it has to be allowed to use the system reserve.
+       */
 
     num_values = m->num_values;
 
-    m2 = get_new_mapping(m->user, num_values, 0, m->num_entries);
-    cm2 = m2->cond;
-
-    if (cm2 != NULL)
+    hm2 = get_new_hash(m, index_size(m->num_entries));
+    if (hm2)
     {
-        /* --- Setup Mergesort ---
-         *
-         * Unravel all hash chains into two chains, dangling from hook1
-         * and hook2.
-         *
-         * The chains differ in length by at most 1 element. Within
-         * the chains, the elements are pairwise sorted.
-         *
-         * In this loop, hook1 is always the next chain to add to,
-         * and last_hash is the first element of the next pair to add.
-         */
-        mcpp = hm->chains;
-        count1 = hm->mask;
-        hook1 = hook2 = NULL;
-        last_hash = NULL;
-
-        do {
-            mcp = *mcpp;
-            *mcpp++ = NULL; /* m no longer owns this chain */
-            while (mcp)
-            {
-                next = mcp->next;
-
-                if (last_hash)
-                {
-                    int d = svalue_cmp(&(mcp->data[0]), &(last_hash->data[0]));
-
-                    if (d < 0) {
-                        last_hash->next = hook1;
-                        mcp->next = last_hash;
-                        hook1 = hook2;
-                        hook2 = mcp;
-                    } else {
-                        mcp->next = hook1;
-                        last_hash->next = mcp;
-                        hook1 = hook2;
-                        hook2 = last_hash;
-                    }
-                    last_hash = NULL;
-                }
-                else
-                {
-                    last_hash = mcp;
-                }
-                mcp = next;
-            }
-        } while (--count1 >= 0);
-
-        /* Add the remaining odd element */
-        if (last_hash)
+        m->hash = hm2;
+        if (!new_map_block(m, m->num_entries))
         {
-            last_hash->next = hook1;
-            hook1 = last_hash;
+            m->user->mapping_total -= SIZEOF_MH(hm2);
+            xfree(hm2);
+            hm2 = NULL;
         }
+        m->hash = hm;
+    }
 
+    malloc_privilege = old_malloc_privilege;
 
-        /* --- Mergesort the hashed entries ---
-         *
-         * Sort hook1 and hook2 into hook1.
-         */
-        for (runlength = 2; runlength < hm->used; runlength <<= 1)
-        {
-            map_chain_t *out_hook1, *out_hook2, **out1, **out2;
-              /* The output chains, which serve as input chains in
-               * the next pass
-               */
-
-            count1 = hm->used & (runlength-1);
-            count2 = hm->used & runlength;
-            if (!count1)
-            {
-                out2 = &out_hook1;
-                *out2 = hook2;
-                while (--count2 >= 0) {
-                    out2 = &(*out2)->next;
-                }
-                hook2 = *out2;
-                count1 = count2 = runlength;
-                out1 = &out_hook2;
-            }
-            else if (!count2)
-            {
-                out2 = &out_hook1;
-                *out2 = hook1;
-                do {
-                    out2 = &(*out2)->next;
-                } while (--count1);
-                hook1 = *out2;
-                count1 = count2 = runlength;
-                out1 = &out_hook2;
-            }
-            else
-            {
-                out1 = &out_hook1;
-                out2 = &out_hook2;
-            }
-
-            while (hook1)
-            {
-                /* Sort the next runlength elements onto out1 */
-                while (1) {
-                    int d = svalue_cmp(&(hook1->data[0]), &(hook2->data[0]));
-
-                    if (d > 0)
-                    {
-                        *out1 = hook2;
-                        out1 = &hook2->next;
-                        hook2 = *out1;
-                        if (!--count2)
-                        {
-                            *out1 = hook1;
-                            do {
-                                out1 = &(*out1)->next;
-                            } while (--count1);
-                            hook1 = *out1;
-                            break;
-                        }
-                    }
-                    else
-                    {
-                        *out1 = hook1;
-                        out1 = &hook1->next;
-                        hook1 = *out1;
-                        if (!--count1)
-                        {
-                            *out1 = hook2;
-                            do {
-                                out1 = &(*out1)->next;
-                            } while (--count2);
-                            hook2 = *out1;
-                            break;
-                        }
-                    }
-                }
-
-                /* Now switch the chains */
-                {
-                    map_chain_t **temp;
-
-                    temp = out1;
-                    out1 = out2;
-                    out2 = temp;
-                }
-                count1 = count2 = runlength;
-            }
+    if (!hm2)
+    {
+        /* No memory: just keep the mapping as it is */
+        check_total_mapping_size();
+        return free_mapping(m);
+    }
 
-            /* Terminate the out-chains and set them up
-             * as next input chains.
-             */
-            *out1 = NULL;
-            *out2 = NULL;
-            hook1 = out_hook1;
-            hook2 = out_hook2;
-        }
-        if (!hook1)
-            hook1 = hook2;
+    for (mb = hm->first; mb != NULL; mb = next)
+    {
+        svalue_t *src = mb->data;
+        p_int ix;
 
+        next = mb->next;
 
-        /* --- Merge the old condensed part with the sorted lists ---
-         */
+        for (ix = BLOCK_FILL(hm, mb); ix > 0; ix--, src += num_values + 1)
         {
-            size_t src_ix;  /* Index into the old keys */
-            svalue_t *src_key, *src_data;
-            svalue_t *dest_key, *dest_data;
-
-            src_ix = 0;
-            src_key = cm ? &(cm->data[0]) : NULL;
-            src_data = cm ? COND_DATA(cm, 0, num_values) : NULL;
-            dest_key = &(cm2->data[0]);
-            dest_data = COND_DATA(cm2, 0, num_values);
-
-            /* Do the actual merge.
-             */
-            while (hook1 && cm != NULL && src_ix < cm->size)
-            {
-                int d;
-
-                if (src_key->type == T_INVALID)
-                {
-                    src_ix++;
-                    src_key++;
-                    src_data += num_values;
-                    continue;
-                }
-
-                d = svalue_cmp(src_key, &(hook1->data[0]));
-
-                if (d > 0)
-                {
-                    /* Take entry from hook1 */
-
-                    map_chain_t *temp;
-                    svalue_t    *src;
-                    p_int i;
-
-                    *dest_key++ = hook1->data[0];
-
-                    for (src = &(hook1->data[1]), i = num_values; i > 0; --i)
-                        *dest_data++ = *src++;
-
-                    temp = hook1;
-                    hook1 = temp->next;
-                    free_map_chain(m, temp, MY_TRUE);
-                }
-                else
-                {
-                    /* Take entry from the old condensed part */
-
-                    p_int i;
-
-                    *dest_key++ = *src_key++;
-
-                    for (i = num_values; i > 0; --i)
-                        *dest_data++ = *src_data++;
-
-                    src_ix++;
-                }
-            } /* if (hook1 && src_ix < cm->size) */
-
-            /* Copy any remaining entries from the old condensed part
-             * or the misc_hook1
-             */
-            if (cm != NULL && src_ix < cm->size)
-            {
-                /* Copy from the old condensed part */
-
-                while (src_ix < cm->size)
-                {
-                    if (src_key->type != T_INVALID)
-                    {
-                        p_int i;
-
-                        *dest_key++ = *src_key++;
-
-                        for (i = num_values; i > 0; --i)
-                            *dest_data++ = *src_data++;
-                    }
-                    else
-                    {
-                        src_key++;
-                        src_data += num_values;
-                    }
-                    src_ix++;
-                }
-            }
-            else
-            {
-                /* Copy from hook1 */
-
-                while (hook1)
-                {
-                    map_chain_t *temp;
-                    svalue_t    *src;
-                    p_int i;
-
-                    *dest_key++ = hook1->data[0];
-
-                    for (src = &(hook1->data[1]), i = num_values; i > 0; --i)
-                        *dest_data++ = *src++;
+            svalue_t *dest;
 
-                    temp = hook1;
-                    hook1 = temp->next;
-                    free_map_chain(m, temp, MY_TRUE);
-                }
-            }
-        } /* --- End of Merge --- */
-    } /* --- if (cm2 != NULL) --- */
+            if (src->type == T_INVALID)
+                continue;
 
-    /* Switch the new key and data blocks from m2 to m, and
-     * vice versa for the old ones. We don't assign the hash block
-     * as we already deleted all the map_chain structures.
-     */
-    m->cond = cm2;
-    m2->cond = cm;
+            dest = hm2->last->data + hm2->fill * (num_values + 1);
+            hm2->fill++;
+            memcpy(dest, src, sizeof(*dest) * (num_values + 1));
+            enter_map_slot(hm2, dest, mhash(dest));
+        }
 
-    m->hash = NULL; /* Since we compacted it away */
+        LOG_SUB("compact_mapping() - old block", SIZEOF_MB(mb, num_values));
+        m->user->mapping_total -= SIZEOF_MB(mb, num_values);
+        xfree(mb);
+    }
 
-    LOG_SUB("compact_mapping() - remove old hash", SIZEOF_MH(hm));
-    malloc_privilege = old_malloc_privilege;
+    LOG_SUB("compact_mapping() - old hash", SIZEOF_MH(hm));
     m->user->mapping_total -= SIZEOF_MH(hm);
     check_total_mapping_size();
-      /* The memorysize for the map_chain_t structure has already been
-       * subtracted.
-       */
-
+    num_dirty_mappings--;
     xfree(hm);
 
-    free_empty_mapping(m2);
-      /* Get rid of the temporary mapping and the old cond block.
-       */
+    m->hash = hm2;
 
     return free_mapping(m);
       /* Undo the initial m->ref++; if there was a recursive
@@ -2614,17 +1773,9 @@ mapping_overhead (mapping_t *m)
  */
 
 {
-    size_t rc = 0;
-
-    rc = sizeof(*m);
-    if (m->cond)
-        rc += sizeof(m->cond) - sizeof(svalue_t);
-    if (m->hash)
-        rc += SIZEOF_MH(m->hash)
-              + m->hash->used * (sizeof(map_chain_t) - sizeof(svalue_t))
-           ;
-
-    return rc;
+    /* Everything but the svalues of the valid entries is overhead */
+    return sizeof(*m) + mapping_storage_size(m)
+           - (size_t)MAP_TOTAL_SIZE(m) * sizeof(svalue_t);
 } /* mapping_overhead() */
 
 /*-------------------------------------------------------------------------*/
@@ -2700,9 +1851,7 @@ set_mapping_user (mapping_t *m, object_t *owner)
     /* Move the total size in the wizlist from the old owner
      * to the new one
      */
-    total = (mp_int)( sizeof(*m)
-                     + ((m->cond) ? SIZEOF_MC(m->cond, m->num_values) : 0)
-                    );
+    total = (mp_int)(sizeof(*m) + mapping_storage_size(m));
     LOG_SUB("set_mapping_user", total);
     m->user->mapping_total -= total;
     check_total_mapping_size();
@@ -2717,7 +1866,7 @@ set_mapping_user (mapping_t *m, object_t *owner)
 
     locals.owner = owner;
     locals.num_values = num_values;
-    first_hairy = alloca(((m->cond) ? m->cond->size : 1) * sizeof(svalue_t *));
+    first_hairy = alloca((m->num_entries + 1) * sizeof(svalue_t *));
     if (!first_hairy)
     {
         errorf("Stack overflow.\n");
@@ -2792,9 +1941,7 @@ void
 count_mapping_size (mapping_t *m)
 
 /* Add the mapping <m> to the statistics.
- * This method is called from the garbage collector only, at which point
- * the .hash member is either NULL or used as link pointer for a list
- * of stale mappings.
+ * This method is called from the garbage collector only.
  */
 
 {
@@ -2809,22 +1956,20 @@ count_mapping_size (mapping_t *m)
                            , (p_int)total, (p_int)m->num_values);
 #endif
 
-    if (m->cond != NULL)
+    if (m->hash != NULL)
     {
         mp_int subtotal;
 
-        subtotal = SIZEOF_MC(m->cond, m->num_values);
+        subtotal = mapping_storage_size(m);
         total += subtotal;
 #if 0 && defined(CHECK_MAPPING_TOTAL)
-        dprintf2(gcollect_outfd, " + %d (size %d)"
+        dprintf2(gcollect_outfd, " + %d (capacity %d)"
                                , (p_int)subtotal
-                               , (p_int)m->cond->size
+                               , (p_int)m->hash->capacity
                                );
 #endif
     }
 
-    /* m->hash does not point to a hash structure at this time */
-
 #if 0 && defined(CHECK_MAPPING_TOTAL)
     dprintf1(gcollect_outfd, " = %d\n", (p_int)total);
 #endif
@@ -2907,85 +2052,60 @@ count_ref_in_mapping (mapping_t *m)
  */
 
 {
-    mp_int size;
+    mapping_hash_t *hm;
+    map_block_t *mb;
+    map_slot_t *slot;
+    svalue_t *entry;
     mp_int num_values;
+    p_int i;
     Bool any_destructed = MY_FALSE;
 
+    if (NULL == (hm = m->hash))
+        return;
+
     num_values = m->num_values;
 
     /* Mark the blocks as referenced */
-    if (m->cond)
-        note_malloced_block_ref(m->cond);
-    if (m->hash)
-        note_malloced_block_ref(m->hash);
+    note_malloced_block_ref(hm);
+    for (mb = hm->first; mb != NULL; mb = mb->next)
+        note_malloced_block_ref(mb);
 
-    /* Count references by condensed keys and their data.
+    /* Count references by the keys and their data.
      * Take special care of keys referencing destructed objects/lambdas.
      */
-
-    size = m->cond ? m->cond->size : 0;
-    while ( --size >= 0)
+    for (i = hm->mask + 1, slot = hm->slots; i > 0; i--, slot++)
     {
-        svalue_t * key = &(m->cond->data[size]);
-        svalue_t * data = COND_DATA(m->cond, size, num_values);
+        entry = slot->entry;
+        if (entry == NULL || entry == MAP_SLOT_DELETED)
+            continue;
 
-        if (destructed_object_ref(key))
+        if (destructed_object_ref(entry))
         {
             /* This key is a destructed object, resp. is bound to a destructed
              * object. The entry has to be deleted.
              */
-            handle_destructed_key(key);
-            m->num_entries--;
+            handle_destructed_key(entry);
 
             any_destructed = MY_TRUE;
         }
         else
         {
-            count_ref_in_vector(key, 1);
-            count_ref_in_vector(data, num_values);
+            count_ref_in_vector(entry, 1);
+            count_ref_in_vector(entry+1, num_values);
         }
     }
 
-    /* Count references by hashed keys and their data.
-     * Take special care of keys referencing destructed objects/lambdas.
-     */
-    size = m->hash ? m->hash->mask+1 : 0;
-    while ( --size >= 0)
-    {
-        map_chain_t * mc = m->hash->chains[size];
-
-        for ( ; mc != NULL; mc = mc->next)
-        {
-            note_malloced_block_ref(mc);
-            if (destructed_object_ref(mc->data))
-            {
-                /* This key is a destructed object, resp. is bound to a
-                 * destructed object. The entry has to be deleted.
-                 */
-                handle_destructed_key(mc->data);
-
-                any_destructed = MY_TRUE;
-            }
-            else
-            {
-                count_ref_in_vector(mc->data, 1);
-                count_ref_in_vector(mc->data+1, num_values);
-            }
-        }
-    }
+    /* Entries pending deletion still hold their values. */
+    for (entry = hm->deleted; entry != NULL; entry = entry->u.lvalue)
+        count_ref_in_vector(entry+1, num_values);
 
-    /* If any stale key was found, link the mapping into the 
+    /* If any stale key was found, link the mapping into the
      * stale mapping list.
      */
     if (any_destructed)
     {
         m->next = stale_mappings;
         stale_mappings = m;
-        /* We are going to use free_svalue() later to get rid of the
-         * data asscoiated with the keys. This data might reference
-         * mappings with destructed keys... Thus, we must prevent
-         * free_mapping() to look at the hash field.
-         */
         m->ref++;
         /* Ref for the stale-mapping link. */
     }
@@ -2997,8 +2117,8 @@ clean_stale_mappings (void)
 
 /* GC support: After count_ref_in_mapping(), the gc will free all
  * unreferenced destructed objects and lambdas. This may have removed
- * several keys in the stale_mappings. Since the objective
- * is to recover memory, we try to compact these mappings now.
+ * several keys in the stale_mappings. Their entries are removed now
+ * and put into the free list.
  * Be aware that the mappings might be empty now.
  */
 
@@ -3007,132 +2127,37 @@ clean_stale_mappings (void)
 
     for (m = stale_mappings; m; m = next)
     {
-        mapping_cond_t *cm;
         mapping_hash_t *hm;
-        size_t size;
-        mp_int num_cond_entries;
-        mp_int num_values;
-        mp_int i;
+        map_slot_t *slot;
+        p_int i, j;
 
         /* Unlink from the stale_mapping list */
         next = m->next;
         m->next = NULL;
 
-        num_values = m->num_values;
-        cm = m->cond;
         hm = m->hash;
 
-        /* Try to reallocate a new condensed block */
-
-        num_cond_entries = m->num_entries - (hm ? hm->used : 0);
-        if (num_cond_entries)
+        for (i = hm->mask + 1, slot = hm->slots; i > 0; i--, slot++)
         {
-            mapping_cond_t *cm2;
-            size_t ix;
-            svalue_t *src_key, *src_data;
-            svalue_t *dest_key, *dest_data;
-
-            size = sizeof(*cm2) + sizeof(svalue_t) * (num_cond_entries * (num_values+1) - 1);
-            cm2 = xalloc(size);
-            if (!cm2)
-            {
-                fprintf(stderr, "%s Unable to compact stale mapping: Out of memory "
-                                "for new condensed block (%zu bytes).\n"
-                              , time_stamp(), size);
-                debug_message("%s Unable to compact stale mapping: Out of memory "
-                              "for new condensed block (%zu bytes).\n"
-                             , time_stamp(), size);
-
-                /* No use in even trying to compact the much bigger data
-                 * block either.
-                 */
-                continue;
-            }
+            svalue_t *entry = slot->entry;
 
-            cm2->size = num_cond_entries;
-
-            /* Copy the data */
-            for (   ix = 0
-                  , src_key = &(cm->data[0])
-                  , src_data = COND_DATA(cm, 0, num_values)
-                  , dest_key = &(cm2->data[0])
-                  , dest_data = COND_DATA(cm2, 0, num_values)
-                ; ix < cm->size
-                ; ix++, src_key++)
-            {
-                if (src_key->type != T_INVALID)
-                {
-                    *dest_key++ = *src_key;
-                    for (i = num_values; i > 0; i--)
-                        *dest_data++ = *src_data++;
-                }
-                else
-                    src_data += num_values;
-            }
+            if (entry == NULL || entry == MAP_SLOT_DELETED
+             || entry->type != T_INVALID)
+                continue;
 
-            /* Replace the old keyblock by the new one. */
-            LOG_ALLOC("clean_stale - new keyblock", SIZEOF_MC(cm2, num_values), size);
-            m->user->mapping_total += SIZEOF_MC(cm2, num_values);
-            m->cond = cm2;
-        }
-        else
-        {
-            /* No condensed block needed. */
-            m->cond = NULL;
-        }
+            /* This key has been marked for deletion. The GC didn't
+             * count the values, so they are just cleared, not freed.
+             */
+            slot->entry = MAP_SLOT_DELETED;
+            hm->used--;
+            hm->deleted_slots++;
+            m->num_entries--;
 
-        /* Delete the old condensed block, if any */
-        if (cm)
-        {
-            LOG_SUB("clean_state - old keyblock", SIZEOF_MC(cm, num_values));
-            m->user->mapping_total -= SIZEOF_MC(cm, num_values);
-            xfree(cm);
+            for (j = m->num_values; j > 0; j--)
+                put_number(entry+j, 0);
+            release_map_entry(m, entry);
         }
 
-        /* Removed all invalid keys from the hash part, if any */
-        if (hm && hm->used)
-        {
-            size_t ix;
-
-            for (ix = 0; ix <= (size_t)hm->mask; ix++)
-            {
-                map_chain_t * mc, * mcp;
-
-                for (mcp = NULL, mc = hm->chains[ix]; mc != NULL ; )
-                {
-                    if (mc->data[0].type == T_INVALID)
-                    {
-                        /* This key has been marked for deletion,
-                         * now remove it altogether.
-                         */
-                        map_chain_t * this = mc;
-
-                        if (mcp == NULL)
-                        {
-                            hm->chains[ix] = this->next;
-                        }
-                        else
-                        {
-                            mcp->next = this->next;
-                        }
-                        mc = this->next;
-
-                        m->num_entries--;
-                        hm->used--;
-                        m->user->mapping_total -= SIZEOF_MCH(this, num_values);
-                        xfree(this);
-                    }
-                    else
-                    {
-                        /* Valid key - just step forward */
-                        mcp = mc;
-                        mc = mc->next;
-                    }
-                } /* for(mc) */
-            } /* for(ix) */
-        } /* hash part */
-
-        check_total_mapping_size();
         free_mapping(m); /* Undo the ref held by the stale-mapping list */
     }
 } /* clean_stale_mappings() */
@@ -3436,26 +2461,14 @@ add_to_mapping (mapping_t *m1, mapping_t *m2)
         /* If one of the two mappings is empty, we can adjust its width
          * after getting rid of all pending data blocks.
          */
-        if (0 == m2->num_entries && NULL == m2->hash)
+        if (0 == m2->num_entries && (NULL == m2->hash || !m2->hash->ref))
         {
-            if (m2->cond != NULL)
-            {
-                LOG_SUB_M("add_to_mapping - m2 no cond", m2, SIZEOF_MC(m2->cond, m2->num_values));
-                m2->user->mapping_total -= SIZEOF_MC(m2->cond, m2->num_values);
-                xfree(m2->cond);
-                m2->cond = NULL;
-            }
+            free_map_storage(m2, MY_FALSE);
             m2->num_values = m1->num_values;
         }
-        else if (0 == m1->num_entries && NULL == m1->hash)
+        else if (0 == m1->num_entries && (NULL == m1->hash || !m1->hash->ref))
         {
-            if (m1->cond != NULL)
-            {
-                LOG_SUB_M("add_to_mapping - m1 no cond", m1, SIZEOF_MC(m2->cond, m2->num_values));
-                m1->user->mapping_total -= SIZEOF_MC(m1->cond, m1->num_values);
-                xfree(m1->cond);
-                m1->cond = NULL;
-            }
+            free_map_storage(m1, MY_FALSE);
             m1->num_values = m2->num_values;
         }
         else
@@ -3785,15 +2798,15 @@ f_walk_mapping_cleanup (error_handler_t *arg)
         {
             /* Last ref gone: deallocated the pending deleted entries */
 
-            map_chain_t *mc, *next;
+            svalue_t *entry, *next;
 
-            for (mc = hm->deleted; mc; mc = next)
+            entry = hm->deleted;
+            hm->deleted = NULL;
+            for ( ; entry; entry = next)
             {
-                next = mc->next;
-                free_map_chain(m, mc, MY_FALSE);
+                next = entry->u.lvalue;
+                release_map_entry(m, entry);
             }
-
-            hm->deleted = NULL;
         }
     }
 
@@ -3,6 +3,7 @@
 
 #include "driver.h"
 #include "typedefs.h"
+#include "gcollect.h"
 #include "svalue.h"
 
 /* --- Types --- */
@@ -10,7 +11,7 @@
 /* Local typedefs */
 
 typedef struct mapping_hash_s mapping_hash_t;
-typedef struct mapping_cond_s mapping_cond_t;
+typedef struct map_slot_s     map_slot_t;
 
 /* --- struct mapping_s: the mapping datatypes --- */
 
@@ -23,94 +24,69 @@ struct mapping_s {
     p_int       num_values;        /* Number of values for a key */
     p_int       num_entries;       /* Number of valid entries */
     uint32_t    last_destr_check;  /* Last check for destr. object in keys */
-    struct mapping_cond_s * cond;  /* Condensed entries */
-    struct mapping_hash_s * hash;  /* Hashed entries */
+    struct mapping_hash_s * hash;  /* Index and entries, NULL if none */
     mapping_t  *next;
       /* Next mapping - for use by the cleanup code and
        * the garbage collector.
        */
 };
 
-/* --- struct mapping_hash_s: the hashed index ---
+/* --- struct map_slot_s: one slot of the hash index --- */
+
+struct map_slot_s {
+    p_int      hash;   /* Hash value of the key */
+    svalue_t * entry;
+      /* The entry (key and values), NULL for an unused slot,
+       * or MAP_SLOT_DELETED for the slot of a deleted entry.
+       */
+};
+
+/* --- struct mapping_hash_s: the hash index ---
  *
- * New entries in a mapping are stored in a hash structure for fast
- * access. The hash grows dynamically with the number of entries -
- * the structure is then reallocated to fit - the goal is to keep
- * on average two entries per hash bucket.
+ * The index is an open-addressed hash table over all entries of the
+ * mapping, the entries themselves are kept in a list of blocks
+ * which are never moved (see mapping.c for the details).
  *
- * This structure is exported so that interpret.c can use it to
- * build protectors.
+ * This structure is exported so that the cleanup code can check
+ * whether a mapping has unused entries left to reclaim.
  */
 
 struct mapping_hash_s {
-    p_int         used;        /* Number of entries in the hash */
     p_int         mask;
-      /* Index mask for chains[], converting the raw hash value into
+      /* Index mask for slots[], converting the raw hash value into
        * the valid index number using a bit-and operation.
-       * Incremented by one, it's the number of chains.
+       * Incremented by one, it's the number of slots.
        */
+    p_int         used;          /* Number of slots holding an entry */
+    p_int         deleted_slots; /* Number of slots marked as deleted */
     p_int         ref;
       /* Refcount if this mapping is part of a T_PROTECTOR_MAPPING svalue.
        * The value is <= the mappings main refcount.
        */
-    mp_int        last_used;
-      /* Time of the last change (add or delete) to the mapping.
-       */
-    p_int         cond_deleted;
-      /* Number of entries deleted from the condensed part
+    p_int         num_free;      /* Number of entries on the .free list */
+    p_int         fill;          /* Number of entries used in .last */
+    p_int         capacity;      /* Number of entries in all blocks */
+    svalue_t    * free;
+      /* List of unused entries, linked through the .u.lvalue of their
+       * keys.
        */
-    struct map_chain_s *deleted;
+    svalue_t    * deleted;
       /* Protector mappings only: list of deleted entries, which are kept
        * pending because the they may still be used as destination for
        * a lvalue.
        */
-    struct map_chain_s * chains[ 1 /* +.mask */ ];
-      /* The hash chain heads ('hash buckets')
+    struct map_block_s * first;  /* The entry blocks, oldest first */
+    struct map_block_s * last;   /* The youngest block */
+    map_slot_t    slots[ 1 /* +.mask */ ];
+      /* The index slots.
        */
 };
 
-#define SIZEOF_MH_ALL(hm, nv) ( \
-    sizeof(*(hm)) + sizeof(map_chain_t *) * (hm)->mask \
-                  + (sizeof(map_chain_t) + sizeof(svalue_t) * (nv)) * ((hm)->used) \
-                      )
-  /* Allocation size of a given mapping_hash_t structure for a mapping
-   * with <nv> values per key, including map_chain structures.
-   */
-
 #define SIZEOF_MH(hm) ( \
-    sizeof(*(hm)) + sizeof(map_chain_t *) * (hm)->mask \
+    sizeof(*(hm)) + sizeof(map_slot_t) * (hm)->mask \
                       )
   /* Allocation size of a given mapping_hash_t structure, excluding
-   * the map_chain structures.
-   */
-
-
-/* --- struct mapping_cond_s: the condensed block ---
- *
- * When a mapping is compacted, the entries are stored in sorted order
- * in this structure (allocated to size).
- * If later a key is deleted, it's .type is set to T_INVALID.
- *
- * The structure is exported so that the swapper can use it.
- */
-
-struct mapping_cond_s {
-    size_t   size;                 /* Number of allocated entries */
-    svalue_t data[1 /* .size * (m->num_values+1) */];
-};
-
-#define SIZEOF_MC(cm, nv) ( \
-    sizeof(*(cm)) + sizeof(svalue_t) * (((cm)->size * ((nv)+1)) - 1) \
-                      )
-  /* Allocation size of a given mapping_cond_t structure for
-   * a mapping with <nv> values per key.
-   */
-
-#define COND_DATA(cm, ix, nv) ( \
-    &((cm)->data[(cm)->size + (ix) * (nv)]) \
-                              )
-  /* For key entry [<ix>] in a given mapping_cond_t for a mapping
-   * with <nv> values per key, return pointer to the first assocated value.
+   * the entry blocks.
    */
 
 
@@ -146,6 +122,11 @@ struct mvf_info
   /* Size (number of keys and values) of a given mapping <m>.
    */
 
+#define MAP_IS_DIRTY(m) ((m)->hash != NULL && (m)->hash->num_free != 0)
+  /* Return TRUE if deletions left unused entries in mapping <m> which
+   * compact_mapping() could reclaim.
+   */
+
 /* mapping_t *ref_mapping(mapping_t *m)
  *   Add another ref to mapping <m> and return the mapping <m>.
  */
@@ -154,11 +135,12 @@ struct mvf_info
 
 /* Bool free_mapping(mapping_t *m)
  *   Subtract one ref from mapping <m>, and free the mapping fully if
- *   the refcount reaches zero.
+ *   the refcount reaches zero. Otherwise the mapping is noted as a
+ *   possible root of a reference cycle.
  *   Return TRUE if the mapping is deallocated, and FALSE if not.
  */
 
-#define free_mapping(m) ( (--((m)->ref) <= 0) ? _free_mapping(m, MY_FALSE) : MY_FALSE )
+#define free_mapping(m) ( (--((m)->ref) <= 0) ? _free_mapping(m, MY_FALSE) : (note_cycle_root(m, T_MAPPING), MY_FALSE) )
 
 /* p_int deref_mapping(mapping_t *m)
  *   Subtract one ref from mapping <m>, but don't check if it needs to
@@ -176,13 +158,15 @@ extern mp_int num_dirty_mappings;
 /* --- Prototypes --- */
 
 extern mapping_t *allocate_mapping(mp_int size, mp_int num_values);
-extern mapping_t *allocate_cond_mapping(wiz_list_t * user, mp_int size, mp_int num_values);
+extern mapping_t *allocate_user_mapping(wiz_list_t * user, mp_int size, mp_int num_values);
 extern Bool _free_mapping(mapping_t *m, Bool no_data);
 #define free_empty_mapping(m) _free_mapping(m, MY_TRUE)
+extern void clear_mapping(mapping_t *m);
 extern svalue_t *_get_map_lvalue(mapping_t *m, svalue_t *map_index, Bool need_lvalue, Bool check_size);
 #define get_map_value(m,x) _get_map_lvalue(m,x,MY_FALSE, MY_TRUE)
 #define get_map_lvalue(m,x) _get_map_lvalue(m,x,MY_TRUE, MY_TRUE)
 #define get_map_lvalue_unchecked(m,x) _get_map_lvalue(m,x,MY_TRUE, MY_FALSE)
+extern svalue_t *add_new_map_entry(mapping_t *m, svalue_t *key);
 extern void remove_mapping(mapping_t *m, svalue_t *map_index);
 extern Bool mapping_references_objects (mapping_t *m);
 extern void check_map_for_destr_keys(mapping_t *m);
@@ -19,17 +19,21 @@
  * results worthless.
  *
  * Compiled expressions are stored together with their generator
- * strings in a hash table, hashed over the generator string content.
+ * strings in a hash table, hashed over the generator string content,
+ * with the entries of one slot chained together. All entries are also
+ * kept in a list in the order of their last use; when the memory
+ * held by the cache exceeds its budget, the least recently used
+ * entries are thrown out.
  *
- * The table sizes are specified in config.h as follows:
+ * The table size is specified in config.h as follows:
  *   RXCACHE_TABLE: size of the expression hash table
+ * The memory budget defaults to DEFAULT_RXCACHE_SIZE and can be changed
+ * with configure_driver(DC_REGEX_CACHE_SIZE).
 #endif
  *
- * TODO: Using shared strings as cache-indices can speed things up,
- * TODO:: especially when knowing where to find the hashvalue from
- * TODO:: the strtable.
- * TODO: Use in-table chaining to improve the use of the table space
- * TODO:: and reduce the number of collisions.
+ * PCRE expressions are compiled into machine code by the PCRE JIT
+ * where the library supports it.
+ *
  * TODO: Separate the results out from HS-Regexp, so that the compiled
  * TODO:: program and the results can be held separate.
  *------------------------------------------------------------------
@@ -103,10 +107,12 @@ typedef struct regdata_s {
 typedef struct RxHashEntry {
     regdata_t base;      /* The base regexp_t structure */
 
-    string_t * pString;  /* Generator string, a counted tabled string
-                          * NULL if unused */
+    string_t * pString;  /* Generator string, a counted tabled string */
     hash32_t    hString;  /* Hash of pString */
     size_t     size;     /* Size of regexp expressions for statistics */
+    struct RxHashEntry * pNext;     /* Next entry in the table slot */
+    struct RxHashEntry * pLruPrev;  /* Next more recently used entry */
+    struct RxHashEntry * pLruNext;  /* Next less recently used entry */
 } RxHashEntry;
 
 #endif /* RXCHACHE_TABLE */
@@ -134,15 +140,28 @@ struct regexp_s {
 
 static RxHashEntry * xtable[RXCACHE_TABLE];  /* The Expression Hashtable */
 
+static RxHashEntry * pLruFirst = NULL;  /* The most recently used entry */
+static RxHashEntry * pLruLast  = NULL;  /* The least recently used entry */
+
+static p_int iXSizeLimit = DEFAULT_RXCACHE_SIZE;
+  /* Memory budget of the cache, see rxcache_set_size_limit().
+   */
+
 /* Expression cache statistics */
 static statcounter_t iNumXRequests   = 0;  /* Number of calls to rx_compile() */
 static statcounter_t iNumXFound      = 0;  /* Number of calls satisfied from table */
-static uint32 iNumXCollisions = 0;  /* Number of hashcollisions */
+static statcounter_t iNumXEvicted    = 0;  /* Number of entries thrown out */
+static uint32 iNumXCollisions = 0;  /* Number of entries added to used slots */
 static uint32 iNumXEntries    = 0;  /* Number of used cache entries */
 static uint32 iXSizeAlloc     = 0;  /* Dynamic memory held in regexp structs */
 
 #endif /* RXCACHE_TABLE */
 
+#ifdef HAS_PCRE
+static statcounter_t iNumXJit = 0;
+  /* Number of expressions compiled by the PCRE JIT */
+#endif
+
 #ifdef HAS_PCRE
 static size_t pcre_malloc_size;
   /* Accumulated size from pcre_malloc() calls. Used when creating
@@ -154,6 +173,20 @@ static const char* pcre_malloc_err;
    * condition in the pcre_xalloc() wrapper can get the proper
    * error message.
    */
+
+/* The study data holds blocks allocated by the PCRE JIT in private
+ * structures, which the GC can't see. Therefore all study data is
+ * allocated in permanent memory, and pcre_free() is pfree(), which
+ * can deallocate both kinds of blocks.
+ */
+#ifdef PCRE_STUDY_JIT_COMPILE
+#define RX_STUDY_OPTIONS  PCRE_STUDY_JIT_COMPILE
+#define rx_free_study(p)  pcre_free_study(p)
+#else
+#define RX_STUDY_OPTIONS  0
+#define rx_free_study(p)  pfree(p)
+#endif
+
 #endif // HAS_PCRE
 
 /*--------------------------------------------------------------------*/
@@ -194,6 +227,80 @@ free_regdata(regdata_t *r)
 #define RxStrHash(s) ((s) % RXCACHE_TABLE)
 #endif
 
+/*--------------------------------------------------------------------*/
+static INLINE void
+rx_lru_unlink (RxHashEntry * pHash)
+
+/* Remove <pHash> from the list of entries in the order of use.
+ */
+
+{
+    if (pHash->pLruPrev)
+        pHash->pLruPrev->pLruNext = pHash->pLruNext;
+    else
+        pLruFirst = pHash->pLruNext;
+
+    if (pHash->pLruNext)
+        pHash->pLruNext->pLruPrev = pHash->pLruPrev;
+    else
+        pLruLast = pHash->pLruPrev;
+} /* rx_lru_unlink() */
+
+/*--------------------------------------------------------------------*/
+static INLINE void
+rx_lru_use (RxHashEntry * pHash)
+
+/* Put <pHash> at the front of the list of entries in the order of
+ * use. <pHash> must not be in the list.
+ */
+
+{
+    pHash->pLruPrev = NULL;
+    pHash->pLruNext = pLruFirst;
+    if (pLruFirst)
+        pLruFirst->pLruPrev = pHash;
+    else
+        pLruLast = pHash;
+    pLruFirst = pHash;
+} /* rx_lru_use() */
+
+/*--------------------------------------------------------------------*/
+static void
+rx_evict (RxHashEntry * pHash)
+
+/* Throw <pHash> out of the cache. Users still holding a reference
+ * to the expression keep it until they are done.
+ */
+
+{
+    RxHashEntry ** ppSlot;
+
+    for ( ppSlot = &xtable[RxStrHash(pHash->hString)]
+        ; *ppSlot != pHash
+        ; ppSlot = &(*ppSlot)->pNext) NOOP;
+    *ppSlot = pHash->pNext;
+    rx_lru_unlink(pHash);
+
+    iNumXEntries--;
+    iXSizeAlloc -= sizeof(*pHash) + pHash->size;
+    iNumXEvicted++;
+
+    free_regdata(&(pHash->base));
+} /* rx_evict() */
+
+/*--------------------------------------------------------------------*/
+static void
+rx_shrink_cache (void)
+
+/* Throw out the least recently used entries until the cache keeps
+ * to its memory budget.
+ */
+
+{
+    while (pLruLast && (p_int)iXSizeAlloc > iXSizeLimit)
+        rx_evict(pLruLast);
+} /* rx_shrink_cache() */
+
 #endif /* RXCHACHE_TABLE */
 
 /*--------------------------------------------------------------------*/
@@ -212,6 +319,26 @@ pcre_xalloc (size_t size)
     pcre_malloc_size += size;
     return p;
 } /* pcre_xalloc() */
+
+/*--------------------------------------------------------------------*/
+static void *
+pcre_pxalloc (size_t size)
+
+/* Wrapper function so that PCRE will use our permanent allocator for
+ * the study data.
+ */
+
+{
+    void * p;
+
+    if (!pcre_malloc_err)
+        pcre_malloc_err = "in PCRE function";
+    p = pxalloc(size);
+    if (!p)
+        outofmem(size, pcre_malloc_err);
+    pcre_malloc_size += size;
+    return p;
+} /* pcre_pxalloc() */
 #endif // HAS_PCRE
 
 /*--------------------------------------------------------------------*/
@@ -242,7 +369,7 @@ void rx_init(void)
 #endif
 #ifdef HAS_PCRE
     pcre_malloc = pcre_xalloc;
-    pcre_free = xfree;
+    pcre_free = pfree;
 #endif
 } /* rx_init() */
 
@@ -279,6 +406,10 @@ get_error_message (int code, int package)
             text = "out of memory"; break;
         case RE_ERROR_BACKTRACK:
             text = "too many backtracks"; break;
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+        case PCRE_ERROR_JIT_STACKLIMIT:
+            text = "too many backtracks"; break;
+#endif
         default:
             text = "unknown internal error"; break;
         }
@@ -417,7 +548,9 @@ rx_compile_pcre (string_t * expr, int opt, Bool from_ed, regdata_t * rdata)
     }
 
     pcre_malloc_err  = "studying regex";
-    pHints = pcre_study(pProg, 0, &pErrmsg);
+    pcre_malloc = pcre_pxalloc;
+    pHints = pcre_study(pProg, RX_STUDY_OPTIONS, &pErrmsg);
+    pcre_malloc = pcre_xalloc;
 
     if (pErrmsg)
     {
@@ -433,7 +566,7 @@ rx_compile_pcre (string_t * expr, int opt, Bool from_ed, regdata_t * rdata)
     if (pHints == NULL) 
     {
         pcre_malloc_err = "allocating memory for pHints section in regexp";
-        pHints = (pcre_extra *)pcre_xalloc(sizeof(pcre_extra));
+        pHints = (pcre_extra *)pcre_pxalloc(sizeof(pcre_extra));
         if (pHints == NULL) 
         {
             if (from_ed)
@@ -452,7 +585,7 @@ rx_compile_pcre (string_t * expr, int opt, Bool from_ed, regdata_t * rdata)
         if (rc != 0)
         {
             xfree(pProg);
-            xfree(pHints);
+            rx_free_study(pHints);
             if (from_ed)
                 add_message("pcre: %s\n", get_error_message(rc, RE_PCRE));
             else
@@ -466,11 +599,29 @@ rx_compile_pcre (string_t * expr, int opt, Bool from_ed, regdata_t * rdata)
     if (pSubs == NULL)
     {
         xfree(pProg);
-        xfree(pHints);
+        rx_free_study(pHints);
         outofmem(num_subs * sizeof (*pSubs), "regexp work area");
     }
     pcre_malloc_size += num_subs * sizeof (*pSubs);
 
+#ifdef PCRE_STUDY_JIT_COMPILE
+    /* The machine code of the JIT lives outside our allocator. */
+    {
+        int jit = 0;
+
+        if (!pcre_fullinfo(pProg, pHints, PCRE_INFO_JIT, &jit) && jit)
+        {
+#ifdef PCRE_INFO_JITSIZE
+            size_t jit_size = 0;
+
+            if (!pcre_fullinfo(pProg, pHints, PCRE_INFO_JITSIZE, &jit_size))
+                pcre_malloc_size += jit_size;
+#endif
+            iNumXJit++;
+        }
+    }
+#endif
+
     /* Compilation complete - store the result in the outgoing regdata
      * structure.
      */
@@ -502,7 +653,7 @@ rx_compile_data (string_t * expr, int opt, Bool from_ed)
  */
 
 {
-    size_t    pcre_size;
+    size_t    size;  /* Memory used by the compiled programs */
     regdata_t rdata; /* Local rdata structure to hold compiled expression */
 
 #ifdef RXCACHE_TABLE
@@ -516,48 +667,64 @@ rx_compile_data (string_t * expr, int opt, Bool from_ed)
 
     hExpr = mstr_get_hash(expr);
     h = RxStrHash(hExpr);
-    pHash = xtable[h];
 
     /* Look for a ready-compiled regexp */
-    if (pHash != NULL
-     && pHash->pString != NULL
-     && pHash->hString == hExpr
-     && pHash->base.opt == (opt & ~(RE_PACKAGE_MASK))
-     && mstreq(pHash->pString, expr)
-       )
+    for (pHash = xtable[h]; pHash != NULL; pHash = pHash->pNext)
+    {
+        if (pHash->hString == hExpr
+         && pHash->base.opt == (opt & ~(RE_PACKAGE_MASK))
+         && mstreq(pHash->pString, expr)
+           )
+            break;
+    }
+
+    if (pHash != NULL)
     {
         iNumXFound++;
 
+        if (pHash != pLruFirst)
+        {
+            rx_lru_unlink(pHash);
+            rx_lru_use(pHash);
+        }
+
         /* Regexp found, but it may not have been compiled for us yet.
          */
 #ifdef HAS_PCRE
         if ((opt & RE_PCRE) && !pHash->base.pProg)
         {
-            pHash->size = rx_compile_pcre(expr, opt, from_ed, &(pHash->base));
-            if (!pHash->size)
+            size = rx_compile_pcre(expr, opt, from_ed, &(pHash->base));
+            if (!size)
                 return NULL;
+            pHash->size += size;
+            iXSizeAlloc += size;
         }
 #endif // HAS_PCRE
         if ((opt & RE_TRADITIONAL) && !pHash->base.rx)
         {
             if (!rx_compile_re(expr, opt, from_ed, &(pHash->base)))
                 return NULL;
+            pHash->size += pHash->base.rx->regalloc;
+            iXSizeAlloc += pHash->base.rx->regalloc;
         }
-        return ref_regdata(&(pHash->base));
+
+        ref_regdata(&(pHash->base));
+        rx_shrink_cache();
+        return &(pHash->base);
     }
 #endif
 
     /* Regexp not found: compile a new one.
      */
 
-    pcre_size = 0;
+    size = 0;
     memset(&rdata, 0, sizeof(rdata));
 
 #ifdef HAS_PCRE
     if (opt & RE_PCRE)
     {
-        pcre_size = rx_compile_pcre(expr, opt, from_ed, &rdata);
-        if (!pcre_size)
+        size = rx_compile_pcre(expr, opt, from_ed, &rdata);
+        if (!size)
         {
             return NULL;
         }
@@ -570,6 +737,7 @@ rx_compile_data (string_t * expr, int opt, Bool from_ed)
         {
             return NULL;
         }
+        size += rdata.rx->regalloc;
     }
 
 #ifndef RXCACHE_TABLE
@@ -595,16 +763,6 @@ rx_compile_data (string_t * expr, int opt, Bool from_ed)
 #else
 
     /* Wrap up the new regular expression and enter it into the table */
-    expr = make_tabled_from(expr); /* for faster comparisons */
-
-    if (NULL != pHash)
-    {
-        iNumXCollisions++;
-        iNumXEntries--;
-        iXSizeAlloc -= sizeof(*pHash) + pHash->size;
-        free_regdata(&(pHash->base));
-    }
-
     pHash = xalloc(sizeof(*pHash));
     if (!pHash)
     {
@@ -612,20 +770,28 @@ rx_compile_data (string_t * expr, int opt, Bool from_ed)
         outofmem(sizeof(*pHash), "Regexp cache structure");
         return NULL;
     }
-    xtable[h] = pHash;
 
     memcpy(&(pHash->base), &rdata, sizeof(pHash->base));
 
     pHash->base.ref = 1;
     pHash->base.opt = opt & ~(RE_PACKAGE_MASK);
-    pHash->pString = expr; /* refs are transferred */
+    pHash->pString = make_tabled_from(expr); /* for faster comparisons */
     pHash->hString = hExpr;
-    pHash->size = pcre_size;
+    pHash->size = size;
+
+    if (xtable[h] != NULL)
+        iNumXCollisions++;
+    pHash->pNext = xtable[h];
+    xtable[h] = pHash;
+    rx_lru_use(pHash);
 
     iNumXEntries++;
     iXSizeAlloc += sizeof(*pHash) + pHash->size;
 
-    return ref_regdata((regdata_t *)pHash);
+    /* Get our reference before the budget may throw the entry out. */
+    ref_regdata(&(pHash->base));
+    rx_shrink_cache();
+    return &(pHash->base);
 #endif /* RXCACHE_TABLE */
 } /* rx_compile_data() */
 
@@ -1157,7 +1323,7 @@ rx_free_subdata (regdata_t * expr)
 {
 #ifdef HAS_PCRE
     if (expr->pSubs)  xfree(expr->pSubs);  expr->pSubs = NULL;
-    if (expr->pHints) xfree(expr->pHints); expr->pHints = NULL;
+    if (expr->pHints) rx_free_study(expr->pHints); expr->pHints = NULL;
     if (expr->pProg)  xfree(expr->pProg);  expr->pProg = NULL;
 #endif // HAS_PCRE
     if (expr->rx)     xfree(expr->rx);     expr->rx = NULL;
@@ -1220,7 +1386,8 @@ rxcache_status (strbuf_t *sbuf, Bool verbose)
         strbuf_add(sbuf,   "--------------------\n");
         strbuf_addf(sbuf, "Expressions in cache:  %"PRIu32" (%.1f%%)\n"
                    , iNumXEntries, 100.0 * (float)iNumXEntries / RXCACHE_TABLE);
-        strbuf_addf(sbuf, "Memory allocated:      %"PRIu32"\n", iXSizeAlloc);
+        strbuf_addf(sbuf, "Memory allocated:      %"PRIu32" (limit %"PRIdPINT")\n"
+                   , iXSizeAlloc, iXSizeLimit);
         iNumXReq = iNumXRequests ? iNumXRequests : 1;
         strbuf_addf(sbuf
                , "Requests: %"PRIuSTATCOUNTER" - Found: %"PRIuSTATCOUNTER" (%.1f%%) - "
@@ -1229,6 +1396,14 @@ rxcache_status (strbuf_t *sbuf, Bool verbose)
                , iNumXCollisions, 100.0 * (float)iNumXCollisions/(float)iNumXReq
                , 100.0 * (float)iNumXCollisions/(iNumXEntries ? iNumXEntries : 1)
                );
+        strbuf_addf(sbuf, "Evicted: %"PRIuSTATCOUNTER" - JIT compiled: %"PRIuSTATCOUNTER"\n"
+                   , iNumXEvicted
+#ifdef HAS_PCRE
+                   , iNumXJit
+#else
+                   , (statcounter_t)0
+#endif
+                   );
     }
     else
     {
@@ -1257,9 +1432,9 @@ rxcache_driver_info (svalue_t *svp, int value)
  */
 
 {
-#ifdef RXCACHE_TABLE
     switch (value)
     {
+#ifdef RXCACHE_TABLE
         case DI_NUM_REGEX_LOOKUPS:
             put_number(svp, iNumXRequests);
             break;
@@ -1284,17 +1459,60 @@ rxcache_driver_info (svalue_t *svp, int value)
             put_number(svp, RXCACHE_TABLE);
             break;
 
+        case DI_NUM_REGEX_LOOKUP_EVICTIONS:
+            put_number(svp, iNumXEvicted);
+            break;
+
         case DI_SIZE_REGEX:
             put_number(svp, iXSizeAlloc);
             break;
+#endif /* RXCACHE_TABLE */
+
+        case DI_NUM_REGEX_JIT_COMPILES:
+#ifdef HAS_PCRE
+            put_number(svp, iNumXJit);
+#endif
+            break;
 
         default:
+#ifdef RXCACHE_TABLE
             fatal("Unknown option for rxcache_driver_info(): %d\n", value);
+#endif
             break;
     }
-#endif
 } /* rxcache_driver_info() */
 
+/*-------------------------------------------------------------------------*/
+void
+rxcache_set_size_limit (p_int size)
+
+/* Set the memory budget of the regexp cache to <size> bytes, and
+ * throw out expressions until the cache keeps to it. With a budget
+ * of 0, no expression is kept beyond its use.
+ */
+
+{
+#ifdef RXCACHE_TABLE
+    iXSizeLimit = size;
+    rx_shrink_cache();
+#endif
+} /* rxcache_set_size_limit() */
+
+/*-------------------------------------------------------------------------*/
+p_int
+rxcache_get_size_limit (void)
+
+/* Return the memory budget of the regexp cache, 0 if there is no cache.
+ */
+
+{
+#ifdef RXCACHE_TABLE
+    return iXSizeLimit;
+#else
+    return 0;
+#endif
+} /* rxcache_get_size_limit() */
+
 /*--------------------------------------------------------------------*/
 #if defined(GC_SUPPORT)
 
@@ -1309,13 +1527,10 @@ clear_rxcache_refs (void)
 
 {
 #ifdef RXCACHE_TABLE
-    int i;
+    RxHashEntry * pHash;
 
-    for (i = 0; i < RXCACHE_TABLE; i++)
-        if (NULL != xtable[i])
-        {
-            xtable[i]->base.ref = 0;
-        }
+    for (pHash = pLruFirst; pHash != NULL; pHash = pHash->pLruNext)
+        pHash->base.ref = 0;
 #endif
 } /* clear_rxcache_refs() */
 
@@ -1345,9 +1560,8 @@ count_regdata_ref (regdata_t * pRegexp)
 #ifdef HAS_PCRE
     if (pRegexp->pProg)
     {
+        /* The study data is in permanent memory. */
         note_malloced_block_ref(pRegexp->pProg);
-        if (pRegexp->pHints)
-            note_malloced_block_ref(pRegexp->pHints);
         if (pRegexp->pSubs)
             note_malloced_block_ref(pRegexp->pSubs);
     }
@@ -1382,15 +1596,10 @@ count_rxcache_refs (void)
 
 {
 #ifdef RXCACHE_TABLE
-    int i;
+    RxHashEntry * pHash;
 
-    for (i = 0; i < RXCACHE_TABLE; i++)
-    {
-        if (NULL != xtable[i])
-        {
-            count_regdata_ref((regdata_t *)xtable[i]);
-        }
-    } /* for (i) */
+    for (pHash = pLruFirst; pHash != NULL; pHash = pHash->pLruNext)
+        count_regdata_ref((regdata_t *)pHash);
 #endif
 
 } /* count_rxcache_refs() */
@@ -12,6 +12,10 @@
 
 /* --- Macros --- */
 
+#define DEFAULT_RXCACHE_SIZE (1024 * 1024)
+  /* Default memory budget of the regexp cache in bytes.
+   */
+
 /* --- Prototypes --- */
 
 extern void rx_init(void);
@@ -30,6 +34,8 @@ extern void   free_regexp(regexp_t *);
 extern const char * rx_pcre_version(void);
 extern size_t rxcache_status(strbuf_t *sbuf, Bool verbose);
 extern void   rxcache_driver_info (svalue_t *svp, int value) __attribute__((nonnull(1)));
+extern void   rxcache_set_size_limit (p_int size);
+extern p_int  rxcache_get_size_limit (void);
 
 #if defined(GC_SUPPORT)
 extern void clear_rxcache_refs(void);
@@ -13,8 +13,12 @@
  * On the creation of a new string the driver can lookup the table for
  * an already existing copy and return a reference to a string held therein.
  * This is used mainly for function names in programs, but also for
- * mapping keys. The table is organized as a hash table
- * with HTABLE_SIZE entries.
+ * mapping keys. The table is organized as a hash table of chains,
+ * starting with HTABLE_SIZE entries (rounded up to a power of two).
+ * When the table holds more strings than chains, it is doubled in size.
+ * This happens incrementally: the new table is allocated next to the old
+ * one, and every following table operation moves a few chains over. As the
+ * hash is cached in every string, this needs no access to the string text.
  *
  * Strings are sequences of chars, stored in an array of known size. The
  * size itself is stored separately, allowing the string to contain every
@@ -72,6 +76,7 @@
 
 #include "mstrings.h"
 
+#include "array.h"
 #include "gcollect.h"
 #include "hash.h"
 #include "main.h"
@@ -89,25 +94,37 @@
 The end.
 #endif
 
-static INLINE hash32_t
-HashToIndex(hash32_t hash)
-/* Adapt a hash value to our table size.
- */
-{
-#if !( (HTABLE_SIZE) & (HTABLE_SIZE)-1 )
-    // use faster masking in case of HTABLE_SIZE being a power of 2.
-    return hash & ((HTABLE_SIZE)-1);
-#else
-    // fallback to slow modulo.
-    return hash % HTABLE_SIZE;
-#endif
-}
+#define STRINGTABLE_REHASH_STEP 4
+  /* Number of non-empty chains moved into the new table with every
+   * insertion, lookup or removal while the table grows. At most ten
+   * times as many empty chains are skipped in one step.
+   */
+
+#define CHAIN_HISTOGRAM_SIZE 8
+  /* Number of entries in the chain length histogram: chains of length
+   * 0 to CHAIN_HISTOGRAM_SIZE-2 are counted individually, the last entry
+   * counts all longer chains.
+   */
 
 /*-------------------------------------------------------------------------*/
 
-static string_t ** stringtable = NULL;
-  /* The hashed string table: an array of pointers to the heads of
-   * the string chains.
+static string_t ** stringtable[2] = { NULL, NULL };
+static size_t stringtable_size[2] = { 0, 0 };
+  /* The hashed string tables: arrays of pointers to the heads of
+   * the string chains, their sizes are powers of two.
+   * stringtable[1] is only used while the table grows: then new strings
+   * are entered into stringtable[1], and the chains of stringtable[0] are
+   * moved over one by one, starting with <rehash_index>. Once all are
+   * moved, stringtable[1] replaces stringtable[0].
+   */
+
+static long rehash_index = -1;
+  /* The next chain of stringtable[0] to move, or -1 if the table
+   * does not grow at the moment.
+   */
+
+static statcounter_t mstr_resizes = 0;
+  /* Number of times the string table was grown.
    */
 
 /* Statistics */
@@ -256,6 +273,115 @@ mstring_get_hash (string_t * pStr)
     return get_hash(pStr);
 } /* mstring_get_hash() */
 
+/*-------------------------------------------------------------------------*/
+static INLINE string_t **
+StrChain (int t, hash32_t hash)
+
+/* Return the head of the chain in stringtable[<t>] for the hash <hash>.
+ */
+
+{
+    return stringtable[t] + (hash & (stringtable_size[t]-1));
+} /* StrChain() */
+
+/*-------------------------------------------------------------------------*/
+static void
+rehash_step (void)
+
+/* If the string table grows, move the next STRINGTABLE_REHASH_STEP chains
+ * into the new table. When all chains are moved, the new table replaces
+ * the old one.
+ */
+
+{
+    int chains = STRINGTABLE_REHASH_STEP;
+    int empty = 10 * STRINGTABLE_REHASH_STEP;
+
+    if (rehash_index < 0)
+        return;
+
+    while (chains > 0 && (size_t)rehash_index < stringtable_size[0])
+    {
+        string_t *string = stringtable[0][rehash_index];
+
+        if (!string)
+        {
+            rehash_index++;
+            if (--empty == 0)
+                return;
+            continue;
+        }
+
+        while (string)
+        {
+            string_t *next = string->next;
+            string_t **chain = StrChain(1, string->hash);
+
+            if (NULL == *chain)
+                mstr_chains++;
+            string->next = *chain;
+            *chain = string;
+            string = next;
+        }
+        stringtable[0][rehash_index++] = NULL;
+        mstr_chains--;
+        chains--;
+    }
+
+    if ((size_t)rehash_index >= stringtable_size[0])
+    {
+        xfree(stringtable[0]);
+        stringtable[0] = stringtable[1];
+        stringtable_size[0] = stringtable_size[1];
+        stringtable[1] = NULL;
+        stringtable_size[1] = 0;
+        rehash_index = -1;
+    }
+} /* rehash_step() */
+
+/*-------------------------------------------------------------------------*/
+static void
+enter_tabled (string_t * string)
+
+/* Enter the <string> (with its hash already computed) into the string
+ * table. Before that, grow the table if it holds more strings than it
+ * has chains.
+ */
+
+{
+    string_t **chain;
+
+    if (rehash_index < 0 && mstr_tabled_count >= stringtable_size[0])
+    {
+        size_t size = stringtable_size[0] * 2;
+        string_t **table = xalloc(sizeof(*table) * size);
+
+        /* If there is no memory, we just try again next time. */
+        if (table)
+        {
+            memset(table, 0, sizeof(*table) * size);
+            stringtable[1] = table;
+            stringtable_size[1] = size;
+            rehash_index = 0;
+            mstr_resizes++;
+        }
+    }
+
+    rehash_step();
+
+    /* While the table grows, new strings go into the new table. */
+    chain = StrChain((rehash_index < 0) ? 0 : 1, string->hash);
+
+    mstr_added++;
+    if (NULL == *chain)
+        mstr_chains++;
+    else
+        mstr_collisions++;
+
+    string->next = *chain;
+    *chain = string;
+} /* enter_tabled() */
+
 /*-------------------------------------------------------------------------*/
 static INLINE string_t *
 find_and_move (const char * const s, size_t size, hash32_t hash)
@@ -268,24 +394,33 @@ find_and_move (const char * const s, size_t size, hash32_t hash)
 
 {
     string_t *prev, *rover;
+    string_t **chain;
+    int t;
 
-    hash32_t idx = HashToIndex(hash);
+    rehash_step();
 
     mstr_searches_byvalue++;
 
-    /* Find the string in the table */
+    /* Find the string in the table, while growing in both tables */
 
     mstr_searchlen_byvalue++;
-    for ( prev = NULL, rover = stringtable[idx]
-        ;    rover != NULL
-          && get_txt(rover) != s
-          && !(   size == mstrsize(rover)
-               && hash == get_hash(rover)
-               && 0 == memcmp(get_txt(rover), s, size)
-              )
-        ; prev = rover, rover = rover->next
-        )
-        mstr_searchlen_byvalue++;
+    for (t = (rehash_index < 0) ? 0 : 1; t >= 0; t--)
+    {
+        chain = StrChain(t, hash);
+        for ( prev = NULL, rover = *chain
+            ;    rover != NULL
+              && get_txt(rover) != s
+              && !(   size == mstrsize(rover)
+                   && hash == rover->hash
+                   && 0 == memcmp(get_txt(rover), s, size)
+                  )
+            ; prev = rover, rover = rover->next
+            )
+            mstr_searchlen_byvalue++;
+
+        if (rover)
+            break;
+    }
 
     /* If the string is in the table (rover != NULL), but not at the beginning
      * of the chain, move it there.
@@ -293,8 +428,8 @@ find_and_move (const char * const s, size_t size, hash32_t hash)
     if (rover && prev)
     {
         prev->next = rover->next;
-        rover->next = stringtable[idx];
-        stringtable[idx] = rover;
+        rover->next = *chain;
+        *chain = rover;
     }
 
     if (rover)
@@ -304,45 +439,56 @@ find_and_move (const char * const s, size_t size, hash32_t hash)
 } /* find_and_move() */
 
 /*-------------------------------------------------------------------------*/
-static INLINE string_t *
-move_to_head (string_t *s, int idx)
+static INLINE string_t **
+move_to_head (string_t *s)
 
-/* If <s> is a tabled string in the stringtable[<index>] chain: move it to
- * the head of the chain and return its pointer.
- * If <s> is not found in that chain, return NULL.
+/* If <s> is a tabled string in the string table: move it to the head
+ * of its chain and return the pointer to the chain head.
+ * If <s> is not found in its chain, return NULL.
  */
 
 {
     string_t *prev, *rover;
+    string_t **chain;
+    int t;
+
+    rehash_step();
 
     mstr_searches++;
 
     /* Find the string in the table */
 
     mstr_searchlen++;
-    for ( prev = NULL, rover = stringtable[idx]
-        ; rover != NULL && rover != s
-        ; prev = rover, rover = rover->next
-        )
+    for (t = (rehash_index < 0) ? 0 : 1; t >= 0; t--)
     {
-        mstr_searchlen++;
+        chain = StrChain(t, s->hash);
+        for ( prev = NULL, rover = *chain
+            ; rover != NULL && rover != s
+            ; prev = rover, rover = rover->next
+            )
+        {
+            mstr_searchlen++;
+        }
+
+        if (rover)
+            break;
     }
 
-    /* If s is found (rover != NULL), but not at the beginning of the chain,
-     * move it there
-     */
+    if (!rover)
+        return NULL;
 
-    if (rover && prev)
+    /* If s is not at the beginning of the chain, move it there */
+
+    if (prev)
     {
         prev->next = rover->next;
-        rover->next = stringtable[idx];
-        stringtable[idx] = rover;
+        rover->next = *chain;
+        *chain = rover;
     }
 
-    if (rover)
-        mstr_found++;
+    mstr_found++;
 
-    return rover;
+    return chain;
 } /* move_to_head() */
 
 /*-------------------------------------------------------------------------*/
@@ -359,7 +505,6 @@ make_new_tabled (const char * const pTxt, size_t size, hash32_t hash MTRACE_DECL
 
 {
     string_t * string;
-    hash32_t   idx = HashToIndex(hash);
 
     /* Get the memory for a new one */
 
@@ -380,14 +525,7 @@ make_new_tabled (const char * const pTxt, size_t size, hash32_t hash MTRACE_DECL
        * the bitfield is initialized in parts.
        */
 
-    mstr_added++;
-    if (NULL == stringtable[idx])
-        mstr_chains++;
-    else
-        mstr_collisions++;
-
-    string->next = stringtable[idx];
-    stringtable[idx] = string;
+    enter_tabled(string);
 
     {
         size_t msize;
@@ -579,7 +717,6 @@ table_string (string_t * pStr MTRACE_DECL)
 {
     string_t *string;
     hash32_t   hash;
-    hash32_t   idx;
     size_t     size;
     size_t     msize;
 
@@ -593,7 +730,6 @@ table_string (string_t * pStr MTRACE_DECL)
 
     size = pStr->size;
     hash = get_hash(pStr);
-    idx = HashToIndex(hash);
 
     /* Check if the string has already been tabled */
     string = find_and_move(pStr->txt, size, hash);
@@ -607,15 +743,9 @@ table_string (string_t * pStr MTRACE_DECL)
             return string;
 
         string->info.type = STRING_TABLED;
+        string->hash = hash;
 
-        mstr_added++;
-        if (NULL == stringtable[idx])
-            mstr_chains++;
-        else
-            mstr_collisions++;
-
-        string->next = stringtable[idx];
-        stringtable[idx] = pStr;
+        enter_tabled(string);
 
         mstr_tabled_count++;
         mstr_tabled_size += msize;
@@ -969,22 +1099,22 @@ mstring_free (string_t *s)
     {
         /* A tabled string */
 
-        hash32_t idx;
+        string_t **chain;
 
         mstr_tabled_count--;
         mstr_tabled_size -= msize;
 
-        idx = HashToIndex(get_hash(s));
-        if (NULL == move_to_head(s, idx))
+        chain = move_to_head(s);
+        if (NULL == chain)
         {
             fatal("String %p (%s) doesn't hash to the same spot.\n"
                  , s, s->txt
                  );
         }
 
-        stringtable[idx] = s->next;
+        *chain = s->next;
 
-        if (NULL == stringtable[idx])
+        if (NULL == *chain)
             mstr_chains--;
         mstr_deleted++;
 
@@ -1154,42 +1284,12 @@ mstring_mstr_n_str ( const string_t * const pStr, size_t start
  */
 
 {
-    const char * cp;
-    size_t left;
-    char   first;
-
     if (start > mstrsize(pStr))
         return NULL;
 
-    /* Initialize 'characters remaining' and 'current position' */
-    left = mstrsize(pStr) - start;
     /* remove the const qualifier temporarily when calling get_txt(). */
-    cp = get_txt((string_t *const)pStr)+start;
-
-    /* Special case: strstr("text", "") */
-    if (len == 0)
-        return cp;
-
-    first = *pTxt;
-
-    while (left >= len)
-    {
-        const char * next;
-
-        next = memchr(cp, first, left);
-        if (NULL == next)
-            break;
-        left -= next - cp;
-        if (left >= len && 0 == memcmp(next, pTxt, len))
-            return next;
-        if (left > 0)
-        {
-            cp = next+1;
-            left--;
-        }
-    }
-
-    return NULL;
+    return xmemmem(get_txt((string_t *const)pStr) + start
+                  , mstrsize(pStr) - start, pTxt, len);
 } /* mstring_mstr_n_str() */
 
 /*-------------------------------------------------------------------------*/
@@ -1674,16 +1774,19 @@ mstring_init (void)
  */
 
 {
-    int x;
+    size_t size = 16;
 
-    stringtable = xalloc(sizeof(*stringtable) * HTABLE_SIZE);
+    while (size < HTABLE_SIZE)
+        size *= 2;
 
-    if (!stringtable)
+    stringtable[0] = xalloc(sizeof(*stringtable[0]) * size);
+
+    if (!stringtable[0])
         fatal("(mstring_init) Out of memory (%lu bytes) for string table\n"
-             , (unsigned long) sizeof(*stringtable)*HTABLE_SIZE);
+             , (unsigned long) sizeof(*stringtable[0])*size);
 
-    for (x = 0; x < HTABLE_SIZE; x++)
-        stringtable[x] = NULL;
+    memset(stringtable[0], 0, sizeof(*stringtable[0]) * size);
+    stringtable_size[0] = size;
 
     init_standard_strings();
 } /* mstring_init() */
@@ -1699,16 +1802,18 @@ mstring_clear_refs (void)
  */
 
 {
-    int x;
+    int t;
+    size_t x;
 
-    for (x = 0; x < HTABLE_SIZE; x++)
-    {
-        string_t *p;
-        for (p = stringtable[x]; p; p = p->next )
+    for (t = 0; t < 2; t++)
+        for (x = 0; x < stringtable_size[t]; x++)
         {
-            p->info.ref = 0;
+            string_t *p;
+            for (p = stringtable[t][x]; p; p = p->next )
+            {
+                p->info.ref = 0;
+            }
         }
-    }
 
 } /* mstring_clear_refs() */
 
@@ -1722,7 +1827,9 @@ mstring_note_refs (void)
 {
     int x;
 
-    note_malloced_block_ref(stringtable);
+    note_malloced_block_ref(stringtable[0]);
+    if (stringtable[1])
+        note_malloced_block_ref(stringtable[1]);
 
     for (x = 0; x < SHSTR_NOSTRINGS; x++)
     {
@@ -1741,16 +1848,18 @@ mstring_walk_table (void (*func) (string_t *))
  */
 
 {
-    int x;
+    int t;
+    size_t x;
 
-    for (x = 0; x < HTABLE_SIZE; x++)
-    {
-        string_t * p;
-        for (p = stringtable[x]; NULL != p; p = p->next)
+    for (t = 0; t < 2; t++)
+        for (x = 0; x < stringtable_size[t]; x++)
         {
-            (*func)(p);
+            string_t * p;
+            for (p = stringtable[t][x]; NULL != p; p = p->next)
+            {
+                (*func)(p);
+            }
         }
-    }
 } /* mstring_walk_table() */
 
 /*-------------------------------------------------------------------------*/
@@ -1764,51 +1873,83 @@ mstring_gc_table (void)
  */
 
 {
-    int x;
+    int t;
+    size_t x;
 
-    for (x = 0; x < HTABLE_SIZE; x++)
-    {
-        string_t * prev, * next;
-        for (prev = NULL, next = stringtable[x]; next != NULL; )
+    for (t = 0; t < 2; t++)
+        for (x = 0; x < stringtable_size[t]; x++)
         {
-            if (next->info.ref == 0)
+            string_t * prev, * next;
+            for (prev = NULL, next = stringtable[t][x]; next != NULL; )
             {
-                string_t * this = next;
-
-                /* Unlink the string from the table, then free it. */
-                if (prev == NULL)
+                if (next->info.ref == 0)
                 {
-                    stringtable[x] = this->next;
-                    next = this->next;
+                    string_t * this = next;
+
+                    /* Unlink the string from the table, then free it. */
+                    if (prev == NULL)
+                    {
+                        stringtable[t][x] = this->next;
+                        next = this->next;
+                        if (next == NULL)
+                            mstr_chains--;
+                    }
+                    else
+                    {
+                        prev->next = this->next;
+                        next = this->next;
+                    }
+
+                    mstr_untabled_count++;
+                    mstr_untabled_size += mstr_mem_size(this);
+                    mstr_tabled_count--;
+                    mstr_tabled_size += mstr_mem_size(this);
+                    mstr_deleted++;
+
+                    this->info.ref = 1;
+                    this->info.type = STRING_UNTABLED;
+                    free_mstring(this);
                 }
                 else
                 {
-                    prev->next = this->next;
-                    next = this->next;
+                    /* Step to next string */
+                    prev = next;
+                    next = next->next;
                 }
-
-                mstr_untabled_count++;
-                mstr_untabled_size += mstr_mem_size(this);
-                mstr_tabled_count--;
-                mstr_tabled_size += mstr_mem_size(this);
-                mstr_deleted++;
-
-                this->info.ref = 1;
-                this->info.type = STRING_UNTABLED;
-                free_mstring(this);
-            }
-            else
-            {
-                /* Step to next string */
-                prev = next;
-                next = next->next;
             }
-        }
-    } /* for (x) */
+        } /* for (x) */
 } /* mstring_gc_table() */
 
 #endif /* GC_SUPPORT */
 
+/*-------------------------------------------------------------------------*/
+static void
+chain_histogram (mp_uint histogram[CHAIN_HISTOGRAM_SIZE])
+
+/* Count the chains of the string table by their length into <histogram>:
+ * entry i is the number of chains with i strings, the last entry counts
+ * all chains with CHAIN_HISTOGRAM_SIZE-1 or more strings.
+ */
+
+{
+    int t, len;
+    size_t x;
+
+    for (len = 0; len < CHAIN_HISTOGRAM_SIZE; len++)
+        histogram[len] = 0;
+
+    for (t = 0; t < 2; t++)
+        for (x = 0; x < stringtable_size[t]; x++)
+        {
+            string_t * p;
+
+            len = 0;
+            for (p = stringtable[t][x]; NULL != p && len < CHAIN_HISTOGRAM_SIZE-1; p = p->next)
+                len++;
+            histogram[len]++;
+        }
+} /* chain_histogram() */
+
 /*-------------------------------------------------------------------------*/
 mp_int
 add_string_status (strbuf_t *sbuf, Bool verbose)
@@ -1820,12 +1961,12 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
 {
 #   define STR_OVERHEAD (sizeof(string_t)+1)
 
-    statcounter_t stringtable_size;
+    statcounter_t table_size;
     statcounter_t distinct_strings;
     statcounter_t distinct_size;
     statcounter_t distinct_overhead;
 
-    stringtable_size = HTABLE_SIZE * sizeof(string_t *);
+    table_size = (stringtable_size[0] + stringtable_size[1]) * sizeof(string_t *);
     distinct_strings = mstr_tabled_count + mstr_untabled_count;
     distinct_size = mstr_tabled_size + mstr_untabled_size;
     distinct_overhead = mstr_tabled_count * STR_OVERHEAD
@@ -1836,9 +1977,9 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
         strbuf_addf(sbuf
                    , "Strings alloced\t\t\t%8"PRIuSTATCOUNTER" %9"PRIuSTATCOUNTER
                      " (%"PRIuSTATCOUNTER" + %"PRIuSTATCOUNTER" overhead)\n"
-                   , distinct_strings, distinct_size + stringtable_size
+                   , distinct_strings, distinct_size + table_size
                    , distinct_size - distinct_overhead
-                   , distinct_overhead + stringtable_size
+                   , distinct_overhead + table_size
                    );
     }
     else
@@ -1857,17 +1998,17 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
         strbuf_addf(sbuf,  "Total allocated\t%9"PRIuSTATCOUNTER" %9"PRIuSTATCOUNTER
                            " (%9"PRIuSTATCOUNTER"+%9"PRIuSTATCOUNTER")\n"
                         , distinct_strings
-                        , distinct_size + stringtable_size
+                        , distinct_size + table_size
                         , distinct_size - distinct_overhead
-                        , distinct_overhead + stringtable_size
+                        , distinct_overhead + table_size
                         );
         strbuf_addf(sbuf,  " - tabled\t%9"PRIuMPINT" %9"PRIuSTATCOUNTER" (%9"PRIuMPINT"+%9"PRIuSTATCOUNTER")\n"
                         , mstr_tabled_count
-                        , mstr_tabled_size + stringtable_size
+                        , mstr_tabled_size + table_size
                         , mstr_tabled_size
                           ? mstr_tabled_size - mstr_tabled_count * STR_OVERHEAD
                           : 0
-                        , mstr_tabled_count * STR_OVERHEAD + stringtable_size
+                        , mstr_tabled_count * STR_OVERHEAD + table_size
                         );
         strbuf_addf(sbuf,  " - untabled\t%9"PRIuMPINT" %9"PRIuMPINT" (%9"PRIuMPINT"+%9"PRIuMPINT")\n"
                         , mstr_untabled_count
@@ -1879,9 +2020,9 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
                         );
         strbuf_addf(sbuf, "\nSpace required vs. 'regular C' string implementation: "
                           "%"PRIuSTATCOUNTER"%% with, %"PRIuSTATCOUNTER"%% without overhead.\n"
-                        , ((distinct_size + stringtable_size) * 100L)
+                        , ((distinct_size + table_size) * 100L)
                           / (mstr_used_size - mstr_used * sizeof(string_t))
-                        , ((distinct_size + stringtable_size
+                        , ((distinct_size + table_size
                                           - distinct_overhead) * 100L)
                           / (mstr_used_size - mstr_used * STR_OVERHEAD)
                         );
@@ -1895,10 +2036,27 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
                         , mstr_found_byvalue, 100.0 * (float)mstr_found_byvalue / (float)mstr_searches_byvalue
                         , (float)mstr_searchlen_byvalue / (float)mstr_searches_byvalue
                         );
-        strbuf_addf(sbuf, "Hash chains used: %"PRIuMPINT" of %lu (%.1f%%)\n"
-                        , mstr_chains, (unsigned long)HTABLE_SIZE
-                        , 100.0 * (float)mstr_chains / (float)HTABLE_SIZE
-                        );
+        {
+            mp_uint histogram[CHAIN_HISTOGRAM_SIZE];
+            size_t slots = stringtable_size[0] + stringtable_size[1];
+            int len;
+
+            strbuf_addf(sbuf, "Hash chains used: %"PRIuMPINT" of %lu (%.1f%%)"
+                              " - table grown %"PRIuSTATCOUNTER" times%s\n"
+                            , mstr_chains, (unsigned long)slots
+                            , 100.0 * (float)mstr_chains / (float)slots
+                            , mstr_resizes
+                            , (rehash_index >= 0) ? ", growing" : ""
+                            );
+
+            chain_histogram(histogram);
+            strbuf_add(sbuf, "Hash chain lengths:");
+            for (len = 0; len < CHAIN_HISTOGRAM_SIZE; len++)
+                strbuf_addf(sbuf, " %d%s: %"PRIuMPINT
+                                , len, (len == CHAIN_HISTOGRAM_SIZE-1) ? "+" : ""
+                                , histogram[len]);
+            strbuf_add(sbuf, "\n");
+        }
         strbuf_addf(sbuf, "Distinct strings added: %"PRIuSTATCOUNTER" "
                           "- deleted: %"PRIuSTATCOUNTER"\n"
                         , mstr_added, mstr_deleted
@@ -1930,7 +2088,7 @@ add_string_status (strbuf_t *sbuf, Bool verbose)
 #endif /* EXT_STRING_STATS */
     }
 
-    return stringtable_size + distinct_size;
+    return table_size + distinct_size;
 #   undef STR_OVERHEAD
 } /* add_string_status() */
 
@@ -1981,6 +2139,21 @@ string_driver_info (svalue_t *svp, int value)
             put_number(svp, mstr_collisions);
             break;
 
+        case DI_STRING_TABLE_CHAIN_LENGTHS:
+        {
+            mp_uint histogram[CHAIN_HISTOGRAM_SIZE];
+            vector_t *v;
+            int len;
+
+            memsafe(v = allocate_array(CHAIN_HISTOGRAM_SIZE), sizeof(*v), "result array");
+
+            chain_histogram(histogram);
+            for (len = 0; len < CHAIN_HISTOGRAM_SIZE; len++)
+                put_number(v->item + len, histogram[len]);
+            put_array(svp, v);
+            break;
+        }
+
 
         case DI_NUM_VIRTUAL_STRINGS:
             put_number(svp, mstr_used);
@@ -1999,7 +2172,7 @@ string_driver_info (svalue_t *svp, int value)
             break;
 
         case DI_NUM_STRING_TABLE_SLOTS:
-            put_number(svp, HTABLE_SIZE);
+            put_number(svp, stringtable_size[0] + stringtable_size[1]);
             break;
 
         case DI_NUM_STRING_TABLE_SLOTS_USED:
@@ -2020,7 +2193,7 @@ string_driver_info (svalue_t *svp, int value)
             break;
 
         case DI_SIZE_STRING_TABLE:
-            put_number(svp, HTABLE_SIZE * sizeof(string_t *));
+            put_number(svp, (stringtable_size[0] + stringtable_size[1]) * sizeof(string_t *));
             break;
 
         case DI_SIZE_STRING_OVERHEAD:
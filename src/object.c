@@ -52,6 +52,8 @@
  *     O_DESTRUCTED       : has actually been destructed
  *     O_SWAPPED          : program and/or variables have been swapped out
  *     O_ONCE_INTERACTIVE : is or was interactive
+ *     O_NO_ACTIONS       : the program declares no actions; this is
+ *                          kept here so that it survives swapping.
  *     O_RESET_STATE      : is in a virgin resetted state
  *     O_WILL_CLEAN_UP    : call clean_up() when time is due
  *     O_LAMBDA_REFERENCED: a reference to a lambda was taken; this may
@@ -670,6 +672,8 @@ _free_prog (program_t *progp, Bool free_all, const char * file, int line
         /* Remove the swap entry */
         remove_prog_swap(progp, MY_FALSE);
 
+        forget_action_table(progp);
+
         program = progp->program;
         functions = progp->functions;
 
@@ -827,8 +831,8 @@ reset_object (object_t *ob, int arg)
  *
  * If the delay to the next (resp. first) reset is not determined by
  * the called function, it is set to a random value between time_to_reset/2
- * and time_to_reset. Upon time of call, the object must not be
- * in the reset table; this function will enter it there.
+ * and time_to_reset. The object is (re)entered into the reset queue
+ * of process_objects() accordingly.
  */
 
 {
@@ -836,6 +840,7 @@ reset_object (object_t *ob, int arg)
     if (time_to_reset > 0)
         ob->time_reset = current_time + time_to_reset/2
                          + (mp_int)random_number((uint32)time_to_reset/2);
+    schedule_object(ob);
 
     if (driver_hook[arg].type == T_CLOSURE)
     {
@@ -886,6 +891,7 @@ reset_object (object_t *ob, int arg)
 
     /* Object is reset now */
     ob->flags |= O_RESET_STATE;
+    schedule_object(ob);
 } /* reset_object() */
 
 /*-------------------------------------------------------------------------*/
@@ -1081,6 +1087,7 @@ replace_programs (void)
         r_ob->new_prog->ref++;
         r_ob->ob->prog = r_ob->new_prog;
         r_ob->ob->flags |= O_REPLACED;
+        r_ob->ob->flags &= ~O_NO_ACTIONS;
 
         r_next = r_ob->next;  /* remove it from the list */
 
@@ -1306,11 +1313,12 @@ tell_object (object_t *ob, string_t *str)
 
 /*-------------------------------------------------------------------------*/
 Bool
-shadow_catch_message (object_t *ob, const char *str)
+shadow_catch_message (object_t *ob, const char *str, string_t *sstr)
 
 /* Called by comm:add_message() to handle the case that messages <str> sent
  * to interactive objects <ob> are to be delivered to shadows of the
- * OR to a function in the interactive itself.
+ * OR to a function in the interactive itself. If the message was given
+ * as string <sstr>, it is passed on by reference instead of copying <str>.
  *
  * This function checks all shadows of <ob> if they contain the lfun
  * catch_tell(), and calls the lfun in the first shadow where it exists
@@ -1340,7 +1348,10 @@ shadow_catch_message (object_t *ob, const char *str)
         return MY_FALSE;
 
     trace_level |= ip->trace_level;
-    push_c_string(inter_sp, str);
+    if (sstr)
+        push_ref_string(inter_sp, sstr);
+    else
+        push_c_string(inter_sp, str);
     if (sapply(STR_CATCH_TELL, ob, 1))
         return MY_TRUE;
 
@@ -1437,6 +1448,7 @@ renumber_programs (void)
             renumber_program(ob->prog);
     }
     invalidate_apply_low_cache();
+    clear_action_tables();
     return ++current_id_number;
 }
 
@@ -3663,6 +3675,7 @@ f_set_next_reset (svalue_t *sp)
             current_object->time_reset = 0;
         else if (new_time > 0)
             current_object->time_reset = new_time + current_time;
+        schedule_object(current_object);
     }
     return sp;
 } /* f_set_next_reset() */
@@ -4308,41 +4321,432 @@ f_move_object (svalue_t *sp)
     return sp;
 } /* f_move_object() */
 
+/*-------------------------------------------------------------------------*/
+/* The ids declared with configure_object(OC_IDS) are kept in ob->ids as
+ * an array of unique tabled strings. present() matches such an object
+ * against them instead of calling id() in it.
+ *
+ * An inventory of at least ID_INDEX_THRESHOLD objects is indexed by the
+ * declared ids when present() searches it first. The index is thrown
+ * away whenever the inventory or the ids of an object in it change.
+ */
+
+#define ID_INDEX_THRESHOLD  32
+  /* Minimum number of objects in an inventory to index it.
+   */
+
+#define ID_INDEX_MIN_SIZE   16
+  /* Minimum size of the hash table of an id index.
+   */
+
+typedef struct id_entry_s id_entry_t;
+
+struct id_entry_s
+{
+    id_entry_t *next;
+      /* Next entry in the hash chain, or in the list of undeclared
+       * objects.
+       */
+    string_t   *id;   /* The declared id (tabled), NULL for undeclared */
+    object_t   *ob;   /* The object */
+    p_int       pos;  /* Position of the object in the inventory */
+};
+
+struct id_index_s
+{
+    p_int       size;       /* Size of the hash table, a power of 2 */
+    id_entry_t *undeclared;
+      /* The objects without declared ids in inventory order.
+       */
+    id_entry_t *table[1];
+      /* The hash table of the declared ids, each chain in
+       * inventory order. The entries follow the table in the
+       * same memory block.
+       */
+};
+
+/*-------------------------------------------------------------------------*/
+void
+free_id_index (object_t *ob)
+
+/* Free the id index of the inventory of <ob>, if any.
+ */
+
+{
+    if (ob->id_index)
+    {
+        xfree(ob->id_index);
+        ob->id_index = NULL;
+    }
+} /* free_id_index() */
+
+/*-------------------------------------------------------------------------*/
+void
+free_object_ids (object_t *ob)
+
+/* Remove the declared ids of <ob>, if any, and with them the index
+ * of the inventory <ob> is in.
+ */
+
+{
+    if (ob->ids)
+    {
+        free_array(ob->ids);
+        ob->ids = NULL;
+        if (ob->super)
+            free_id_index(ob->super);
+    }
+} /* free_object_ids() */
+
+/*-------------------------------------------------------------------------*/
+void
+set_object_ids (object_t *ob, vector_t *ids)
+
+/* Declare the strings in <ids> as the ids of <ob>, or remove the declared
+ * ids if <ids> is NULL. Duplicate ids are dropped.
+ */
+
+{
+    vector_t *vec = NULL;
+
+    if (ids)
+    {
+        p_int size = (p_int)VEC_SIZE(ids);
+        p_int num, i, j;
+
+        for (i = 0; i < size; i++)
+            if (ids->item[i].type != T_STRING)
+                errorf("Bad id for OC_IDS: got %s, expected string.\n"
+                      , typename(ids->item[i].type));
+
+        vec = allocate_array(size);
+        for (num = i = 0; i < size; i++)
+        {
+            string_t *id = make_tabled_from(ids->item[i].u.str);
+
+            if (!id)
+            {
+                free_array(vec);
+                outofmem(mstrsize(ids->item[i].u.str), "id string");
+            }
+
+            for (j = 0; j < num && vec->item[j].u.str != id; j++) NOOP;
+            if (j < num)
+                free_mstring(id);
+            else
+            {
+                put_string(vec->item + num, id);
+                num++;
+            }
+        }
+
+        if (num < size)
+        {
+            vector_t *unique = slice_array(vec, 0, num - 1);
+
+            free_array(vec);
+            vec = unique;
+        }
+    }
+
+    if (ob->ids)
+        free_object_ids(ob);
+    else if (ob->super)
+        free_id_index(ob->super);
+    ob->ids = vec;
+} /* set_object_ids() */
+
+/*-------------------------------------------------------------------------*/
+static id_index_t *
+build_id_index (object_t *env)
+
+/* Build the id index of the inventory of <env> and return it.
+ * If nothing in there declared ids, or if the memory for the index
+ * can't be allocated, <env> goes without and NULL is returned.
+ */
+
+{
+    id_index_t *index;
+    id_entry_t *entries, *entry, **undeclared;
+    object_t *ob;
+    p_int num_entries, num_ids, size, pos;
+
+    /* Count the entries: one per declared id or undeclared object. */
+    num_entries = 0;
+    num_ids = 0;
+    for (ob = env->contains; ob; ob = ob->next_inv)
+    {
+        if (!ob->ids)
+            num_entries++;
+        else
+            num_ids += (p_int)VEC_SIZE(ob->ids);
+    }
+
+    /* Without declared ids there's nothing to index. */
+    if (!num_ids)
+        return NULL;
+    num_entries += num_ids;
+
+    for (size = ID_INDEX_MIN_SIZE; size < num_ids / 2; )
+        size *= 2;
+
+    index = xalloc(sizeof(*index) + (size - 1) * sizeof(index->table[0])
+                                  + num_entries * sizeof(*entries));
+    if (!index)
+        return NULL;
+
+    index->size = size;
+    index->undeclared = NULL;
+    memset(index->table, 0, size * sizeof(index->table[0]));
+    entries = (id_entry_t *)(index->table + size);
+
+    /* Fill the entries in inventory order... */
+    entry = entries;
+    undeclared = &index->undeclared;
+    for (pos = 0, ob = env->contains; ob; pos++, ob = ob->next_inv)
+    {
+        if (!ob->ids)
+        {
+            entry->id = NULL;
+            entry->ob = ob;
+            entry->pos = pos;
+            *undeclared = entry;
+            undeclared = &entry->next;
+            entry++;
+        }
+        else
+        {
+            svalue_t *svp = ob->ids->item;
+            p_int i;
+
+            for (i = (p_int)VEC_SIZE(ob->ids); i > 0; i--, svp++, entry++)
+            {
+                entry->id = svp->u.str;
+                entry->ob = ob;
+                entry->pos = pos;
+            }
+        }
+    }
+    *undeclared = NULL;
+
+    /* ...and hash them backwards, so that the chains end up in that order.
+     */
+    while (entry-- != entries)
+    {
+        id_entry_t **chain;
+
+        if (!entry->id)
+            continue;
+
+        chain = &index->table[mstr_get_hash(entry->id) & (size - 1)];
+        entry->next = *chain;
+        *chain = entry;
+    }
+
+    env->id_index = index;
+    return index;
+} /* build_id_index() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+object_has_id (object_t *ob, string_t *str, string_t *id)
+
+/* Return whether <ob> identifies as <str>, whose tabled version is <id>
+ * (NULL if there is none): by its declared ids, or else by calling
+ * id() in it. Check <ob> for destruction afterwards!
+ */
+
+{
+    svalue_t *ret;
+
+    if (ob->ids)
+    {
+        svalue_t *svp = ob->ids->item;
+        p_int i;
+
+        if (!id)
+            return MY_FALSE;
+        for (i = (p_int)VEC_SIZE(ob->ids); i > 0; i--, svp++)
+            if (svp->u.str == id)
+                return MY_TRUE;
+        return MY_FALSE;
+    }
+
+    push_ref_string(inter_sp, str);
+    ret = sapply(STR_ID, ob, 1);
+    return ret != NULL && !(ret->type == T_NUMBER && ret->u.number == 0);
+} /* object_has_id() */
+
 /*-------------------------------------------------------------------------*/
 static object_t *
-object_present_in (string_t *str, object_t *ob, p_int num, p_int * num_matched)
+object_present_in_index (string_t *str, string_t *id, id_entry_t *first
+                        , id_index_t *index, object_t *env
+                        , p_int num, p_int * num_matched)
+
+/* Look for the <num>th object matching <str> (tabled: <id>) in <env>
+ * with the help of its id <index>: only the objects declaring <id>,
+ * which start with the index entry <first>, and the objects without
+ * declared ids are tested. Result and *<num_matched> are those of
+ * object_present_in().
+ */
+
+{
+    id_entry_t *match, *undeclared;
+    vector_t *candidates;
+    svalue_t *svp;
+    object_t *ob, *found;
+    p_int count, num_candidates;
+
+    count = num-1;
+
+    if (!index->undeclared)
+    {
+        /* No id() to call: the matches can be counted right here. */
+        for (match = first; match; match = match->next)
+        {
+            if (match->id != id)
+                continue;
+
+            if (num_matched)
+                (*num_matched)++;
+
+            if (count-- > 0)
+                continue;
+
+            return match->ob;
+        }
+
+        return NULL;
+    }
+
+    /* The id() calls may change the inventory and with it the index,
+     * so collect the candidates in inventory order first.
+     */
+    num_candidates = 0;
+    for (undeclared = index->undeclared; undeclared; undeclared = undeclared->next)
+        num_candidates++;
+    for (match = first; match; match = match->next)
+        if (match->id == id)
+            num_candidates++;
+
+    candidates = allocate_array_unlimited(num_candidates);
+    push_array(inter_sp, candidates);
+
+    match = first;
+    undeclared = index->undeclared;
+    svp = candidates->item;
+
+    while (match || undeclared)
+    {
+        if (!undeclared || (match && match->pos < undeclared->pos))
+        {
+            put_ref_object(svp, match->ob, "present");
+            do
+                match = match->next;
+            while (match && match->id != id);
+        }
+        else
+        {
+            put_ref_object(svp, undeclared->ob, "present");
+            undeclared = undeclared->next;
+        }
+        svp++;
+    }
+
+    /* Now test them, skipping those which left meanwhile. */
+    found = NULL;
+    for (svp = candidates->item; num_candidates > 0; num_candidates--, svp++)
+    {
+        ob = svp->u.ob;
+        if ((ob->flags & O_DESTRUCTED) || ob->super != env)
+            continue;
+
+        if (!object_has_id(ob, str, id))
+        {
+            if (ob->flags & O_DESTRUCTED)
+                break;
+            continue;
+        }
+        if (ob->flags & O_DESTRUCTED)
+            break;
+
+        if (num_matched)
+            (*num_matched)++;
+
+        if (count-- > 0)
+            continue;
+
+        found = ob;
+        break;
+    }
+
+    free_svalue(inter_sp--);
+    return found;
+} /* object_present_in_index() */
 
-/* <ob> is the first object in an environment: test all the objects there
- * if they match the id <str>.
- * If <hasNumber> is false, <str> may be of the form "<id> <num>" - then the
- * <num>th object with this <id> is returned, it it is found.
- * If <hasNumber> is true, the <num>th object with the given id is returned.
+/*-------------------------------------------------------------------------*/
+static object_t *
+object_present_in (string_t *str, object_t *env, p_int num, p_int * num_matched)
+
+/* Test the objects in the inventory of <env> if they match the id <str>
+ * and return the <num>th object matching, if it is found.
  *
  * If the object is not found, *<num_matched> (if not NULL) is set to the
  * number of objects which did match the id.
  */
 
 {
-    svalue_t *ret;
+    object_t *ob;
+    id_index_t *index;
+    string_t *id;
     p_int count = 0; /* return the <count+1>th object */
 
     if (num_matched)
         *num_matched = 0;
 
+    /* Only a tabled string can be a declared id. */
+    id = find_tabled(str);
+
+    index = env->id_index;
+    if (!index)
+    {
+        p_int num_obs = 0;
+
+        for ( ob = env->contains
+            ; ob && num_obs < ID_INDEX_THRESHOLD
+            ; ob = ob->next_inv)
+            num_obs++;
+        if (num_obs >= ID_INDEX_THRESHOLD)
+            index = build_id_index(env);
+    }
+
+    if (index && id)
+    {
+        id_entry_t *first;
+
+        for ( first = index->table[mstr_get_hash(id) & (index->size - 1)]
+            ; first && first->id != id
+            ; first = first->next) NOOP;
+
+        /* Without declared matches, the plain search is cheaper. */
+        if (first || !index->undeclared)
+            return object_present_in_index(str, id, first, index, env
+                                          , num, num_matched);
+    }
+
     count = num-1;
 
     /* Now look for the object */
-    for (; ob; ob = ob->next_inv)
+    for (ob = env->contains; ob; ob = ob->next_inv)
     {
-        push_ref_string(inter_sp, str);
-        ret = sapply(STR_ID, ob, 1);
-        if (ob->flags & O_DESTRUCTED)
+        if (!object_has_id(ob, str, id))
         {
-            return NULL;
-        }
-
-        if (ret == NULL || (ret->type == T_NUMBER && ret->u.number == 0))
+            if (ob->flags & O_DESTRUCTED)
+                return NULL;
             continue;
+        }
+        if (ob->flags & O_DESTRUCTED)
+            return NULL;
 
         if (num_matched)
             (*num_matched)++;
@@ -4367,7 +4771,6 @@ e_object_present (svalue_t *v, object_t *ob, p_int num)
  */
 
 {
-    svalue_t *ret;
     object_t *ret_ob;
     p_int num_matched = 0;
     Bool specific = MY_FALSE;
@@ -4402,7 +4805,7 @@ e_object_present (svalue_t *v, object_t *ob, p_int num)
     }
 
     /* Always search in the object's inventory */
-    ret_ob = object_present_in(v->u.str, ob->contains, num, &num_matched);
+    ret_ob = object_present_in(v->u.str, ob, num, &num_matched);
     if (ret_ob)
         return ret_ob;
 
@@ -4412,17 +4815,19 @@ e_object_present (svalue_t *v, object_t *ob, p_int num)
     /* Search in the environment of <ob> if it was not specified */
     if (!specific && ob->super)
     {
+        object_t *env = ob->super;
+        Bool is_env;
+
         /* Is it _the_ environment? */
-        push_ref_string(inter_sp, v->u.str);
-        ret = sapply(STR_ID, ob->super, 1);
-        if (ob->super->flags & O_DESTRUCTED)
+        is_env = object_has_id(env, v->u.str, find_tabled(v->u.str));
+        if (env->flags & O_DESTRUCTED)
             return NULL;
-        if (ret && !(ret->type == T_NUMBER && ret->u.number == 0))
-            return ob->super;
+        if (is_env)
+            return env;
 
         /* No, search the other objects here. */
         if (num_matched < num)
-            return object_present_in(v->u.str, ob->super->contains, num - num_matched, NULL);
+            return object_present_in(v->u.str, env, num - num_matched, NULL);
     }
 
     /* Not found */
@@ -4542,6 +4947,141 @@ v_present (svalue_t *sp, int num_arg)
     return sp;
 } /* v_present() */
 
+/*-------------------------------------------------------------------------*/
+#define MAX_LINEAR_AVOID 8
+  /* say() and tell_room() search lists of objects to exclude up to this
+   * size linearly.
+   */
+
+static INLINE Bool
+is_avoided (object_t *ob, vector_t *avoid)
+
+/* Return TRUE if <ob> is listed in <avoid>. An <avoid> vector longer
+ * than MAX_LINEAR_AVOID must be in order_array() order, shorter ones
+ * are just searched linearly, which saves say() and tell_room() from
+ * sorting their few excluded objects for every message.
+ */
+
+{
+    svalue_t *item, *end;
+
+    if (VEC_SIZE(avoid) > MAX_LINEAR_AVOID)
+    {
+        static svalue_t key = { T_OBJECT };
+
+        key.u.ob = ob;
+        return lookup_key(&key, avoid) >= 0;
+    }
+
+    for (item = avoid->item, end = item + VEC_SIZE(avoid); item < end; item++)
+    {
+        if (item->type == T_OBJECT && item->u.ob == ob)
+            return MY_TRUE;
+    }
+    return MY_FALSE;
+} /* is_avoided() */
+
+/*-------------------------------------------------------------------------*/
+static void
+tell_recipients ( object_t **recipients, svalue_t *v, object_t *origin
+                , vector_t *avoid, const char *efun)
+
+/* Send value <v> on behalf of <origin> to all objects in the NULL
+ * terminated table <recipients>, except those destructed meanwhile or
+ * listed in <avoid> (see is_avoided()). This is the common part of
+ * say() and tell_room(), <efun> is the name for error messages.
+ *
+ * A string is passed by reference to every recipient, either into the
+ * output buffer of an interactive user or as argument to catch_tell()
+ * of an NPC. Other values are passed to catch_msg() together with
+ * <origin>.
+ *
+ * Rooms are usually full of NPCs of the same few programs, often
+ * without a catch_tell(). Once the lookup of catch_tell() failed for
+ * a program, the following recipients of that program are skipped
+ * without another apply. The order of delivery is not changed by this.
+ */
+
+{
+    object_t *ob;
+    program_t *deaf_prog = NULL;
+      /* The last program without a catch_tell().
+       */
+    Bool can_skip;
+      /* Whether an NPC can be skipped without the apply having visible
+       * effects: there must be no default method and no tracing.
+       */
+
+    switch (v->type)
+    {
+    case T_STRING:
+        can_skip = driver_hook[H_DEFAULT_METHOD].type != T_STRING
+                && driver_hook[H_DEFAULT_METHOD].type != T_CLOSURE
+                && !trace_level;
+
+        while (NULL != (ob = *recipients++))
+        {
+            interactive_t *ip;
+
+            if (ob->flags & O_DESTRUCTED || is_avoided(ob, avoid))
+                continue;
+
+            if (O_SET_INTERACTIVE(ip, ob))
+            {
+                tell_object(ob, v->u.str);
+                continue;
+            }
+
+            if (ob->flags & (O_SHADOW|O_SWAPPED) || ob == current_object)
+            {
+                tell_npc(ob, v->u.str);
+                continue;
+            }
+
+            if (ob->prog == deaf_prog)
+            {
+                /* Touch it like the apply would do. */
+                ob->flags &= ~O_RESET_STATE;
+                ob->time_of_ref = current_time;
+                continue;
+            }
+
+            push_ref_string(inter_sp, v->u.str);
+            if (!sapply(STR_CATCH_TELL, ob, 1) && can_skip)
+                deaf_prog = ob->prog;
+        }
+        break;
+
+    case T_OBJECT:
+    case T_POINTER:
+    case T_MAPPING:
+    case T_STRUCT:
+        /* say()s and tell_room()s evil twin: send <v> to all recipients'
+         * catch_msg() lfun
+         */
+        while (NULL != (ob = *recipients++))
+        {
+            if (ob->flags & O_DESTRUCTED || is_avoided(ob, avoid))
+                continue;
+            switch (v->type) {
+            case T_OBJECT:  push_ref_object(inter_sp, v->u.ob, efun); break;
+            case T_POINTER: push_ref_array(inter_sp, v->u.vec); break;
+            case T_MAPPING: psh_ref_mapping(inter_sp, v->u.map); break;
+            case T_STRUCT:  push_ref_struct(inter_sp, v->u.strct); break;
+            }
+            push_ref_object(inter_sp, origin, efun);
+            sapply(STR_CATCH_MSG, ob, 2);
+        }
+        break;
+
+    default:
+        errorf("Invalid argument to %s(): expected '%s', got '%s'.\n"
+              , efun
+              , efun_arg_typename(T_POINTER|T_MAPPING|T_STRUCT|T_STRING|T_OBJECT)
+              , typename(v->type));
+    }
+} /* tell_recipients() */
+
 /*-------------------------------------------------------------------------*/
 static void
 e_say (svalue_t *v, vector_t *avoid)
@@ -4553,12 +5093,9 @@ e_say (svalue_t *v, vector_t *avoid)
  */
 
 {
-    static svalue_t stmp = { T_OBJECT };
-
     object_t *ob;
     object_t *save_command_giver = command_giver;
     object_t *origin;
-    string_t *message;
 #define INITIAL_MAX_RECIPIENTS 48
     int max_recipients = INITIAL_MAX_RECIPIENTS;
       /* Current size of the recipients table.
@@ -4609,10 +5146,13 @@ e_say (svalue_t *v, vector_t *avoid)
     else
         origin = current_object;
 
-    /* Sort the avoid vector for fast lookups.
-     * The caller will free the original <avoid>.
+    /* Sort a long avoid vector for fast lookups, short ones are searched
+     * linearly. The caller will free the original <avoid>.
      */
-    avoid = order_array(avoid);
+    if (VEC_SIZE(avoid) > MAX_LINEAR_AVOID)
+        avoid = order_array(avoid);
+    else
+        ref_array(avoid);
     push_array(inter_sp, avoid); /* In case of errors */
 
     /* Collect the list of propable recipients.
@@ -4675,57 +5215,8 @@ e_say (svalue_t *v, vector_t *avoid)
 
     *curr_recipient = NULL;  /* Mark the end of the list */
 
-    /* Construct the message. */
-
-    switch(v->type)
-    {
-    case T_STRING:
-        message = v->u.str;
-        break;
-
-    case T_OBJECT:
-    case T_POINTER:
-    case T_MAPPING:
-    case T_STRUCT:
-        /* tell_room()'s evil twin: send <v> to all recipients' catch_msg() lfun */
-
-        for (curr_recipient = recipients; NULL != (ob = *curr_recipient++) ; )
-        {
-            if (ob->flags & O_DESTRUCTED)
-                continue;
-            stmp.u.ob = ob;
-            if (lookup_key(&stmp, avoid) >= 0)
-                continue;
-            switch (v->type) {
-            case T_OBJECT:  push_ref_object(inter_sp, v->u.ob, "say"); break;
-            case T_POINTER: push_ref_array(inter_sp, v->u.vec); break;
-            case T_MAPPING: psh_ref_mapping(inter_sp, v->u.map); break;
-            case T_STRUCT:  push_ref_struct(inter_sp, v->u.strct); break;
-            }
-            push_ref_object(inter_sp, origin, "say");
-            sapply(STR_CATCH_MSG, ob, 2);
-        }
-        pop_stack(); /* free avoid alist */
-        command_giver = check_object(save_command_giver);
-        return;
-
-    default:
-        errorf("Invalid argument to say(): expected '%s', got '%s'.\n"
-              , efun_arg_typename(T_POINTER|T_MAPPING|T_STRUCT|T_STRING|T_OBJECT)
-              , typename(v->type));
-    }
-
     /* Now send the message to all recipients */
-
-    for (curr_recipient = recipients; NULL != (ob = *curr_recipient++); )
-    {
-        if (ob->flags & O_DESTRUCTED)
-            continue;
-        stmp.u.ob = ob;
-        if (lookup_key(&stmp, avoid) >= 0)
-            continue;
-        tell_object (ob, message);
-    }
+    tell_recipients(recipients, v, origin, avoid, "say");
 
     pop_stack(); /* free avoid alist */
     command_giver = check_object(save_command_giver);
@@ -4828,7 +5319,8 @@ e_tell_room (object_t *room, svalue_t *v, vector_t *avoid)
 /* Implementation of the EFUN tell_room().
  *
  * Value <v> is sent to all living objects in <room>, except those
- * in <avoid>. <avoid> has to be in order_array() order.
+ * in <avoid>. <avoid> has to be in order_array() order if it is longer
+ * than MAX_LINEAR_AVOID.
  */
 
 {
@@ -4837,8 +5329,6 @@ e_tell_room (object_t *room, svalue_t *v, vector_t *avoid)
     object_t *some_recipients[20];
     object_t **recipients;
     object_t **curr_recipient;
-    string_t *message;
-    static svalue_t stmp = { T_OBJECT, } ;
     interactive_t *ip;        
 
     /* Like in say(), collect the possible recipients.
@@ -4887,60 +5377,9 @@ e_tell_room (object_t *room, svalue_t *v, vector_t *avoid)
 
     *curr_recipient = NULL; /* Mark the end of the table */
 
-    /* Construct the message */
-    switch(v->type)
-    {
-    case T_STRING:
-        message = v->u.str;
-        break;
-
-    case T_OBJECT:
-    case T_POINTER:
-    case T_MAPPING:
-    case T_STRUCT:
-      {
-        /* say()s evil brother: send <v> to all recipients'
-         * catch_msg() lfun
-         */
-        object_t *origin = command_giver;
-
-        if (!origin)
-            origin = current_object;
-
-        for (curr_recipient = recipients; NULL != (ob = *curr_recipient++); )
-        {
-            if (ob->flags & O_DESTRUCTED)
-                continue;
-            stmp.u.ob = ob;
-            if (lookup_key(&stmp, avoid) >= 0)
-                continue;
-            switch (v->type) {
-            case T_OBJECT:  push_ref_object(inter_sp, v->u.ob, "tell_room"); break;
-            case T_POINTER: push_ref_array(inter_sp, v->u.vec); break;
-            case T_MAPPING: psh_ref_mapping(inter_sp, v->u.map); break;
-            case T_STRUCT:  push_ref_struct(inter_sp, v->u.strct); break;
-            }
-            push_ref_object(inter_sp, origin, "tell_room");
-            sapply(STR_CATCH_MSG, ob, 2);
-        }
-        return;
-      }
-
-    default:
-        errorf("Invalid argument to tell_room(): expected '%s', got '%s'.\n"
-              , efun_arg_typename(T_POINTER|T_MAPPING|T_STRUCT|T_STRING|T_OBJECT)
-              , typename(v->type));
-    }
-
     /* Now send the message to all recipients */
-
-    for (curr_recipient = recipients; NULL != (ob = *curr_recipient++); )
-    {
-        if (ob->flags & O_DESTRUCTED) continue;
-        stmp.u.ob = ob;
-        if (lookup_key(&stmp, avoid) >= 0) continue;
-        tell_object(ob, message);
-    }
+    tell_recipients(recipients, v, command_giver ? command_giver : current_object
+                   , avoid, "tell_room");
 } /* e_tell_room() */
 
 /*-------------------------------------------------------------------------*/
@@ -4992,12 +5431,16 @@ v_tell_room (svalue_t *sp, int num_arg)
     }
     else
     {
-        /* Sort the list of objects to exclude for faster
+        /* Sort a long list of objects to exclude for faster
          * operation.
          */
-        avoid = order_array(arg[2].u.vec);
-        free_array(arg[2].u.vec);
-        sp->u.vec = avoid; /* in case of an error, this will be freed. */
+        avoid = arg[2].u.vec;
+        if (VEC_SIZE(avoid) > MAX_LINEAR_AVOID)
+        {
+            avoid = order_array(avoid);
+            free_array(arg[2].u.vec);
+            sp->u.vec = avoid; /* in case of an error, this will be freed. */
+        }
     }
 
     e_tell_room(ob, arg+1, avoid);
@@ -5085,6 +5528,8 @@ f_set_environment (svalue_t *sp)
         if (!okey)
             fatal("Failed to find object %s in super list of %s.\n",
                   get_txt(item->name), get_txt(item->super->name));
+
+        free_id_index(item->super);
     }
 
     /* Now put it into its new environment (if any) */
@@ -5097,6 +5542,7 @@ f_set_environment (svalue_t *sp)
     {
         item->next_inv = dest->contains;
         dest->contains = item;
+        free_id_index(dest);
     }
 
     command_giver = check_object(save_cmd);
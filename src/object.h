@@ -12,6 +12,18 @@
 
 /* --- Types --- */
 
+/* --- enum object_queue_e: the due-time queues of process_objects()
+ */
+
+enum object_queue_e
+{
+    OQ_RESET = 0,     /* Next reset */
+    OQ_CLEAN_UP,      /* Next call to clean_up() */
+    OQ_DATA_CLEANUP,  /* Next data cleanup */
+    OQ_SWAP,          /* Next swap check */
+    OQ_NUM_QUEUES
+};
+
 /* --- struct object: the base structure of every object
  */
 
@@ -41,6 +53,17 @@ struct object_s
     object_t *contains;   /* First contained object */
     object_t *super;      /* Current environment */
     sentence_t *sent;     /* Sentences, shadows, interactive data */
+    action_index_t *action_index;
+      /* Verb index of the action sentences, or NULL if not indexed */
+    vector_t *ids;
+      /* The ids declared with configure_object(OC_IDS) as unique tabled
+       * strings, or NULL if present() is to call id() instead.
+       */
+    id_index_t *id_index;
+      /* Index of the declared ids in the inventory, or NULL if not indexed */
+    call_t *call_outs;    /* Pending callouts bound to this object */
+    uint32 queue_pos[OQ_NUM_QUEUES];
+      /* Position+1 in the process_objects() queues, 0 if not queued */
     wiz_list_t *user;     /* What wizard defined this object */
     wiz_list_t *eff_user; /* Effective user */
 #ifdef DEBUG
@@ -69,7 +92,7 @@ struct object_s
 #define O_DESTRUCTED         0x10   /* Is it destructed ? */
 #define O_SWAPPED            0x20   /* Is it swapped to file */
 #define O_ONCE_INTERACTIVE   0x40   /* Has it ever been interactive? */
-#define O_UNUSED_80          0x80
+#define O_NO_ACTIONS         0x80   /* Does its program declare no actions? */
 #define O_RESET_STATE        0x100  /* Object in a 'reset':ed state ? */
 #define O_WILL_CLEAN_UP      0x200  /* clean_up will be called next time */
 #define O_LAMBDA_REFERENCED  0x400  /* be careful with replace_program() */
@@ -279,7 +302,7 @@ extern void _free_prog(program_t *progp, Bool free_all, const char * file, int l
 extern void reset_object(object_t *ob, int arg);
 extern void logon_object (object_t *ob, p_int flag);
 extern void replace_programs(void);
-extern Bool shadow_catch_message(object_t *ob, const char *str);
+extern Bool shadow_catch_message(object_t *ob, const char *str, string_t *sstr);
 
 #ifndef CHECK_OBJECT_REF
 extern void dealloc_object(object_t *);
@@ -320,6 +343,9 @@ extern svalue_t *f_first_inventory(svalue_t *sp);
 extern svalue_t *f_next_inventory(svalue_t *sp);
 extern svalue_t *f_move_object (svalue_t *sp);
 extern svalue_t *v_present(svalue_t *sp, int num_arg);
+extern void set_object_ids(object_t *ob, vector_t *ids);
+extern void free_object_ids(object_t *ob);
+extern void free_id_index(object_t *ob);
 extern svalue_t *v_say(svalue_t *sp, int num_arg);
 extern svalue_t *v_tell_room(svalue_t *sp, int num_arg);
 extern svalue_t *f_set_environment(svalue_t *sp);
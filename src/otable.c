@@ -12,17 +12,18 @@
  *
  *   The hash index is computed from the object name, and if the object
  *   is found in the index chain, it is moved to the head of the chain
- *   to speed up further lookups.
+ *   to speed up further lookups. The hash value itself is cached in
+ *   the name string.
  *
- *   The size of the hash table is given by OTABLE_SIZE in config.h. It does
- *   not need to be prime, and should probably be set to 1/4 of the number
- *   of objects in the game.
+ *   The table starts with OTABLE_SIZE chains (or the number given
+ *   with --otable-size), rounded up to a power of two. When it holds
+ *   more objects than chains, it is doubled in size. To avoid a long
+ *   pause on big muds, this is done incrementally: the new table is
+ *   allocated next to the old one, and every following lookup, insertion
+ *   or removal moves a few of the old chains over. Meanwhile lookups
+ *   search both tables, and new objects are entered into the new table.
  *
  *   The table links are not counted in the object's refcount.
- *
- *   TODO: Maybe make the object table size dynamic (start with 128 and double
- *   TODO:: as required). This also requires to store the hashvalue in
- *   TODO:: the object.
  *---------------------------------------------------------------------------
  */
 
@@ -30,6 +31,7 @@
 #include "typedefs.h"
 
 #include <stdio.h>
+#include <string.h>
 
 #include "otable.h"
 
@@ -49,27 +51,29 @@
 /*                           OBJECT TABLE                                  */
 /*-------------------------------------------------------------------------*/
 
-/* Hash the string <s> and compute the appropriate table index
- */
-static INLINE hash32_t ObjHash(string_t * const s)
-{
-#if !( (OTABLE_SIZE) & (OTABLE_SIZE)-1 )
-    return mstr_get_hash(s) & ((OTABLE_SIZE)-1);
-#else
-    return mstr_get_hash(s) % (OTABLE_SIZE);
-#endif
-}
-static INLINE hash32_t ObjHashStr(char const * const s, size_t len)
-{
-#if !( (OTABLE_SIZE) & (OTABLE_SIZE)-1 )
-    return hash_string(s, len) & ((OTABLE_SIZE)-1);
-#else
-    return hash_string(s, len) % (OTABLE_SIZE);
-#endif
-}
+#define OTABLE_REHASH_STEP 4
+  /* Number of non-empty chains moved into the new table with every
+   * operation on the table while it grows. At most ten times as many
+   * empty chains are skipped in one step.
+   */
+
+long otable_initial_size = OTABLE_SIZE;
+  /* The number of chains the table starts with (set by --otable-size).
+   * init_otable() rounds it up to a power of two.
+   */
+
+static object_t ** obj_table[2] = { NULL, NULL };
+static size_t otable_size[2] = { 0, 0 };
+  /* The (allocated) hashtables and their sizes, which are always powers
+   * of two. obj_table[1] is only used while the table grows: then new
+   * objects are entered into obj_table[1], and the chains of obj_table[0]
+   * are moved over one by one, starting with the chain <rehash_index>.
+   * When all are moved, obj_table[1] replaces obj_table[0].
+   */
 
-static object_t ** obj_table = NULL;
-  /* Pointer to the (allocated) hashtable.
+static long rehash_index = -1;
+  /* The next chain of obj_table[0] to move, or -1 if the table
+   * does not grow at the moment.
    */
 
 static long objs_in_table = 0;
@@ -88,6 +92,99 @@ static statcounter_t user_obj_found = 0;
   /* Number of externally requested lookups, and how many succeeded.
    */
 
+static statcounter_t otable_resizes = 0;
+  /* Number of times the table was grown.
+   */
+
+/*-------------------------------------------------------------------------*/
+static INLINE object_t **
+ObjChain (int t, hash32_t hash)
+
+/* Return the head of the chain in table <t> for the hash value <hash>.
+ */
+
+{
+    return obj_table[t] + (hash & (otable_size[t]-1));
+}
+
+/*-------------------------------------------------------------------------*/
+static void
+rehash_step (void)
+
+/* If the table grows, move the next OTABLE_REHASH_STEP chains into the
+ * new table. When all chains are moved, the new table replaces the old one.
+ */
+
+{
+    int chains = OTABLE_REHASH_STEP;
+    int empty = 10 * OTABLE_REHASH_STEP;
+
+    if (rehash_index < 0)
+        return;
+
+    while (chains > 0 && (size_t)rehash_index < otable_size[0])
+    {
+        object_t *ob = obj_table[0][rehash_index];
+
+        if (!ob)
+        {
+            rehash_index++;
+            if (--empty == 0)
+                return;
+            continue;
+        }
+
+        while (ob)
+        {
+            object_t *next = ob->next_hash;
+            object_t **chain = ObjChain(1, mstr_get_hash(ob->name));
+
+            ob->next_hash = *chain;
+            *chain = ob;
+            ob = next;
+        }
+        obj_table[0][rehash_index++] = NULL;
+        chains--;
+    }
+
+    if ((size_t)rehash_index >= otable_size[0])
+    {
+        xfree(obj_table[0]);
+        obj_table[0] = obj_table[1];
+        otable_size[0] = otable_size[1];
+        obj_table[1] = NULL;
+        otable_size[1] = 0;
+        rehash_index = -1;
+    }
+} /* rehash_step() */
+
+/*-------------------------------------------------------------------------*/
+static void
+check_otable_size (void)
+
+/* Called before an object is entered: if there are more objects than
+ * chains in the table, start to grow it to twice the size.
+ */
+
+{
+    size_t size;
+    object_t **table;
+
+    if (rehash_index >= 0 || (size_t)objs_in_table < otable_size[0])
+        return;
+
+    size = otable_size[0] * 2;
+    table = xalloc(sizeof(object_t *) * size);
+    if (!table)
+        return; /* Try again with the next object */
+
+    memset(table, 0, sizeof(object_t *) * size);
+    obj_table[1] = table;
+    otable_size[1] = size;
+    rehash_index = 0;
+    otable_resizes++;
+} /* check_otable_size() */
+
 /*-------------------------------------------------------------------------*/
 static object_t *
 find_obj_n (string_t *s)
@@ -100,31 +197,32 @@ find_obj_n (string_t *s)
  */
 
 {
-    object_t * curr, *prev;
-
-    int h = ObjHash(s);
-
-    curr = obj_table[h];
-    prev = NULL;
+    hash32_t hash = mstr_get_hash(s);
+    int t;
 
+    rehash_step();
     obj_searches++;
 
-    while (curr)
+    for (t = (rehash_index < 0) ? 0 : 1; t >= 0; t--)
     {
-        obj_probes++;
-        if (mstreq(curr->name, s)) /* found it */
+        object_t **chain = ObjChain(t, hash);
+        object_t *curr, *prev;
+
+        for (curr = *chain, prev = NULL; curr; prev = curr, curr = curr->next_hash)
         {
-            if (prev) /* not at head of list */
+            obj_probes++;
+            if (mstreq(curr->name, s)) /* found it */
             {
-                prev->next_hash = curr->next_hash;
-                curr->next_hash = obj_table[h];
-                obj_table[h] = curr;
+                if (prev) /* not at head of list */
+                {
+                    prev->next_hash = curr->next_hash;
+                    curr->next_hash = *chain;
+                    *chain = curr;
+                }
+                objs_found++;
+                return curr;
             }
-            objs_found++;
-            return curr;
         }
-        prev = curr;
-        curr = curr->next_hash;
     }
 
     /* Not found */
@@ -144,37 +242,38 @@ find_obj_n_str (char const * const s)
  */
 
 {
-    object_t * curr, *prev;
-
-    int h = ObjHashStr(s,strlen(s));
-
-    curr = obj_table[h];
-    prev = NULL;
+    hash32_t hash = hash_string(s, strlen(s));
+    int t;
 
+    rehash_step();
     obj_searches++;
 
-    while (curr)
+    for (t = (rehash_index < 0) ? 0 : 1; t >= 0; t--)
     {
-        obj_probes++;
-        if (!strcmp(get_txt(curr->name), s)) /* found it */
+        object_t **chain = ObjChain(t, hash);
+        object_t *curr, *prev;
+
+        for (curr = *chain, prev = NULL; curr; prev = curr, curr = curr->next_hash)
         {
-            if (prev) /* not at head of list */
+            obj_probes++;
+            if (!strcmp(get_txt(curr->name), s)) /* found it */
             {
-                prev->next_hash = curr->next_hash;
-                curr->next_hash = obj_table[h];
-                obj_table[h] = curr;
+                if (prev) /* not at head of list */
+                {
+                    prev->next_hash = curr->next_hash;
+                    curr->next_hash = *chain;
+                    *chain = curr;
+                }
+                objs_found++;
+                return curr;
             }
-            objs_found++;
-            return curr;
         }
-        prev = curr;
-        curr = curr->next_hash;
     }
 
     /* Not found */
     return NULL;
 
-} /* find_obj_n() */
+} /* find_obj_n_str() */
 
 /*-------------------------------------------------------------------------*/
 void
@@ -185,10 +284,10 @@ enter_object_hash (object_t *ob)
  */
 
 {
+    object_t **chain;
 #ifdef DEBUG
     object_t * s;
 #endif
-    int h = ObjHash(ob->name);
 
 #ifdef DEBUG
     s = find_obj_n(ob->name);
@@ -206,8 +305,13 @@ enter_object_hash (object_t *ob)
              , get_txt(ob->name));
 #endif
 
-    ob->next_hash = obj_table[h];
-    obj_table[h] = ob;
+    check_otable_size();
+    rehash_step();
+
+    /* While the table grows, new objects go into the new table. */
+    chain = ObjChain((rehash_index < 0) ? 0 : 1, mstr_get_hash(ob->name));
+    ob->next_hash = *chain;
+    *chain = ob;
     objs_in_table++;
 }
 
@@ -220,7 +324,8 @@ remove_object_hash (object_t *ob)
 
 {
     object_t * s;
-    int h = ObjHash(ob->name);
+    object_t **chain;
+    hash32_t hash = mstr_get_hash(ob->name);
 
     s = find_obj_n(ob->name);
 
@@ -228,7 +333,12 @@ remove_object_hash (object_t *ob)
         fatal( "Remove object \"%s\": found a different object!"
              , get_txt(ob->name));
 
-    obj_table[h] = ob->next_hash;
+    /* find_obj_n() moved <ob> to the head of its chain. */
+    chain = ObjChain(0, hash);
+    if (*chain != ob)
+        chain = ObjChain(1, hash);
+
+    *chain = ob->next_hash;
     ob->next_hash = NULL;
     objs_in_table--;
 }
@@ -281,9 +391,13 @@ show_otable_status (strbuf_t * sbuf, Bool verbose)
 #endif
         strbuf_add(sbuf, "\nObject name hash table status:\n");
         strbuf_add(sbuf, "------------------------------\n");
+        strbuf_addf(sbuf
+                   , "Table size (times grown)             %zu (%"PRIuSTATCOUNTER")%s\n"
+                   , otable_size[0] + otable_size[1], otable_resizes
+                   , (rehash_index >= 0) ? ", growing" : "");
         strbuf_addf(sbuf
                    , "Average hash chain length                   %.2f\n"
-                   , (float) objs_in_table / (float) OTABLE_SIZE);
+                   , (float) objs_in_table / (float) (otable_size[0] + otable_size[1]));
         strbuf_addf(sbuf
                    , "Searches/average search length       %"PRIuSTATCOUNTER" (%.2f)\n"
                    , obj_searches
@@ -297,8 +411,8 @@ show_otable_status (strbuf_t * sbuf, Bool verbose)
     /* objs_in_table * sizeof(object_t) is already accounted for
        in tot_alloc_object_size.  */
     strbuf_addf(sbuf, "hash table overhead\t\t\t %9ld\n",
-                (long)(OTABLE_SIZE * sizeof(object_t *)));
-    return OTABLE_SIZE * sizeof(object_t *);
+                (long)((otable_size[0] + otable_size[1]) * sizeof(object_t *)));
+    return (otable_size[0] + otable_size[1]) * sizeof(object_t *);
 }
 
 /*-------------------------------------------------------------------------*/
@@ -317,11 +431,11 @@ otable_driver_info (svalue_t *svp, int value)
             break;
 
         case DI_NUM_OBJECT_TABLE_SLOTS:
-            put_number(svp, OTABLE_SIZE);
+            put_number(svp, otable_size[0] + otable_size[1]);
             break;
 
         case DI_SIZE_OBJECT_TABLE:
-            put_number(svp, OTABLE_SIZE * sizeof(object_t *));
+            put_number(svp, (otable_size[0] + otable_size[1]) * sizeof(object_t *));
             break;
 
 
@@ -343,11 +457,17 @@ init_otable (void)
  */
 
 {
-    int x;
-    obj_table = xalloc(sizeof(object_t *) * OTABLE_SIZE);
+    size_t size = 16;
+
+    while (size < (size_t)otable_initial_size)
+        size *= 2;
 
-    for (x = 0; x < OTABLE_SIZE; x++)
-        obj_table[x] = NULL;
+    obj_table[0] = xalloc(sizeof(object_t *) * size);
+    if (!obj_table[0])
+        fatal("Out of memory (%zu bytes) for object table.\n"
+             , sizeof(object_t *) * size);
+    memset(obj_table[0], 0, sizeof(object_t *) * size);
+    otable_size[0] = size;
 }
 
 /*-------------------------------------------------------------------------*/
@@ -355,11 +475,13 @@ init_otable (void)
 void
 note_otable_ref (void)
 
-/* GC support: mark the memory used by the hashtable as used.
+/* GC support: mark the memory used by the hashtables as used.
  */
 
 {
-    note_malloced_block_ref((char *)obj_table);
+    note_malloced_block_ref((char *)obj_table[0]);
+    if (obj_table[1])
+        note_malloced_block_ref((char *)obj_table[1]);
 }
 
 #endif /* GC_SUPPORT */
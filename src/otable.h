@@ -5,6 +5,8 @@
 #include "typedefs.h"
 #include "strfuns.h"
 
+extern long otable_initial_size;
+
 extern void init_otable(void);
 extern size_t show_otable_status(strbuf_t *sbuf, Bool verbose);
 extern void otable_driver_info(svalue_t *svp, int value) __attribute__((nonnull(1)));
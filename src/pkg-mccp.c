@@ -46,6 +46,7 @@
 
 #include "pkg-mccp.h"
 
+#include "actions.h"
 #include "array.h"
 #include "comm.h"
 #include "mstrings.h"
@@ -55,6 +56,44 @@
 
 #include "../mudlib/sys/telnet.h"
 
+/*-------------------------------------------------------------------------*/
+
+int mccp_default_level = 9;
+int mccp_default_window_bits = MAX_WBITS;
+int mccp_default_mem_level = 8;
+  /* The zlib settings for new connections.
+   */
+
+unsigned char mccp_compress_buf[COMPRESS_BUF_SIZE];
+  /* The output buffer for all compressions. The compressed data is
+   * sent or copied into the write buffers right away, so one buffer
+   * serves all connections.
+   */
+
+/* --- union zlib_block_u: a memory block for the zlib
+ */
+
+typedef union zlib_block_u
+{
+    size_t size;  /* Size of the block (excluding this header) */
+
+    /* The alignment for the data following the header: */
+    double   d;
+    void   * p;
+    long     l;
+} zlib_block_t;
+
+#define ZLIB_POOL_SIZE 32
+  /* Number of freed zlib memory blocks kept for reuse.
+   */
+
+static zlib_block_t * zlib_pool[ZLIB_POOL_SIZE];
+static int zlib_pool_num = 0;
+  /* The freed zlib memory blocks. As all connections use blocks of
+   * the same few sizes, these are reused when the next compression
+   * starts.
+   */
+
 /*=========================================================================*/
 
 /*                          Support functions                              */
@@ -68,14 +107,33 @@ void *
 zlib_alloc (void *opaque UNUSED, unsigned int items, unsigned int size)
 
 /* Callback function for the zlib to allocate an zeroed block of
- * memory.
+ * memory. Blocks of the right size are taken from the pool first.
  */
 
 {
+    zlib_block_t *block;
+    size_t total = (size_t)items * size;
+    int i;
+
 #ifdef __MWERKS__
 #   pragma unused(opaque)
 #endif
-    return calloc (items, size);
+    for (i = 0; i < zlib_pool_num; i++)
+    {
+        block = zlib_pool[i];
+        if (block->size == total)
+        {
+            zlib_pool[i] = zlib_pool[--zlib_pool_num];
+            memset(block + 1, 0, total);
+            return block + 1;
+        }
+    }
+
+    block = calloc(1, sizeof(*block) + total);
+    if (!block)
+        return NULL;
+    block->size = total;
+    return block + 1;
 } /* zlib_alloc() */
 
 /*-------------------------------------------------------------------------*/
@@ -83,14 +141,19 @@ void
 zlib_free (void *opaque UNUSED, void *address)
 
 /* Callback function for the zlib to free a block of memory allocated with
- * zlib_alloc().
+ * zlib_alloc(). The block is kept in the pool if there is room.
  */
 
 {
+    zlib_block_t *block = (zlib_block_t *)address - 1;
+
 #ifdef __MWERKS__
 #   pragma unused(opaque)
 #endif
-    free (address);
+    if (zlib_pool_num < ZLIB_POOL_SIZE)
+        zlib_pool[zlib_pool_num++] = block;
+    else
+        free(block);
 } /* zlib_free() */
 
 /*-------------------------------------------------------------------------*/
@@ -110,21 +173,20 @@ start_compress (interactive_t * ip, unsigned char telopt)
     if (ip->out_compress)
         return MY_TRUE;
     
-    /* allocate and init stream, buffer */
+    /* allocate and init stream */
     s = xalloc(sizeof (*s));
-    ip->out_compress_buf = xalloc(COMPRESS_BUF_SIZE);
-    
+
     s->next_in = NULL;
     s->avail_in = 0;
-    s->next_out = ip->out_compress_buf;
+    s->next_out = mccp_compress_buf;
     s->avail_out = COMPRESS_BUF_SIZE;
     s->zalloc = zlib_alloc;
     s->zfree = zlib_free;
     s->opaque = NULL;
-    
-    if (deflateInit (s, 9) != Z_OK)
+
+    if (deflateInit2(s, ip->mccp_level, Z_DEFLATED, ip->mccp_window_bits
+                    , ip->mccp_mem_level, Z_DEFAULT_STRATEGY) != Z_OK)
     {
-        xfree(ip->out_compress_buf);
         xfree(s);
         return MY_FALSE;
     }
@@ -149,7 +211,7 @@ start_compress (interactive_t * ip, unsigned char telopt)
         else
         {
             printf("Bad teloption %d passed", telopt);
-            xfree(ip->out_compress_buf);
+            deflateEnd(s);
             xfree(s);
             return MY_FALSE;
         }
@@ -176,35 +238,44 @@ end_compress (interactive_t * ip, Bool force)
 
 {
     unsigned char dummy[1];
-    unsigned char buf[256];
     size_t len;
     Bool retval = MY_TRUE;
     
     if (!ip->out_compress)
         return MY_TRUE;
+
+    /* The text still waiting in the message buffer belongs into the
+     * compressed stream.
+     */
+    if (!force)
+    {
+        object_t *save = command_giver;
+
+        command_giver = ip->ob;
+        add_message(message_flush);
+        command_giver = save;
+    }
    
     ip->out_compress->avail_in = 0;
     ip->out_compress->next_in = dummy;
     
-    ip->out_compress->next_out = buf;
-    ip->out_compress->avail_out = sizeof(buf);
+    ip->out_compress->next_out = mccp_compress_buf;
+    ip->out_compress->avail_out = COMPRESS_BUF_SIZE;
 
     /* No terminating signature is needed - receiver will get Z_STREAM_END */
     if (deflate (ip->out_compress, Z_FINISH) != Z_STREAM_END && !force)
         return MY_FALSE;
    
-    len = ip->out_compress->next_out - buf;
+    len = ip->out_compress->next_out - mccp_compress_buf;
     
     /* first reset compression values */
     deflateEnd(ip->out_compress);
-    xfree(ip->out_compress_buf);
     xfree(ip->out_compress);
     ip->compressing = 0;
     ip->out_compress = NULL;
-    ip->out_compress_buf = NULL;
 
     /* try to send any residual data */
-    comm_socket_write((char*) buf, len, ip, WB_NONDISCARDABLE);
+    comm_socket_write((char*) mccp_compress_buf, len, ip, WB_NONDISCARDABLE);
    
     printf("%s MCCP-DEBUG: '%s' mccp ended\n"
           , time_stamp(), get_txt(ip->ob->name));
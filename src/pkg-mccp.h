@@ -13,6 +13,13 @@
 
 #define COMPRESS_BUF_SIZE 8192
 
+/* --- Variables --- */
+
+extern int mccp_default_level;
+extern int mccp_default_window_bits;
+extern int mccp_default_mem_level;
+extern unsigned char mccp_compress_buf[COMPRESS_BUF_SIZE];
+
 /* --- Prototypes --- */
 
 extern void * zlib_alloc (void *opaque, unsigned int items, unsigned int size);
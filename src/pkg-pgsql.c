@@ -95,6 +95,7 @@
 #include "main.h"
 #include "mapping.h"
 #include "mstrings.h"
+#include "poller.h"
 #include "simulate.h"
 #include "stdstrings.h"
 #include "xalloc.h"
@@ -177,10 +178,10 @@ static void pgnotice (dbconn_t *pgconn, const char *msg);
 
 /*-------------------------------------------------------------------------*/
 void
-pg_setfds (fd_set *readfds, fd_set *writefds, int *nfds)
+pg_setfds (void)
 
-/* Called from the get_message() loop in comm.c, this function has to add
- * the fds of the database connections to the fd sets.
+/* Called from the get_message() loop in comm.c, this function has to
+ * update the events the poller waits for on the database connections.
  */
 
 {
@@ -188,15 +189,15 @@ pg_setfds (fd_set *readfds, fd_set *writefds, int *nfds)
     
     for (ptr = head; ptr != NULL; ptr = ptr->next)
     {
+        int events = POLLER_READ;
+
         if (ptr->fd < 0)
             continue;
         if ((ptr->pgstate == PGRES_POLLING_WRITING)
          || (ptr->state == PG_SENDQUERY)
            )
-            FD_SET(ptr->fd, writefds);
-        FD_SET(ptr->fd, readfds);
-        if (*nfds <= ptr->fd)
-            *nfds = ptr->fd + 1;
+            events |= POLLER_WRITE;
+        poller_set(ptr->fd, events);
     }
 } /* pg_setfds() */
 
@@ -368,6 +369,7 @@ pgclose (dbconn_t *pgconn)
 
 {
     pgconn->state = PG_UNCONNECTED;
+    poller_set(pgconn->fd, 0);
     if (pgconn->conn)
         PQfinish(pgconn->conn);
     pgconn->conn = NULL;
@@ -382,6 +384,10 @@ pgreset (dbconn_t *pgconn)
  */
 
 {
+    /* The reset reopens the connection, possibly with a new socket. */
+    poller_set(pgconn->fd, 0);
+    pgconn->fd = -1;
+
     if (!PQresetStart(pgconn->conn))
     {
         pgclose(pgconn);
@@ -395,6 +401,7 @@ pgreset (dbconn_t *pgconn)
         return;
     }
     
+    pgconn->fd = PQsocket(pgconn->conn);
     pgconn->state = PG_RESETTING;
     pgconn->pgstate = PGRES_POLLING_WRITING;
 } /* pgreset() */
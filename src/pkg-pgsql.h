@@ -14,7 +14,7 @@
 
 /* --- Prototypes --- */
 
-extern void pg_setfds(fd_set *readfds, fd_set *writefds, int *nfds);
+extern void pg_setfds(void);
 extern void pg_process_all(void);
 extern void pg_purge_connections (void);
 
@@ -23,6 +23,7 @@
 #include "mstrings.h"
 #include "object.h"
 #include "pkg-python.h"
+#include "poller.h"
 #include "prolang.h"
 #include "simul_efun.h"
 #include "simulate.h"
@@ -239,6 +240,26 @@ python_unregister_efun (PyObject *module, PyObject *args, PyObject *kwds)
     return Py_None;
 } /* python_register_efun */
 
+/*-------------------------------------------------------------------------*/
+static int
+poll_to_poller_events (int events)
+
+/* Convert the poll() <events> into POLLER_xxx flags.
+ */
+
+{
+    int result = 0;
+
+    if (events & POLLIN)
+        result |= POLLER_READ;
+    if (events & POLLOUT)
+        result |= POLLER_WRITE;
+    if (events & POLLPRI)
+        result |= POLLER_EXCEPT;
+
+    return result;
+} /* poll_to_poller_events() */
+
 /*-------------------------------------------------------------------------*/
 static PyObject*
 python_register_socket (PyObject *module, PyObject *args, PyObject *kwds)
@@ -312,6 +333,12 @@ python_register_socket (PyObject *module, PyObject *args, PyObject *kwds)
     fds->events = events;
     fds->eventsfun = eventsfun;
 
+    /* Static event masks are registered right away,
+     * dynamic ones in every cycle by python_set_fds().
+     */
+    if (eventsfun == NULL)
+        poller_set(fd, poll_to_poller_events(events));
+
     Py_INCREF(Py_None);
     return Py_None;
 } /* python_register_socket */
@@ -342,6 +369,8 @@ python_unregister_socket (PyObject *module, PyObject *args, PyObject *kwds)
             python_poll_fds_t *oldpoll = *fds;
             *fds = oldpoll->next;
 
+            poller_set(fd, 0);
+
             Py_XDECREF(oldpoll->fun);
             Py_XDECREF(oldpoll->eventsfun);
             xfree(oldpoll);
@@ -1977,7 +2006,7 @@ ldmud_mapping_new (PyTypeObject *type, PyObject *args, PyObject *kwds)
     ldmud_mapping_t *self;
     mapping_t *map;
 
-    map = allocate_cond_mapping(&default_wizlist_entry, 0, 1);
+    map = allocate_user_mapping(&default_wizlist_entry, 0, 1);
     if (map == NULL)
         return PyErr_NoMemory();
 
@@ -2031,7 +2060,7 @@ ldmud_mapping_init (ldmud_mapping_t *self, PyObject *args, PyObject *kwds)
             return 0; /* Nothing todo. */
 
         /* Make a new empty mapping... */
-        map = allocate_cond_mapping(&default_wizlist_entry, 0, width);
+        map = allocate_user_mapping(&default_wizlist_entry, 0, width);
         if (map == NULL)
         {
             PyErr_NoMemory();
@@ -2083,7 +2112,7 @@ ldmud_mapping_init (ldmud_mapping_t *self, PyObject *args, PyObject *kwds)
                 return 0; /* Nothing todo. */
 
             /* Make a new empty mapping... */
-            map = allocate_cond_mapping(&default_wizlist_entry, 0, width);
+            map = allocate_user_mapping(&default_wizlist_entry, 0, width);
             if (map == NULL)
             {
                 PyErr_NoMemory();
@@ -2108,7 +2137,7 @@ ldmud_mapping_init (ldmud_mapping_t *self, PyObject *args, PyObject *kwds)
             map = self->lpc_mapping;
         else
         {
-            map = allocate_cond_mapping(&default_wizlist_entry, 0, width);
+            map = allocate_user_mapping(&default_wizlist_entry, 0, width);
             if (map == NULL)
             {
                 PyErr_NoMemory();
@@ -4804,59 +4833,50 @@ call_python_efun (int idx, int num_arg)
 
 /*-------------------------------------------------------------------------*/
 void
-python_set_fds (fd_set *readfds, fd_set *writefds, fd_set *exceptfds, int *nfds)
+python_set_fds (void)
 
-/* Set all file descriptors that some python routines are waiting for.
+/* Update the poller events for all file descriptors whose event mask
+ * is determined by a python function. The others were registered
+ * with the poller already in python_register_socket().
  */
 
 {
     python_is_external = true;
     for (python_poll_fds_t *fds = poll_fds; fds != NULL; fds = fds->next)
     {
-        short events = fds->events;
-
-        if (fds->eventsfun)
-        {
-            PyObject *result;
+        PyObject *result;
+        long events;
 
-            result = PyObject_CallObject(fds->eventsfun, NULL);
-            if (result == NULL)
-            {
-                /* Exception occurred. */
-                if (PyErr_Occurred())
-                    PyErr_Print();
-                continue;
-            }
+        if (!fds->eventsfun)
+            continue;
 
-            events = PyLong_AsLong(result);
-            if (events == -1 && PyErr_Occurred())
-            {
+        result = PyObject_CallObject(fds->eventsfun, NULL);
+        if (result == NULL)
+        {
+            /* Exception occurred. */
+            if (PyErr_Occurred())
                 PyErr_Print();
-                Py_DECREF(result);
-                continue;
-            }
-            Py_DECREF(result);
+            continue;
         }
 
-        if(events & POLLIN)
-            FD_SET(fds->fd, readfds);
-
-        if(events & POLLOUT)
-            FD_SET(fds->fd, writefds);
-
-        if(events & POLLPRI)
-            FD_SET(fds->fd, exceptfds);
+        events = PyLong_AsLong(result);
+        if (events == -1 && PyErr_Occurred())
+        {
+            PyErr_Print();
+            Py_DECREF(result);
+            continue;
+        }
+        Py_DECREF(result);
 
-        if(events & (POLLIN|POLLOUT|POLLPRI))
-            (*nfds)++;
+        poller_set(fds->fd, poll_to_poller_events((int)events));
     }
 } /* python_set_fds */
 
 /*-------------------------------------------------------------------------*/
 void
-python_handle_fds (fd_set *readfds, fd_set *writefds, fd_set *exceptfds, int nfds)
+python_handle_fds (void)
 
-/* File descriptors in the given sets have events.
+/* File descriptors registered with the poller have events.
  * Check whether a callable is waiting for it, then call it.
  */
 
@@ -4864,15 +4884,16 @@ python_handle_fds (fd_set *readfds, fd_set *writefds, fd_set *exceptfds, int nfd
     python_is_external = true;
     for (python_poll_fds_t *fds = poll_fds; fds != NULL; fds = fds->next)
     {
+        int ready = poller_ready(fds->fd);
         int events = 0;
 
-        if (FD_ISSET(fds->fd, readfds))
+        if (ready & POLLER_READ)
             events |= POLLIN;
 
-        if (FD_ISSET(fds->fd, writefds))
+        if (ready & POLLER_WRITE)
             events |= POLLOUT;
 
-        if (FD_ISSET(fds->fd, exceptfds))
+        if (ready & POLLER_EXCEPT)
             events |= POLLPRI;
 
         if (events != 0)
@@ -44,8 +44,8 @@ extern bool is_python_efun(ident_t *p);
 extern void call_python_efun(int idx, int num_arg);
 extern const char* closure_python_efun_to_string(int type);
 
-extern void python_set_fds(fd_set *readfds, fd_set *writefds, fd_set *exceptfds, int *nfds);
-extern void python_handle_fds(fd_set *readfds, fd_set *writefds, fd_set *exceptfds, int nfds);
+extern void python_set_fds(void);
+extern void python_handle_fds(void);
 
 extern void python_call_hook(int hook, bool is_external);
 extern void python_call_hook_object(int hook, bool is_external, object_t *ob);
@@ -0,0 +1,403 @@
+/*---------------------------------------------------------------------------
+ * Socket readiness polling.
+ *
+ *---------------------------------------------------------------------------
+ * This module abstracts the system call used by the backend to wait for
+ * activity on the driver's file descriptors (login ports, user sockets,
+ * UDP, ERQ and the descriptors of packages like pgsql or python).
+ *
+ * Interest in a descriptor is registered with poller_set() and stays
+ * in effect until it is changed again, so that get_message() doesn't
+ * have to rebuild the full set of descriptors in every cycle. Setting the
+ * same events again is a no-op, setting no events removes the descriptor;
+ * this has to happen before the descriptor is closed.
+ *
+ * poller_wait() then waits for activity, afterwards poller_ready()
+ * returns the events which occurred on a given descriptor until the
+ * next call to poller_wait().
+ *
+ * If available, epoll() is used, otherwise select(). The epoll set is
+ * level-triggered: get_message() deliberately leaves data pending on a
+ * socket (e.g. when a user used up the commands for this second), and
+ * expects to be woken up again for it in the next cycle.
+ *---------------------------------------------------------------------------
+ */
+
+#include "driver.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/select.h>
+#include <unistd.h>
+
+#ifdef USE_EPOLL
+#    include <sys/epoll.h>
+#endif
+
+#include "poller.h"
+#include "simulate.h"
+#include "xalloc.h"
+
+/*-------------------------------------------------------------------------*/
+
+static Bool poller_initialized = MY_FALSE;
+  /* TRUE when poller_init() was called.
+   */
+
+static unsigned char *fd_events = NULL;
+  /* For every descriptor the events registered for it.
+   */
+
+static unsigned char *fd_ready = NULL;
+  /* For every descriptor the events which occurred in the last
+   * poller_wait().
+   */
+
+static int fd_size = 0;
+  /* The allocated size of fd_events[] and fd_ready[].
+   */
+
+static int *ready_list = NULL;
+static int  num_ready = 0;
+  /* The descriptors with a non-zero fd_ready[] entry, so that they can
+   * be reset quickly at the begin of the next poller_wait().
+   */
+
+static int num_registered = 0;
+  /* Number of descriptors with a non-zero fd_events[] entry.
+   */
+
+#ifdef USE_EPOLL
+
+static int epoll_fd = -1;
+  /* The epoll descriptor.
+   */
+
+static struct epoll_event *epoll_events = NULL;
+static int epoll_events_size = 0;
+  /* The buffer for the results of epoll_wait().
+   */
+
+#else
+
+static fd_set read_set, write_set, except_set;
+  /* The descriptors registered for the respective events.
+   */
+
+static int max_fd = -1;
+  /* The highest registered descriptor.
+   */
+
+#endif /* USE_EPOLL */
+
+/*-------------------------------------------------------------------------*/
+static void
+poller_init (void)
+
+/* Initialize the poller. This happens implicitely on the first
+ * registration of a descriptor.
+ */
+
+{
+    if (poller_initialized)
+        return;
+
+#ifdef USE_EPOLL
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        perror("epoll_create1");
+        exit(1);
+    }
+#else
+    FD_ZERO(&read_set);
+    FD_ZERO(&write_set);
+    FD_ZERO(&except_set);
+#endif
+
+    poller_initialized = MY_TRUE;
+} /* poller_init() */
+
+/*-------------------------------------------------------------------------*/
+static void
+reserve_fd (int fd)
+
+/* Make sure that the tables can hold information about <fd>.
+ */
+
+{
+    int new_size;
+
+    if (fd < fd_size)
+        return;
+
+    for (new_size = fd_size ? fd_size : 64; new_size <= fd; new_size *= 2)
+        NOOP;
+
+    fd_events = prexalloc(fd_events, (size_t)new_size);
+    fd_ready = prexalloc(fd_ready, (size_t)new_size);
+    ready_list = prexalloc(ready_list, (size_t)new_size * sizeof(*ready_list));
+    if (!fd_events || !fd_ready || !ready_list)
+        fatal("Out of memory (%d descriptors) for the poller.\n", new_size);
+
+    memset(fd_events + fd_size, 0, (size_t)(new_size - fd_size));
+    memset(fd_ready + fd_size, 0, (size_t)(new_size - fd_size));
+    fd_size = new_size;
+} /* reserve_fd() */
+
+/*-------------------------------------------------------------------------*/
+#ifdef USE_EPOLL
+
+static uint32_t
+epoll_mask (int events)
+
+/* Return the epoll event mask for the POLLER_xxx <events>.
+ */
+
+{
+    uint32_t mask = 0;
+
+    if (events & POLLER_READ)
+        mask |= EPOLLIN;
+    if (events & POLLER_WRITE)
+        mask |= EPOLLOUT;
+    if (events & POLLER_EXCEPT)
+        mask |= EPOLLPRI;
+
+    return mask;
+} /* epoll_mask() */
+
+#endif /* USE_EPOLL */
+
+/*-------------------------------------------------------------------------*/
+void
+poller_set (int fd, int events)
+
+/* Register interest in the <events> (POLLER_xxx flags) of descriptor <fd>,
+ * replacing any previous registration. If <events> is 0, <fd> is removed
+ * from the poller.
+ */
+
+{
+    int old_events;
+
+    if (fd < 0)
+        return;
+
+    if (!poller_initialized)
+        poller_init();
+
+    if (!events && fd >= fd_size)
+        return;
+
+    reserve_fd(fd);
+
+    old_events = fd_events[fd];
+    if (old_events == events)
+        return;
+
+#ifdef USE_EPOLL
+    {
+        struct epoll_event ev;
+        int op;
+
+        memset(&ev, 0, sizeof(ev));
+        ev.events = epoll_mask(events);
+        ev.data.fd = fd;
+
+        if (!events)
+            op = EPOLL_CTL_DEL;
+        else if (!old_events)
+            op = EPOLL_CTL_ADD;
+        else
+            op = EPOLL_CTL_MOD;
+
+        if (epoll_ctl(epoll_fd, op, fd, &ev) < 0)
+        {
+            /* A descriptor closed behind our back vanishes from the
+             * epoll set by itself; a reused number then must be added anew.
+             */
+            if (op == EPOLL_CTL_MOD && errno == ENOENT)
+                op = EPOLL_CTL_ADD;
+            else if (op == EPOLL_CTL_ADD && errno == EEXIST)
+                op = EPOLL_CTL_MOD;
+            else
+                op = -1;
+
+            if (op == -1 || epoll_ctl(epoll_fd, op, fd, &ev) < 0)
+            {
+                if (events)
+                    perror("epoll_ctl");
+            }
+        }
+    }
+#else
+    if (events & POLLER_READ)
+        FD_SET(fd, &read_set);
+    else
+        FD_CLR(fd, &read_set);
+    if (events & POLLER_WRITE)
+        FD_SET(fd, &write_set);
+    else
+        FD_CLR(fd, &write_set);
+    if (events & POLLER_EXCEPT)
+        FD_SET(fd, &except_set);
+    else
+        FD_CLR(fd, &except_set);
+
+    if (events && fd > max_fd)
+        max_fd = fd;
+    else if (!events && fd == max_fd)
+    {
+        /* fd_events[fd] is still set at this point. */
+        for (max_fd = fd - 1; max_fd >= 0 && !fd_events[max_fd]; max_fd--)
+            NOOP;
+    }
+#endif
+
+    if (!old_events)
+        num_registered++;
+    else if (!events)
+        num_registered--;
+
+    fd_events[fd] = (unsigned char)events;
+    fd_ready[fd] &= (unsigned char)events;
+} /* poller_set() */
+
+/*-------------------------------------------------------------------------*/
+int
+poller_wait (int twait)
+
+/* Wait at most <twait> seconds for activity on the registered descriptors.
+ * Return the number of descriptors with events, or -1 on failure (errno
+ * is set accordingly).
+ */
+
+{
+    int i, res;
+
+    if (!poller_initialized)
+        poller_init();
+
+    for (i = 0; i < num_ready; i++)
+        fd_ready[ready_list[i]] = 0;
+    num_ready = 0;
+
+#ifdef USE_EPOLL
+    if (epoll_events_size < num_registered)
+    {
+        int new_size = epoll_events_size ? epoll_events_size : 64;
+
+        while (new_size < num_registered)
+            new_size *= 2;
+        epoll_events = prexalloc(epoll_events
+                                , (size_t)new_size * sizeof(*epoll_events));
+        if (!epoll_events)
+            fatal("Out of memory (%d events) for the poller.\n", new_size);
+        epoll_events_size = new_size;
+    }
+
+    res = epoll_wait(epoll_fd, epoll_events
+                    , epoll_events_size > 0 ? epoll_events_size : 1
+                    , twait * 1000);
+    if (res < 0)
+        return res;
+
+    for (i = 0; i < res; i++)
+    {
+        int fd = epoll_events[i].data.fd;
+        uint32_t mask = epoll_events[i].events;
+        int events = 0;
+
+        if (fd < 0 || fd >= fd_size)
+            continue;
+
+        if (mask & EPOLLIN)
+            events |= POLLER_READ;
+        if (mask & EPOLLOUT)
+            events |= POLLER_WRITE;
+        if (mask & EPOLLPRI)
+            events |= POLLER_EXCEPT;
+        if (mask & (EPOLLERR|EPOLLHUP))
+            /* select() would report these as readable or writable. */
+            events |= POLLER_READ|POLLER_WRITE;
+
+        events &= fd_events[fd];
+        if (events)
+        {
+            fd_ready[fd] = (unsigned char)events;
+            ready_list[num_ready++] = fd;
+        }
+    }
+#else
+    {
+        fd_set readfds, writefds, exceptfds;
+        struct timeval timeout;
+
+        readfds = read_set;
+        writefds = write_set;
+        exceptfds = except_set;
+        timeout.tv_sec = twait;
+        timeout.tv_usec = 0;
+
+        res = select(max_fd + 1, &readfds, &writefds, &exceptfds, &timeout);
+        if (res <= 0)
+            return res;
+
+        for (i = 0; i <= max_fd; i++)
+        {
+            int events = 0;
+
+            if (!fd_events[i])
+                continue;
+
+            if (FD_ISSET(i, &readfds))
+                events |= POLLER_READ;
+            if (FD_ISSET(i, &writefds))
+                events |= POLLER_WRITE;
+            if (FD_ISSET(i, &exceptfds))
+                events |= POLLER_EXCEPT;
+
+            if (events)
+            {
+                fd_ready[i] = (unsigned char)events;
+                ready_list[num_ready++] = i;
+            }
+        }
+    }
+#endif
+
+    return num_ready;
+} /* poller_wait() */
+
+/*-------------------------------------------------------------------------*/
+int
+poller_ready (int fd)
+
+/* Return the events which occurred on <fd> in the last poller_wait().
+ */
+
+{
+    if (fd < 0 || fd >= fd_size)
+        return 0;
+    return fd_ready[fd];
+} /* poller_ready() */
+
+/*-------------------------------------------------------------------------*/
+void
+poller_clear (int fd, int events)
+
+/* Mark the <events> of <fd> as handled, so that poller_ready() won't
+ * report them anymore until the next poller_wait().
+ */
+
+{
+    if (fd < 0 || fd >= fd_size)
+        return;
+    fd_ready[fd] &= (unsigned char)~events;
+} /* poller_clear() */
+
+/***************************************************************************/
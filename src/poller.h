@@ -0,0 +1,19 @@
+#ifndef POLLER_H__
+#define POLLER_H__ 1
+
+#include "driver.h"
+
+/* --- Event flags --- */
+
+#define POLLER_READ    0x01  /* The fd is readable (or can accept) */
+#define POLLER_WRITE   0x02  /* The fd is writable */
+#define POLLER_EXCEPT  0x04  /* The fd has out-of-band data */
+
+/* --- Prototypes --- */
+
+extern void poller_set(int fd, int events);
+extern int  poller_wait(int twait);
+extern int  poller_ready(int fd);
+extern void poller_clear(int fd, int events);
+
+#endif /* POLLER_H__ */
@@ -176,15 +176,14 @@ xmemmem ( const char *haystack, size_t haystacklen
  * A needle of length 0 is always found at <haystack>.
  * If not found, return NULL.
  *
-#ifndef HAVE_MEMMEM
- * This function is a GNU/Linux extension, but up to and including
- * glibc 2 it wasn't implemented correctly. Since it is also used
- * only in the get_dir() implementation, we don't even bother to
- * use the glibc implementation.
-#endif
+ * Where available, this uses the memmem() of the C library, which is
+ * usually much faster than the simple loop.
  */
 
 {
+#ifdef HAVE_MEMMEM
+    return memmem(haystack, haystacklen, needle, needlelen);
+#else
     mp_int i;
 
     i = (mp_int)(haystacklen - needlelen);
@@ -194,6 +193,7 @@ xmemmem ( const char *haystack, size_t haystacklen
         haystack++;
     } while (--i >= 0);
     return 0;
+#endif
 } /* xmemmem() */
 
 /*-------------------------------------------------------------------------*/
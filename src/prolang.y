@@ -912,6 +912,12 @@ static p_uint last_expression;
    * is (unsigned)-1.
    */
 
+static p_uint last_local_lvalue;
+  /* If >= 0, the address of the F_PUSH_LOCAL_VARIABLE_LVALUE which
+   * add_lvalue_code() inserted last, directly in front of the instruction
+   * at last_expression. Otherwise the value is (unsigned)-1.
+   */
+
 static Bool last_string_is_new;
   /* TRUE: the last string stored with store_prog_string() was indeed
    * a new string.
@@ -2972,6 +2978,72 @@ ins_number (p_int num)
     }
 } /* ins_number() */
 
+/*-------------------------------------------------------------------------*/
+static void
+ins_binary_op (p_uint start1, p_uint start2, int instruction)
+
+/* Insert the binary operator <instruction>, whose operands were compiled
+ * starting at <start1> and <start2> to the end of the program.
+ *
+ * If the first operand is a local variable and the second one a local
+ * variable or a number between 0 and 255, both are fused into one
+ * superinstruction; for the comparison operators, the operator itself
+ * is fused, too.
+ */
+
+{
+    bytecode_p p = PROGRAM_BLOCK + start1;
+    p_uint size = CURRENT_PROGRAM_SIZE;
+    bytecode_t second;
+    int operand, fused;
+
+    /* Check that there's nothing but the two operands: a line number
+     * entry or a different code would be broken by the changes.
+     */
+    if (p[0] != F_LOCAL || start2 != start1 + 2 || stored_bytes > (p_int)start1)
+    {
+        ins_f_code(instruction);
+        return;
+    }
+
+    if (size == start2 + 2 && (p[2] == F_LOCAL || p[2] == F_CLIT))
+    {
+        second = p[2];
+        operand = p[3];
+    }
+    else if (size == start2 + 1 && (p[2] == F_CONST0 || p[2] == F_CONST1))
+    {
+        second = F_CLIT;
+        operand = (p[2] == F_CONST1) ? 1 : 0;
+    }
+    else
+    {
+        ins_f_code(instruction);
+        return;
+    }
+
+    switch (instruction)
+    {
+    case F_LT: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_LT : F_LOCAL_CLIT_LT; break;
+    case F_LE: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_LE : F_LOCAL_CLIT_LE; break;
+    case F_GT: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_GT : F_LOCAL_CLIT_GT; break;
+    case F_GE: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_GE : F_LOCAL_CLIT_GE; break;
+    case F_EQ: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_EQ : F_LOCAL_CLIT_EQ; break;
+    case F_NE: fused = (second == F_LOCAL) ? F_LOCAL_LOCAL_NE : F_LOCAL_CLIT_NE; break;
+    default:   fused = 0; break;
+    }
+
+    p[0] = fused ? fused : ((second == F_LOCAL) ? F_LOCAL_LOCAL : F_LOCAL_CLIT);
+    p[2] = (bytecode_t)operand;
+    CURRENT_PROGRAM_SIZE = start1 + 3;
+
+    if (!fused)
+        ins_f_code(instruction);
+
+    /* It could point into the superinstruction. */
+    last_expression = -1;
+} /* ins_binary_op() */
+
 /*-------------------------------------------------------------------------*/
 /* The following macros are used for a speedy codegeneration within bigger
  * functions.
@@ -10098,7 +10170,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_OR);
+          ins_binary_op($1.start, $3.start, F_OR);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10112,7 +10184,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_XOR);
+          ins_binary_op($1.start, $3.start, F_XOR);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10126,7 +10198,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_AND);
+          ins_binary_op($1.start, $3.start, F_AND);
       } /* end of '&' code */
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10144,7 +10216,7 @@ expr0:
           free_fulltype($3.type);
           free_lpctype(result);
 
-          ins_f_code(F_EQ);
+          ins_binary_op($1.start, $3.start, F_EQ);
 
           $$ = $1;
           $$.type = get_fulltype(lpctype_int);
@@ -10165,7 +10237,7 @@ expr0:
           free_fulltype($3.type);
           free_lpctype(result);
 
-          ins_f_code(F_NE);
+          ins_binary_op($1.start, $3.start, F_NE);
 
           $$ = $1;
           $$.type = get_fulltype(lpctype_int);
@@ -10180,7 +10252,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_GT);
+          ins_binary_op($1.start, $3.start, F_GT);
       }
     | expr0 L_GE  expr0
       {
@@ -10190,7 +10262,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_GE);
+          ins_binary_op($1.start, $3.start, F_GE);
       }
     | expr0 '<'  expr0
       {
@@ -10200,7 +10272,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_LT);
+          ins_binary_op($1.start, $3.start, F_LT);
       }
     | expr0 L_LE  expr0
       {
@@ -10210,7 +10282,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_LE);
+          ins_binary_op($1.start, $3.start, F_LE);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10225,7 +10297,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_LSH);
+          ins_binary_op($1.start, $3.start, F_LSH);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10239,7 +10311,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_f_code(F_RSH);
+          ins_binary_op($1.start, $3.start, F_RSH);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10253,7 +10325,7 @@ expr0:
           free_fulltype($1.type);
           free_fulltype($3.type);
 
-          ins_byte(F_RSHL);
+          ins_binary_op($1.start, $3.start, F_RSHL);
       }
 
     /*- - - - - - - - - - - - - - - - - - - - - - - - - - - - -*/
@@ -10342,7 +10414,7 @@ expr0:
               lpctype_t *result = check_binary_op_types($1.type.t_type, $4.type.t_type, "+", types_addition, lpctype_mixed);
               $$.type = get_fulltype(result);
 
-              ins_f_code(F_ADD);
+              ins_binary_op($1.start, $4.start, F_ADD);
           }
 
           free_fulltype($1.type);
@@ -10357,7 +10429,7 @@ expr0:
           lpctype_t *result = check_binary_op_types($1.type.t_type, $3.type.t_type, "-", types_subtraction, lpctype_mixed);
           $$.type = get_fulltype(result);
 
-          ins_f_code(F_SUBTRACT);
+          ins_binary_op($1.start, $3.start, F_SUBTRACT);
           free_fulltype($1.type);
           free_fulltype($3.type);
       } /* '-' */
@@ -10369,7 +10441,7 @@ expr0:
           lpctype_t *result = check_binary_op_types($1.type.t_type, $3.type.t_type, "*", types_multiplication, lpctype_mixed);
           $$.type = get_fulltype(result);
 
-          ins_f_code(F_MULTIPLY);
+          ins_binary_op($1.start, $3.start, F_MULTIPLY);
           free_fulltype($1.type);
           free_fulltype($3.type);
       } /* '*' */
@@ -10381,7 +10453,7 @@ expr0:
           lpctype_t *result = check_binary_op_types($1.type.t_type, $3.type.t_type, "%", types_modulus, lpctype_int);
           $$.type = get_fulltype(result);
 
-          ins_f_code(F_MOD);
+          ins_binary_op($1.start, $3.start, F_MOD);
           free_fulltype($1.type);
           free_fulltype($3.type);
       }
@@ -10392,7 +10464,7 @@ expr0:
           lpctype_t *result = check_binary_op_types($1.type.t_type, $3.type.t_type, "/", types_division, lpctype_int);
           $$.type = get_fulltype(result);
 
-          ins_f_code(F_DIVIDE);
+          ins_binary_op($1.start, $3.start, F_DIVIDE);
           free_fulltype($1.type);
           free_fulltype($3.type);
       } /* '/' */
@@ -13739,8 +13811,24 @@ add_lvalue_code ( struct lvalue_s * lv, int instruction)
  */
 
 {
+    bytecode_p lvalue_code = LVALUE_BLOCK + lv->lvalue.start;
+    Bool is_local = (lv->lvalue.size == 2
+                  && lvalue_code[0] == F_PUSH_LOCAL_VARIABLE_LVALUE);
+
+    if (is_local && instruction == F_VOID_ASSIGN)
+    {
+        /* Use the superinstruction right away. */
+        last_expression = CURRENT_PROGRAM_SIZE;
+        last_local_lvalue = -1;
+        ins_f_code(F_VOID_ASSIGN_LOCAL);
+        ins_byte(lvalue_code[1]);
+        free_lvalue_block(lv->lvalue);
+        return MY_TRUE;
+    }
+
     /* Create the code to push the lvalue */
-    if (!add_to_mem_block(A_PROGRAM, LVALUE_BLOCK + lv->lvalue.start, lv->lvalue.size))
+    last_local_lvalue = is_local ? CURRENT_PROGRAM_SIZE : -1;
+    if (!add_to_mem_block(A_PROGRAM, lvalue_code, lv->lvalue.size))
         return MY_FALSE;
 
     free_lvalue_block(lv->lvalue);
@@ -13772,6 +13860,36 @@ insert_pop_value (void)
         /* No last expression but a value to pop, interesting... */
         ins_f_code(F_POP_VALUE);
     }
+    else if (last_expression == CURRENT_PROGRAM_SIZE - sizeof(bytecode_t)
+          && last_expression >= 2
+          && last_local_lvalue == last_expression - 2
+          && stored_bytes <= (p_int)last_local_lvalue)
+    {
+        /* An assignment to a local variable: combine the lvalue
+         * and the instruction into a superinstruction.
+         */
+        bytecode_p p = PROGRAM_BLOCK + last_local_lvalue;
+        int fused;
+
+        switch (p[2])
+        {
+            case F_ASSIGN:   fused = F_VOID_ASSIGN_LOCAL; break;
+            case F_ADD_EQ:   fused = F_VOID_ADD_EQ_LOCAL; break;
+            case F_PRE_INC:
+            case F_POST_INC: fused = F_INC_LOCAL;         break;
+            case F_PRE_DEC:
+            case F_POST_DEC: fused = F_DEC_LOCAL;         break;
+            default:         fused = 0;                   break;
+        }
+
+        if (fused)
+        {
+            p[0] = fused;
+            CURRENT_PROGRAM_SIZE = last_local_lvalue + 2;
+        }
+        else
+            ins_f_code(F_POP_VALUE);
+    }
     else if (last_expression == CURRENT_PROGRAM_SIZE - sizeof(bytecode_t))
     {
          /* The following ops have no data in the bytecode. */
@@ -13852,6 +13970,7 @@ insert_pop_value (void)
     }
     
     last_expression = -1;
+    last_local_lvalue = -1;
 } /* insert_pop_value() */
 
 /*-------------------------------------------------------------------------*/
@@ -16449,6 +16568,7 @@ prolog (const char * fname, Bool isMasterObj)
     variables_defined = MY_FALSE;
     disable_sefuns   = isMasterObj;
     last_expression  = -1;
+    last_local_lvalue = -1;
     compiled_prog    = NULL;  /* NULL means fail to load. */
     heart_beat       = -1;
     comp_stackp      = 0;     /* Local temp stack used by compiler */
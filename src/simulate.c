@@ -1107,6 +1107,7 @@ errorf (const char *fmt, ...)
         int a;
         object_t *save_cmd;
         object_t *culprit = NULL;
+        p_int culprit_interval = 0;
 
 
         if (!published_catch)
@@ -1133,6 +1134,7 @@ errorf (const char *fmt, ...)
 
             culprit = current_heart_beat;
             current_heart_beat = NULL;
+            culprit_interval = query_heart_beat(culprit);
             set_heart_beat(culprit, MY_FALSE);
             debug_message("%s Heart beat in %s turned off.\n"
                          , time_stamp(), get_txt(culprit->name));
@@ -1191,7 +1193,7 @@ errorf (const char *fmt, ...)
             {
                 debug_message("%s Heart beat in %s turned back on.\n"
                              , time_stamp(), get_txt(culprit->name));
-                set_heart_beat(culprit, MY_TRUE);
+                set_heart_beat(culprit, culprit_interval ? culprit_interval : 1);
             }
         }
 
@@ -2151,6 +2153,7 @@ load_object (const char *lname, Bool create_super, int depth
         obj_list_end = ob;
     num_listed_objs++;
     enter_object_hash(ob);        /* add name to fast object lookup table */
+    schedule_object(ob);
 
     /* Give the object its uids */
     push_give_uid_error_context(ob);
@@ -2207,7 +2210,10 @@ load_object (const char *lname, Bool create_super, int depth
     }
 
     if ( !(ob->flags & O_DESTRUCTED))
+    {
         ob->flags |= O_WILL_CLEAN_UP;
+        schedule_object(ob);
+    }
 
     /* free the error handler with the buffer for name and fname. */
     pop_stack();
@@ -2404,6 +2410,7 @@ clone_object (string_t *str1)
         obj_list_end = new_ob;
     num_listed_objs++;
     enter_object_hash(new_ob);        /* Add name to fast object lookup table */
+    schedule_object(new_ob);
     push_give_uid_error_context(new_ob);
     push_ref_object(inter_sp, ob, "clone_object");
     push_ref_string(inter_sp, new_ob->name);
@@ -2724,6 +2731,7 @@ destruct (object_t *ob)
     }
 
     /* Move all objects in the inventory into the "void" */
+    free_id_index(ob);
     for (item = ob->contains; item; item = next)
     {
         remove_action_sent(ob, item);
@@ -2759,13 +2767,17 @@ destruct (object_t *ob)
             else
                 *pp = (*pp)->next_inv;
         }
+        free_id_index(ob->super);
     }
+    free_object_ids(ob);
 
     /* Now remove us out of the list of all objects.
      * This must be done last, because an error in the above code would
      * halt execution.
      */
     remove_object_hash(ob);
+    unschedule_object(ob);
+    cleanup_remove_object(ob);
     if (ob->prev_all)
         ob->prev_all->next_all = ob->next_all;
     if (ob->next_all)
@@ -2959,11 +2971,17 @@ remove_object (object_t *ob
                 free_action_sent((action_t *)sent);
         } while ( NULL != (sent = next) );
         ob->sent = NULL;
+        free_action_index(ob);
 #ifdef CHECK_OBJECT_REF
         sh->sent = NULL;
 #endif /* CHECK_OBJECT_REF */
     }
 
+    /* Pending callouts are of no use anymore, and they hold references
+     * to the object.
+     */
+    remove_object_call_outs(ob);
+
     /* Either free the object, or link it up for future freeing. */
     if (ob->ref <= 1)
     {
@@ -3248,7 +3266,7 @@ status_parse (strbuf_t * sbuf, char * buff)
             strbuf_addf(sbuf, "Arrays:\t\t\t\t%8ld %9ld\n"
                             , (long)num_arrays, total_array_size() );
             strbuf_addf(sbuf, "Mappings:\t\t\t%8"PRIdMPINT" %9"PRIdMPINT
-                              " (%"PRIdMPINT" hybrid, %"PRIdMPINT" hash)\n"
+                              " (%"PRIdMPINT" dirty, %"PRIdMPINT" hash)\n"
                             , num_mappings, total_mapping_size()
                             , num_dirty_mappings, num_hash_mappings
                             );
@@ -3379,6 +3397,7 @@ status_parse (strbuf_t * sbuf, char * buff)
                        , stat_last_data_cleaned.weighted_avg
                        , 100.0 * relate_statistics(stat_last_data_cleaned, stat_in_list)
                        );
+            object_queue_status(sbuf);
         }
         tot += show_otable_status(sbuf, verbose);
         tot += heart_beat_status(sbuf, verbose);
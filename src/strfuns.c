@@ -322,8 +322,8 @@ trim_all_spaces (const string_t * txt)
 
 {
     char * dest;
-    const char * src;
-    size_t dest_ix, src_ix, srclen;
+    const char * src, * end;
+    size_t dest_ix;
     string_t * rc;
 
     dest = alloca(mstrsize(txt));
@@ -331,31 +331,33 @@ trim_all_spaces (const string_t * txt)
         errorf("Stack overflow (%zu bytes)\n", mstrsize(txt));
 
     src = get_txt((string_t *const)txt);
-    srclen = mstrsize(txt);
-    src_ix = 0;
+    end = src + mstrsize(txt);
     dest_ix = 0;
 
     /* Blank out trailing spaces */
-    while (srclen > 0 && src[srclen-1] == ' ')
-        srclen--;
+    while (end > src && end[-1] == ' ')
+        end--;
 
     /* Skip leading spaces */
-    while (src_ix < srclen && *src == ' ')
-        src_ix++, src++;
+    while (src < end && *src == ' ')
+        src++;
 
-    /* Copy characters, but fold embedded spaces. */
-    for ( ; src_ix < srclen; src_ix++, src++, dest_ix++)
+    /* Copy the words between the spaces, and fold each space run
+     * into one space. As the trailing spaces are gone, every space
+     * run is followed by another word.
+     */
+    while (src < end)
     {
-        dest[dest_ix] = *src;
+        const char * space = memchr(src, ' ', end - src);
+        size_t wordlen = (space != NULL ? space : end) - src;
 
-        /* If this and the next character is a space, forward
-         * src until the last space in this run.
-         */
-        if (' ' == *src)
-        {
-            while (src_ix+1 < srclen && ' ' == src[1])
-                src_ix++, src++;
-        }
+        memcpy(dest + dest_ix, src, wordlen);
+        dest_ix += wordlen;
+        if (space == NULL)
+            break;
+
+        dest[dest_ix++] = ' ';
+        for (src = space + 1; *src == ' '; src++) NOOP;
     }
 
     memsafe(rc = new_n_mstring(dest, dest_ix), dest_ix, "trimmed result");
@@ -592,179 +594,6 @@ f_convert_charset (svalue_t *sp)
 
 #endif /* HAS_ICONV */
 
-/*--------------------------------------------------------------------*/
-static char *
-sort_string (const string_t * p_in, size_t len, long ** pos)
-
-/* Sort the characters of string <in> (with length <len>) by their numeric
- * values and return a newly allocated memory block with the sorted string.
- * If <pos> is not NULL, it will be set to a newly allocated memory block
- * giving the original positions of the characters in the sorted string.
- *
- * We use Mergesort to sort the strings.
- * TODO: Use Quicksort instead of Mergesort?
- */
-
-{
-    const char * in;  /* Input string */
-    char   * out;     /* Result string */
-    long   * outpos;  /* Result position array */
-    char   * tmp;     /* Temporary string */
-    long   * tmppos;  /* Temporary position array */
-    size_t   step;
-    size_t   i, j;
-
-    in = get_txt((string_t *const)p_in);
-    out = xalloc(len+1);
-    tmp = xalloc(len+1);
-    if (!out || !tmp)
-    {
-        if (out)
-            xfree(out);
-        if (tmp)
-            xfree(tmp);
-        errorf("(sort_string) Out of memory (2 * %zu bytes) for temporaries.\n"
-             , len+1);
-    }
-    out[len] = '\0';
-    tmp[len] = '\0';
-
-    if (pos)
-    {
-        outpos = xalloc(len * sizeof(*outpos) + 1);
-        tmppos = xalloc(len * sizeof(*outpos) + 1);
-          /* +1 so that smalloc won't complain when given an empty string */
-        if (!outpos || !tmppos)
-        {
-            if (out)
-                xfree(out);
-            if (tmp)
-                xfree(tmp);
-            if (outpos)
-                xfree(outpos);
-            if (tmppos)
-                xfree(tmppos);
-            errorf("(sort_string) Out of memory (2 * %zu bytes) for positions.\n"
-                 , len*sizeof(*outpos)+1);
-        }
-    }
-    else
-    {
-        outpos = NULL;
-        tmppos = NULL;
-    }
-
-    /* First Mergesort pass: comparison of adjacent characters
-     * and initialisation of the out arrays.
-     */
-    for (i = 0; i < len; i += 2)
-    {
-        if (i == len-1)
-        {
-            out[i] = in[i];
-            if (outpos)
-                outpos[i] = i;
-        }
-        else if (in[i] <= in[i+1])
-        {
-            out[i] = in[i];
-            out[i+1] = in[i+1];
-            if (outpos)
-            {
-                outpos[i] = i;
-                outpos[i+1] = i+1;
-            }
-        }
-        else /* (in[i] > in[i+1]) */
-        {
-            out[i] = in[i+1];
-            out[i+1] = in[i];
-            if (outpos)
-            {
-                outpos[i] = i+1;
-                outpos[i+1] = i;
-            }
-        }
-    } /* for(initial pass) */
-
-    /* Mergesort loop: perform the mergesort passes with increasing steps.
-     * Invariant: out is the (semi-sorted) data, tmp is the scratchspace.
-     */
-    for (step = 2; step < len; step *= 2)
-    {
-        size_t start, dest, left;
-
-        /* Exchange out and tmp */
-        {
-            char *tmp2;
-            long *tmp2pos;
-
-            tmp2 = out; out = tmp; tmp = tmp2;
-            if (outpos)
-            {
-                tmp2pos = outpos; outpos = tmppos; tmppos = tmp2pos;
-            }
-        }
-
-        for (start = 0, dest = 0; start <= len; start += 2*step)
-        {
-            for ( i = start, j = start+step, left = 2 * step
-                ; left && dest < len
-                ; left--, dest++
-                )
-            {
-                if (i >= start+step
-                 || i >= len)
-                {
-                    if (j < len)
-                    {
-                        out[dest] = tmp[j];
-                        if (outpos)
-                            outpos[dest] = tmppos[j];
-                        j++;
-                    }
-                }
-                else if (j >= start+2*step
-                      || j >= len)
-                {
-                    if (i < len)
-                    {
-                        out[dest] = tmp[i];
-                        if (outpos)
-                            outpos[dest] = tmppos[i];
-                        i++;
-                    }
-                }
-                else if (tmp[i] <= tmp[j])
-                {
-                    out[dest] = tmp[i];
-                    if (outpos)
-                        outpos[dest] = tmppos[i];
-                    i++;
-                }
-                else /* (tmp[i] > tmp[i+step]) */
-                {
-                    out[dest] = tmp[j];
-                    if (outpos)
-                        outpos[dest] = tmppos[j];
-                    j++;
-                }
-            } /* for (sort run) */
-        } /* for (start) */
-    } /* for(step) */
-
-    /* Free the temporary data */
-    if (tmppos)
-        xfree(tmppos);
-    xfree(tmp);
-
-    /* Return the result */
-    if (pos)
-        *pos = outpos;
-
-    return out;
-} /* sort_string() */
-
 /*--------------------------------------------------------------------*/
 string_t *
 intersect_strings (const string_t * p_left, const string_t * p_right, Bool bSubtract)
@@ -781,67 +610,36 @@ intersect_strings (const string_t * p_left, const string_t * p_right, Bool bSubt
 
 {
     size_t   len_left, len_right, len_out;
-    size_t   ix_left, ix_right;
-    long   * pos;
-    CBool  * matches;
-    const char * left_txt;
-    char * left, * right, * result_txt;
+    size_t   ix;
+    CBool    keep[UCHAR_MAX+1];
+    const char * left_txt, * right_txt;
+    char * result_txt;
     string_t *result;
 
     len_left = mstrsize(p_left);
     len_right = mstrsize(p_right);
+    left_txt = get_txt((string_t *const)p_left);
+    right_txt = get_txt((string_t *const)p_right);
 
-    xallocate(matches, len_left+1, "intersection matches");
-      /* +1 so that smalloc won't complain when given an empty left string */
-
-    for (ix_left = 0; ix_left < len_left; ix_left++)
-        matches[ix_left] = bSubtract ? MY_TRUE : MY_FALSE;
-
-    /* Sort the two strings */
-    left = sort_string(p_left, len_left, &pos);
-    right = sort_string(p_right, len_right, NULL);
-
-    /* Intersect the two strings by mutual comparison.
-     * Each non-matched character in left gets is pos[] set to -1.
+    /* Note which characters of left to keep: those in right
+     * for an intersection, those not in right for a subtraction.
      */
-    len_out = bSubtract ? len_left : 0;
-    for ( ix_left = 0, ix_right = 0
-        ; ix_left < len_left && ix_right < len_right
-        ; )
-    {
-        if (left[ix_left] < right[ix_right])
-            ix_left++;
-        else if (left[ix_left] > right[ix_right])
-            ix_right++;
-        else /* left[ix_left] == right[ix_right]) */
-        {
-            if (!bSubtract)
-            {
-                matches[pos[ix_left]] = MY_TRUE;
-                len_out++;
-            }
-            else
-            {
-                matches[pos[ix_left]] = MY_FALSE;
-                len_out--;
-            }
-            ix_left++;
-        }
-    }
+    memset(keep, bSubtract ? MY_TRUE : MY_FALSE, sizeof(keep));
+    for (ix = 0; ix < len_right; ix++)
+        keep[(unsigned char)right_txt[ix]] = bSubtract ? MY_FALSE : MY_TRUE;
 
-    /* Create the result: copy all flagged characters */
+    /* Count the characters to keep */
+    len_out = 0;
+    for (ix = 0; ix < len_left; ix++)
+        if (keep[(unsigned char)left_txt[ix]])
+            len_out++;
+
+    /* Create the result: copy all those characters */
     memsafe(result = alloc_mstring(len_out), len_out, "intersection result");
-    left_txt = get_txt((string_t *const)p_left);
     result_txt = get_txt(result);
-    for (ix_left = 0, ix_right = 0; ix_left < len_left; ix_left++)
-        if (matches[ix_left])
-            result_txt[ix_right++] = left_txt[ix_left];
-
-    /* Free intermediate results */
-    xfree(pos);
-    xfree(matches);
-    xfree(left);
-    xfree(right);
+    for (ix = 0; ix < len_left; ix++)
+        if (keep[(unsigned char)left_txt[ix]])
+            *result_txt++ = left_txt[ix];
 
     return result;
 } /* intersect_strings() */
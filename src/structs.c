@@ -832,6 +832,7 @@ struct_free_empty (struct_t *pStruct)
 
     /* Don't free_struct_type(pStruct->type) */
 
+    forget_cycle_root(pStruct);
     xfree(pStruct);
 } /* struct_free_empty() */
 
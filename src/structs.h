@@ -7,6 +7,7 @@
 
 #include "exec.h"
 #include "hash.h"
+#include "gcollect.h"
 #include "svalue.h"
 #include "mstrings.h"
 
@@ -248,7 +249,8 @@ static INLINE struct_name_t *ref_struct_name(struct_name_t *t)
 
 /* void free_struct(struct_t *t)
  *   Subtract one ref from struct <t>, and free the struct
- *   fully if the refcount reaches zero.
+ *   fully if the refcount reaches zero. Otherwise the struct is
+ *   noted as a possible root of a reference cycle.
  *
  * void free_struct_type(struct_type_t *t)
  *   Subtract one ref from struct typeobject <t>, and free the typeobject
@@ -262,6 +264,8 @@ static INLINE void free_struct(struct_t *t)
 {
     if (--(t->ref) <= 0)
         struct_free(t);
+    else
+        note_cycle_root(t, T_STRUCT);
 }
 static INLINE void free_struct_type(struct_type_t *t)
 {
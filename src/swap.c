@@ -69,6 +69,22 @@
  *   until the free blocks occupy only 1/4th of the swap file - then
  *   the swapper switches back to immediate extension.
  *
+ * With USE_SWAP_THREAD, the data to swap out is copied into a write
+ * request and queued for a background thread, which writes it into the
+ * file with pwrite(). The backend thus never waits for the disk when
+ * swapping out, unless more than SWAP_QUEUE_LIMIT bytes are waiting to
+ * be written. Reads of data still in the queue are satisfied from there.
+ * Finished requests are removed from the queue by the backend thread,
+ * which is also the only one to allocate and free memory. A failed write
+ * is fatal, since the data is already gone from memory.
+ *
+ * When an object is swapped in, the swapper tells the OS that the
+ * swapped-out objects in the same environment are likely to be needed
+ * soon, so that it can read them ahead.
+ *
+ * The latency of every read from and write to the swap file is counted
+ * in histograms with logarithmic buckets.
+ *
  *---------------------------------------------------------------------------
  */
 
@@ -77,8 +93,17 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <fcntl.h>
 #include <stddef.h>
 #include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#ifdef USE_SWAP_THREAD
+#include <pthread.h>
+#include <signal.h>
+#endif
 
 #include "swap.h"
 
@@ -110,6 +135,7 @@
 /*-------------------------------------------------------------------------*/
 
 typedef struct swap_block_s swap_block_t;
+typedef struct swap_write_s swap_write_t;
 typedef struct varblock_s   varblock_t;
 typedef struct free_swapped_mapping_locals_s free_swapped_mapping_locals_t;
 
@@ -129,6 +155,22 @@ struct swap_block_s
 };
 
 
+/* --- struct swap_write_s
+ *
+ * A block of data queued for writing into the swapfile. The requests
+ * are written in the order they were queued.
+ */
+
+struct swap_write_s
+{
+    swap_write_t  *next;     /* Next (younger) request */
+    p_int          offset;   /* Offset of the data in the swapfile */
+    mp_int         size;     /* Size of the data */
+    Bool           written;  /* TRUE once the data is in the file */
+    unsigned char  data[1];  /* The data, .size bytes */
+};
+
+
 /* --- struct varblock_s
  *
  * Varblocks are used to store the data from variables.
@@ -166,6 +208,24 @@ struct free_swapped_mapping_locals_s
 
 #define SWAP_ABS(a) ((a)>0 ? (a) : (-a))
 
+#define SWAP_QUEUE_LIMIT  (4 * 1024 * 1024)
+  /* Maximum number of bytes waiting to be written by the writer thread
+   * before the backend waits for it.
+   */
+
+#define SWAP_PREFETCH_SIZE 4096
+#define SWAP_PREFETCH_MAX  8
+  /* When an object is swapped in, the first SWAP_PREFETCH_SIZE bytes
+   * of the swapped blocks of up to SWAP_PREFETCH_MAX other objects in
+   * its environment are prefetched.
+   */
+
+#define SWAP_LATENCY_BUCKETS 20
+  /* Number of buckets in the latency histograms: bucket 0 counts
+   * accesses below one microsecond, bucket i>0 those taking
+   * 2^(i-1) to 2^i-1 microseconds, the last one also all longer ones.
+   */
+
 /*-------------------------------------------------------------------------*/
 
 Bool swap_compact_mode = MY_FALSE;
@@ -177,10 +237,59 @@ static char file_name[MAXPATHLEN+1] = "";
    * Defaults to "SWAP_FILE.<hostname>".
    */
 
-static FILE *swap_file = NULL;
+static int swap_fd = -1;
   /* The swapfile - it is kept open all the time.
    */
 
+#ifdef USE_SWAP_THREAD
+
+static pthread_t swap_thread;
+  /* The thread writing the queued requests.
+   */
+
+static Bool swap_thread_running = MY_FALSE;
+  /* TRUE when the writer thread has been started.
+   */
+
+static pthread_mutex_t swap_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+  /* Protects the state shared with the writer thread: swap_queue_next,
+   * the .written flags, swap_thread_stop, swap_write_errno and
+   * swap_write_latency[].
+   */
+
+static pthread_cond_t swap_queue_work = PTHREAD_COND_INITIALIZER;
+  /* Signalled when a request is queued or the thread is to stop.
+   */
+
+static pthread_cond_t swap_queue_done = PTHREAD_COND_INITIALIZER;
+  /* Signalled when a request has been written.
+   */
+
+static swap_write_t *swap_queue_first = NULL;
+static swap_write_t *swap_queue_last = NULL;
+  /* The queue of write requests, oldest first. The requests are
+   * linked and unlinked by the backend thread only.
+   */
+
+static swap_write_t *swap_queue_next = NULL;
+  /* The oldest request not yet written, or NULL.
+   */
+
+static mp_int swap_queue_num = 0;
+static mp_int swap_queue_size = 0;
+  /* Number and total data size of the requests in the queue.
+   */
+
+static Bool swap_thread_stop = MY_FALSE;
+  /* Set to make the writer thread terminate once the queue is written.
+   */
+
+static int swap_write_errno = 0;
+  /* The errno of the first failed write, or 0.
+   */
+
+#endif /* USE_SWAP_THREAD */
+
 static Bool recycle_free_space = MY_FALSE;
   /* True when freespace should be re-used, false if not
    */
@@ -286,6 +395,20 @@ static long swap_free_searchlength;
   /* Sum of search steps done when freeing a block.
    */
 
+static statcounter_t swap_write_latency[SWAP_LATENCY_BUCKETS];
+static statcounter_t swap_read_latency[SWAP_LATENCY_BUCKETS];
+  /* Histograms of the time taken by the writes to resp. the reads
+   * from the swapfile.
+   */
+
+static statcounter_t num_swap_reads_queued;
+  /* Number of reads satisfied from the write queue.
+   */
+
+static statcounter_t num_swap_prefetches;
+  /* Number of blocks prefetched from the swapfile.
+   */
+
 mp_int total_num_prog_blocks;
   /* Number of program blocks in memory.
    */
@@ -566,54 +689,292 @@ swap_free (mp_int offset)
 } /* swap_free() */
 
 /*-------------------------------------------------------------------------*/
-static p_int
-store_swap_block (void * buffer, mp_int size)
+static long
+swap_usecs (void)
 
-/* Store the memory block <buffer> of <size> bytes into the swapfile
- * and return the offset at which it was stored.
- * Return -1 on a failure.
+/* Return a monotonic time in microseconds, for measuring latencies.
+ */
+
+{
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+
+    if (!clock_gettime(CLOCK_MONOTONIC, &ts))
+        return (long)ts.tv_sec * 1000000L + ts.tv_nsec / 1000;
+#endif
+    {
+        struct timeval tv;
+
+        gettimeofday(&tv, NULL);
+        return (long)tv.tv_sec * 1000000L + tv.tv_usec;
+    }
+} /* swap_usecs() */
+
+/*-------------------------------------------------------------------------*/
+static void
+count_latency (statcounter_t *histogram, long usecs)
+
+/* Count an access to the swap file which took <usecs> microseconds
+ * in <histogram>.
+ */
+
+{
+    int bucket;
+
+    for (bucket = 0; usecs > 0 && bucket < SWAP_LATENCY_BUCKETS - 1; bucket++)
+        usecs >>= 1;
+    histogram[bucket]++;
+} /* count_latency() */
+
+/*-------------------------------------------------------------------------*/
+static Bool
+write_swap_data (const void *buffer, mp_int size, p_int offset)
+
+/* Write <size> bytes from <buffer> at <offset> into the swapfile.
+ * Return FALSE on a failure, with errno set.
  *
- * The swapfile is opened it necessary.
+ * This function is also called by the writer thread.
  */
 
 {
-    mp_int offset;
+    const char *p = buffer;
 
-    /* Make sure the swap file is open. */
-    if (swap_file == NULL)
+    while (size > 0)
     {
-        if (*file_name == '\0')
+        ssize_t rc = pwrite(swap_fd, p, (size_t)size, (off_t)offset);
+
+        if (rc < 0)
         {
-            sprintf(file_name, "%s.%s", SWAP_FILE, query_host_name());
+            if (errno == EINTR)
+                continue;
+            return MY_FALSE;
         }
-        swap_file = fopen(file_name, "w+b");
-        /* Leave this file pointer open! */
-        if (swap_file == NULL)
+        p += rc;
+        offset += rc;
+        size -= rc;
+    }
+
+    return MY_TRUE;
+} /* write_swap_data() */
+
+#ifdef USE_SWAP_THREAD
+
+/*-------------------------------------------------------------------------*/
+static void *
+swap_writer (void *arg UNUSED)
+
+/* The writer thread: write the queued requests in order until
+ * swap_thread_stop is set and the queue is empty.
+ */
+
+{
+#ifdef __MWERKS__
+#    pragma unused(arg)
+#endif
+    pthread_mutex_lock(&swap_queue_mutex);
+
+    for (;;)
+    {
+        swap_write_t *req;
+        Bool ok;
+        long start, usecs;
+
+        while (swap_queue_next == NULL && !swap_thread_stop)
+            pthread_cond_wait(&swap_queue_work, &swap_queue_mutex);
+
+        req = swap_queue_next;
+        if (req == NULL)
+            break;
+
+        /* The request won't be touched by the backend until it
+         * is marked as written, so the lock can be released.
+         */
+        pthread_mutex_unlock(&swap_queue_mutex);
+
+        start = swap_usecs();
+        ok = write_swap_data(req->data, req->size, req->offset);
+        usecs = swap_usecs() - start;
+
+        pthread_mutex_lock(&swap_queue_mutex);
+
+        if (!ok && !swap_write_errno)
+            swap_write_errno = errno ? errno : EIO;
+        count_latency(swap_write_latency, usecs);
+        req->written = MY_TRUE;
+        swap_queue_next = req->next;
+        pthread_cond_broadcast(&swap_queue_done);
+    }
+
+    pthread_mutex_unlock(&swap_queue_mutex);
+
+    return NULL;
+} /* swap_writer() */
+
+/*-------------------------------------------------------------------------*/
+static void
+start_swap_thread (void)
+
+/* Start the writer thread. If that fails, the swapfile is written
+ * synchronously.
+ */
+
+{
+    sigset_t all, old;
+    int rc;
+
+    /* The writer thread must not receive any of the driver's signals */
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &old);
+    rc = pthread_create(&swap_thread, NULL, swap_writer, NULL);
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+    if (rc)
+    {
+        debug_message("%s Couldn't start the swap writer thread, errno %d: "
+                      "writing the swap file synchronously.\n"
+                     , time_stamp(), rc);
+        return;
+    }
+
+    swap_thread_running = MY_TRUE;
+} /* start_swap_thread() */
+
+/*-------------------------------------------------------------------------*/
+static void
+finish_swap_writes (mp_int limit)
+
+/* Remove the written requests from the queue. If more than <limit>
+ * bytes remain queued, wait for the writer thread until that is no
+ * longer the case.
+ *
+ * A failed write is fatal.
+ */
+
+{
+    swap_write_t *done = NULL;
+    int write_errno;
+
+    pthread_mutex_lock(&swap_queue_mutex);
+
+    for (;;)
+    {
+        while (swap_queue_first != NULL && swap_queue_first->written)
         {
-            debug_message("%s Couldn't open swap file.\n", time_stamp());
-            return -1;
+            swap_write_t *req = swap_queue_first;
+
+            swap_queue_first = req->next;
+            if (swap_queue_first == NULL)
+                swap_queue_last = NULL;
+            swap_queue_num--;
+            swap_queue_size -= req->size;
+
+            req->next = done;
+            done = req;
         }
+
+        if (swap_queue_size <= limit)
+            break;
+
+        pthread_cond_wait(&swap_queue_done, &swap_queue_mutex);
     }
 
-    /* Find a free swap block */
-    offset = swap_alloc(size);
+    write_errno = swap_write_errno;
+
+    pthread_mutex_unlock(&swap_queue_mutex);
 
-    /* Seek and write the data */
-    if (fseek(swap_file, offset, 0) == -1)
+    while (done != NULL)
     {
-        debug_message("%s Couldn't seek the swap file, errno %d, "
-            "offset %"PRIdMPINT".\n", time_stamp(), errno, offset);
-        return -1;
+        swap_write_t *req = done;
+
+        done = req->next;
+        xfree(req);
+    }
+
+    if (write_errno)
+        fatal("I/O error in swap, errno %d.\n", write_errno);
+} /* finish_swap_writes() */
+
+/*-------------------------------------------------------------------------*/
+static void
+wait_for_swap_write (swap_write_t *req)
+
+/* Wait until the queued request <req> has been written.
+ */
+
+{
+    pthread_mutex_lock(&swap_queue_mutex);
+    while (!req->written)
+        pthread_cond_wait(&swap_queue_done, &swap_queue_mutex);
+    pthread_mutex_unlock(&swap_queue_mutex);
+} /* wait_for_swap_write() */
+
+#endif /* USE_SWAP_THREAD */
+
+/*-------------------------------------------------------------------------*/
+static void
+read_swap (void *buffer, mp_int size, p_int offset)
+
+/* Read <size> bytes at <offset> from the swapfile into <buffer>.
+ * Data still waiting in the write queue is taken from there.
+ *
+ * A failure is fatal.
+ */
+
+{
+    char *p = buffer;
+    long start;
+
+#ifdef USE_SWAP_THREAD
+    swap_write_t *req, *youngest = NULL;
+
+    /* Don't search through requests already written */
+    if (swap_queue_first != NULL)
+        finish_swap_writes(SWAP_QUEUE_LIMIT);
+
+    /* Find the youngest request overlapping the data: it holds the
+     * current data of the overlapping part.
+     */
+    for (req = swap_queue_first; req != NULL; req = req->next)
+    {
+        if (req->offset < offset + size && offset < req->offset + req->size)
+            youngest = req;
     }
 
-    if (fwrite((char *)buffer, size, 1, swap_file) != 1)
+    if (youngest != NULL)
     {
-        debug_message("%s I/O error in swap.\n", time_stamp());
-        return -1;
+        if (youngest->offset <= offset
+         && offset + size <= youngest->offset + youngest->size)
+        {
+            memcpy(buffer, youngest->data + (offset - youngest->offset), size);
+            num_swap_reads_queued++;
+            return;
+        }
+
+        /* The data is only partly in the request - wait until the
+         * file is up to date (the requests are written in order).
+         */
+        wait_for_swap_write(youngest);
     }
+#endif /* USE_SWAP_THREAD */
 
-    return offset;
-} /* store_swap_block() */
+    start = swap_usecs();
+
+    while (size > 0)
+    {
+        ssize_t rc = pread(swap_fd, p, (size_t)size, (off_t)offset);
+
+        if (rc < 0 && errno == EINTR)
+            continue;
+        if (rc <= 0)
+            fatal("Couldn't read the swap file, errno %d, offset %"
+                PRIdPINT".\n", errno, offset);
+        p += rc;
+        offset += rc;
+        size -= rc;
+    }
+
+    count_latency(swap_read_latency, swap_usecs() - start);
+} /* read_swap() */
 
 /*-------------------------------------------------------------------------*/
 static p_int
@@ -622,57 +983,110 @@ store_swap_block2 ( void * buffer1, mp_int size1
 
 /* Store the memory blocks <buffer1> of <size1> bytes and <buffer2> of
  * <size2> bytes into one block in the swapfile and return the offset at
- * which it was stored.
+ * which it was stored. <buffer2> may be NULL if <size2> is 0.
  * Return -1 on a failure.
  *
- * The swapfile is opened it necessary.
+ * The swapfile is opened it necessary. With the writer thread, the data
+ * is just copied into the write queue (except during a garbage
+ * collection), and the buffers may be freed right away.
  */
 
 {
     mp_int offset;
+    long start;
 
     /* Make sure the swap file is open. */
-    if (swap_file == NULL)
+    if (swap_fd < 0)
     {
         if (*file_name == '\0')
         {
             sprintf(file_name, "%s.%s", SWAP_FILE, query_host_name());
         }
-        swap_file = fopen(file_name, "w+b");
-        /* Leave this file pointer open! */
-        if (swap_file == NULL)
+        swap_fd = ixopen3(file_name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        /* Leave this file open! */
+        if (swap_fd < 0)
         {
             debug_message("%s Couldn't open swap file.\n", time_stamp());
             return -1;
         }
+#ifdef USE_SWAP_THREAD
+        start_swap_thread();
+#endif
     }
 
     /* Find a free swap block */
     offset = swap_alloc(size1 + size2);
 
-    /* Seek and write the data */
-    if (fseek(swap_file, offset, 0) == -1)
+#ifdef USE_SWAP_THREAD
+    if (swap_thread_running && !gc_status)
     {
-        debug_message("%s Couldn't seek the swap file, errno %d, "
-            "offset %"PRIdMPINT".\n", time_stamp(), errno, offset);
-        return -1;
-    }
+        swap_write_t *req;
+        mp_int size = size1 + size2;
 
-    if (fwrite((char *)buffer1, size1, 1, swap_file) != 1)
-    {
-        debug_message("%s I/O error in swap.\n", time_stamp());
-        return -1;
+        /* Make room in the queue */
+        finish_swap_writes(size < SWAP_QUEUE_LIMIT ? SWAP_QUEUE_LIMIT - size : 0);
+
+        req = xalloc(offsetof(swap_write_t, data) + size);
+        if (req != NULL)
+        {
+            req->next = NULL;
+            req->offset = offset;
+            req->size = size;
+            req->written = MY_FALSE;
+            memcpy(req->data, buffer1, size1);
+            if (size2)
+                memcpy(req->data + size1, buffer2, size2);
+
+            pthread_mutex_lock(&swap_queue_mutex);
+            if (swap_queue_last != NULL)
+                swap_queue_last->next = req;
+            else
+                swap_queue_first = req;
+            swap_queue_last = req;
+            if (swap_queue_next == NULL)
+                swap_queue_next = req;
+            swap_queue_num++;
+            swap_queue_size += size;
+            pthread_cond_signal(&swap_queue_work);
+            pthread_mutex_unlock(&swap_queue_mutex);
+
+            return offset;
+        }
+
+        /* Out of memory: write the data directly, but after
+         * everything queued before.
+         */
+        finish_swap_writes(0);
     }
+#endif /* USE_SWAP_THREAD */
+
+    start = swap_usecs();
 
-    if (fwrite((char *)buffer2, size2, 1, swap_file) != 1)
+    if (!write_swap_data(buffer1, size1, offset)
+     || (size2 && !write_swap_data(buffer2, size2, offset + size1)))
     {
-        debug_message("%s I/O error in swap.\n", time_stamp());
+        debug_message("%s I/O error in swap, errno %d.\n", time_stamp(), errno);
         return -1;
     }
 
+    count_latency(swap_write_latency, swap_usecs() - start);
+
     return offset;
 } /* store_swap_block2() */
 
+/*-------------------------------------------------------------------------*/
+static p_int
+store_swap_block (void * buffer, mp_int size)
+
+/* Store the memory block <buffer> of <size> bytes into the swapfile
+ * and return the offset at which it was stored.
+ * Return -1 on a failure.
+ */
+
+{
+    return store_swap_block2(buffer, size, NULL, 0);
+} /* store_swap_block() */
+
 /*-------------------------------------------------------------------------*/
 Bool
 swap_program (object_t *ob)
@@ -1627,19 +2041,15 @@ swap_variables (object_t *ob)
 
         if (last_changed_swapped_svalue)
         {
-            if (fseek(swap_file, last_variable_swap_num + sizeof(p_int), 0) ==
-                                                                            -1)
-            {
-                fatal("Couldn't seek the swap file, errno %d, offset %"
-                    PRIdMPINT".\n",
-                    errno, last_variable_swap_num + sizeof(p_int));
-            }
-            if (fwrite(
+            /* The write queue has been flushed at the begin of the GC,
+             * so the file can be written directly.
+             */
+            if (!write_swap_data(
                   last_variable_block,
                   last_changed_swapped_svalue - (char *)last_variable_block,
-                  1, swap_file) != 1)
+                  last_variable_swap_num + sizeof(p_int)))
             {
-                fatal("I/O error in swap.\n");
+                fatal("I/O error in swap, errno %d.\n", errno);
             }
         }
         mb_free(mbSwap);
@@ -1675,14 +2085,7 @@ swap_variables (object_t *ob)
         swap_num += offsetof(program_t, num_variables);
         if (swapfile_size <= swap_num)
             fatal("Attempt to swap in from beyond the end of the swapfile.\n");
-        if (fseek(swap_file, swap_num, 0) == -1)
-            fatal("Couldn't seek the swap file, errno %d, offset %"
-                PRIdPINT".\n", errno, swap_num);
-        if (fread(&num_variables, sizeof num_variables, 1, swap_file)
-            != 1)
-        {
-            fatal("Couldn't read the swap file.\n");
-        }
+        read_swap(&num_variables, sizeof num_variables, swap_num);
     }
     else
     {
@@ -1979,43 +2382,33 @@ read_unswapped_svalues (svalue_t *svp, mp_int num, unsigned char *p)
             p += sizeof user;
             if (gc_status)
             {
-                /* The garbage collector is not prepared to handle hash
-                 * mappings. On the other hand, the order of keys does
-                 * not matter here.
+                /* The garbage collector can't deal with the refcount
+                 * changes of get_map_lvalue(), so the keys are entered
+                 * into the mapping as they are.
                  * We can assume here that all allocation functions succeed
                  * because the garbage collector runs with
                  * malloc_privilege == MALLOC_SYSTEM .
                  */
-                mapping_cond_t *cm;
-                mp_int size;
-                svalue_t *data, *svp2;
-
-                m = allocate_cond_mapping(user, num_keys, num_values);
+                m = allocate_user_mapping(user, num_keys, num_values);
                 svp->u.map = m;
-                if (m->cond)
+                while (--num_keys >= 0)
                 {
-                    cm = m->cond;
-
-                    svp2 = &(cm->data[0]);
-                    size = cm->size;
-                    data = COND_DATA(cm, 0, num_values);
-                    while ( --size >= 0) {
-                        p = read_unswapped_svalues(svp2++, 1, p);
-                        p = read_unswapped_svalues(data, num_values, p);
-                        data += num_values;
-                    }
+                    svalue_t key, *data;
+
+                    p = read_unswapped_svalues(&key, 1, p);
+                    data = add_new_map_entry(m, &key);
+                    p = read_unswapped_svalues(data, num_values, p);
+                }
 #ifdef GC_SUPPORT
-                    if (gc_status == gcCountRefs)
-                    {
-                        /* Pretend that this memory block was already existing
-                         * in the clear phase.
-                         */
-                        clear_memory_reference(m);
-                        clear_memory_reference(cm);
-                        m->ref = 0;
-                    }
-#endif
+                if (gc_status == gcCountRefs)
+                {
+                    /* Pretend that this memory block was already existing
+                     * in the clear phase.
+                     */
+                    clear_memory_reference(m);
+                    m->ref = 0;
                 }
+#endif
             }
             else
             {
@@ -2098,6 +2491,48 @@ dummy_handler(const char * fmt UNUSED, ...)
 #endif
 } /* dummy_handler() */
 
+/*-------------------------------------------------------------------------*/
+static void
+prefetch_environment (object_t *ob)
+
+/* Object <ob> has just been swapped in: tell the OS that the swapped
+ * out objects in the same environment are likely to be needed soon.
+ * Since the sizes of their swap blocks are not known without reading
+ * the blocks, just their first SWAP_PREFETCH_SIZE bytes are named.
+ */
+
+{
+#if defined(HAVE_POSIX_FADVISE) && defined(POSIX_FADV_WILLNEED)
+    object_t *other;
+    int num;
+
+    if (!ob->super || gc_status)
+        return;
+
+    for ( other = ob->super->contains, num = 0
+        ; other != NULL && num < SWAP_PREFETCH_MAX
+        ; other = other->next_inv)
+    {
+        if (other == ob || !(other->flags & O_SWAPPED))
+            continue;
+
+        if ((p_int)other->prog & 1)
+        {
+            (void)posix_fadvise(swap_fd, (off_t)((p_int)other->prog & ~1)
+                               , SWAP_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+            num_swap_prefetches++;
+        }
+        if ((p_int)other->variables & 1)
+        {
+            (void)posix_fadvise(swap_fd, (off_t)((p_int)other->variables & ~1)
+                               , SWAP_PREFETCH_SIZE, POSIX_FADV_WILLNEED);
+            num_swap_prefetches++;
+        }
+        num++;
+    }
+#endif
+} /* prefetch_environment() */
+
 /*-------------------------------------------------------------------------*/
 int
 load_ob_from_swap (object_t *ob)
@@ -2137,9 +2572,6 @@ load_ob_from_swap (object_t *ob)
 
         if (swapfile_size <= swap_num)
             fatal("Attempt to swap in from beyond the end of the swapfile.\n");
-        if (fseek(swap_file, swap_num, 0) == -1)
-            fatal("Couldn't seek the swap file, errno %d, offset %"
-                PRIdPINT".\n", errno, swap_num);
         if (d_flag > 1)
         {
             debug_message("%s Unswap object %s (ref %"PRIdPINT")\n", 
@@ -2150,10 +2582,7 @@ load_ob_from_swap (object_t *ob)
          * find out. For greater efficiency we read in the full program_t
          * structure.
          */
-        if (fread(&tmp_prog, sizeof tmp_prog, 1, swap_file) != 1)
-        {
-            fatal("Couldn't read the swap file.\n");
-        }
+        read_swap(&tmp_prog, sizeof tmp_prog, swap_num);
         tmp_prog.swap_num = swap_num;
 
         /* Allocate the memory for the program, except for the
@@ -2166,11 +2595,9 @@ load_ob_from_swap (object_t *ob)
         /* Read in the rest of the program */
         if (tmp_prog.total_size - sizeof tmp_prog)
         {
-            if (fread( ((char *)prog) + sizeof tmp_prog,
-              tmp_prog.total_size - sizeof tmp_prog, 1, swap_file) != 1)
-            {
-                fatal("Couldn't read the swap file.\n");
-            }
+            read_swap( ((char *)prog) + sizeof tmp_prog
+                     , tmp_prog.total_size - sizeof tmp_prog
+                     , swap_num + sizeof tmp_prog);
         }
 
         ob->prog = prog;
@@ -2202,9 +2629,6 @@ load_ob_from_swap (object_t *ob)
         swap_num &= ~1;
         if (swapfile_size <= swap_num)
             fatal("Attempt to swap in from beyond the end of the swapfile.\n");
-        if (fseek(swap_file, swap_num, 0) == -1)
-            fatal("Couldn't seek the swap file, errno %d, offset %"
-                PRIdPINT".\n", errno, swap_num);
         if (d_flag > 1)
         {
             debug_message("%s Unswap variables of %s\n", time_stamp()
@@ -2212,10 +2636,7 @@ load_ob_from_swap (object_t *ob)
         }
 
         /* Read the size of the block from the file */
-        if (fread(&total_size, sizeof total_size, 1, swap_file) != 1)
-        {
-            fatal("Couldn't read the swap file.\n");
-        }
+        read_swap(&total_size, sizeof total_size, swap_num);
         size = total_size - sizeof total_size;
 
         /* Allocate the memory buffer */
@@ -2232,7 +2653,7 @@ load_ob_from_swap (object_t *ob)
             return result | -0x80;
         }
 
-        fread(block, size, 1, swap_file);
+        read_swap(block, size, swap_num + sizeof total_size);
 
         /* Prepare to restore */
         current_object = &dummy;
@@ -2308,6 +2729,8 @@ load_ob_from_swap (object_t *ob)
     /* Update the object flags */
     ob->flags &= ~O_SWAPPED;
 
+    prefetch_environment(ob);
+
     return result;
 } /* load_ob_from_swap() */
 
@@ -2328,12 +2751,7 @@ load_line_numbers_from_swap (program_t *prog)
 
     if (swapfile_size <= swap_num)
         fatal("Attempt to swap in from beyond the end of the swapfile.\n");
-    if (fseek(swap_file, swap_num, 0) == -1)
-        fatal("Couldn't seek the swap file, errno %d, offset %"
-            PRIdPINT".\n", errno, swap_num);
-    if (fread((char *)&tmp_numbers, sizeof tmp_numbers, 1, swap_file) != 1) {
-        fatal("Couldn't read the swap file.\n");
-    }
+    read_swap(&tmp_numbers, sizeof tmp_numbers, swap_num);
 
     if ( !(lines = xalloc(tmp_numbers.size)) )
         return MY_FALSE;
@@ -2342,8 +2760,8 @@ load_line_numbers_from_swap (program_t *prog)
 
     if (tmp_numbers.size > sizeof(tmp_numbers))
     {
-        fread(lines+1, tmp_numbers.size - sizeof(tmp_numbers)
-             , 1, swap_file);
+        read_swap(lines+1, tmp_numbers.size - sizeof(tmp_numbers)
+                 , swap_num + sizeof(tmp_numbers));
     }
 
     prog->line_numbers = lines;
@@ -2390,13 +2808,7 @@ remove_prog_swap (program_t *prog, Bool load_line_numbers)
          */
         linenumbers_t tmp_lines;
 
-        if (fseek(swap_file, swap_num + prog->total_size, 0 ) == -1)
-            fatal("Couldn't seek the swap file, errno %d, offset %"
-                PRIdPINT".\n", errno, swap_num);
-        if (fread(&tmp_lines, sizeof tmp_lines, 1, swap_file) != 1)
-        {
-            fatal("Couldn't read the swap file.\n");
-        }
+        read_swap(&tmp_lines, sizeof tmp_lines, swap_num + prog->total_size);
         total_bytes_swapped -= tmp_lines.size;
     }
     else
@@ -2433,12 +2845,42 @@ unlink_swap_file (void)
  */
 
 {
-    if (swap_file == NULL)
+    if (swap_fd < 0)
         return;
+
+#ifdef USE_SWAP_THREAD
+    if (swap_thread_running)
+    {
+        pthread_mutex_lock(&swap_queue_mutex);
+        swap_thread_stop = MY_TRUE;
+        pthread_cond_signal(&swap_queue_work);
+        pthread_mutex_unlock(&swap_queue_mutex);
+        pthread_join(swap_thread, NULL);
+        swap_thread_running = MY_FALSE;
+    }
+#endif
+
     unlink(file_name);
-    fclose(swap_file);
+    close(swap_fd);
+    swap_fd = -1;
 } /* unlink_swap_file() */
 
+/*-------------------------------------------------------------------------*/
+void
+sync_swap_file (void)
+
+/* Wait until all queued data is written into the swapfile, and release
+ * the write queue. This is done before a garbage collection, which has
+ * to see all allocated memory in a defined state.
+ */
+
+{
+#ifdef USE_SWAP_THREAD
+    if (swap_thread_running)
+        finish_swap_writes(0);
+#endif
+} /* sync_swap_file() */
+
 /*-------------------------------------------------------------------------*/
 size_t
 swap_overhead (void)
@@ -2450,6 +2892,51 @@ swap_overhead (void)
     return num_swap_structs * sizeof(swap_block_t);
 } /* swap_overhead() */
 
+/*-------------------------------------------------------------------------*/
+static void
+get_latency_histograms (statcounter_t *writes, statcounter_t *reads)
+
+/* Copy the latency histograms for the writes and the reads into
+ * <writes> resp. <reads>, each an array of SWAP_LATENCY_BUCKETS entries.
+ */
+
+{
+#ifdef USE_SWAP_THREAD
+    pthread_mutex_lock(&swap_queue_mutex);
+#endif
+    memcpy(writes, swap_write_latency, sizeof swap_write_latency);
+#ifdef USE_SWAP_THREAD
+    pthread_mutex_unlock(&swap_queue_mutex);
+#endif
+    memcpy(reads, swap_read_latency, sizeof swap_read_latency);
+} /* get_latency_histograms() */
+
+/*-------------------------------------------------------------------------*/
+static void
+add_latency_histogram (strbuf_t *sbuf, const char *title, statcounter_t *histogram)
+
+/* Add the latency <histogram> with the given <title> to the
+ * stringbuffer <sbuf>, omitting empty buckets.
+ */
+
+{
+    int i;
+
+    strbuf_addf(sbuf, "%s latency (us):", title);
+    for (i = 0; i < SWAP_LATENCY_BUCKETS; i++)
+    {
+        if (!histogram[i])
+            continue;
+        if (i == SWAP_LATENCY_BUCKETS - 1)
+            strbuf_addf(sbuf, " >=%ld: %"PRIuSTATCOUNTER
+                       , 1L << (i-1), histogram[i]);
+        else
+            strbuf_addf(sbuf, " <%ld: %"PRIuSTATCOUNTER
+                       , 1L << i, histogram[i]);
+    }
+    strbuf_add(sbuf, "\n");
+} /* add_latency_histogram() */
+
 /*-------------------------------------------------------------------------*/
 void
 swap_status (strbuf_t *sbuf)
@@ -2490,6 +2977,25 @@ swap_status (strbuf_t *sbuf)
                , swap_compact_mode ? "compact" : "non-compact"
                , (recycle_free_space || !swap_compact_mode) ? "on" : "off"
     );
+#ifdef USE_SWAP_THREAD
+    strbuf_addf(sbuf, "Write queue: %"PRIdMPINT" blocks, %"PRIdMPINT
+                      " bytes - writer thread: %s\n"
+               , swap_queue_num, swap_queue_size
+               , swap_thread_running ? "running" : "off"
+    );
+#endif
+    strbuf_addf(sbuf, "Reads from the write queue: %"PRIuSTATCOUNTER
+                      ", prefetched blocks: %"PRIuSTATCOUNTER"\n"
+               , num_swap_reads_queued, num_swap_prefetches
+    );
+    {
+        statcounter_t writes[SWAP_LATENCY_BUCKETS];
+        statcounter_t reads[SWAP_LATENCY_BUCKETS];
+
+        get_latency_histograms(writes, reads);
+        add_latency_histogram(sbuf, "Write", writes);
+        add_latency_histogram(sbuf, "Read", reads);
+    }
 } /* swap_status() */
 
 /*-------------------------------------------------------------------------*/
@@ -2543,6 +3049,50 @@ swap_driver_info (svalue_t *svp, int value)
             put_number(svp, recycle_free_space);
             break;
 
+        case DI_NUM_SWAP_WRITES_QUEUED:
+#ifdef USE_SWAP_THREAD
+            put_number(svp, swap_queue_num);
+#else
+            put_number(svp, 0);
+#endif
+            break;
+
+        case DI_SIZE_SWAP_WRITES_QUEUED:
+#ifdef USE_SWAP_THREAD
+            put_number(svp, swap_queue_size);
+#else
+            put_number(svp, 0);
+#endif
+            break;
+
+        case DI_NUM_SWAP_READS_QUEUED:
+            put_number(svp, num_swap_reads_queued);
+            break;
+
+        case DI_NUM_SWAP_PREFETCHES:
+            put_number(svp, num_swap_prefetches);
+            break;
+
+        case DI_SWAP_WRITE_LATENCY:
+            /* FALLTHROUGH */
+        case DI_SWAP_READ_LATENCY:
+        {
+            statcounter_t writes[SWAP_LATENCY_BUCKETS];
+            statcounter_t reads[SWAP_LATENCY_BUCKETS];
+            statcounter_t *histogram;
+            vector_t *v;
+            int i;
+
+            memsafe(v = allocate_array(SWAP_LATENCY_BUCKETS), sizeof(*v), "result array");
+
+            get_latency_histograms(writes, reads);
+            histogram = (value == DI_SWAP_WRITE_LATENCY) ? writes : reads;
+            for (i = 0; i < SWAP_LATENCY_BUCKETS; i++)
+                put_number(v->item + i, histogram[i]);
+            put_array(svp, v);
+            break;
+        }
+
         default:
             fatal("Unknown option for swap_driver_info(): %d\n", value);
             break;
@@ -24,6 +24,7 @@ extern Bool load_line_numbers_from_swap(program_t *prog);
 extern void remove_prog_swap(program_t *prog, Bool load_line_numbers);
 extern void name_swap_file(const char *name);
 extern void unlink_swap_file(void);
+extern void sync_swap_file(void);
 extern size_t swap_overhead (void);
 extern void swap_status(strbuf_t *sbuf);
 extern void swap_driver_info(svalue_t *svp, int value) __attribute__((nonnull(1)));
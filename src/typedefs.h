@@ -11,16 +11,19 @@
 
 #include "driver.h"
 
+typedef struct action_index_s     action_index_t;     /* actions.h */
 typedef struct action_s           action_t;           /* sent.h */
 // NOTE: mk_bytecode_gen.sh assumes that sizeof(bytecode_t) == 1
 typedef unsigned char             bytecode_t;         /* bytecode.h */
 typedef bytecode_t              * bytecode_p;         /* bytecode.h */
 typedef struct callback_s         callback_t;         /* simulate.h */
+typedef struct call_s             call_t;             /* call_out.c */
 typedef struct case_list_entry_s  case_list_entry_t;  /* switch.h */
 typedef struct case_state_s       case_state_t;       /* switch.h */
 typedef struct error_handler_s    error_handler_t;    /* interpret.h */
 typedef struct fulltype_s         fulltype_t;         /* types.h */
 typedef struct function_s         function_t;         /* exec.h */
+typedef struct id_index_s         id_index_t;         /* object.c */
 typedef struct ident_s            ident_t;            /* lex.h */
 typedef struct include_s          include_t;          /* exec.h */
 typedef struct inherit_s          inherit_t;          /* exec.h */
@@ -0,0 +1,18 @@
+/* An object defining many actions for the command benchmark. */
+
+#pragma strong_types
+
+int calls;
+
+void add_actions(object player, string *verbs)
+{
+    set_this_player(player);
+    foreach (string verb: verbs)
+        add_action("act", verb);
+}
+
+int act(string arg)
+{
+    calls++;
+    return 1;
+}
@@ -0,0 +1,376 @@
+/* The workloads of the interpreter benchmark.
+ *
+ * Every bench_xxx() function executes its workload <n> times. The
+ * workloads are chosen to exercise the instruction dispatch of the
+ * interpreter with a mix of cheap instructions, rather than the
+ * implementation of a few expensive efuns.
+ */
+
+#pragma strong_types, save_types
+
+int counter;
+
+int add(int a, int b) { return a + b; }
+
+void bench_loop(int n)
+{
+    int sum;
+
+    for (int i = 0; i < n; i++)
+    {
+        sum += i;
+        sum ^= i << 2;
+        if (sum > 1000000)
+            sum -= 1000000;
+    }
+}
+
+void bench_while(int n)
+{
+    int i = n, j;
+
+    while (i--)
+    {
+        j = i % 7;
+        if (j == 3 || j == 5)
+            j++;
+        else if (!j)
+            j--;
+    }
+}
+
+void bench_calls(int n)
+{
+    int sum;
+
+    for (int i = 0; i < n; i++)
+        sum = add(sum, i) & 0xffff;
+}
+
+void bench_call_other(int n)
+{
+    object ob = this_object();
+
+    for (int i = 0; i < n; i++)
+        ob->add(i, 1);
+}
+
+void bench_strings(int n)
+{
+    string s;
+
+    for (int i = 0; i < n; i++)
+    {
+        s = "abc" + i;
+        if (s[0] != 'a' || sizeof(s) < 4)
+            counter++;
+        s = s[1..2];
+    }
+}
+
+void bench_arrays(int n)
+{
+    int *arr = allocate(100, 0);
+
+    for (int i = 0; i < n; i++)
+    {
+        arr[i % 100] += i;
+        if (arr[<1] > 1000000)
+            arr[<1] = 0;
+    }
+}
+
+void bench_mappings(int n)
+{
+    mapping m = ([]);
+
+    for (int i = 0; i < n; i++)
+    {
+        m[i & 255] = i;
+        if (m[(i + 1) & 255])
+            counter++;
+    }
+}
+
+/* The map_xxx workloads exercise the mapping implementation itself,
+ * on mappings of MAP_KEYS entries.
+ */
+#define MAP_KEYS 1000
+
+string *make_keys()
+{
+    string *keys = allocate(MAP_KEYS);
+
+    for (int i = 0; i < MAP_KEYS; i++)
+        keys[i] = "key" + i;
+    return keys;
+}
+
+string *map_keys = make_keys();
+
+mapping fill_mapping()
+{
+    mapping m = ([]);
+
+    for (int i = 0; i < MAP_KEYS; i++)
+        m[map_keys[i]] = i;
+    return m;
+}
+
+void bench_map_insert(int n)
+{
+    mapping m;
+
+    for (int i = 0; i < n; i++)
+    {
+        if (!(i % MAP_KEYS))
+            m = ([]);
+        m[map_keys[i % MAP_KEYS]] = i;
+    }
+}
+
+void bench_map_lookup(int n)
+{
+    mapping m = fill_mapping();
+    int sum;
+
+    for (int i = 0; i < n; i++)
+        sum += m[map_keys[i % MAP_KEYS]] + m[i];
+}
+
+void bench_map_delete(int n)
+{
+    mapping m = fill_mapping();
+
+    /* Delete every key and add it again, so the mapping keeps its size. */
+    for (int i = 0; i < n; i++)
+    {
+        string key = map_keys[(i * 7) % MAP_KEYS];
+
+        m_delete(m, key);
+        m[key] = i;
+    }
+}
+
+void bench_map_iterate(int n)
+{
+    mapping m = fill_mapping();
+    int sum;
+
+    for (int i = 0; i < n; i += MAP_KEYS)
+        foreach (string key, int val: m)
+            sum += val;
+    for (int i = 0; i < n; i += MAP_KEYS)
+        walk_mapping(m, (: $2 += 1 :));
+}
+
+void bench_closures(int n)
+{
+    closure cl = (: $1 + $2 :);
+    int sum;
+
+    for (int i = 0; i < n; i++)
+        sum = funcall(cl, sum, i) & 0xffff;
+}
+
+void bench_switch(int n)
+{
+    for (int i = 0; i < n; i++)
+    {
+        switch (i & 7)
+        {
+        case 0: counter++; break;
+        case 1: counter--; break;
+        case 2..4: counter += 2; break;
+        case 5: counter -= 2; break;
+        default: break;
+        }
+    }
+}
+
+/* The broadcast workloads send messages into rooms with ROOM_SIZE
+ * livings, <n> counts the deliveries. The livings in /deaf have no
+ * catch_tell().
+ */
+#define ROOM_SIZE 500
+
+object *listeners;
+
+object *fill_room(object room, string file)
+{
+    object *obs = allocate(ROOM_SIZE);
+
+    for (int i = 0; i < ROOM_SIZE; i++)
+    {
+        obs[i] = clone_object(file);
+        obs[i]->setup();
+        set_environment(obs[i], room);
+    }
+    return obs;
+}
+
+void bench_tell_room(int n)
+{
+    if (!listeners)
+        listeners = fill_room(this_object(), "/listener");
+
+    for (int i = 0; i < n; i += ROOM_SIZE)
+        tell_room(this_object(), "Somebody shouts something.\n");
+}
+
+void bench_tell_deaf(int n)
+{
+    object room = load_object("/deaf");
+
+    if (!first_inventory(room))
+        fill_room(room, "/deaf");
+
+    for (int i = 0; i < n; i += ROOM_SIZE)
+        tell_room(room, "Somebody shouts something.\n");
+}
+
+void bench_say(int n)
+{
+    if (!listeners)
+        listeners = fill_room(this_object(), "/listener");
+
+    for (int i = 0; i < n; i += ROOM_SIZE)
+        listeners[(i / ROOM_SIZE) % ROOM_SIZE]->speak("Somebody says something.\n");
+}
+
+/* The command workload executes commands for a living with
+ * NUM_ACTIONS actions.
+ */
+#define NUM_ACTIONS 500
+
+object commander;
+string *commands;
+
+void bench_command(int n)
+{
+    if (!commander)
+    {
+        object actor = clone_object("/actor");
+
+        commander = clone_object("/listener");
+        commander->setup();
+        set_environment(actor, commander);
+        commands = allocate(NUM_ACTIONS);
+        for (int i = 0; i < NUM_ACTIONS; i++)
+            commands[i] = "verb" + i;
+        actor->add_actions(commander, commands);
+    }
+
+    for (int i = 0; i < n; i++)
+        command(commands[i % NUM_ACTIONS], commander);
+}
+
+/* The present() workload looks up items by id in a container with
+ * STORAGE_SIZE items, <n> counts the items searched.
+ */
+#define STORAGE_SIZE 1000
+
+object storage;
+string *item_ids;
+
+void bench_present(int n)
+{
+    if (!storage)
+    {
+        storage = clone_object("/item");
+        item_ids = allocate(STORAGE_SIZE);
+        for (int i = 0; i < STORAGE_SIZE; i++)
+        {
+            object item = clone_object("/item");
+
+            item->setup(i);
+            set_environment(item, storage);
+            item_ids[i] = "item" + i;
+        }
+    }
+
+    for (int i = 0; i < n; i += STORAGE_SIZE)
+        present(item_ids[(i / STORAGE_SIZE * 7) % STORAGE_SIZE], storage);
+}
+
+/* The regexp workload matches strings against NUM_PATTERNS different
+ * patterns, which are compiled once and then found in the regexp cache.
+ */
+#define NUM_PATTERNS 300
+
+string *patterns;
+
+void bench_regexp(int n)
+{
+    if (!patterns)
+    {
+        patterns = allocate(NUM_PATTERNS);
+        for (int i = 0; i < NUM_PATTERNS; i++)
+            patterns[i] = "^(a|b)*" + i + "[0-9]?$";
+    }
+
+    for (int i = 0; i < n; i += 10)
+        regmatch("abab" + i, patterns[i % NUM_PATTERNS]);
+}
+
+/* The text workloads process a player command of TEXT_LENGTH bytes,
+ * <n> counts the bytes processed.
+ */
+#define TEXT_LENGTH 200
+
+string text = implode(map(allocate(TEXT_LENGTH / 10), (: "Take sword" :)), ", ");
+
+void bench_explode(int n)
+{
+    for (int i = 0; i < n; i += TEXT_LENGTH)
+    {
+        explode(text, " ");
+        explode(text, ", ");
+    }
+}
+
+void bench_lower_case(int n)
+{
+    string lower = lower_case(text);
+
+    for (int i = 0; i < n; i += TEXT_LENGTH)
+    {
+        lower_case(text);
+        upper_case(lower);
+    }
+}
+
+void bench_strstr(int n)
+{
+    for (int i = 0; i < n; i += TEXT_LENGTH)
+    {
+        strstr(text, "shield");
+        strstr(text, "sword", i % TEXT_LENGTH);
+    }
+}
+
+void bench_intersect(int n)
+{
+    for (int i = 0; i < n; i += TEXT_LENGTH)
+    {
+        text & "aeiou";
+        text - " ,";
+    }
+}
+
+/* The hash workload looks up freshly built (and thus not yet hashed)
+ * short and long strings in a mapping, <n> counts the lookups.
+ */
+string long_prefix = "This is a long description of an item in the game. " * 4;
+
+void bench_hash(int n)
+{
+    mapping m = fill_mapping();
+    int sum;
+
+    for (int i = 0; i < n; i += 2)
+    {
+        sum += m["key" + (i % MAP_KEYS)];
+        sum += m[long_prefix + i];
+    }
+}
@@ -0,0 +1,44 @@
+#! /bin/sh
+#
+# Run the interpreter benchmark with one or more drivers:
+#
+#   ./bench.sh [-b bench1,bench2,...] [driver...]
+#
+# Without arguments, ../../src/ldmud (or $DRIVER) is used. To compare
+# two builds (e.g. configured with and without --enable-computed-goto),
+# give both drivers on the command line.
+
+BENCHMARKS=""
+
+if [ "$1" = "-b" ]
+then
+    BENCHMARKS="-f $2"
+    shift 2
+fi
+
+cd `dirname $0`
+
+DRIVER_DEFAULTS="-u-1 -E 0 --no-compat -e -N --cleanup-time -1 --reset-time -1
+    --max-array 0 --max-callouts 0 --max-bytes 0 --max-file 0 -s-1
+    -sv-1 --hard-malloc-limit unlimited --min-malloc 0 -ru0 -rm0 -rs0
+    --no-strict-euids --no-wizlist-file
+    --access-file none --access-log none"
+
+for driver in ${@:-${DRIVER:-../../src/ldmud}}
+do
+    if [ ! -x "${driver}" ]
+    then
+        echo "Did not find the driver '${driver}'."
+        exit 1
+    fi
+
+    echo "Driver: ${driver}"
+    ${driver} --options | grep -q USE_COMPUTED_GOTO \
+        && echo "Dispatch: computed goto" \
+        || echo "Dispatch: switch"
+
+    ${driver} ${DRIVER_DEFAULTS} ${BENCHMARKS} -Mmaster -m. \
+        --debug-file /dev/null 65433 \
+    || { echo "Benchmark with ${driver} FAILED."; exit 1; }
+    echo
+done
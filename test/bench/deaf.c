@@ -0,0 +1,10 @@
+/* A living object without catch_tell() for the broadcast benchmarks. */
+
+#pragma strong_types
+
+#include "/sys/configuration.h"
+
+void setup()
+{
+    configure_object(this_object(), OC_COMMANDS_ENABLED, 1);
+}
@@ -0,0 +1,20 @@
+/* An item for the present() benchmark. It declares its ids where
+ * the driver supports it, and answers id() otherwise.
+ */
+
+#pragma strong_types
+
+#include "/sys/configuration.h"
+
+string *ids = ({});
+
+void setup(int nr)
+{
+    ids = ({ "item", "item" + nr });
+    catch(configure_object(this_object(), OC_IDS, ids); nolog);
+}
+
+int id(string str)
+{
+    return member(ids, str) >= 0;
+}
@@ -0,0 +1,22 @@
+/* A living object for the broadcast benchmarks. */
+
+#pragma strong_types
+
+#include "/sys/configuration.h"
+
+int heard;
+
+void setup()
+{
+    configure_object(this_object(), OC_COMMANDS_ENABLED, 1);
+}
+
+void catch_tell(string str)
+{
+    heard++;
+}
+
+void speak(string str)
+{
+    say(str);
+}
@@ -0,0 +1,91 @@
+/* Benchmark of the interpreter.
+ *
+ * This is not a test: it is not run by run.sh, but by bench.sh in this
+ * directory, which passes the names of the benchmarks to run via -f.
+ *
+ * Every benchmark of bench.c is run ROUNDS times; the fastest round
+ * counts. The number of executed instructions is taken from the
+ * evaluation cost, which the interpreter increments by one for every
+ * instruction.
+ */
+
+#include "/inc/base.inc"
+#include "/sys/debug_message.h"
+#include "/sys/rtlimits.h"
+
+#define ITERATIONS 1000000
+#define ROUNDS     5
+
+string *benchmarks = ({});
+
+void out(string str, varargs mixed *par)
+{
+    debug_message(apply(#'sprintf, str, par), DMSG_STDOUT);
+}
+
+int *measure(object ob, string fun)
+{
+    int ticks = get_eval_cost();
+    int *start = utime();
+
+    call_other(ob, fun, ITERATIONS);
+
+    int *stop = utime();
+    ticks -= get_eval_cost();
+
+    return ({ ticks, (stop[0] - start[0]) * 1000000 + stop[1] - start[1] });
+}
+
+void run_benchmarks()
+{
+    object ob = load_object("/bench");
+    int total_ticks, total_usecs;
+
+    if (!sizeof(benchmarks))
+        benchmarks = map(filter(functionlist(ob), (: $1[0..5] == "bench_" :))
+                        , (: $1[6..] :));
+
+    out("%-15s %12s %10s %12s\n", "Benchmark", "Instructions", "Time (ms)", "Instr/sec");
+
+    foreach (string name: benchmarks)
+    {
+        int ticks, usecs = -1;
+
+        for (int round = 0; round < ROUNDS; round++)
+        {
+            int *res = limited(#'measure, ({ LIMIT_EVAL, LIMIT_UNLIMITED })
+                              , ob, "bench_" + name);
+
+            ticks = res[0];
+            if (usecs < 0 || res[1] < usecs)
+                usecs = res[1];
+        }
+
+        if (usecs < 1)
+            usecs = 1;
+        total_ticks += ticks;
+        total_usecs += usecs;
+
+        out("%-15s %12d %10d %12d\n", name, ticks, usecs / 1000
+           , to_int(ticks * 1000000.0 / usecs));
+    }
+
+    if (total_usecs < 1)
+        total_usecs = 1;
+    out("%-15s %12d %10d %12d\n", "total", total_ticks, total_usecs / 1000
+       , to_int(total_ticks * 1000000.0 / total_usecs));
+
+    shutdown(0);
+}
+
+void flag(string arg)
+{
+    if (arg != "test")
+        benchmarks += explode(arg, ",") - ({ "" });
+}
+
+string *epilog(int eflag)
+{
+    run_benchmarks();
+    return 0;
+}
@@ -0,0 +1,285 @@
+/* Test of the command search in a living with many actions, which
+ * is done with the verb index of its actions, and of the actions
+ * declared with action_table().
+ */
+
+#include "/inc/base.inc"
+#include "/inc/gc.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/commands.h"
+#include "/sys/configuration.h"
+
+#define NUM_FILLERS 50
+
+#define DECLARED_FILE __DIR__".tmp-actions-declared.c"
+#define BAD_FILE      __DIR__".tmp-actions-bad.c"
+
+mixed *called = ({});
+object player, room, other_room;
+object filler, first, second, in_room;
+object declared_env, declared_inv;
+
+/* These functions are for the clones. */
+
+int result = 1;
+
+void setup()
+{
+    configure_object(this_object(), OC_COMMANDS_ENABLED, 1);
+}
+
+void set_result(int r)
+{
+    result = r;
+}
+
+void add(object pl, string verb, varargs int *flag)
+{
+    set_this_player(pl);
+    add_action("act", verb, sizeof(flag) ? flag[0] : 0);
+}
+
+int remove_verb(object pl, string verb)
+{
+    return remove_action(verb, pl);
+}
+
+void log_call(object ob, string verb, string arg)
+{
+    called += ({ ({ ob, verb, arg }) });
+}
+
+int act(string arg)
+{
+    blueprint()->log_call(this_object(), query_verb(), arg);
+
+    /* Enough new actions to rebuild the index during the search. */
+    if (query_verb() == "grow")
+        foreach (int i: 2 * NUM_FILLERS)
+            add_action("act", "grown" + i);
+
+    return result;
+}
+
+/* Returns whether the last command called exactly <calls>, given as
+ * ({ object, verb, arg }) each.
+ */
+int check_called(mixed *calls)
+{
+    int ok = sizeof(called) == sizeof(calls);
+
+    for (int i = 0; ok && i < sizeof(calls); i++)
+        ok = called[i][0] == calls[i][0] && called[i][1] == calls[i][1]
+          && called[i][2] == calls[i][2];
+    called = ({});
+    return ok;
+}
+
+int do_command(string cmd)
+{
+    called = ({});
+    return command(cmd, player);
+}
+
+void run_test()
+{
+    int errors;
+
+    msg("\nRunning test for the command search:\n"
+          "------------------------------------\n");
+
+    room = clone_object(this_object());
+    other_room = clone_object(this_object());
+    player = clone_object(this_object());
+    player->setup();
+    set_environment(player, room);
+
+    filler = clone_object(this_object());
+    set_environment(filler, player);
+    foreach (int i: NUM_FILLERS)
+        filler->add(player, "verb" + i);
+
+    first = clone_object(this_object());
+    set_environment(first, player);
+    second = clone_object(this_object());
+    set_environment(second, player);
+    in_room = clone_object(this_object());
+    set_environment(in_room, room);
+
+    write_file(DECLARED_FILE,
+        "#include \"/sys/commands.h\"\n"
+        "int result = 1;\n"
+        "void set_result(int r) { result = r; }\n"
+        "mixed *action_table() {\n"
+        "    return ({ ({ \"act\", \"wave\" }), ({ \"act\", \"#\", AA_IMM_ARGS }) });\n"
+        "}\n"
+        "int act(string arg) {\n"
+        "    blueprint(this_player())->log_call(this_object(), query_verb(), arg);\n"
+        "    return result;\n"
+        "}\n", 1);
+    write_file(BAD_FILE, "mixed *action_table() { return ({ 42 }); }\n", 1);
+
+    errors = run_array_without_callback(({
+        ({ "Plain verb", 0,
+           (:
+               return do_command("verb7 x")
+                   && check_called(({ ({ filler, "verb7", "x" }) }));
+           :)
+        }),
+        ({ "Unknown verb", 0,
+           (:
+               return !do_command("verb")
+                   && check_called(({}));
+           :)
+        }),
+        ({ "Last added action first", 0,
+           (:
+               first->add(player, "look");
+               second->add(player, "look");
+               return do_command("look")
+                   && check_called(({ ({ second, "look", 0 }) }));
+           :)
+        }),
+        ({ "Failing action continues the search", 0,
+           (:
+               second->set_result(0);
+               return do_command("look at me")
+                   && check_called(({ ({ second, "look", "at me" }),
+                                      ({ first, "look", "at me" }) }));
+           :)
+        }),
+        ({ "Short verb added later", 0,
+           (:
+               first->add(player, "exa");
+               second->add(player, "examine", -3);
+               second->set_result(1);
+               return do_command("exa")
+                   && check_called(({ ({ second, "exa", 0 }) }));
+           :)
+        }),
+        ({ "Short verb added earlier", 0,
+           (:
+               first->add(player, "exa");
+               return do_command("exam")
+                   && check_called(({ ({ second, "exam", 0 }) }))
+                   && do_command("exa")
+                   && check_called(({ ({ first, "exa", 0 }) }));
+           :)
+        }),
+        ({ "No-space action", 0,
+           (:
+               second->add(player, "'", AA_NOSPACE);
+               first->add(player, "'hello");
+               return do_command("'hello")
+                   && check_called(({ ({ first, "'hello", 0 }) }))
+                   && do_command("'hello there")
+                   && check_called(({ ({ first, "'hello", "there" }) }))
+                   && do_command("'hi")
+                   && check_called(({ ({ second, "'hi", "hi" }) }));
+           :)
+        }),
+        ({ "remove_action()", 0,
+           (:
+               return first->remove_verb(player, "'hello")
+                   && do_command("'hello")
+                   && check_called(({ ({ second, "'hello", "hello" }) }));
+           :)
+        }),
+        ({ "Actions added during the search", 0,
+           (:
+               first->add(player, "grow");
+               second->add(player, "grow");
+               second->set_result(0);
+               return do_command("grow")
+                   && check_called(({ ({ second, "grow", 0 }),
+                                      ({ first, "grow", 0 }) }))
+                   && do_command("grown7")
+                   && check_called(({ ({ first, "grown7", 0 }) }));
+           :)
+        }),
+        ({ "Moving away", 0,
+           (:
+               in_room->add(player, "open");
+               if (!do_command("open") || !check_called(({ ({ in_room, "open", 0 }) })))
+                   return 0;
+               set_environment(player, other_room);
+               return !do_command("open")
+                   && check_called(({}))
+                   && do_command("verb3")
+                   && check_called(({ ({ filler, "verb3", 0 }) }));
+           :)
+        }),
+        ({ "Destructed action object", 0,
+           (:
+               destruct(filler);
+               return !do_command("verb3")
+                   && check_called(({}))
+                   && do_command("look")
+                   && check_called(({ ({ second, "look", 0 }),
+                                      ({ first, "look", 0 }) }));
+           :)
+        }),
+        ({ "Declared actions", 0,
+           (:
+               declared_env = clone_object(DECLARED_FILE);
+               set_environment(declared_env, other_room);
+               declared_inv = clone_object(DECLARED_FILE);
+               set_environment(declared_inv, player);
+               return do_command("wave at all")
+                   && check_called(({ ({ declared_env, "wave", "at all" }) }))
+                   && do_command("#smile")
+                   && check_called(({ ({ declared_env, "#", "smile" }) }))
+                   && !do_command("jump")
+                   && check_called(({}));
+           :)
+        }),
+        ({ "Added actions before declared actions", 0,
+           (:
+               first->add(player, "wave");
+               return do_command("wave")
+                   && check_called(({ ({ first, "wave", 0 }) }))
+                   && first->remove_verb(player, "wave");
+           :)
+        }),
+        ({ "Failing declared action continues the search", 0,
+           (:
+               declared_env->set_result(0);
+               return do_command("wave")
+                   && check_called(({ ({ declared_env, "wave", 0 }),
+                                      ({ declared_inv, "wave", 0 }) }));
+           :)
+        }),
+        ({ "Declared actions after moving away", 0,
+           (:
+               declared_env->set_result(1);
+               set_environment(player, room);
+               return do_command("wave")
+                   && check_called(({ ({ declared_inv, "wave", 0 }) }));
+           :)
+        }),
+        ({ "Bad action table", TF_ERROR,
+           (:
+               set_environment(clone_object(BAD_FILE), room);
+               return do_command("wave");
+           :)
+        }),
+    }));
+
+    rm(DECLARED_FILE);
+    rm(BAD_FILE);
+
+    /* The action index and the action tables are still there. */
+    start_gc(function void(int gc_error)
+    {
+        destruct(first);
+        destruct(second);
+        shutdown(errors || gc_error);
+    });
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
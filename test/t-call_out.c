@@ -0,0 +1,151 @@
+#pragma save_types, rtt_checks
+
+#include "/inc/base.inc"
+#include "/inc/gc.inc"
+#include "/inc/deep_eq.inc"
+#include "/sys/driver_info.h"
+
+string *order = ({});
+
+void record(string what) { order += ({ what }); }
+void dummy() {}
+
+int check_order()
+{
+    // Callouts with the same delay must run in the order of creation,
+    // callouts with a shorter delay before those with a longer one.
+    return deep_eq(order, ({ "a1", "b1", "c1", "a2", "b2" }));
+}
+
+void check_destruct(int expected)
+{
+    // The callout of the clone must be gone by now.
+    msg("Running Test destruct...");
+    if (driver_info(DI_NUM_CALLOUTS_REMOVED_BY_DESTRUCT) == expected)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        shutdown(1);
+    }
+}
+
+void finish()
+{
+    int errors;
+
+    msg("Running Test execution order...");
+    if (check_order())
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result: %Q)\n", order);
+        errors++;
+    }
+
+    msg("Running Test remaining callouts...");
+    if (find_call_out("dummy") < 0 && find_call_out("record") < 0)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Callouts left.)\n");
+        errors++;
+    }
+
+    if (errors)
+        shutdown(1);
+    else
+        start_gc(#'shutdown);
+}
+
+void run_test()
+{
+    int errors;
+    closure cl = #'dummy;
+    object clone = clone_object(this_object());
+
+    msg("\nRunning test for call_out()s:\n"
+          "-----------------------------\n");
+
+    // Long delays end up in the higher levels of the wheel.
+    call_out("dummy", 100000000);
+    call_out("dummy", 5000);
+    call_out("dummy", 300000);
+    call_out(cl, 70);
+    call_out(#'dummy, 10);
+    call_out("dummy", 2);
+    clone->call_out_from(10, "dummy");
+    call_out(#'write, 4000, "never");
+
+    msg("Running Test find_call_out()...");
+    if (find_call_out("dummy") == 2
+     && find_call_out(cl) == 10
+     && find_call_out(#'write) == 4000
+     && find_call_out("nothing") == -1)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    msg("Running Test call_out_info()...");
+    mixed *info = filter(call_out_info(), (: $1[0] == this_object() :));
+    if (deep_eq(map(info, (: $1[2] :)), ({ 2, 10, 70, 4000, 5000, 300000, 100000000 })))
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result: %Q)\n", info);
+        errors++;
+    }
+
+    msg("Running Test remove_call_out()...");
+    if (remove_call_out("dummy") == 2
+     && remove_call_out("dummy") == 5000
+     && remove_call_out(#'dummy) == 10
+     && remove_call_out(cl) == 70
+     && remove_call_out(#'write) == 4000
+     && remove_call_out("dummy") == 300000
+     && remove_call_out("dummy") == 100000000
+     && remove_call_out("dummy") == -1
+     && clone->find_call_out_from("dummy") == 10)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    int removed = driver_info(DI_NUM_CALLOUTS_REMOVED_BY_DESTRUCT);
+    destruct(clone);
+    call_out("check_destruct", 0, removed + 1);
+
+    if (errors)
+    {
+        shutdown(1);
+        return;
+    }
+
+    call_out("record", 1, "a2");
+    call_out("record", 0, "a1");
+    call_out("record", 0, "b1");
+    call_out("record", 1, "b2");
+    call_out("record", 0, "c1");
+    call_out("finish", 3);
+}
+
+void call_out_from(int delay, string fun)
+{
+    call_out(fun, delay);
+}
+
+int find_call_out_from(string fun)
+{
+    return find_call_out(fun);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,90 @@
+/* Test of the cycle collector: containers only referenced by
+ * reference cycles are freed without a garbage collection.
+ */
+
+#include "/inc/base.inc"
+
+#include "/sys/driver_info.h"
+
+struct node
+{
+    struct node next;
+    mixed       data;
+};
+
+mixed *kept;
+int freed_before;
+
+void make_garbage()
+{
+    mixed *arr = ({ 0, "array" });
+    mapping map = ([ "map": 0 ]);
+    struct node s = (<node> data: "struct");
+    struct node s1 = (<node>), s2 = (<node>);
+    mixed *holder = ({ 0 });
+    closure cl = function mixed() : mixed *h = holder { return h; };
+
+    arr[0] = arr;
+    map["map"] = map;
+    s->next = s;
+    s1->next = s2;
+    s2->next = s1;
+    holder[0] = cl;
+}
+
+void make_kept()
+{
+    mixed *arr = ({ 0, "kept" });
+
+    arr[0] = arr;
+    kept = ({ arr });
+}
+
+void check(int round)
+{
+    int freed = driver_info(DI_NUM_CYCLE_GARBAGE_FREED) - freed_before;
+
+    /* The array, the mapping, three structs, the holder and the closure. */
+    if (freed < 7)
+    {
+        if (round < 10)
+        {
+            call_out("check", 1, round + 1);
+            return;
+        }
+
+        msg(" FAILURE! (Only %d containers freed.)\n", freed);
+        shutdown(1);
+        return;
+    }
+
+    if (kept[0][0] != kept[0] || kept[0][1] != "kept")
+    {
+        msg(" FAILURE! (Referenced cycle was damaged.)\n");
+        shutdown(1);
+        return;
+    }
+
+    msg(" Success.\n");
+    shutdown(0);
+}
+
+void run_test()
+{
+    msg("\nRunning test for the cycle collector:\n"
+          "-------------------------------------\n");
+
+    msg("Running Test garbage cycles...");
+
+    freed_before = driver_info(DI_NUM_CYCLE_GARBAGE_FREED);
+    make_kept();
+    make_garbage();
+
+    call_out("check", 1, 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
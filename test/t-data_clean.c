@@ -0,0 +1,114 @@
+/* Test of the incremental data-clean of all objects, which is started
+ * when there are more referenced destructed objects than living ones,
+ * and of the pause time histograms.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/gc.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+
+#define NUM_LIVING      5
+#define NUM_DESTRUCTED  200
+#define NUM_VALUES      1000
+
+object *living, *destructed;
+int gc_pauses;
+mixed *values;
+
+void fill_values()
+{
+    /* Enough values that cleaning up the object takes longer
+     * than a slice of 1us.
+     */
+    values = map(allocate(NUM_VALUES), (: ({ $1 }) :));
+}
+
+int sum(int *arr)
+{
+    int result;
+
+    foreach (int num: arr)
+        result += num;
+    return result;
+}
+
+void finish(int error)
+{
+    msg("Running Test GC pause histogram...");
+    if (sum(driver_info(DI_GC_PAUSE_HISTOGRAM)) == gc_pauses + 1)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (GC not counted.)\n");
+        error = 1;
+    }
+
+    shutdown(error);
+}
+
+void check_clean(int round, int last_slices)
+{
+    int *histogram = driver_info(DI_DATA_CLEAN_PAUSE_HISTOGRAM);
+    int slices = sum(histogram);
+
+    if (sizeof(histogram) != 20)
+    {
+        msg(" FAILURE! (Wrong histogram size.)\n");
+        shutdown(1);
+        return;
+    }
+
+    /* With a slice time of 1us every slice handles only one of
+     * the filled objects, so the data-clean takes several backend cycles.
+     */
+    if (slices <= NUM_LIVING || slices != last_slices)
+    {
+        if (round < 30)
+        {
+            call_out("check_clean", 1, round + 1, slices);
+            return;
+        }
+
+        msg(" FAILURE! (Data-clean not finished after %d slices.)\n", slices);
+        shutdown(1);
+        return;
+    }
+
+    msg(" Success.\n");
+
+    gc_pauses = sum(driver_info(DI_GC_PAUSE_HISTOGRAM));
+    start_gc(#'finish);
+}
+
+void run_test()
+{
+    msg("\nRunning test for the incremental data-clean:\n"
+          "--------------------------------------------\n");
+
+    msg("Running Test data-clean in slices...");
+
+    configure_driver(DC_DATA_CLEAN_SLICE_TIME, 1);
+    if (driver_info(DC_DATA_CLEAN_SLICE_TIME) != 1)
+    {
+        msg(" FAILURE! (Slice time not set.)\n");
+        shutdown(1);
+        return;
+    }
+
+    fill_values();
+    living = map(allocate(NUM_LIVING), (: clone_object(blueprint()) :));
+    living->fill_values();
+    destructed = map(allocate(NUM_DESTRUCTED), (: clone_object(blueprint()) :));
+    foreach (object ob: destructed)
+        destruct(ob);
+
+    call_out("check_clean", 1, 0, -1);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -157,6 +157,16 @@ mixed *tests = ({
     ({ "strstr 09", 0, (: strstr("abcdefa","a", 7) == -1 :) }),
     ({ "strstr 10", 0, (: strstr("abcdefabc","a", 7) == -1 :) }),
     ({ "strstr 11", 0, (: strstr("abcdefabc","c") == 2 :) }),
+    ({ "strstr 12", 0, (: strstr("the quick brown fox jumps","fox", 3) == 16 :) }),
+    ({ "strstr 13", 0, (: strstr("the quick brown fox jumps","foxes") == -1 :) }),
+    ({ "lower_case 1", 0, (: lower_case("") == "" :) }),
+    ({ "lower_case 2", 0, (: lower_case("the quick brown fox jumps") == "the quick brown fox jumps" :) }),
+    ({ "lower_case 3", 0, (: lower_case("The Quick Brown FOX jumps OVER@[Z]") == "the quick brown fox jumps over@[z]" :) }),
+    ({ "lower_case 4", 0, (: lower_case("Grüße AUS dem Süden, ÄÖÜ A") == lower_case("Grüße aus dem Süden, ÄÖÜ a") :) }),
+    ({ "upper_case 1", 0, (: upper_case("THE QUICK BROWN FOX") == "THE QUICK BROWN FOX" :) }),
+    ({ "upper_case 2", 0, (: upper_case("the quick brown fox jumps over`{a}") == "THE QUICK BROWN FOX JUMPS OVER`{A}" :) }),
+    ({ "string intersection", 0, (: ("the quick brown fox" & "aeiou ") == "e ui o o" :) }),
+    ({ "string subtraction", 0, (: ("the quick brown fox" - "aeiou ") == "thqckbrwnfx" :) }),
     ({ "hash string (MD5)", 0, (:
                          hash(TLS_HASH_MD5, "line 13: Warning: Missing "
                               "'return <value>' statement") ==
@@ -285,6 +295,9 @@ mixed *tests = ({
     ({ "explode 5", 0, (: deep_eq(explode("abc","abc"), ({"",""})) :) }),
     ({ "explode 6", 0, (: deep_eq(explode(" ab cd ef ", " "), 
                                   ({ "", "ab", "cd", "ef", "" })) :) }),
+    ({ "explode 7", 0, (: deep_eq(explode("###", "##"), ({ "", "#" })) :) }),
+    ({ "explode 8", 0, (: deep_eq(explode("a, b,, c, ", ", "),
+                                  ({ "a", "b,", "c", "" })) :) }),
     ({ "implode 1", 0, (: implode(({ "foo", "bar", "" }), "*") == "foo*bar*":) }),
     ({ "implode 2", 0, (: implode(({ "a", 2, this_object(), "c" }), "b") == "abc" :) }),
     ({ "implode 3", 0, (: implode(({ "", "" }), "") == "":) }),
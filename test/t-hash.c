@@ -0,0 +1,88 @@
+/* Test of the distribution of the string hash with the string table:
+ * strings following simple patterns should spread over the table
+ * like random strings.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/driver_info.h"
+
+#define NUM_STRINGS  20000
+#define NUM_MAPPINGS 10
+
+string prefix = "A long common prefix of many strings " * 5;
+
+/* Returns whether the tabled strings are spread over the table as
+ * expected from a random hash.
+ */
+int check_distribution()
+{
+    int *histogram = driver_info(DI_STRING_TABLE_CHAIN_LENGTHS);
+    int slots = driver_info(DI_NUM_STRING_TABLE_SLOTS);
+    int strings = driver_info(DI_NUM_STRINGS_TABLED);
+    float expected = slots * (1.0 - exp(-to_float(strings) / slots));
+    int used = slots - histogram[0];
+
+    /* The number of used slots should be close to the expected one,
+     * and long chains (which are only counted together in the last
+     * element) should be very rare.
+     */
+    return used > 0.95 * expected
+        && histogram[<1] * 1000 < slots;
+}
+
+/* Tables the strings built by <fun> for 0..NUM_STRINGS-1 (as keys of
+ * NUM_MAPPINGS mappings) and checks their distribution.
+ */
+int check_pattern(closure fun)
+{
+    mapping *m = map(allocate(NUM_MAPPINGS), (: ([]) :));
+    int num;
+
+    foreach (int i: NUM_STRINGS)
+        m[i % NUM_MAPPINGS][funcall(fun, i)] = i;
+    foreach (mapping part: m)
+        num += sizeof(part);
+
+    return num == NUM_STRINGS && check_distribution();
+}
+
+string binary(int i)
+{
+    string str = "";
+
+    foreach (int bit: 16)
+        str += (i & (1 << bit)) ? "b" : "a";
+    return str;
+}
+
+void run_test()
+{
+    msg("\nRunning test for the string hash:\n"
+          "---------------------------------\n");
+
+    run_array(({
+        ({ "Tabled strings", 0,
+           (: check_distribution() :)
+        }),
+        ({ "Numbered strings", 0,
+           (: check_pattern((: "key" + $1 :)) :)
+        }),
+        ({ "Long common prefix", 0,
+           (: check_pattern((: prefix + $1 :)) :)
+        }),
+        ({ "Two characters", 0,
+           (: check_pattern(#'binary) :)
+        }),
+        ({ "Numbers as bytes", 0,
+           (: check_pattern((: sprintf("%c%c", $1 & 0xff, $1 >> 8) :)) :)
+        }),
+    }), (: shutdown($1) :));
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
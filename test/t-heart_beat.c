@@ -0,0 +1,104 @@
+/* Test of the heart beat intervals: objects are called only
+ * every <interval> heart beat cycles.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/client.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+
+#define CYCLES 6
+
+int beats;
+object *obs;
+
+void heart_beat()
+{
+    beats++;
+
+    /* The object with interval 1 counts the cycles. */
+    if (object_info(this_object(), OC_HEART_BEAT_INTERVAL) == 1 && beats == CYCLES)
+        call_out(#'call_other, 0, blueprint(), "check");
+}
+
+int sum(int *arr)
+{
+    int result;
+
+    foreach (int num: arr)
+        result += num;
+    return result;
+}
+
+int query_beats()
+{
+    return beats;
+}
+
+void check()
+{
+    int *wheel = driver_info(DI_HEARTBEAT_WHEEL_OBJECTS);
+    int failed;
+
+    msg("Heart beats with interval 2: %d, with interval 3: %d\n"
+      , obs[1]->query_beats(), obs[2]->query_beats());
+
+    if (obs[1]->query_beats() < CYCLES/2 - 1 || obs[1]->query_beats() > CYCLES/2 + 1)
+        failed = 1;
+    if (obs[2]->query_beats() < CYCLES/3 - 1 || obs[2]->query_beats() > CYCLES/3 + 1)
+        failed = 1;
+    if (object_info(obs[1], OC_HEART_BEAT_INTERVAL) != 2)
+        failed = 1;
+
+    /* OC_HEART_BEAT is just on or off, and keeps the interval. */
+    configure_object(obs[1], OC_HEART_BEAT, 5);
+    if (object_info(obs[1], OC_HEART_BEAT) != 1
+     || object_info(obs[1], OC_HEART_BEAT_INTERVAL) != 2)
+        failed = 1;
+
+    /* All due heart beats have been done, so all objects
+     * are in the wheel.
+     */
+    if (sizeof(heart_beat_info()) != 3 || sum(wheel) != 3)
+        failed = 1;
+    if (sizeof(driver_info(DI_HEARTBEAT_WHEEL_LAST_PROCESSED)) != sizeof(wheel)
+     || sizeof(driver_info(DI_HEARTBEAT_WHEEL_LAST_TIME)) != sizeof(wheel))
+        failed = 1;
+
+    configure_object(obs[2], OC_HEART_BEAT, 0);
+    if (object_info(obs[2], OC_HEART_BEAT) != 0
+     || object_info(obs[2], OC_HEART_BEAT_INTERVAL) != 0
+     || sizeof(heart_beat_info()) != 2)
+        failed = 1;
+
+    msg(failed ? "FAILURE!\n" : "Success.\n");
+    shutdown(failed);
+}
+
+void start()
+{
+    obs = ({ clone_object(blueprint()), clone_object(blueprint()), clone_object(blueprint()) });
+
+    foreach (int i: sizeof(obs))
+        configure_object(obs[i], OC_HEART_BEAT_INTERVAL, i + 1);
+}
+
+void run_server()
+{
+    blueprint()->start();
+}
+
+void run_test()
+{
+    msg("\nRunning test for heart beat intervals:\n"
+          "--------------------------------------\n");
+
+    connect_self("run_server", 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,320 @@
+/* Test of the IP name cache.
+ *
+ * The test connects to itself and attaches the server end of the
+ * connection as the ERQ, so the client end gets the hostname lookups
+ * of the driver and sends the answers. All connections come from
+ * 127.0.0.1, so the cache is filled with answers for other addresses,
+ * which the driver takes even if it didn't ask for them.
+ *
+ * The lookups are done with interactive_info(II_IP_NAME), which is
+ * what query_ip_name() calls.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/client.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+#include "/sys/interactive_info.h"
+
+#define LOCALHOST ({ 127, 0, 0, 1 })
+#define SENTINEL  ({ 10, 255, 255, 255 })
+#define NAME      "ipcache.test"
+
+/* These variables are used in the master object. */
+object client;         // The client end, which answers for the ERQ.
+int num_connections;   // The number of connections made.
+int next_address;      // The next address to answer for.
+int slots;             // The size of the cache.
+int requests;          // DI_NUM_IP_NAME_REQUESTS at some point.
+
+void fail(string reason)
+{
+    msg(" FAILURE! (%s)\n", reason);
+    configure_driver(DC_IP_NAME_FAILED_TTL, 600);
+    shutdown(1);
+}
+
+void success()
+{
+    msg(" Success.\n");
+}
+
+/* --- Functions of the connected clones --- */
+
+void attach_erq()
+{
+    if (!attach_erq_demon(this_object(), 0))
+        blueprint()->fail("ERQ not attached.");
+}
+
+void client_ready()
+{
+    blueprint()->set_client(this_object());
+}
+
+void count_connection()
+{
+    blueprint()->connected();
+}
+
+void ignore_connection()
+{
+}
+
+/* Send the answer to the hostname lookup of <addr>: its <name>, or
+ * the failure of the lookup if <name> is 0.
+ */
+void answer(int *addr, string name)
+{
+    int *data = addr;
+    int len;
+
+    if (name)
+        data += to_array(name) + ({ 0 });
+    len = 8 + sizeof(data);
+
+    binary_message(({ len >> 24, (len >> 16) & 0xff, (len >> 8) & 0xff, len & 0xff
+                    , 0xff, 0xff, 0xff, 0xff }) + data, 0);
+}
+
+/* --- Functions of the master object --- */
+
+void set_client(object ob)
+{
+    client = ob;
+}
+
+void connected()
+{
+    num_connections++;
+}
+
+/* Call <next> as soon as <cond> is true. */
+void wait_for(closure cond, closure next, string reason, int round)
+{
+    if (funcall(cond))
+        funcall(next);
+    else if (round < 20)
+        call_out(#'wait_for, 1, cond, next, reason, round + 1);
+    else
+        fail(reason);
+}
+
+/* Let the client answer for <num> new addresses, and call <next> when
+ * the driver has read all answers: the failure for the sentinel
+ * address is answered last.
+ */
+void fill_cache(int num, closure next)
+{
+    int failed = driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED);
+
+    for (int i = 0; i < num; i++, next_address++)
+        client->answer(({ 10, next_address >> 16, (next_address >> 8) & 0xff
+                        , next_address & 0xff })
+                      , "host" + next_address + ".test");
+    client->answer(SENTINEL, 0);
+
+    wait_for((: driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED) > failed :), next
+            , "ERQ answers not read.", 0);
+}
+
+/* Connect once more to ourselves, and call <next> when done. */
+void connect_again(closure next)
+{
+    int num = num_connections;
+
+    connect_self("count_connection", "ignore_connection");
+    wait_for((: num_connections > num :), next, "No connection.", 0);
+}
+
+/* Check that a lookup of localhost gives <name>, and whether it was a hit.
+ */
+int check_lookup(string name, int hit)
+{
+    int hits = driver_info(DI_NUM_IP_NAME_LOOKUP_HITS);
+    int misses = driver_info(DI_NUM_IP_NAME_LOOKUP_MISSES);
+
+    if (interactive_info(client, II_IP_NAME) != name)
+    {
+        fail("Wrong name for localhost.");
+        return 0;
+    }
+
+    if (driver_info(DI_NUM_IP_NAME_LOOKUP_HITS) != hits + hit
+     || driver_info(DI_NUM_IP_NAME_LOOKUP_MISSES) != misses + !hit)
+    {
+        fail("Wrong lookup counters.");
+        return 0;
+    }
+
+    return 1;
+}
+
+void check_failure_expired()
+{
+    if (driver_info(DI_NUM_IP_NAME_REQUESTS) != requests + 1)
+    {
+        fail("Expired failure not looked up again.");
+        return;
+    }
+
+    success();
+    configure_driver(DC_IP_NAME_FAILED_TTL, 600);
+    shutdown(0);
+}
+
+void check_failure_cached()
+{
+    if (driver_info(DI_NUM_IP_NAME_REQUESTS) != requests
+     || !check_lookup("127.0.0.1", 1))
+    {
+        fail("Failure not cached.");
+        return;
+    }
+
+    /* After the time to live the next connection asks again. */
+    call_out(#'connect_again, 6, #'check_failure_expired);
+}
+
+void check_failure()
+{
+    /* The failure is kept, a new connection doesn't ask again. */
+    requests = driver_info(DI_NUM_IP_NAME_REQUESTS);
+    connect_again(#'check_failure_cached);
+}
+
+void answer_failure()
+{
+    int failed = driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED);
+
+    if (driver_info(DI_NUM_IP_NAME_REQUESTS) != requests + 1)
+    {
+        fail("No lookup sent.");
+        return;
+    }
+
+    client->answer(LOCALHOST, 0);
+    wait_for((: driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED) > failed :)
+            , #'check_failure, "Failure not read.", 0);
+}
+
+void test_failure()
+{
+#ifndef __IPV6__
+    msg("Running Test negative caching...");
+
+    if (catch(configure_driver(DC_IP_NAME_FAILED_TTL, -1); nolog) == 0)
+    {
+        fail("Negative time accepted.");
+        return;
+    }
+
+    configure_driver(DC_IP_NAME_FAILED_TTL, 5);
+    if (driver_info(DC_IP_NAME_FAILED_TTL) != 5)
+    {
+        fail("Time not set.");
+        return;
+    }
+
+    /* The evicted address was added again without a name, so
+     * the next connection asks the ERQ.
+     */
+    requests = driver_info(DI_NUM_IP_NAME_REQUESTS);
+    connect_again(#'answer_failure);
+#else
+    /* IPv6 lookups are answered by name, which a failure doesn't give. */
+    shutdown(0);
+#endif
+}
+
+void check_evicted()
+{
+    /* It was the least recently used entry now. */
+    if (!check_lookup("127.0.0.1", 0)
+     || driver_info(DI_NUM_IP_NAMES) != slots)
+        return;
+
+    success();
+    test_failure();
+}
+
+void check_kept()
+{
+    /* It was used more recently than the first new addresses. */
+    if (!check_lookup(NAME, 1)
+     || driver_info(DI_NUM_IP_NAMES) != slots)
+        return;
+
+    fill_cache(slots, #'check_evicted);
+}
+
+void check_full()
+{
+    if (driver_info(DI_NUM_IP_NAMES) != slots
+     || !check_lookup(NAME, 1))
+    {
+        fail("Cache not filled.");
+        return;
+    }
+
+    fill_cache(slots / 2, #'check_kept);
+}
+
+void check_resolved()
+{
+    if (!check_lookup(NAME, 1))
+        return;
+
+    success();
+
+    msg("Running Test eviction...");
+    slots = driver_info(DI_NUM_IP_NAME_TABLE_SLOTS);
+    if (slots <= 0 || driver_info(DI_NUM_IP_NAMES) != 1)
+    {
+        fail("Wrong cache size.");
+        return;
+    }
+
+    /* Fill up the cache, localhost is the oldest entry then. */
+    fill_cache(slots - 1, #'check_full);
+}
+
+void test_lookup()
+{
+    int failed = driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED);
+
+    msg("Running Test lookup...");
+
+    /* The connection has added localhost without a name. */
+    if (!check_lookup("127.0.0.1", 1))
+        return;
+
+    client->answer(LOCALHOST, NAME);
+    client->answer(SENTINEL, 0);
+    wait_for((: driver_info(DI_NUM_IP_NAME_REQUESTS_FAILED) > failed :)
+            , #'check_resolved, "ERQ answer not read.", 0);
+}
+
+void run_test()
+{
+    msg("\nRunning test for the IP name cache:\n"
+          "-----------------------------------\n");
+
+#ifdef __ERQ_MAX_SEND__
+    connect_self("attach_erq", "client_ready");
+
+    /* The ERQ is attached in the backend cycle after attach_erq(). */
+    wait_for((: client && !sizeof(filter(users(), (: $1 != client :))) :)
+            , #'test_lookup, "Not connected.", 0);
+#else
+    msg("Skipped (no ERQ support).\n");
+    shutdown(0);
+#endif
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,160 @@
+/* Test of the mapping implementation: the hash index has to grow and
+ * to cope with deleted entries, and the entries must not move while
+ * references to their values exist.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/testarray.inc"
+
+#define NUM_KEYS 5000
+
+mapping fill(int num)
+{
+    mapping m = ([:2]);
+
+    for (int i = 0; i < num; i++)
+    {
+        m[i, 0] = "value " + i;
+        m[i, 1] = i;
+    }
+    return m;
+}
+
+int check(mapping m, int from, int to)
+{
+    if (sizeof(m) != to - from)
+        return 0;
+    for (int i = from; i < to; i++)
+        if (m[i, 0] != "value " + i || m[i, 1] != i)
+            return 0;
+    return 1;
+}
+
+mixed *tests = ({
+    ({ "Growth", 0,
+        (:
+            mapping m = fill(NUM_KEYS);
+            return check(m, 0, NUM_KEYS) && !member(m, NUM_KEYS);
+        :)
+    }),
+    ({ "Deletion and reinsertion", 0,
+        (:
+            mapping m = fill(NUM_KEYS);
+
+            for (int i = 0; i < NUM_KEYS; i += 2)
+                m_delete(m, i);
+            for (int i = 1; i < NUM_KEYS; i += 2)
+                if (m[i, 1] != i || member(m, i - 1))
+                    return 0;
+
+            /* Cycle through the keys many times to fill the index
+             * with deleted slots.
+             */
+            for (int round = 0; round < 10; round++)
+                for (int i = 0; i < NUM_KEYS; i += 2)
+                {
+                    m[i, 0] = "value " + i;
+                    m[i, 1] = i;
+                    m_delete(m, i);
+                }
+
+            for (int i = 0; i < NUM_KEYS; i += 2)
+            {
+                m[i, 0] = "value " + i;
+                m[i, 1] = i;
+            }
+            return check(m, 0, NUM_KEYS);
+        :)
+    }),
+    ({ "Reference to a value while the mapping grows", 0,
+        (:
+            mapping m = ([ 0: 0 ]);
+            int ref = &(m[0]);
+
+            for (int i = 1; i < NUM_KEYS; i++)
+                m[i] = i;
+            ref = 42;
+            return m[0] == 42 && m[NUM_KEYS - 1] == NUM_KEYS - 1;
+        :)
+    }),
+    ({ "Deletion during foreach", 0,
+        (:
+            mapping m = fill(100);
+            int num;
+
+            foreach (int key, string str, int val: m)
+            {
+                if (str != "value " + key || val != key)
+                    return 0;
+                m_delete(m, key);
+                m_delete(m, key + 1);
+                num++;
+            }
+            return num == 50 && !sizeof(m);
+        :)
+    }),
+    ({ "Insertion during walk_mapping", 0,
+        (:
+            mapping m = fill(100);
+
+            /* The new entries must not be walked. */
+            walk_mapping(m,
+                function void(int key, string str, int val)
+                {
+                    m[key + 100, 1] = key;
+                });
+            if (sizeof(m) != 200)
+                return 0;
+            for (int i = 0; i < 100; i++)
+                if (m[i + 100, 1] != i)
+                    return 0;
+            return 1;
+        :)
+    }),
+    ({ "Copies", 0,
+        (:
+            mapping m1 = fill(100);
+            mapping m2 = copy(m1);
+
+            m_delete(m2, 0);
+            m2[100, 1] = 100;
+            return check(m1, 0, 100) && sizeof(m2) == 100 && !member(m2, 0);
+        :)
+    }),
+    ({ "Addition", 0,
+        (:
+            mapping m = fill(50) + (fill(100) - fill(50));
+            m += ([ 100: "value 100"; 100 ]);
+            return check(m, 0, 101);
+        :)
+    }),
+    ({ "Width change", 0,
+        (:
+            mapping m = fill(NUM_KEYS);
+            mapping m2 = m_reallocate(m, 1);
+
+            for (int i = 0; i < NUM_KEYS; i++)
+                if (m2[i] != "value " + i)
+                    return 0;
+            return widthof(m2) == 1 && sizeof(m2) == NUM_KEYS;
+        :)
+    }),
+});
+
+void run_test()
+{
+    msg("\nRunning test suite for mappings:\n"
+          "--------------------------------\n");
+
+    run_array(tests,
+        (:
+            shutdown($1);
+            return 0;
+        :));
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,196 @@
+/* Test of the MCCP compression settings.
+ *
+ * Compiled with -DMCCP_CLIENT (by t-mccp.sh), the test serves requests
+ * of an external client instead, which decompresses the data and
+ * compares it with what it asked for.
+ */
+
+#include "/inc/base.inc"
+#ifndef MCCP_CLIENT
+#include "/inc/client.inc"
+#endif
+
+#include "/sys/configuration.h"
+#include "/sys/interactive_info.h"
+#include "/sys/telnet.h"
+
+#define NUM_LINES 2000
+
+#define COMPRESS_BUF_SIZE 8192
+  /* The size of the compression buffer shared by all connections. */
+
+#define SEED 4711
+  /* The start of the pseudo random bytes, as in t-mccp.sh. */
+
+/* Return <num> pseudo random bytes, which don't compress. */
+int *random_bytes(int num)
+{
+    int *result = allocate(num);
+    int state = SEED;
+
+    for (int i = 0; i < num; i++)
+    {
+        state = (state * 1103515245 + 12345) & 0x7fffffff;
+        result[i] = state >> 23;
+    }
+    return result;
+}
+
+#ifdef __MCCP__
+/* Send <num_bytes> random bytes and <num_lines> lines of text compressed
+ * with the given settings.
+ */
+void send_compressed(int window_bits, int mem_level, int num_bytes, int num_lines)
+{
+    configure_interactive(this_object(), IC_MCCP_WINDOW_BITS, window_bits);
+    configure_interactive(this_object(), IC_MCCP_MEM_LEVEL, mem_level);
+    configure_interactive(this_object(), IC_MCCP
+        , interactive_info(this_object(), IC_TELNET_ENABLED) ? TELOPT_COMPRESS2 : 1);
+
+    if (num_bytes)
+        binary_message(random_bytes(num_bytes), 0);
+    foreach (int i: num_lines)
+        write(sprintf("Line %d of the text to compress.\n", i));
+}
+#endif
+
+#ifdef MCCP_CLIENT
+
+object connect()
+{
+    return clone_object(this_object());
+}
+
+/* Serve the request '<window bits> <mem level> <random bytes> <lines>'
+ * of the client and close the connection, or shut down for 'shutdown'.
+ */
+void run_request(string request)
+{
+    int window_bits, mem_level, num_bytes, num_lines;
+
+    if (request == "shutdown")
+    {
+        shutdown(0);
+        return;
+    }
+
+    if (sscanf(request, "%d %d %d %d"
+              , window_bits, mem_level, num_bytes, num_lines) != 4)
+    {
+        msg("Bad request: %O\n", request);
+        shutdown(1);
+        return;
+    }
+
+    send_compressed(window_bits, mem_level, num_bytes, num_lines);
+    configure_interactive(this_object(), IC_MCCP, 0);
+    destruct(this_object());
+}
+
+int logon()
+{
+    input_to("run_request");
+    return 1;
+}
+
+string *epilog(int eflag)
+{
+    return 0;
+}
+
+#else /* !MCCP_CLIENT */
+
+void run_server()
+{
+#ifdef __MCCP__
+    int *stats;
+    int failed;
+
+    /* Default settings. */
+    if (interactive_info(this_object(), IC_MCCP_LEVEL) != 9
+     || interactive_info(this_object(), IC_MCCP_WINDOW_BITS) != 15
+     || interactive_info(0, IC_MCCP_MEM_LEVEL) != 8)
+        failed = 1;
+
+    if (!catch(configure_interactive(this_object(), IC_MCCP_WINDOW_BITS, 16); nolog))
+        failed = 1;
+
+    configure_interactive(this_object(), IC_MCCP_LEVEL, 6);
+    configure_interactive(this_object(), IC_MCCP_WINDOW_BITS, 10);
+    configure_interactive(this_object(), IC_MCCP_MEM_LEVEL, 2);
+    if (interactive_info(this_object(), IC_MCCP_LEVEL) != 6
+     || interactive_info(this_object(), IC_MCCP_WINDOW_BITS) != 10
+     || interactive_info(this_object(), IC_MCCP_MEM_LEVEL) != 2
+     || interactive_info(0, IC_MCCP_LEVEL) != 9)
+        failed = 1;
+
+    configure_interactive(this_object(), IC_MCCP, 1);
+
+    /* More than the compression buffer takes at once. */
+    write(sprintf("%'x'20000s\n", ""));
+    foreach (int i: NUM_LINES)
+        write(sprintf("Line %d of the text to compress.\n", i));
+
+    stats = interactive_info(this_object(), II_MCCP_STATS);
+    if (!pointerp(stats) || stats[0] < NUM_LINES * 30 || stats[1] >= stats[0] / 4)
+        failed = 1;
+
+    configure_interactive(this_object(), IC_MCCP, 0);
+    if (interactive_info(this_object(), II_MCCP_STATS) != 0)
+        failed = 1;
+
+    msg(failed ? " FAILURE!\n" : " Success.\n");
+
+    /* Random bytes grow a bit when compressed, so they take several
+     * rounds through the compression buffer.
+     */
+    msg("Running Test incompressible data...");
+    send_compressed(15, 8, 3 * COMPRESS_BUF_SIZE + 100, 0);
+    stats = interactive_info(this_object(), II_MCCP_STATS);
+    if (!pointerp(stats) || stats[0] != 3 * COMPRESS_BUF_SIZE + 100
+     || stats[1] < stats[0])
+    {
+        msg(" FAILURE!\n");
+        failed = 1;
+    }
+    else
+        msg(" Success.\n");
+    configure_interactive(this_object(), IC_MCCP, 0);
+
+    /* The smallest window and memory level. */
+    msg("Running Test small window...");
+    send_compressed(9, 1, 1000, NUM_LINES);
+    stats = interactive_info(this_object(), II_MCCP_STATS);
+    if (!pointerp(stats) || stats[0] < 1000 + NUM_LINES * 30
+     || stats[1] >= stats[0] / 2)
+    {
+        msg(" FAILURE!\n");
+        failed = 1;
+    }
+    else
+        msg(" Success.\n");
+    configure_interactive(this_object(), IC_MCCP, 0);
+
+    shutdown(failed);
+#else
+    msg(" Skipped (no MCCP support).\n");
+    shutdown(0);
+#endif
+}
+
+void run_test()
+{
+    msg("\nRunning test for MCCP:\n"
+          "----------------------\n");
+
+    msg("Running Test compression settings...");
+    connect_self("run_server", 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
+
+#endif /* MCCP_CLIENT */
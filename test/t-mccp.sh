@@ -0,0 +1,103 @@
+echo
+echo "Running test for MCCP with an external client:"
+echo "----------------------------------------------"
+ulimit -c 0
+
+if ! ${DRIVER} --options | grep -q 'MCCP supported'; then
+    echo "Skipped (no MCCP support)."
+    exit 0
+fi
+
+if ! python3 -c 'import zlib' 2> /dev/null; then
+    echo "Skipped (no python3 with zlib)."
+    exit 0
+fi
+
+# The port is the last of the default options.
+for option in ${DRIVER_DEFAULTS}; do
+    PORT=${option}
+done
+
+${DRIVER} ${DRIVER_DEFAULTS} -DMCCP_CLIENT -Mt-mccp.c -m. \
+    --debug-file ${TEST_LOGFILE} > /dev/null &
+DRIVER_PID=$!
+
+# The client asks t-mccp.c for random bytes and lines of text with
+# the given compression settings, and checks what it decompresses.
+python3 - ${PORT} <<'EOF'
+import socket, sys, time, zlib
+
+SEED = 4711
+COMPRESS_BUF_SIZE = 8192
+START = bytes([255, 250, 86, 255, 240]) # IAC SB COMPRESS2 IAC SE
+
+def random_bytes(num):
+    result = bytearray()
+    state = SEED
+    for i in range(num):
+        state = (state * 1103515245 + 12345) & 0x7fffffff
+        result.append(state >> 23)
+    return bytes(result)
+
+def request(line):
+    for i in range(100):
+        try:
+            s = socket.create_connection(("127.0.0.1", int(sys.argv[1])))
+            break
+        except OSError:
+            time.sleep(0.1)
+    else:
+        sys.exit("Could not connect.")
+
+    s.settimeout(30)
+    s.sendall(line.encode() + b"\r\n")
+    data = b""
+    while True:
+        chunk = s.recv(65536)
+        if not chunk:
+            break
+        data += chunk
+    s.close()
+    return data
+
+def check(name, window_bits, mem_level, num_bytes, num_lines):
+    print("Running Test %s..." % name, end="")
+    data = request("%d %d %d %d" % (window_bits, mem_level, num_bytes, num_lines))
+    expected = random_bytes(num_bytes) + b"".join(
+        b"Line %d of the text to compress.\r\n" % i for i in range(num_lines))
+
+    pos = data.find(START)
+    if pos < 0:
+        print(" FAILURE! (Compression not started.)")
+        return False
+    compressed = data[pos + len(START):]
+
+    d = zlib.decompressobj()
+    try:
+        result = d.decompress(compressed)
+    except zlib.error as e:
+        print(" FAILURE! (%s)" % e)
+        return False
+
+    if (compressed[0] >> 4) + 8 != window_bits:
+        print(" FAILURE! (Wrong window size.)")
+    elif not d.eof or d.unused_data:
+        print(" FAILURE! (Compression not ended.)")
+    elif result != expected:
+        print(" FAILURE! (Wrong data.)")
+    else:
+        print(" Success.")
+        return True
+    return False
+
+ok = check("incompressible data", 15, 8, 3 * COMPRESS_BUF_SIZE + 100, 0)
+ok = check("small window", 9, 1, 1000, 2000) and ok
+request("shutdown")
+sys.exit(0 if ok else 1)
+EOF
+RESULT=$?
+
+# Without a shutdown request the driver would keep running.
+[ ${RESULT} -eq 0 ] || kill ${DRIVER_PID} 2> /dev/null
+wait ${DRIVER_PID} || RESULT=1
+exit ${RESULT}
@@ -0,0 +1,68 @@
+#pragma save_types, rtt_checks
+
+#include "/inc/base.inc"
+#include "/inc/gc.inc"
+#include "/sys/driver_info.h"
+
+int check_queues(int expected)
+{
+    // Resets, clean_up() and swapping are disabled by the test
+    // environment, but every object waits for its data cleanup.
+    return driver_info(DI_NUM_OBJECTS_IN_DATA_CLEANUP_QUEUE) == expected
+        && driver_info(DI_NUM_OBJECTS_IN_RESET_QUEUE) == 0
+        && driver_info(DI_NUM_OBJECTS_IN_CLEAN_UP_QUEUE) == 0
+        && driver_info(DI_NUM_OBJECTS_IN_SWAP_QUEUE) == 0
+        && floatp(driver_info(DI_LOAD_AVERAGE_DATA_CLEANUP_LATENESS));
+}
+
+void run_test()
+{
+    int errors;
+    int num = driver_info(DI_NUM_OBJECTS_IN_LIST);
+    object *clones;
+
+    msg("\nRunning test for the object queues:\n"
+          "-----------------------------------\n");
+
+    msg("Running Test initial state...");
+    if (check_queues(num))
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    clones = map(allocate(10), (: clone_object(this_object()) :));
+
+    msg("Running Test clone_object()...");
+    if (check_queues(num + 10))
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    map(clones, #'destruct);
+
+    msg("Running Test destruct()...");
+    if (check_queues(num))
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    if (errors)
+        shutdown(1);
+    else
+        start_gc(#'shutdown);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
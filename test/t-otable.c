@@ -0,0 +1,57 @@
+#include "/inc/base.inc"
+#include "/sys/driver_info.h"
+
+#define NUM_CLONES 5000
+
+void run_test()
+{
+    int errors;
+    int slots = driver_info(DI_NUM_OBJECT_TABLE_SLOTS);
+    object *clones;
+
+    msg("\nRunning test for the object table:\n"
+          "----------------------------------\n");
+
+    clones = map(allocate(NUM_CLONES), (: clone_object(this_object()) :));
+
+    msg("Running Test table growth...");
+    if (driver_info(DI_NUM_OBJECT_TABLE_SLOTS) > slots
+     && driver_info(DI_NUM_OBJECTS_IN_TABLE) >= NUM_CLONES)
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Table did not grow.)\n");
+        errors++;
+    }
+
+    msg("Running Test find_object() while growing...");
+    if (sizeof(filter(clones, (: find_object(object_name($1)) != $1 :))))
+    {
+        msg(" FAILURE! (Clone not found.)\n");
+        errors++;
+    }
+    else
+        msg(" Success.\n");
+
+    foreach (object ob: clones[0..NUM_CLONES/2])
+        destruct(ob);
+    clones -= ({ 0 });
+
+    msg("Running Test find_object() after destruction...");
+    if (sizeof(filter(clones, (: find_object(object_name($1)) != $1 :)))
+     || find_object(object_name(this_object())) != this_object())
+    {
+        msg(" FAILURE! (Object not found.)\n");
+        errors++;
+    }
+    else
+        msg(" Success.\n");
+
+    shutdown(errors ? 1 : 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
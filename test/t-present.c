@@ -0,0 +1,213 @@
+/* Test of present() with ids declared by configure_object(OC_IDS),
+ * which are matched without calling id() and indexed for large
+ * inventories.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/deep_eq.inc"
+#include "/inc/gc.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/configuration.h"
+
+#define NUM_ITEMS 100
+
+object room, box, holder, npc, mover, outside;
+object *items;
+int id_calls;
+
+/* These functions are for the clones. */
+
+string *ids = ({});
+object move_on_id;
+
+void count_id()
+{
+    id_calls++;
+}
+
+int id(string str)
+{
+    blueprint()->count_id();
+    if (move_on_id)
+        set_environment(move_on_id, blueprint()->query_outside());
+    return member(ids, str) >= 0;
+}
+
+void set_ids(string *i)
+{
+    ids = i;
+}
+
+void set_move_on_id(object ob)
+{
+    move_on_id = ob;
+}
+
+void declare(mixed i)
+{
+    configure_object(this_object(), OC_IDS, i);
+}
+
+object find(varargs mixed *args)
+{
+    return apply(#'present, args);
+}
+
+object query_outside()
+{
+    return outside;
+}
+
+/* Returns <result>, if present() called id() exactly <calls> times
+ * since the last call.
+ */
+mixed check_calls(int calls, mixed result)
+{
+    int ok = id_calls == calls;
+
+    id_calls = 0;
+    return ok && result;
+}
+
+object make(object env, varargs mixed *declared)
+{
+    object ob = clone_object(this_object());
+
+    if (sizeof(declared))
+        ob->declare(declared[0]);
+    set_environment(ob, env);
+    return ob;
+}
+
+void run_test()
+{
+    int errors;
+
+    msg("\nRunning test for present():\n"
+          "---------------------------\n");
+
+    room = make(0, ({ "room" }));
+    outside = make(0);
+    items = allocate(NUM_ITEMS);
+
+    /* The inventory of room is then:
+     *   mover, items[99..50], npc, items[49..0]
+     */
+    foreach (int i: NUM_ITEMS)
+    {
+        items[i] = make(room, ({ "item", "item" + i, "item" }));
+        if (i == NUM_ITEMS / 2 - 1)
+        {
+            npc = make(room);
+            npc->set_ids(({ "item", "npc" }));
+        }
+    }
+    mover = make(room);
+
+    errors = run_array_without_callback(({
+        ({ "Declared ids", 0,
+           (:
+               return deep_eq(object_info(items[7], OC_IDS), ({ "item", "item7" }))
+                   && object_info(npc, OC_IDS) == 0;
+           :)
+        }),
+        ({ "Bad declared ids", TF_ERROR,
+           (: npc->declare(({ "npc", 42 })) :)
+        }),
+        ({ "Small inventory", 0,
+           (:
+               object ob;
+
+               box = make(room, ({ "box" }));
+               ob = make(box, ({ "thing" }));
+               make(box, ({ "thing" }));
+               return check_calls(0, present("thing", 2, box) == ob)
+                   && check_calls(0, !present("item", box));
+           :)
+        }),
+        ({ "Indexed inventory", 0,
+           (:
+               return check_calls(2, present("item42", room) == items[42])
+                   && check_calls(1, present("item", room) == items[99])
+                   && check_calls(2, !present("nothing", room))
+                   && check_calls(2, !present(" unknown id ", room));
+           :)
+        }),
+        ({ "Counting declared and undeclared matches", 0,
+           (:
+               return check_calls(2, present("item 51", room) == npc)
+                   && check_calls(2, present("item", 52, room) == items[49])
+                   && check_calls(2, present("item", 101, room) == items[0])
+                   && check_calls(2, !present("item", 102, room));
+           :)
+        }),
+        ({ "Moving out of the inventory", 0,
+           (:
+               set_environment(items[99], outside);
+               return check_calls(1, present("item", room) == items[98])
+                   && check_calls(2, !present("item99", room));
+           :)
+        }),
+        ({ "Moving into the inventory", 0,
+           (:
+               set_environment(items[99], room);
+               return check_calls(0, present("item", room) == items[99])
+                   && check_calls(0, present("item99", room) == items[99]);
+           :)
+        }),
+        ({ "Changing declared ids", 0,
+           (:
+               items[98]->declare(({ "thing" }));
+               if (!check_calls(2, !present("item98", room))
+                || !check_calls(1, present("thing", room) == items[98]))
+                   return 0;
+
+               items[98]->declare(0);
+               return check_calls(3, !present("thing", room))
+                   && check_calls(3, !present("item98", room));
+           :)
+        }),
+        ({ "Destructed item", 0,
+           (:
+               destruct(items[98]);
+               destruct(items[97]);
+               return check_calls(2, !present("item97", room))
+                   && check_calls(1, present("item", 2, room) == items[96]);
+           :)
+        }),
+        ({ "Environment by declared id", 0,
+           (:
+               return check_calls(0, items[3]->find("room") == room)
+                   && check_calls(0, items[3]->find("item", room) == items[99]);
+           :)
+        }),
+        ({ "Inventory and environment", 0,
+           (:
+               holder = make(room);
+               make(holder, ({ "item" }));
+               make(holder, ({ "item" }));
+               return check_calls(2, holder->find("item", 4) == items[96]);
+           :)
+        }),
+        ({ "id() moving an item", 0,
+           (:
+               mover->set_move_on_id(items[0]);
+               return check_calls(3, !present("item0", room))
+                   && environment(items[0]) == outside;
+           :)
+        }),
+    }));
+
+    /* The id arrays and the index are still there. */
+    start_gc(function void(int gc_error)
+    {
+        shutdown(errors || gc_error);
+    });
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,151 @@
+/* Test of the sampling profiler and the function profiles. */
+
+#include "/inc/base.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+
+int busy_loop(int num)
+{
+    int result;
+
+    for (int i = 0; i < num; i++)
+        result += i % 7;
+    return result;
+}
+
+int test_sampling()
+{
+    string *lines;
+    int busy_samples, num;
+
+    configure_driver(DC_PROFILE_SAMPLING_RATE, 1000);
+    if (driver_info(DC_PROFILE_SAMPLING_RATE) != 1000)
+        return 0;
+
+    /* Use the CPU until we have some samples. */
+    for (int i = 0; i < 100 && driver_info(DI_NUM_PROFILE_SAMPLES) < 20; i++)
+        busy_loop(100000);
+
+    configure_driver(DC_PROFILE_SAMPLING_RATE, 0);
+    if (driver_info(DC_PROFILE_SAMPLING_RATE) != 0)
+        return 0;
+
+    /* The stacks pass through run_array() of /inc/testarray.inc,
+     * whose frames must not bring a space into them.
+     */
+    lines = explode(driver_info(DI_PROFILE_SAMPLES), "\n") - ({ "" });
+    foreach (string line: lines)
+    {
+        string stack;
+        int count;
+
+        if (sscanf(line, "%s %d", stack, count) != 2 || count <= 0 || member(stack, ' ') >= 0)
+            return 0;
+        if (strstr(stack, "t-profiler.c:test_sampling:") >= 0
+         && strstr(stack, ";t-profiler.c:busy_loop:") > 0)
+            busy_samples += count;
+    }
+
+    if (!busy_samples)
+        return 0;
+
+    /* No more samples after the profiler is stopped. */
+    num = driver_info(DI_NUM_PROFILE_SAMPLES);
+    busy_loop(1000000);
+    return driver_info(DI_NUM_PROFILE_SAMPLES) == num;
+}
+
+void failing()
+{
+    busy_loop(100);
+    raise_error("Failure.\n");
+}
+
+void outer()
+{
+    foreach (int i: 3)
+        busy_loop(1000);
+    catch(failing(); nolog);
+}
+
+int test_function_profile()
+{
+    mapping profiles = ([:FUNCTION_PROFILE_MAX ]);
+    int busy_cost_in_outer;
+
+    configure_driver(DC_FUNCTION_PROFILING, 1);
+    if (driver_info(DC_FUNCTION_PROFILING) != 1)
+        return 0;
+    outer();
+    configure_driver(DC_FUNCTION_PROFILING, 0);
+
+    foreach (mixed *entry: driver_info(DI_FUNCTION_PROFILE))
+    {
+        if (sizeof(entry) != FUNCTION_PROFILE_MAX
+         || entry[FUNCTION_PROFILE_EXCL_COST] > entry[FUNCTION_PROFILE_COST]
+         || entry[FUNCTION_PROFILE_EXCL_TIME] > entry[FUNCTION_PROFILE_TIME])
+            return 0;
+        if (entry[FUNCTION_PROFILE_PROGRAM] == "t-profiler.c")
+            foreach (int i: FUNCTION_PROFILE_MAX)
+                profiles[entry[FUNCTION_PROFILE_FUNCTION], i] = entry[i];
+    }
+
+    if (profiles["outer", FUNCTION_PROFILE_CALLS] != 1
+     || profiles["busy_loop", FUNCTION_PROFILE_CALLS] != 4
+     || profiles["failing", FUNCTION_PROFILE_CALLS] != 1
+     || profiles["busy_loop", FUNCTION_PROFILE_COST] <= 0)
+        return 0;
+
+    /* outer() calls busy_loop() three times directly and once through
+     * failing(), its own cost is what is left of its total.
+     */
+    busy_cost_in_outer = profiles["busy_loop", FUNCTION_PROFILE_COST]
+                       - (profiles["failing", FUNCTION_PROFILE_COST]
+                          - profiles["failing", FUNCTION_PROFILE_EXCL_COST]);
+    return profiles["outer", FUNCTION_PROFILE_EXCL_COST]
+        == profiles["outer", FUNCTION_PROFILE_COST]
+           - profiles["failing", FUNCTION_PROFILE_COST]
+           - busy_cost_in_outer;
+}
+
+int test_rates()
+{
+    /* The slowest and fastest rates need an interval of one second
+     * and one microsecond.
+     */
+    foreach (int rate: ({ 1, 1000000 }))
+    {
+        configure_driver(DC_PROFILE_SAMPLING_RATE, rate);
+        if (driver_info(DC_PROFILE_SAMPLING_RATE) != rate)
+            return 0;
+    }
+
+    configure_driver(DC_PROFILE_SAMPLING_RATE, 0);
+    return driver_info(DC_PROFILE_SAMPLING_RATE) == 0;
+}
+
+mixed *tests = ({
+    ({ "Sampling profiler", 0, #'test_sampling }),
+    ({ "Lowest and highest sampling rate", 0, #'test_rates }),
+    ({ "Function profile", 0, #'test_function_profile }),
+});
+
+void run_test()
+{
+    msg("\nRunning test for the profilers:\n"
+          "-------------------------------\n");
+
+    run_array(tests,
+        (:
+            shutdown($1);
+            return 0;
+        :));
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
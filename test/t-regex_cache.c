@@ -0,0 +1,129 @@
+/* Test of the regexp cache, which keeps the compiled expressions
+ * within the size set by DC_REGEX_CACHE_SIZE.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/deep_eq.inc"
+#include "/inc/gc.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+
+#define NUM_PATTERNS 200
+
+/* Returns whether all <NUM_PATTERNS> patterns still match correctly. */
+int check_patterns()
+{
+    for (int i = 0; i < NUM_PATTERNS; i++)
+    {
+        string pattern = "^pat" + i + "[a-z]+$";
+
+        if (!regmatch("pat" + i + "abc", pattern)
+         || regmatch("pat" + i + "123", pattern))
+            return 0;
+    }
+    return 1;
+}
+
+void run_test()
+{
+    int errors;
+    int size = driver_info(DC_REGEX_CACHE_SIZE);
+
+    msg("\nRunning test for the regexp cache:\n"
+          "----------------------------------\n");
+
+    errors = run_array_without_callback(({
+        ({ "Default size", 0,
+           (: size > 0 :)
+        }),
+        ({ "Negative size", TF_ERROR,
+           (: configure_driver(DC_REGEX_CACHE_SIZE, -1) :)
+        }),
+        ({ "Hits in a large cache", 0,
+           (:
+               int hits, evictions;
+
+               configure_driver(DC_REGEX_CACHE_SIZE, size);
+               check_patterns();
+               hits = driver_info(DI_NUM_REGEX_LOOKUP_HITS);
+               evictions = driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS);
+               return check_patterns()
+                   && driver_info(DI_NUM_REGEX_LOOKUP_HITS) - hits >= 2 * NUM_PATTERNS
+                   && driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS) == evictions;
+           :)
+        }),
+        ({ "Size of the compiled program", 0,
+           (:
+               /* The program of a long pattern is at least as long. */
+               string pattern = "^" + "abcdefghij" * 300 + "$";
+               int before = driver_info(DI_SIZE_REGEX);
+
+               return regmatch("abcdefghij" * 300, pattern)
+                   && driver_info(DI_SIZE_REGEX) - before >= sizeof(pattern);
+           :)
+        }),
+        ({ "Shrinking the cache", 0,
+           (:
+               int evictions = driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS);
+
+               configure_driver(DC_REGEX_CACHE_SIZE, 1000);
+               return driver_info(DC_REGEX_CACHE_SIZE) == 1000
+                   && driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS) > evictions
+                   && driver_info(DI_SIZE_REGEX) <= 1000;
+           :)
+        }),
+        ({ "Evictions in a small cache", 0,
+           (:
+               int evictions = driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS);
+
+               /* Only one of the patterns fits, the last one stays. */
+               return check_patterns()
+                   && driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS) - evictions >= NUM_PATTERNS - 1
+                   && driver_info(DI_NUM_REGEX) == 1
+                   && driver_info(DI_SIZE_REGEX) <= 1000;
+           :)
+        }),
+        ({ "Program larger than the cache", 0,
+           (:
+               int evictions = driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS);
+
+               return regmatch("klmnopqrst" * 300, "^" + "klmnopqrst" * 300 + "$")
+                   && driver_info(DI_NUM_REGEX_LOOKUP_EVICTIONS) > evictions
+                   && driver_info(DI_SIZE_REGEX) <= 1000;
+           :)
+        }),
+        ({ "Recently used patterns stay", 0,
+           (:
+               int misses = driver_info(DI_NUM_REGEX_LOOKUP_MISSES);
+
+               foreach (int i: NUM_PATTERNS)
+                   regmatch("x" + i, "^x");
+               return driver_info(DI_NUM_REGEX_LOOKUP_MISSES) - misses <= 1;
+           :)
+        }),
+        ({ "Empty cache", 0,
+           (:
+               configure_driver(DC_REGEX_CACHE_SIZE, 0);
+               return check_patterns()
+                   && deep_eq(regexplode("a1b22c", "[0-9]+"), ({ "a", "1", "b", "22", "c" }))
+                   && regreplace("a1b22c", "[0-9]+", "-", 1) == "a-b-c"
+                   && driver_info(DI_SIZE_REGEX) == 0;
+           :)
+        }),
+    }));
+
+    configure_driver(DC_REGEX_CACHE_SIZE, size);
+
+    start_gc(function void(int gc_error)
+    {
+        shutdown(errors || gc_error);
+    });
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,137 @@
+/* Test of say() and tell_room() in a room with livings of two programs,
+ * one of them without catch_tell().
+ */
+
+#include "/inc/base.inc"
+#include "/inc/testarray.inc"
+
+#include "/sys/configuration.h"
+
+#define DEAF_FILE __DIR__".tmp-say-deaf.c"
+#define NUM_EACH  10
+
+mixed *heard = ({});
+object room;
+object *listeners, *deaf;
+
+void setup()
+{
+    configure_object(this_object(), OC_COMMANDS_ENABLED, 1);
+}
+
+void add_heard(object ob, mixed message)
+{
+    heard += ({ ({ ob, message }) });
+}
+
+void catch_tell(string str)
+{
+    blueprint()->add_heard(this_object(), str);
+}
+
+void catch_msg(mixed message, object origin)
+{
+    blueprint()->add_heard(this_object(), message);
+}
+
+void do_say(varargs mixed *args)
+{
+    apply(#'say, args);
+}
+
+/* Returns whether exactly <expected> heard <message> since the last call. */
+int check_heard(object *expected, mixed message)
+{
+    object *who = map(heard, (: $1[0] :));
+    int result = sizeof(who) == sizeof(expected)
+              && !sizeof(who - expected) && !sizeof(expected - who)
+              && !sizeof(filter(heard, (: $1[1] != $2 :), message));
+
+    heard = ({});
+    return result;
+}
+
+void run_test()
+{
+    int errors;
+
+    msg("\nRunning test for say() and tell_room():\n"
+          "---------------------------------------\n");
+
+    write_file(DEAF_FILE, "void setup() { configure_object(this_object(), 0, 1); }", 1);
+
+    room = clone_object(this_object());
+    listeners = allocate(NUM_EACH);
+    deaf = allocate(NUM_EACH);
+    foreach (int i: NUM_EACH)
+    {
+        deaf[i] = clone_object(DEAF_FILE);
+        deaf[i]->setup();
+        set_environment(deaf[i], room);
+        listeners[i] = clone_object(this_object());
+        listeners[i]->setup();
+        set_environment(listeners[i], room);
+    }
+
+    errors = run_array_without_callback(({
+        ({ "tell_room() to all", 0,
+           (:
+               tell_room(room, "hello");
+               return check_heard(listeners, "hello");
+           :)
+        }),
+        ({ "tell_room() with a short exclude list", 0,
+           (:
+               tell_room(room, "hello", listeners[0..2] + deaf[0..2]);
+               return check_heard(listeners[3..], "hello");
+           :)
+        }),
+        ({ "tell_room() with a long exclude list", 0,
+           (:
+               tell_room(room, "hello", listeners[5..] + deaf);
+               return check_heard(listeners[0..4], "hello");
+           :)
+        }),
+        ({ "tell_room() with an array", 0,
+           (:
+               tell_room(room, ({ "hello" }), listeners[0..0]);
+               return sizeof(heard) == NUM_EACH - 1
+                   && check_heard(listeners[1..], heard[0][1]);
+           :)
+        }),
+        ({ "say()", 0,
+           (:
+               listeners[0]->do_say("hi");
+               return check_heard(listeners[1..], "hi");
+           :)
+        }),
+        ({ "say() with an exclude object", 0,
+           (:
+               listeners[0]->do_say("hi", listeners[1]);
+               return check_heard(listeners[2..], "hi");
+           :)
+        }),
+        ({ "say() with an exclude list", 0,
+           (:
+               listeners[0]->do_say("hi", listeners[0..1] + deaf + listeners[7..]);
+               return check_heard(listeners[2..6], "hi");
+           :)
+        }),
+        ({ "say() with a destructed listener", 0,
+           (:
+               destruct(listeners[9]);
+               listeners[0]->do_say("hi");
+               return check_heard(listeners[1..8], "hi");
+           :)
+        }),
+    }));
+
+    rm(DEAF_FILE);
+    shutdown(errors && 1);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
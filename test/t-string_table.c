@@ -0,0 +1,80 @@
+#include "/inc/base.inc"
+#include "/sys/driver_info.h"
+
+#define NUM_STRINGS  50000
+#define NUM_MAPPINGS 10
+
+int check_histogram()
+{
+    int *histogram = driver_info(DI_STRING_TABLE_CHAIN_LENGTHS);
+    int chains, used;
+
+    foreach (int num: histogram)
+        chains += num;
+    used = chains - histogram[0];
+
+    return chains == driver_info(DI_NUM_STRING_TABLE_SLOTS)
+        && used == driver_info(DI_NUM_STRING_TABLE_SLOTS_USED);
+}
+
+void run_test()
+{
+    int errors;
+    int slots = driver_info(DI_NUM_STRING_TABLE_SLOTS);
+    mapping *m = map(allocate(NUM_MAPPINGS), (: ([]) :));
+
+    msg("\nRunning test for the string table:\n"
+          "----------------------------------\n");
+
+    msg("Running Test chain length histogram...");
+    if (check_histogram())
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    /* Mapping keys are tabled strings. */
+    for (int i = 0; i < NUM_STRINGS; i++)
+        m[i % NUM_MAPPINGS]["string table test " + i] = i;
+
+    msg("Running Test table growth...");
+    if (driver_info(DI_NUM_STRING_TABLE_SLOTS) > slots && check_histogram())
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Table did not grow.)\n");
+        errors++;
+    }
+
+    msg("Running Test lookup while growing...");
+    for (int i = 0; i < NUM_STRINGS; i++)
+        if (m[i % NUM_MAPPINGS]["string table test " + i] != i)
+        {
+            msg(" FAILURE! (String %d not found.)\n", i);
+            errors++;
+            break;
+        }
+    if (!errors)
+        msg(" Success.\n");
+
+    m = 0;
+
+    msg("Running Test removal...");
+    if (check_histogram())
+        msg(" Success.\n");
+    else
+    {
+        msg(" FAILURE! (Wrong result.)\n");
+        errors++;
+    }
+
+    shutdown(errors ? 1 : 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,195 @@
+/* Test of the superinstructions, which the compiler creates for
+ * frequent instruction sequences on local variables. Each test
+ * checks both the fast path for numbers and the fallback for
+ * other types.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/testarray.inc"
+#include "/inc/deep_eq.inc"
+
+#pragma no_warn_missing_return
+
+int ga = 7, gb = 3;
+
+mixed *tests = ({
+    ({ "local op local (numbers)", 0,
+        function int()
+        {
+            int a = 7, b = 3;
+            return a + b == 10 && a - b == 4 && a * b == 21
+                && a / b == 2 && a % b == 1 && (a & b) == 3
+                && (a | b) == 7 && (a ^ b) == 4 && a << b == 56
+                && a >> 1 == 3;
+        }
+    }),
+    ({ "local op local (other types)", 0,
+        function int()
+        {
+            string s = "ab", t = "cd";
+            float f = 1.5, g = 2.0;
+            int *x = ({ 1, 2 }), *y = ({ 2 });
+            return s + t == "abcd" && f * g == 3.0 && f - g == -0.5
+                && deep_eq(x - y, ({ 1 })) && deep_eq(x & y, ({ 2 }));
+        }
+    }),
+    ({ "local op local (error)", TF_ERROR,
+        function int()
+        {
+            int a = 1, b = 0;
+            return a / b;
+        }
+    }),
+    ({ "local compare local (numbers)", 0,
+        function int()
+        {
+            int a = 7, b = 3;
+            return (a < b) == 0 && (a <= b) == 0 && (a > b) == 1
+                && (a >= b) == 1 && (a == b) == 0 && (a != b) == 1
+                && (b < a) == 1 && (a <= a) == 1 && (a == a) == 1;
+        }
+    }),
+    ({ "local compare local (other types)", 0,
+        function int()
+        {
+            string s = "ab", t = "cd";
+            float f = 1.5;
+            int i = 2;
+            mixed m = ({ 1 }), n = ({ 1 });
+            return s < t && !(s > t) && s != t && f < i && i >= f
+                && !(m == n) && m != n;
+        }
+    }),
+    ({ "local compare literal", 0,
+        function int()
+        {
+            int a = 5;
+            float f = 0.5;
+            return a < 6 && !(a < 5) && a <= 5 && a > 0 && a >= 1
+                && a != 1 && !(a == 0) && f > 0 && f < 1 && a - 1 == 4
+                && a + 0 == 5;
+        }
+    }),
+    ({ "loop with local compare", 0,
+        function int()
+        {
+            int sum;
+            for (int i = 0; i < 100; i++)
+                sum += i;
+            for (int i = 100; i > 0; i--)
+                sum -= i;
+            return sum == -100;
+        }
+    }),
+    ({ "assignment to local in void context", 0,
+        function int()
+        {
+            mixed a = 1;
+            a = "abc";
+            a = ({ a });
+            return deep_eq(a, ({ "abc" }));
+        }
+    }),
+    ({ "assignment through reference", 0,
+        function int()
+        {
+            int a, b = 5;
+            int c = &a;
+            c = b;
+            c += b;
+            c++;
+            return a == 11 && c == 11;
+        }
+    }),
+    ({ "+= to local (other types)", 0,
+        function int()
+        {
+            string s = "ab";
+            float f = 1.5;
+            int *x = ({ 1 });
+            s += "cd";
+            f += 1;
+            x += ({ 2 });
+            return s == "abcd" && f == 2.5 && deep_eq(x, ({ 1, 2 }));
+        }
+    }),
+    ({ "++ on local (float)", 0,
+        function int()
+        {
+            float f = 1.5;
+            f++;
+            ++f;
+            f--;
+            return f == 2.5;
+        }
+    }),
+    ({ "++ on local (overflow)", TF_ERROR,
+        function int()
+        {
+            int a = __INT_MAX__;
+            a++;
+            return 0;
+        }
+    }),
+    ({ "-- on local (overflow)", TF_ERROR,
+        function int()
+        {
+            int a = __INT_MIN__;
+            a--;
+            return 0;
+        }
+    }),
+    ({ "++ on local (wrong type)", TF_ERROR,
+        function int()
+        {
+            mixed a = "abc";
+            a++;
+            return 0;
+        }
+    }),
+    ({ "++ on local used as value", 0,
+        function int()
+        {
+            int a = 1;
+            int b = a++;
+            int c = ++a;
+            return a == 3 && b == 1 && c == 3;
+        }
+    }),
+    ({ "Eval cost like the separate instructions", 0,
+        function int()
+        {
+            /* The same statements on global variables are not fused. */
+            int a = 7, b = 3, r;
+            int before, fused, plain;
+
+            before = get_eval_cost();
+            r = a < b; r = a + b; r = a == 3; a++; a--; a += b;
+            fused = before - get_eval_cost();
+
+            before = get_eval_cost();
+            r = ga < gb; r = ga + gb; r = ga == 3; ga++; ga--; ga += gb;
+            plain = before - get_eval_cost();
+
+            return fused == plain;
+        }
+    }),
+});
+
+void run_test()
+{
+    msg("\nRunning test suite for superinstructions:\n"
+          "-----------------------------------------\n");
+
+    run_array(tests,
+        (:
+            shutdown($1);
+            return 0;
+        :));
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
@@ -0,0 +1,245 @@
+/* Test of the swapper: programs and variables of objects are swapped
+ * out and read back in, while the writer thread may still be writing
+ * them into the swap file.
+ *
+ * The refcount check of the test driver swaps in all objects with
+ * swapped variables at the begin of every backend cycle, that is right
+ * after process_objects() queued their variables for writing. So the
+ * first pass swaps only the programs, which stay swapped until they
+ * are used, and the second pass checks for the reads instead.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/deep_eq.inc"
+#include "/inc/gc.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/driver_info.h"
+#include "/sys/object_info.h"
+
+#define NUM_OBJECTS 20
+#define DATA_SIZE   100000
+#define FILE(i)     (__DIR__".tmp-swap-" + (i) + ".c")
+
+object *obs = ({});
+mixed *expected = ({});
+int reads_before;
+
+int sum(int *arr)
+{
+    int result;
+
+    foreach (int num: arr)
+        result += num;
+    return result;
+}
+
+/* Return the number of blocks read so far, from the file or the queue. */
+int num_reads()
+{
+    return sum(driver_info(DI_SWAP_READ_LATENCY))
+         + driver_info(DI_NUM_SWAP_READS_QUEUED);
+}
+
+/* Return the values object <i> holds after setup(<i>, <pass>). */
+mixed *values(int i, int pass)
+{
+    mixed *arr = ({ i, ({ "pass " + pass }), ([ i: 1.5 * i ]) });
+
+    return ({ i, i + 0.5
+            , sprintf("%'-'*d", DATA_SIZE, i * 1000 + pass)
+            , arr, ([ "num": i, "arr": arr ]) });
+}
+
+void finish(int error)
+{
+    foreach (object ob: obs)
+        destruct(ob);
+    for (int i = 0; i < NUM_OBJECTS; i++)
+        rm(FILE(i));
+
+    shutdown(error);
+}
+
+void fail(string reason)
+{
+    msg(" FAILURE! (%s)\n", reason);
+    configure_driver(DC_SWAP_TIME, 0);
+    configure_driver(DC_SWAP_VAR_TIME, 0);
+    finish(1);
+}
+
+int check_statistics()
+{
+    int *writes = driver_info(DI_SWAP_WRITE_LATENCY);
+    int *reads = driver_info(DI_SWAP_READ_LATENCY);
+    int num_queued = driver_info(DI_NUM_SWAP_WRITES_QUEUED);
+    int size_queued = driver_info(DI_SIZE_SWAP_WRITES_QUEUED);
+
+    msg("Running Test swap statistics...");
+
+    if (sizeof(writes) != 20 || sizeof(reads) != 20)
+    {
+        fail("Wrong histogram size.");
+        return 0;
+    }
+
+    /* Every object wrote its program and its variables once. */
+    if (sum(writes) < 2 * NUM_OBJECTS)
+    {
+        fail("Writes not counted.");
+        return 0;
+    }
+
+    /* Every object read its program twice and its variables once. */
+    if (num_reads() < 3 * NUM_OBJECTS)
+    {
+        fail("Reads not counted.");
+        return 0;
+    }
+
+    if (num_queued < 0 || size_queued < 0 || !num_queued != !size_queued)
+    {
+        fail("Wrong queue statistics.");
+        return 0;
+    }
+
+    msg(" Success.\n");
+    return 1;
+}
+
+/* Use all objects and compare their contents. */
+int check_contents(int pass)
+{
+    msg("Running Test pass %d: contents...", pass);
+
+    for (int i = 0; i < NUM_OBJECTS; i++)
+    {
+        if (obs[i]->id() != "swapped object " + i)
+        {
+            fail("Wrong program in object " + i + ".");
+            return 0;
+        }
+
+        if (!deep_eq(obs[i]->query(), expected[i]))
+        {
+            fail("Wrong variables in object " + i + ".");
+            return 0;
+        }
+
+        if (object_info(obs[i], OI_SWAPPED))
+        {
+            fail("Object " + i + " still swapped.");
+            return 0;
+        }
+    }
+
+    msg(" Success.\n");
+    return 1;
+}
+
+/* Wait until the variables of all objects were swapped out and in. */
+void check_variables_swapped(int round)
+{
+    if (num_reads() - reads_before < NUM_OBJECTS
+     && sizeof(filter(obs, (: !object_info($1, OI_VAR_SWAPPED) :))))
+    {
+        if (round < 10)
+            call_out("check_variables_swapped", 1, round + 1);
+        else
+            fail("Variables not swapped.");
+        return;
+    }
+
+    configure_driver(DC_SWAP_TIME, 0);
+    configure_driver(DC_SWAP_VAR_TIME, 0);
+    msg(" Success.\n");
+
+    if (!check_contents(2) || !check_statistics())
+        return;
+
+    start_gc(#'finish);
+}
+
+/* Wait until the programs of all objects are swapped. */
+void check_programs_swapped(int round)
+{
+    if (sizeof(filter(obs, (: !object_info($1, OI_PROG_SWAPPED) :))))
+    {
+        if (round < 10)
+            call_out("check_programs_swapped", 1, round + 1);
+        else
+            fail("Programs not swapped.");
+        return;
+    }
+
+    msg(" Success.\n");
+
+    if (!check_contents(1))
+        return;
+
+    /* Change the variables and swap them as well. The programs
+     * are swapped into their old blocks again.
+     */
+    for (int i = 0; i < NUM_OBJECTS; i++)
+    {
+        expected[i] = values(i, 2);
+        obs[i]->setup(i, 2);
+    }
+
+    msg("Running Test pass 2: swapping variables...");
+    reads_before = num_reads();
+    configure_driver(DC_SWAP_VAR_TIME, 1);
+    call_out("check_variables_swapped", 1, 0);
+}
+
+void run_test()
+{
+    msg("\nRunning test for the swapper:\n"
+          "-----------------------------\n");
+
+    msg("Running Test swap time configuration...");
+
+    if (catch(configure_driver(DC_SWAP_TIME, -1); nolog) == 0)
+    {
+        fail("Negative swap time accepted.");
+        return;
+    }
+
+    configure_driver(DC_SWAP_TIME, 1);
+    if (driver_info(DC_SWAP_TIME) != 1 || driver_info(DC_SWAP_VAR_TIME) != 0)
+    {
+        fail("Swap time not set.");
+        return;
+    }
+
+    msg(" Success.\n");
+
+    /* Separate programs, as cloned programs aren't swapped. */
+    for (int i = 0; i < NUM_OBJECTS; i++)
+    {
+        object ob;
+
+        write_file(FILE(i),
+            "mixed *values;\n"
+            "string id() { return \"swapped object " + i + "\"; }\n"
+            "void setup(int i, int pass) {\n"
+            "    values = previous_object()->values(i, pass);\n"
+            "}\n"
+            "mixed *query() { return values; }\n", 1);
+
+        ob = load_object(FILE(i));
+        ob->setup(i, 1);
+        obs += ({ ob });
+        expected += ({ values(i, 1) });
+    }
+
+    msg("Running Test pass 1: swapping programs...");
+    call_out("check_programs_swapped", 1, 0);
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}
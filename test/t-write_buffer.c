@@ -0,0 +1,73 @@
+/* Test of the write buffers: more data than the socket takes at once
+ * is queued and arrives completely and in order.
+ */
+
+#include "/inc/base.inc"
+#include "/inc/client.inc"
+
+#include "/sys/configuration.h"
+#include "/sys/input_to.h"
+
+#define NUM_LINES 8000
+
+/* This is the MUD object */
+void run_server()
+{
+    string pad = sprintf("%'-'500s", "");
+
+    configure_interactive(this_object(), IC_MAX_WRITE_BUFFER_SIZE, -1);
+
+    foreach (int i: NUM_LINES)
+        write(sprintf("%d %s\n", i, pad));
+    write("END\n");
+}
+
+/* This is the object simulating a player. */
+void receive(string str, int nr)
+{
+    int num;
+
+    if (str == "END")
+    {
+        if (nr != NUM_LINES)
+        {
+            msg(" FAILURE! (Received %d of %d lines.)\n", nr, NUM_LINES);
+            shutdown(1);
+            return;
+        }
+
+        msg(" Success.\n");
+        shutdown(0);
+        return;
+    }
+
+    if (sscanf(str, "%d %s", num, str) != 2 || num != nr || sizeof(str) != 500)
+    {
+        msg(" FAILURE! (Line %d garbled.)\n", nr);
+        shutdown(1);
+        return;
+    }
+
+    input_to("receive", 0, nr + 1);
+}
+
+void run_client()
+{
+    call_out(#'shutdown, 60, 1); // If something goes wrong.
+    input_to("receive", 0, 0);
+}
+
+void run_test()
+{
+    msg("\nRunning test for the write buffers:\n"
+          "-----------------------------------\n");
+
+    msg("Running Test queued output...");
+    connect_self("run_server", "run_client");
+}
+
+string *epilog(int eflag)
+{
+    run_test();
+    return 0;
+}